@@ -26,6 +26,7 @@ bool editor::create()
     render_configuration render_config;
     render_config.set_base_render_pipeline(render_pipeline::deferred_pbr)
         .set_vsync(true)
+        .set_retained_static_meshes(true)
         .enable_render_step(mango::render_step::cubemap)
         .enable_render_step(mango::render_step::shadow_map)
         .enable_render_step(mango::render_step::fxaa);
@@ -206,6 +207,7 @@ void editor::update(float dt)
     cam_transform->position.x = cam_data->target.x + m_camera_radius * (sinf(m_camera_rotation.y) * cosf(m_camera_rotation.x));
     cam_transform->position.y = cam_data->target.y + m_camera_radius * (cosf(m_camera_rotation.y));
     cam_transform->position.z = cam_data->target.z + m_camera_radius * (sinf(m_camera_rotation.y) * sinf(m_camera_rotation.x));
+    cam_transform->changed    = true;
 }
 
 void editor::destroy() {}
\ No newline at end of file
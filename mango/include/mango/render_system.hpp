@@ -48,6 +48,10 @@ namespace mango
         render_configuration()
             : m_base_pipeline(render_pipeline::default_pbr)
             , m_vsync(true)
+            , m_retained_static_meshes(false)
+            , m_multi_draw_indirect(false)
+            , m_bindless_textures(false)
+            , m_occlusion_culling(false)
         {
             std::memset(m_render_steps, 0, render_step::number_of_step_types * sizeof(bool));
         }
@@ -58,6 +62,10 @@ namespace mango
         render_configuration(render_pipeline base_render_pipeline, bool vsync)
             : m_base_pipeline(base_render_pipeline)
             , m_vsync(vsync)
+            , m_retained_static_meshes(false)
+            , m_multi_draw_indirect(false)
+            , m_bindless_textures(false)
+            , m_occlusion_culling(false)
         {
             std::memset(m_render_steps, 0, render_step::number_of_step_types * sizeof(bool));
         }
@@ -91,6 +99,76 @@ namespace mango
             return *this;
         }
 
+        //! \brief Sets or changes the setting for retained rendering of static meshes in the \a render_configuration.
+        //! \details If enabled, the commands of opaque meshes are kept over multiple frames and only get patched or recorded again, when the mesh changes.
+        //! \param[in] retained_static_meshes The configurated setting for the \a render_system. Spezifies if retained rendering should be enabled or disabled.
+        //! \return A reference to the modified \a render_configuration.
+        inline render_configuration& set_retained_static_meshes(bool retained_static_meshes)
+        {
+            m_retained_static_meshes = retained_static_meshes;
+            return *this;
+        }
+
+        //! \brief Retrieves and returns the setting for retained rendering of static meshes of the \a render_configuration.
+        //! \return The current configurated retained rendering setting.
+        inline bool is_retained_static_meshes_enabled() const
+        {
+            return m_retained_static_meshes;
+        }
+
+        //! \brief Sets or changes the setting for multi draw indirect submission of the gbuffer pass in the \a render_configuration.
+        //! \details If enabled, opaque indexed draws sharing vertex array and textures are packed into an indirect buffer and issued with one multi draw call.
+        //! \param[in] multi_draw_indirect The configurated setting for the \a render_system. Spezifies if multi draw indirect submission should be enabled or disabled.
+        //! \return A reference to the modified \a render_configuration.
+        inline render_configuration& set_multi_draw_indirect(bool multi_draw_indirect)
+        {
+            m_multi_draw_indirect = multi_draw_indirect;
+            return *this;
+        }
+
+        //! \brief Retrieves and returns the setting for multi draw indirect submission of the \a render_configuration.
+        //! \return The current configurated multi draw indirect setting.
+        inline bool is_multi_draw_indirect_enabled() const
+        {
+            return m_multi_draw_indirect;
+        }
+
+        //! \brief Sets or changes the setting for bindless material textures in the \a render_configuration.
+        //! \details If enabled, the multi draw indirect gbuffer pass reads the material textures by handle from the per draw data instead of binding them.
+        //! Only has an effect with multi draw indirect submission enabled.
+        //! \param[in] bindless_textures The configurated setting for the \a render_system. Spezifies if bindless material textures should be enabled or disabled.
+        //! \return A reference to the modified \a render_configuration.
+        inline render_configuration& set_bindless_textures(bool bindless_textures)
+        {
+            m_bindless_textures = bindless_textures;
+            return *this;
+        }
+
+        //! \brief Retrieves and returns the setting for bindless material textures of the \a render_configuration.
+        //! \return The current configurated bindless material textures setting.
+        inline bool is_bindless_textures_enabled() const
+        {
+            return m_bindless_textures;
+        }
+
+        //! \brief Sets or changes the setting for hierarchical z occlusion culling in the \a render_configuration.
+        //! \details If enabled, the bounds of the drawn meshes are tested against a depth pyramid of the gbuffer on the gpu.
+        //! Meshes found occluded are skipped in the next frame.
+        //! \param[in] occlusion_culling The configurated setting for the \a render_system. Spezifies if occlusion culling should be enabled or disabled.
+        //! \return A reference to the modified \a render_configuration.
+        inline render_configuration& set_occlusion_culling(bool occlusion_culling)
+        {
+            m_occlusion_culling = occlusion_culling;
+            return *this;
+        }
+
+        //! \brief Retrieves and returns the setting for hierarchical z occlusion culling of the \a render_configuration.
+        //! \return The current configurated occlusion culling setting.
+        inline bool is_occlusion_culling_enabled() const
+        {
+            return m_occlusion_culling;
+        }
+
         //! \brief Retrieves and returns the setting for vertical synchronization of the \a render_configuration.
         //! \return The current configurated vertical synchronization setting.
         inline bool is_vsync_enabled() const
@@ -119,6 +197,14 @@ namespace mango
         render_pipeline m_base_pipeline;
         //! \brief The configurated setting of the \a render_configuration to enable or disable vertical synchronization.
         bool m_vsync;
+        //! \brief The configurated setting of the \a render_configuration to enable or disable retained rendering of static meshes.
+        bool m_retained_static_meshes;
+        //! \brief The configurated setting of the \a render_configuration to enable or disable multi draw indirect submission of the gbuffer pass.
+        bool m_multi_draw_indirect;
+        //! \brief The configurated setting of the \a render_configuration to enable or disable bindless material textures.
+        bool m_bindless_textures;
+        //! \brief The configurated setting of the \a render_configuration to enable or disable hierarchical z occlusion culling.
+        bool m_occlusion_culling;
         //! \brief The configurated additional \ render_steps of the \a render_configuration to enable or disable vertical synchronization.
         bool m_render_steps[render_step::number_of_step_types];
     };
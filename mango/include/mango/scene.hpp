@@ -12,20 +12,26 @@
 #include <map>
 #include <queue>
 
-namespace tinygltf
-{
-    class Model;
-    class Node;
-    struct Mesh;
-    struct Primitive;
-    struct Camera;
-} // namespace tinygltf
-
 namespace mango
 {
     class context_impl;
     class shader_program;
     class buffer;
+    class bounding_volume_hierarchy;
+    class cooked_model;
+    struct async_model_load;
+    struct cooked_camera;
+    struct model_gpu_resources;
+
+    //! \brief The state of a model loaded with scene::create_entities_from_model_async().
+    enum class model_load_state : uint8
+    {
+        loading,   //!< The model file is parsed in the background.
+        uploading, //!< The model data is uploaded to the gpu over multiple frames.
+        finished,  //!< The entities of the model are created.
+        failed     //!< The model could not be loaded.
+    };
+
     //! \brief The \a scene of mango.
     //! \details A collection of entities, components and systems. Responsible for handling content in mango.
     class scene
@@ -33,7 +39,9 @@ namespace mango
       public:
         //! \brief Constructs a new \a scene with a \a name.
         //! \param[in] name The name of the new \a scene.
-        scene(const string& name);
+        //! \param[in] pool_chunk_size The number of components the component pools allocate memory for at once. Has to be a power of two.
+        //! Large scenes should use larger chunks, small scenes smaller ones.
+        scene(const string& name, int32 pool_chunk_size = default_pool_chunk_size);
         ~scene();
 
         //! \brief Creates an empty entity with no components.
@@ -64,6 +72,19 @@ namespace mango
         //! \return The root entity of the model.
         entity create_entities_from_model(const string& path, entity gltf_root = invalid_entity);
 
+        //! \brief Creates entities from a model loaded from a gltf file in the background.
+        //! \details The gltf file is parsed and the images are decoded on a worker thread. Afterwards the data is uploaded to the gpu
+        //! during the next updates, limited by a budget per frame. The entities are created after all resources are uploaded.
+        //! \param[in] path The path to the gltf model to load.
+        //! \param[in] gltf_root If there is already a entity created to work as root it should be passed here.
+        //! \return The root entity of the model. It is created immediately and used as handle for get_model_load_state().
+        entity create_entities_from_model_async(const string& path, entity gltf_root = invalid_entity);
+
+        //! \brief Retrieves the state of a model loaded with create_entities_from_model_async().
+        //! \param[in] gltf_root The root entity of the model.
+        //! \return The \a model_load_state of the model. Failed models lose their \a model_component.
+        model_load_state get_model_load_state(entity gltf_root) const;
+
         //! \brief Creates an environment entity.
         //! \details An entity with \a environment_component. ATTENTION: This creates the \a light_data and fills it. Do not recreate it.
         //! The environment texture is preprocessed, prefiltered and can be rendered as a cube. This is done with a \a pipeline_step.
@@ -175,6 +196,7 @@ namespace mango
             case 1:
                 return (comp*)&m_transformations.create_component_for(e);
             case 2:
+                m_hierarchy_changes.push_back(e);
                 return (comp*)&m_nodes.create_component_for(e);
             case 3:
                 return (comp*)&m_mesh_primitives.create_component_for(e);
@@ -212,6 +234,7 @@ namespace mango
                 return;
             case 2:
                 m_nodes.remove_component_from(e);
+                m_hierarchy_changes.push_back(e);
                 return;
             case 3:
                 m_mesh_primitives.remove_component_from(e);
@@ -279,6 +302,12 @@ namespace mango
             m_active.camera = e;
         }
 
+        //! \brief Finds the closest mesh primitive hit by a ray. The world bounds of the primitives are tested, not their triangles.
+        //! \param[in] origin The origin of the ray in world space.
+        //! \param[in] direction The direction of the ray in world space.
+        //! \return The \a entity of the closest mesh primitive or invalid_entity if nothing is hit.
+        entity pick(const glm::vec3& origin, const glm::vec3& direction);
+
         //! \brief Retrieves the \a scene root \a entity.
         //! \return The \a scene root \a entity.
         inline entity get_root()
@@ -310,7 +339,23 @@ namespace mango
         //! \return True if \a entity is still alive, else False.
         inline bool is_entity_alive(entity e)
         {
-            return std::find(m_free_entities.begin(), m_free_entities.end(), e) == m_free_entities.end(); // TODO Paul: This is not correct, need entity versions.
+            return e != invalid_entity && e < m_next_entity &&
+                   std::find(m_free_entities.begin(), m_free_entities.end(), e) == m_free_entities.end(); // TODO Paul: This is not correct, need entity versions.
+        }
+
+        //! \brief Retrieves information about the memory used by the component pools.
+        //! \return A \a component_pool_memory_info for each component pool of the \a scene.
+        std::vector<component_pool_memory_info> get_component_pool_memory_info() const;
+
+        //! \brief Releases the memory of all component pools not used by any component.
+        void shrink_component_pools();
+
+        //! \brief Returns the number of transformation matrices recomputed in the last update.
+        //! \details Local and world matrices are only recomputed for changed \a transform_components and their children.
+        //! \return The number of recomputed matrices.
+        inline int32 get_recomputed_transformations() const
+        {
+            return m_recomputed_transformations;
         }
 
       private:
@@ -324,53 +369,84 @@ namespace mango
         //! \details Retrieves all relevant \a render_commands from different components and submits them to the \a render_system.
         void render();
 
-        //! \brief Builds one or more entities that describe an entire model with data loaded by tinygltf.
-        //! \details Internally called by create_entities_from_model(...).
+        //! \brief Prepares the root entity of a model with a \a model_component and the tag.
+        //! \param[in] path The path to the gltf model.
+        //! \param[in] gltf_root The entity to use as root or invalid_entity to create a new one.
+        //! \return The root entity of the model.
+        entity create_model_root(const string& path, entity gltf_root);
+
+        //! \brief Builds all entities of a \a cooked_model, after all gpu resources are created.
+        //! \details Internally called by create_entities_from_model(...) and after asynchronous loads.
+        //! \param[in] m The \a cooked_model.
+        //! \param[in] gltf_root The root entity of the model.
+        //! \param[in] resources The \a model_gpu_resources of the model.
+        //! \return True on success, else false.
+        bool build_model(const cooked_model& m, entity gltf_root, const model_gpu_resources& resources);
+
+        //! \brief Advances the models loaded asynchronously.
+        //! \details Starts the uploads of loaded models, executes uploads up to the budget per frame and builds the finished models.
+        void update_model_loads();
+
+        //! \brief Builds one or more entities that describe an entire model with data of a \a cooked_model.
+        //! \details Internally called by build_model(...).
         //! This also creates the hierarchy incl. \a transform_components and \a node_components.
-        //! \param[in] m The model loaded by tinygltf.
-        //! \param[in] n The node loaded by tinygltf.
+        //! \param[in] m The \a cooked_model.
+        //! \param[in] node_index The index of the \a cooked_node.
         //! \param[in] parent_world The parents world transformation matrix.
-        //! \param[in] buffer_map The mapped buffers of the model.
+        //! \param[in] resources The \a model_gpu_resources of the model.
         //! \return The root node of the function call.
-        entity build_model_node(tinygltf::Model& m, tinygltf::Node& n, const glm::mat4& parent_world, const std::map<int, shared_ptr<buffer>>& buffer_map);
+        entity build_model_node(const cooked_model& m, int32 node_index, const glm::mat4& parent_world, const model_gpu_resources& resources);
 
-        //! \brief Attaches a \a mesh_component to an \a entity with data loaded by tinygltf.
-        //! \details Internally called by create_entities_from_model(...).
+        //! \brief Attaches a \a mesh_component to an \a entity with data of a \a cooked_model.
+        //! \details Internally called by build_model(...).
         //! \param[in] node The entity that the \a mesh_component should be attached to.
-        //! \param[in] m The model loaded by tinygltf.
-        //! \param[in] mesh The mesh loaded by tinygltf.
-        //! \param[in] buffer_map The mapped buffers of the model.
-        void build_model_mesh(entity node, tinygltf::Model& m, tinygltf::Mesh& mesh, const std::map<int, shared_ptr<buffer>>& buffer_map);
+        //! \param[in] m The \a cooked_model.
+        //! \param[in] mesh_index The index of the \a cooked_mesh.
+        //! \param[in] resources The \a model_gpu_resources of the model.
+        void build_model_mesh(entity node, const cooked_model& m, int32 mesh_index, const model_gpu_resources& resources);
 
-        //! \brief Attaches a \a camera_component to an \a entity with data loaded by tinygltf.
-        //! \details Internally called by create_entities_from_model(...).
+        //! \brief Attaches a \a camera_component to an \a entity with data of a \a cooked_model.
+        //! \details Internally called by build_model(...).
         //! \param[in] node The entity that the \a mesh_component should be attached to.
-        //! \param[in] camera The camera loaded by tinygltf.
-        void build_model_camera(entity node, tinygltf::Camera& camera);
+        //! \param[in] camera The \a cooked_camera.
+        void build_model_camera(entity node, const cooked_camera& camera);
 
         //! \brief Loads a \a material and stores it in the component.
-        //! \details Loads all supported component values and textures if they exist.
+        //! \details Loads all supported component values and links the uploaded textures if they exist.
         //! \param[out] material The component to store the material in.
-        //! \param[in] primitive The tinygltf primitive the material is linked to.
-        //! \param[in] m The model loaded by tinygltf.
-        void load_material(material_component& material, const tinygltf::Primitive& primitive, tinygltf::Model& m);
+        //! \param[in] m The \a cooked_model.
+        //! \param[in] material_index The index of the \a cooked_material.
+        //! \param[in] resources The \a model_gpu_resources of the model.
+        void load_material(material_component& material, const cooked_model& m, int32 material_index, const model_gpu_resources& resources);
 
         //! \brief Detach an \a entity from the parent and the children.
         //! \details Removes the \a node_component.
         //! \param[in] node The \a entity to delete the node from.
         void delete_node(entity node);
 
+        //! \brief Brings the \a bounding_volume_hierarchy over the mesh primitives up to date.
+        //! \details Moved primitives are refitted. The hierarchy is built again if primitives were added or removed or refitting degraded it too much.
+        void update_mesh_bvh();
+
         friend class context_impl; // TODO Paul: Could this be avoided?
         //! \brief Mangos internal context for shared usage in all \a render_systems.
         shared_ptr<context_impl> m_shared_context;
 
-        //! \brief All free entity ids.
+        //! \brief All free entity ids, that were used before.
         std::deque<uint32> m_free_entities;
+        //! \brief The next entity id never used before.
+        entity m_next_entity;
+        //! \brief The number of transformation matrices recomputed in the last update.
+        int32 m_recomputed_transformations;
+        //! \brief The entities attached, detached, added to or removed from the hierarchy since the flat hierarchy was updated.
+        std::vector<entity> m_hierarchy_changes;
 
         //! \brief All \a tag_components.
         scene_component_pool<tag_component> m_tags;
         //! \brief All \a node_components.
         scene_component_pool<node_component> m_nodes;
+        //! \brief The flat hierarchy of all \a node_components. The changed subtrees are spliced in in update().
+        flat_hierarchy m_hierarchy;
         //! \brief All \a transform_components.
         scene_component_pool<transform_component> m_transformations;
         //! \brief All \a model_components.
@@ -387,6 +463,12 @@ namespace mango
         scene_component_pool<atmosphere_light_component> m_atmosphere_lights;
         //! \brief All \a skylight_component.
         scene_component_pool<skylight_component> m_skylights;
+        //! \brief The \a bounding_volume_hierarchy over the world bounds of all mesh primitives. The item indices are the indices in m_mesh_primitives.
+        unique_ptr<bounding_volume_hierarchy> m_mesh_bvh;
+        //! \brief The entities of the items in m_mesh_bvh, to detect changes of m_mesh_primitives.
+        std::vector<entity> m_mesh_bvh_entities;
+        //! \brief The models loaded asynchronously, that are not finished yet.
+        std::vector<unique_ptr<async_model_load>> m_model_loads;
         //! \brief The root entity of the ecs.
         entity m_root_entity;
         //! \brief The current root entity of the scene.
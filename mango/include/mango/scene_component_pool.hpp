@@ -7,25 +7,44 @@
 #ifndef MANGO_SCENE_COMPONENT_MANAGER_HPP
 #define MANGO_SCENE_COMPONENT_MANAGER_HPP
 
-#include <array>
+#include <algorithm>
 #include <mango/assert.hpp>
 #include <mango/scene_ecs.hpp>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 
 namespace mango
 {
     class context_impl;
 
+    //! \brief Memory usage information of a \a scene_component_pool.
+    struct component_pool_memory_info
+    {
+        const char* component_name; //!< The name of the component type.
+        int32 size;                 //!< The number of components in the pool.
+        int32 capacity;             //!< The number of components memory is allocated for.
+        int64 allocated_bytes;      //!< The number of bytes allocated for components, entities and the lookup.
+    };
+
     //! \brief Manages entities and components for a specific component.
     //! \brief Does all the mapping, provides a quick way to iterate and does provide functionality to get components for entities, entities for components etc.
+    //! \details The components are stored densely, the mapping from \a entities to indices is a paged sparse array.
+    //! Pages are only allocated for ranges of \a entities that have components, so a lookup is just two array accesses without any hashing.
+    //! The dense storage grows and shrinks in chunks. Components do not move when chunks are added, but they do when other components are removed.
     template <typename component>
     class scene_component_pool
     {
       public:
-        scene_component_pool()
+        //! \brief Constructs an empty \a scene_component_pool.
+        //! \param[in] chunk_size The number of components memory is allocated for at once. Has to be a power of two.
+        scene_component_pool(int32 chunk_size = default_pool_chunk_size)
             : end(0)
+            , m_capacity(0)
+            , m_chunk_bits(0)
         {
-            m_entities.fill(invalid_entity);
+            MANGO_ASSERT(chunk_size > 0 && (chunk_size & (chunk_size - 1)) == 0, "Chunk size has to be a power of two!");
+            while ((1 << m_chunk_bits) < chunk_size)
+                ++m_chunk_bits;
             assert_state();
         }
 
@@ -34,7 +53,7 @@ namespace mango
         //! \return True if the \a component exists, else false.
         bool contains(entity e) const
         {
-            return m_lookup.find(e) != m_lookup.end();
+            return lookup(e) != invalid_index;
         }
 
         //! \brief Creates a \a component for a specific \a entity.
@@ -44,17 +63,19 @@ namespace mango
         {
             MANGO_ASSERT(e != invalid_entity, "Entity is not valid!");
             assert_state();
-            auto it = m_lookup.find(e);
-            if (it != m_lookup.end())
+            const int32 index = lookup(e);
+            if (index != invalid_index)
             {
                 MANGO_LOG_DEBUG("Entity does already have a component of type {0}!", type_name<component>::get());
-                return m_components.at(it->second);
+                return dense_component(index);
             }
-            m_lookup.insert({ e, end });
-            m_components.at(end) = component(); // reset component
-            m_entities.at(end)   = e;
+            if (end == m_capacity)
+                add_chunk();
+            set_lookup(e, end);
+            dense_component(end) = component(); // reset component
+            dense_entity(end)    = e;
 
-            return m_components.at(end++);
+            return dense_component(end++);
         }
 
         //! \brief Removes a \a component from a specific \a entity.
@@ -62,26 +83,25 @@ namespace mango
         void remove_component_from(entity e)
         {
             assert_state();
-            auto it = m_lookup.find(e);
-            if (it == m_lookup.end())
+            const int32 index = lookup(e);
+            if (index == invalid_index)
             {
                 MANGO_LOG_DEBUG("Entity does not have a component of type {0}!", type_name<component>::get());
                 return;
             }
-            const int32 index    = it->second;
-            const entity indexed = m_entities.at(index);
-            MANGO_LOG_DEBUG("e == indexed is {0}", e == indexed);
+            MANGO_ASSERT(dense_entity(index) == e, "Sparse lookup is not consistent!");
 
             if (index < end - 1)
             {
-                m_components.at(index)            = m_components.at(end - 1);
-                m_entities.at(index)              = m_entities.at(end - 1);
-                m_lookup.at(m_entities.at(index)) = index;
+                dense_component(index) = dense_component(end - 1);
+                dense_entity(index)    = dense_entity(end - 1);
+                set_lookup(dense_entity(index), index);
             }
 
-            m_components.at(end - 1) = component(); // reinitialize default
-            m_entities.at(end--)     = invalid_entity;
-            m_lookup.erase(indexed);
+            dense_component(end - 1) = component(); // reinitialize default
+            dense_entity(--end)      = invalid_entity;
+            set_lookup(e, invalid_index);
+            release_spare_chunks();
         }
 
         //! \brief Removes a \a component from a specific \a entity but keeps the list sorted.
@@ -90,29 +110,28 @@ namespace mango
         void sort_remove_component_from(entity e)
         {
             assert_state();
-            auto it = m_lookup.find(e);
-            if (it == m_lookup.end())
+            const int32 index = lookup(e);
+            if (index == invalid_index)
             {
                 MANGO_LOG_DEBUG("Entity does not have a component of type {0}!", type_name<component>::get());
                 return;
             }
-            const int32 index    = it->second;
-            const entity indexed = m_entities.at(index);
-            MANGO_LOG_DEBUG("e == indexed is {0}", e == indexed);
+            MANGO_ASSERT(dense_entity(index) == e, "Sparse lookup is not consistent!");
 
             if (index < end - 1)
             {
                 for (int32 i = index + 1; i < end; ++i)
                 {
-                    m_components.at(i - 1)            = m_components.at(i);
-                    m_entities.at(i - 1)              = m_entities.at(i);
-                    m_lookup.at(m_entities.at(i - 1)) = i - 1;
+                    dense_component(i - 1) = dense_component(i);
+                    dense_entity(i - 1)    = dense_entity(i);
+                    set_lookup(dense_entity(i - 1), i - 1);
                 }
             }
-            m_components.at(end - 1) = component(); // reinitialize default
+            dense_component(end - 1) = component(); // reinitialize default
 
-            m_entities.at(end--) = invalid_entity;
-            m_lookup.erase(indexed);
+            dense_entity(--end) = invalid_entity;
+            set_lookup(e, invalid_index);
+            release_spare_chunks();
         }
 
         //! \brief Retrieves the \a component of a specific \a entity.
@@ -122,8 +141,8 @@ namespace mango
         component* get_component_for_entity(entity e, bool query = false)
         {
             assert_state();
-            auto it = m_lookup.find(e);
-            if (it == m_lookup.end())
+            const int32 index = lookup(e);
+            if (index == invalid_index)
             {
                 if (!query)
                 {
@@ -132,7 +151,15 @@ namespace mango
                 return nullptr;
             }
 
-            return &(m_components.at(it->second));
+            return &dense_component(index);
+        }
+
+        //! \brief Retrieves the index of the \a component of a specific \a entity.
+        //! \param[in] e The \a entity to get the index for.
+        //! \return The index in the array or -1 if the \a entity does not have a \a component.
+        inline int32 index_of(entity e) const
+        {
+            return lookup(e);
         }
 
         //! \brief Retrieves a \a component from the array via an index.
@@ -142,7 +169,7 @@ namespace mango
         {
             assert_state();
             MANGO_ASSERT(index < end, "Index not valid!");
-            return m_components.at(index);
+            return dense_component(index);
         }
 
         //! \brief Retrieves a \a component from the array via an index.
@@ -152,7 +179,7 @@ namespace mango
         {
             assert_state();
             MANGO_ASSERT(index < end, "Index not valid!");
-            return m_components.at(index);
+            return dense_component(index);
         }
 
         //! \brief Retrieves a \a entity from the array via an index.
@@ -162,35 +189,81 @@ namespace mango
         {
             assert_state();
             MANGO_ASSERT(index < end, "Index not valid!");
-            return m_entities.at(index);
+            return dense_entity(index);
         }
 
         //! \brief Retrieves the array size.
-        //! \details This means the size of the internal array used by the \a scene_component_pool.
+        //! \details This means the number of \a components in the \a scene_component_pool.
         //! \return The size of the array.
         inline ptr_size size() const
         {
             return static_cast<ptr_size>(end);
         }
 
+        //! \brief Retrieves the number of \a components memory is allocated for.
+        //! \return The capacity of the \a scene_component_pool.
+        inline int32 capacity() const
+        {
+            return m_capacity;
+        }
+
+        //! \brief Releases all chunks and lookup pages not used by any \a component.
+        void shrink_to_fit()
+        {
+            assert_state();
+            const int32 chunk_size = 1 << m_chunk_bits;
+            while (m_capacity - chunk_size >= end)
+                remove_chunk();
+            m_component_chunks.shrink_to_fit();
+            m_entity_chunks.shrink_to_fit();
+
+            for (auto& page : m_sparse_pages)
+            {
+                if (page && std::all_of(page.get(), page.get() + sparse_page_size, [](int32 i) { return i == invalid_index; }))
+                    page.reset();
+            }
+            while (!m_sparse_pages.empty() && !m_sparse_pages.back())
+                m_sparse_pages.pop_back();
+            m_sparse_pages.shrink_to_fit();
+        }
+
+        //! \brief Retrieves information about the memory used by the \a scene_component_pool.
+        //! \return The \a component_pool_memory_info of the \a scene_component_pool.
+        component_pool_memory_info get_memory_info() const
+        {
+            component_pool_memory_info info;
+            info.component_name  = type_name<component>::get();
+            info.size            = end;
+            info.capacity        = m_capacity;
+            info.allocated_bytes = static_cast<int64>(m_capacity) * static_cast<int64>(sizeof(component) + sizeof(entity));
+            info.allocated_bytes += static_cast<int64>(m_component_chunks.capacity() + m_entity_chunks.capacity() + m_sparse_pages.capacity()) * static_cast<int64>(sizeof(void*));
+            for (const auto& page : m_sparse_pages)
+            {
+                if (page)
+                    info.allocated_bytes += static_cast<int64>(sparse_page_size * sizeof(int32));
+            }
+            return info;
+        }
+
         //! \brief Iterates over each \a component and call \a lambda on it.
         //! \param[in] lambda The lambda function to call on each \a component.
         //! \param[in] backwards Specifies if the iteration should be from the last to the first element, or from the first to the last.
-        inline void for_each(std::function<void(component& c, int32& index)> lambda, bool backwards)
+        template <typename function>
+        inline void for_each(function lambda, bool backwards)
         {
             assert_state();
             if (backwards)
             {
                 for (int32 i = static_cast<int32>(size()) - 1; i >= 0; --i)
                 {
-                    lambda(m_components.at(i), i);
+                    lambda(dense_component(i), i);
                 }
             }
             else
             {
                 for (int32 i = 0; i < static_cast<int32>(size()); ++i)
                 {
-                    lambda(m_components.at(i), i);
+                    lambda(dense_component(i), i);
                 }
             }
         }
@@ -208,41 +281,201 @@ namespace mango
             if (from == to)
                 return;
 
-            component c = std::move(m_components.at(from));
-            entity e    = m_entities.at(from);
+            component c = std::move(dense_component(from));
+            entity e    = dense_entity(from);
 
             const int32 d = from < to ? 1 : -1;
             for (int32 i = from; i != to; i += d)
             {
-                const int32 next              = i + d;
-                m_components.at(i)            = std::move(m_components.at(next));
-                m_entities.at(i)              = m_entities.at(next);
-                m_lookup.at(m_entities.at(i)) = i;
+                const int32 next   = i + d;
+                dense_component(i) = std::move(dense_component(next));
+                dense_entity(i)    = dense_entity(next);
+                set_lookup(dense_entity(i), i);
             }
 
-            m_components.at(to) = std::move(c);
-            m_entities.at(to)   = e;
-            m_lookup.at(e)      = to;
+            dense_component(to) = std::move(c);
+            dense_entity(to)    = e;
+            set_lookup(e, to);
         }
 
       private:
-        //! \brief The list of \a components.
-        std::array<component, max_entities + 1> m_components;
-        //! \brief The list of \a entities.
-        std::array<entity, max_entities + 1> m_entities;
+        //! \brief The chunks of the list of \a components.
+        std::vector<std::unique_ptr<component[]>> m_component_chunks;
+        //! \brief The chunks of the list of \a entities.
+        std::vector<std::unique_ptr<entity[]>> m_entity_chunks;
         //! \brief The current number of entries. Also the next free index.
         int32 end;
-        //! \brief A mapping from \a entities to indices.
-        std::unordered_map<entity, int32> m_lookup;
+        //! \brief The number of entries memory is allocated for.
+        int32 m_capacity;
+        //! \brief The number of bits of an index addressing the entry inside a chunk.
+        int32 m_chunk_bits;
+
+        //! \brief The index stored in the sparse pages for \a entities without a \a component.
+        static const int32 invalid_index = -1;
+        //! \brief The number of bits of an \a entity addressing the index inside a sparse page.
+        static const uint32 sparse_page_bits = 10;
+        //! \brief The number of \a entities mapped by one sparse page.
+        static const uint32 sparse_page_size = 1 << sparse_page_bits;
+        //! \brief The pages of the mapping from \a entities to indices. Not allocated pages do not map any \a entity.
+        std::vector<std::unique_ptr<int32[]>> m_sparse_pages;
+
+        //! \brief Retrieves the \a component stored at an index.
+        //! \param[in] index The index in the dense storage. Has to be smaller than the capacity.
+        //! \return A reference to the \a component at \a index.
+        inline component& dense_component(int32 index)
+        {
+            return m_component_chunks[index >> m_chunk_bits][index & ((1 << m_chunk_bits) - 1)];
+        }
+
+        //! \brief Retrieves the \a entity stored at an index.
+        //! \param[in] index The index in the dense storage. Has to be smaller than the capacity.
+        //! \return A reference to the \a entity at \a index.
+        inline entity& dense_entity(int32 index)
+        {
+            return m_entity_chunks[index >> m_chunk_bits][index & ((1 << m_chunk_bits) - 1)];
+        }
+
+        //! \brief Allocates one more chunk of \a components and \a entities.
+        void add_chunk()
+        {
+            const int32 chunk_size = 1 << m_chunk_bits;
+            m_component_chunks.push_back(std::unique_ptr<component[]>(new component[chunk_size]));
+            m_entity_chunks.push_back(std::unique_ptr<entity[]>(new entity[chunk_size]));
+            std::fill(m_entity_chunks.back().get(), m_entity_chunks.back().get() + chunk_size, invalid_entity);
+            m_capacity += chunk_size;
+        }
+
+        //! \brief Releases the last chunk of \a components and \a entities.
+        void remove_chunk()
+        {
+            m_component_chunks.pop_back();
+            m_entity_chunks.pop_back();
+            m_capacity -= 1 << m_chunk_bits;
+        }
+
+        //! \brief Releases chunks at the end, keeps one spare chunk to not reallocate when adding and removing alternately.
+        void release_spare_chunks()
+        {
+            const int32 chunk_size = 1 << m_chunk_bits;
+            while (m_capacity - 2 * chunk_size >= end)
+                remove_chunk();
+        }
+
+        //! \brief Retrieves the index of the \a component of an \a entity.
+        //! \param[in] e The \a entity to get the index for.
+        //! \return The index in the \a component array or invalid_index if the \a entity does not have a \a component.
+        inline int32 lookup(entity e) const
+        {
+            const uint32 page = e >> sparse_page_bits;
+            if (page >= m_sparse_pages.size() || !m_sparse_pages[page])
+                return invalid_index;
+            return m_sparse_pages[page][e & (sparse_page_size - 1)];
+        }
+
+        //! \brief Sets the index of the \a component of an \a entity, allocates the sparse page if necessary.
+        //! \param[in] e The \a entity to set the index for.
+        //! \param[in] index The index in the \a component array or invalid_index to remove the mapping.
+        inline void set_lookup(entity e, int32 index)
+        {
+            const uint32 page = e >> sparse_page_bits;
+            if (page >= m_sparse_pages.size())
+                m_sparse_pages.resize(page + 1);
+            if (!m_sparse_pages[page])
+            {
+                m_sparse_pages[page] = std::unique_ptr<int32[]>(new int32[sparse_page_size]);
+                std::fill(m_sparse_pages[page].get(), m_sparse_pages[page].get() + sparse_page_size, static_cast<int32>(invalid_index));
+            }
+            m_sparse_pages[page][e & (sparse_page_size - 1)] = index;
+        }
 
         //! \brief Asserts the internal state of the \a scene_component_pool.
         inline void assert_state()
         {
             MANGO_ASSERT(end >= 0, "Negative number is invalid for end!");
-            MANGO_ASSERT(end <= static_cast<int32>(max_entities), "Too many entities in the system!");
-            MANGO_ASSERT(static_cast<int32>(m_lookup.size()) == end, "Number of lookups in table != Number of entities!");
+            MANGO_ASSERT(end <= m_capacity, "More entities than allocated in the pool!");
         }
     };
+
+    //! \brief Iterates over all \a entities having a component in both \a scene_component_pools.
+    //! \details The smaller pool is iterated, the components of the other one are resolved via its sparse lookup.
+    //! So the iteration order is the order of the smaller pool. Components must not be added or removed while iterating.
+    //! \param[in] pool_1 The first \a scene_component_pool.
+    //! \param[in] pool_2 The second \a scene_component_pool.
+    //! \param[in] func The function to call for each \a entity. Signature: void(entity e, component_1& c1, component_2& c2).
+    template <typename component_1, typename component_2, typename function>
+    void join(scene_component_pool<component_1>& pool_1, scene_component_pool<component_2>& pool_2, function func)
+    {
+        const int32 size_1 = static_cast<int32>(pool_1.size());
+        const int32 size_2 = static_cast<int32>(pool_2.size());
+        if (size_1 <= size_2)
+        {
+            for (int32 i = 0; i < size_1; ++i)
+            {
+                entity e      = pool_1.entity_at(i);
+                const int32 j = pool_2.index_of(e);
+                if (j >= 0)
+                    func(e, pool_1.component_at(i), pool_2.component_at(j));
+            }
+        }
+        else
+        {
+            for (int32 j = 0; j < size_2; ++j)
+            {
+                entity e      = pool_2.entity_at(j);
+                const int32 i = pool_1.index_of(e);
+                if (i >= 0)
+                    func(e, pool_1.component_at(i), pool_2.component_at(j));
+            }
+        }
+    }
+
+    //! \brief Iterates over all \a entities having a component in all three \a scene_component_pools.
+    //! \details The smallest pool is iterated, the components of the other ones are resolved via their sparse lookups.
+    //! So the iteration order is the order of the smallest pool. Components must not be added or removed while iterating.
+    //! \param[in] pool_1 The first \a scene_component_pool.
+    //! \param[in] pool_2 The second \a scene_component_pool.
+    //! \param[in] pool_3 The third \a scene_component_pool.
+    //! \param[in] func The function to call for each \a entity. Signature: void(entity e, component_1& c1, component_2& c2, component_3& c3).
+    template <typename component_1, typename component_2, typename component_3, typename function>
+    void join(scene_component_pool<component_1>& pool_1, scene_component_pool<component_2>& pool_2, scene_component_pool<component_3>& pool_3, function func)
+    {
+        const int32 size_1 = static_cast<int32>(pool_1.size());
+        const int32 size_2 = static_cast<int32>(pool_2.size());
+        const int32 size_3 = static_cast<int32>(pool_3.size());
+        if (size_1 <= size_2 && size_1 <= size_3)
+        {
+            for (int32 i = 0; i < size_1; ++i)
+            {
+                entity e      = pool_1.entity_at(i);
+                const int32 j = pool_2.index_of(e);
+                const int32 k = pool_3.index_of(e);
+                if (j >= 0 && k >= 0)
+                    func(e, pool_1.component_at(i), pool_2.component_at(j), pool_3.component_at(k));
+            }
+        }
+        else if (size_2 <= size_3)
+        {
+            for (int32 j = 0; j < size_2; ++j)
+            {
+                entity e      = pool_2.entity_at(j);
+                const int32 i = pool_1.index_of(e);
+                const int32 k = pool_3.index_of(e);
+                if (i >= 0 && k >= 0)
+                    func(e, pool_1.component_at(i), pool_2.component_at(j), pool_3.component_at(k));
+            }
+        }
+        else
+        {
+            for (int32 k = 0; k < size_3; ++k)
+            {
+                entity e      = pool_3.entity_at(k);
+                const int32 i = pool_1.index_of(e);
+                const int32 j = pool_2.index_of(e);
+                if (i >= 0 && j >= 0)
+                    func(e, pool_1.component_at(i), pool_2.component_at(j), pool_3.component_at(k));
+            }
+        }
+    }
 } // namespace mango
 
 #endif // MANGO_SCENE_COMPONENT_MANAGER_HPP
@@ -8,13 +8,13 @@
 #define MANGO_SCENE_ECS_HPP
 
 #include <mango/types.hpp>
+#include <unordered_map>
+#include <vector>
 
 namespace mango
 {
-    //! \brief Maximum number of scene \a pool entries in mango.
-    const uint32 max_pool_entries = 10000; // Extend if necessary.
-    //! \brief Maximum number of \a entities in mango.
-    const uint32 max_entities = max_pool_entries;
+    //! \brief Default number of components a scene \a pool allocates memory for at once.
+    const int32 default_pool_chunk_size = 256;
 
     //! \brief An \a entity. Just a positive integer used as an id.
     using entity = uint32;
@@ -72,15 +72,19 @@ namespace mango
     };
 
     //! \brief Component used to transform anything in the scene.
+    //! \details Kept small, since the transformation updates stream over all of them every frame.
+    //! The local transformation is not stored, it is composed from position, rotation and scale when needed.
     struct transform_component
     {
-        glm::vec3 position      = glm::vec3(0.0f);                     //!< The local position.
-        glm::quat rotation      = glm::quat(glm::vec3(0.0, 0.0, 0.0)); //!< The local rotation quaternion.
-        glm::vec3 rotation_hint = glm::vec3(0.0, 0.0, 0.0);            //!< The local rotation hint (used for editor controls).
-        glm::vec3 scale         = glm::vec3(1.0f);                     //!< The local scale.
+        glm::vec3 position = glm::vec3(0.0f);                     //!< The local position.
+        glm::quat rotation = glm::quat(glm::vec3(0.0, 0.0, 0.0)); //!< The local rotation quaternion.
+        glm::vec3 scale    = glm::vec3(1.0f);                     //!< The local scale.
 
-        glm::mat4 local_transformation_matrix = glm::mat4(1.0f); //!< The local transformation.
-        glm::mat4 world_transformation_matrix = glm::mat4(1.0f); //!< The world transformation. If there is no parent this is also the local transformation.
+        //! \brief The affine world transformation, the fourth column is the translation. If there is no parent this is also the local transformation.
+        glm::mat4x3 world_transformation_matrix = glm::mat4x3(1.0f);
+
+        bool changed       = true; //!< True if position, rotation or scale changed. Has to be set after modifying them, only changed matrices are recomputed.
+        bool world_changed = true; //!< True if the world transformation was recomputed in the last update. Set by the scene.
     };
 
     //! \brief Component used to build a graph like structure. This is necessary for parenting.
@@ -94,6 +98,22 @@ namespace mango
         entity previous_sibling = invalid_entity; //!< The previous sibling entity id.
     };
 
+    //! \brief An entry in the flat scene hierarchy.
+    //! \details Parents are always stored before their children.
+    struct hierarchy_node
+    {
+        entity node_entity; //!< The entity id of the node. Invalid for removed entries.
+        int32 parent_index; //!< The index of the parent in the hierarchy. -1 for root nodes.
+    };
+
+    //! \brief The flat scene hierarchy with the index of every node, so moved subtrees can be spliced in without rebuilding it.
+    struct flat_hierarchy
+    {
+        std::vector<hierarchy_node> nodes;        //!< The \a hierarchy_nodes, parents are stored before their children.
+        std::unordered_map<entity, int32> indices; //!< The index of each node entity in nodes.
+        int32 removed_count = 0;                   //!< The number of removed entries still stored in nodes.
+    };
+
     //! \brief A type for mesh_primitives.
     enum class mesh_primitive_type : uint8
     {
@@ -103,6 +123,14 @@ namespace mango
         custom     //!< Custom type. Normaly used when loaded from file.
     };
 
+    //! \brief An axis aligned bounding box.
+    //! \details The default constructed box is empty (min greater than max) and counts as unknown bounds.
+    struct axis_aligned_bounding_box
+    {
+        glm::vec3 min = glm::vec3(3.402823e+38f);  //!< The minimum corner.
+        glm::vec3 max = glm::vec3(-3.402823e+38f); //!< The maximum corner.
+    };
+
     //! \brief Component used to describe a mesh primitive draw call.
     struct mesh_primitive_component
     {
@@ -110,11 +138,15 @@ namespace mango
         primitive_topology topology;                  //!< Topology of the mesh primitive data.
         int32 first;                                  //!< First index.
         int32 count;                                  //!< Number of elements/vertices.
+        int32 base_vertex;                            //!< Value added to the indices, the first vertex in a vertex buffer shared with other primitives.
         index_type type_index;                        //!< The type of the values in the index buffer.
         int32 instance_count;                         //!< Number of instances. Usually 1.
         bool has_normals;                             //!< Specifies if the mesh primitive has normals.
         bool has_tangents;                            //!< Specifies if the mesh primitive has tangents.
         mesh_primitive_type tp;                       //!< Specifies if the type of mesh primitive.
+
+        axis_aligned_bounding_box local_bounds; //!< The bounds of the vertex positions. Meshes with empty bounds are never culled.
+        axis_aligned_bounding_box world_bounds; //!< The local bounds transformed to world space. Updated with the transformations.
     };
 
     //! \brief Component used for materials.
@@ -5,6 +5,7 @@
 //! \copyright Apache License 2.0
 
 #include <core/context_impl.hpp>
+#include <core/job_system.hpp>
 #if defined(WIN32)
 #include <core/win32_input_system.hpp>
 #include <core/win32_window_system.hpp>
@@ -101,6 +102,11 @@ weak_ptr<resource_system> context_impl::get_resource_system_internal()
     return m_resource_system;
 }
 
+weak_ptr<job_system> context_impl::get_job_system_internal()
+{
+    return m_job_system;
+}
+
 weak_ptr<ui_system_impl> context_impl::get_ui_system_internal()
 {
     return m_ui_system;
@@ -138,6 +144,7 @@ bool context_impl::create_systems()
 {
     NAMED_PROFILE_ZONE("System Creation");
     bool success = true;
+    m_job_system = std::make_shared<job_system>();
 #if defined(WIN32)
     m_window_system = std::make_shared<win32_window_system>(shared_from_this());
     m_input_system  = std::make_shared<win32_input_system>(shared_from_this());
@@ -172,4 +179,5 @@ void context_impl::destroy_systems()
     m_input_system->destroy();
     MANGO_ASSERT(m_window_system, "Window System is invalid!");
     m_window_system->destroy();
+    m_job_system.reset(); // joins the worker threads
 }
@@ -17,6 +17,7 @@ namespace mango
     class ui_system_impl;
     class shader_system;
     class resource_system;
+    class job_system;
     //! \brief The implementation of the public context.
     class context_impl : public context, public std::enable_shared_from_this<context_impl>
     {
@@ -72,6 +73,11 @@ namespace mango
         //! \return A weak pointer to the internal \a resource_system.
         virtual weak_ptr<resource_system> get_resource_system_internal();
 
+        //! \brief Queries and returns a weak pointer to mangos \a job_system.
+        //! \details The \a job_system is only available internally, but the function name was choosen to be consistent.
+        //! \return A weak pointer to the internal \a job_system.
+        virtual weak_ptr<job_system> get_job_system_internal();
+
         //! \brief Queries and returns a mangos loading procedure for opengl.
         //! \return Mangos loading procedure for opengl.
         const mango_gl_load_proc& get_gl_loading_procedure();
@@ -105,6 +111,8 @@ namespace mango
         shared_ptr<resource_system> m_resource_system;
         //! \brief A shared pointer to the \a ui_system of mango.
         shared_ptr<ui_system_impl> m_ui_system;
+        //! \brief A shared pointer to the \a job_system of mango.
+        shared_ptr<job_system> m_job_system;
         //! \brief A shared pointer to the current \a scene of mango.
         shared_ptr<scene> m_current_scene;
         //! \brief The gl loading procedure of mango.
@@ -0,0 +1,196 @@
+//! \file      job_system.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <algorithm>
+#include <core/job_system.hpp>
+#include <mango/assert.hpp>
+
+using namespace mango;
+
+//! \brief The id of the next \a job_system created.
+static std::atomic<uint32> next_job_system_id(1);
+//! \brief The id of the \a job_system the queue index of the calling thread belongs to.
+static thread_local uint32 t_queue_owner = 0;
+//! \brief The queue index of the calling thread.
+static thread_local int32 t_queue_index = -1;
+//! \brief The number of additional threads started by parallel_for_background() that are running, across all calls.
+static std::atomic<int32> background_thread_count(0);
+
+job_system::job_system(int32 worker_count)
+    : m_id(next_job_system_id.fetch_add(1))
+    , m_queues(new job_queue[max_queues])
+    , m_queue_count(0)
+    , m_queued_jobs(0)
+    , m_stop(false)
+{
+    if (worker_count <= 0)
+        worker_count = static_cast<int32>(std::thread::hardware_concurrency()) - 1;
+    worker_count = std::min(std::max(worker_count, 0), static_cast<int32>(max_queues / 2));
+
+    m_queue_count = worker_count;
+    m_workers.reserve(worker_count);
+    for (int32 i = 0; i < worker_count; ++i)
+        m_workers.emplace_back(&job_system::worker_loop, this, i);
+}
+
+job_system::~job_system()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_stop = true;
+    }
+    m_wake_condition.notify_all();
+    for (auto& worker : m_workers)
+        worker.join();
+}
+
+void job_system::submit(job j, job_counter& counter)
+{
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+    job_queue& queue = m_queues[get_queue_index()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({ std::move(j), &counter });
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        m_queued_jobs.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_wake_condition.notify_one();
+}
+
+void job_system::wait(job_counter& counter)
+{
+    const int32 queue_index = get_queue_index();
+    counted_job j;
+    while (!counter.finished())
+    {
+        if (try_take_job(queue_index, j))
+            execute(j);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void job_system::parallel_for(int32 count, int32 batch_size, const std::function<void(int32 begin, int32 end)>& func)
+{
+    if (count <= 0)
+        return;
+    // A few batches per thread, so threads finishing early can steal.
+    const int32 batch_count = get_concurrency() * 4;
+    batch_size              = std::max(std::max(batch_size, (count + batch_count - 1) / batch_count), 1);
+    if (batch_size >= count || m_workers.empty())
+    {
+        func(0, count);
+        return;
+    }
+
+    job_counter counter;
+    for (int32 begin = batch_size; begin < count; begin += batch_size)
+    {
+        const int32 end = std::min(begin + batch_size, count);
+        submit([&func, begin, end]() { func(begin, end); }, counter);
+    }
+    func(0, batch_size);
+    wait(counter);
+}
+
+int32 job_system::get_queue_index()
+{
+    if (t_queue_owner != m_id)
+    {
+        t_queue_owner = m_id;
+        t_queue_index = m_queue_count.fetch_add(1);
+        MANGO_ASSERT(t_queue_index < max_queues, "Too many threads submitting jobs!");
+    }
+    return t_queue_index;
+}
+
+bool job_system::try_take_job(int32 queue_index, counted_job& j)
+{
+    {
+        job_queue& own = m_queues[queue_index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.jobs.empty())
+        {
+            j = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            m_queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    const int32 queue_count = m_queue_count.load();
+    for (int32 i = 1; i < queue_count; ++i)
+    {
+        job_queue& other = m_queues[(queue_index + i) % queue_count];
+        std::lock_guard<std::mutex> lock(other.mutex);
+        if (!other.jobs.empty())
+        {
+            j = std::move(other.jobs.front());
+            other.jobs.pop_front();
+            m_queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void job_system::execute(counted_job& j)
+{
+    j.function();
+    j.function = nullptr;
+    j.counter->m_pending.fetch_sub(1, std::memory_order_release);
+}
+
+void job_system::worker_loop(int32 queue_index)
+{
+    t_queue_owner = m_id;
+    t_queue_index = queue_index;
+    counted_job j;
+    while (true)
+    {
+        if (try_take_job(queue_index, j))
+        {
+            execute(j);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_sleep_mutex);
+        m_wake_condition.wait(lock, [this]() { return m_stop || m_queued_jobs.load(std::memory_order_relaxed) > 0; });
+        if (m_stop)
+            return;
+    }
+}
+
+int32 mango::parallel_for_background(int32 count, const std::function<void(int32 index)>& func)
+{
+    MANGO_ASSERT(count >= 0, "The index count has to be positive!");
+    const int32 limit = std::max(static_cast<int32>(std::thread::hardware_concurrency()) / 2, 1);
+
+    // Reserve the additional threads from the budget shared with concurrent calls.
+    int32 additional = 0;
+    int32 running    = background_thread_count.load();
+    do
+    {
+        additional = std::max(std::min(count - 1, limit - running), 0);
+    } while (additional > 0 && !background_thread_count.compare_exchange_weak(running, running + additional));
+
+    std::atomic<int32> next(0);
+    auto work = [&next, count, &func]() {
+        for (int32 i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            func(i);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(static_cast<ptr_size>(additional));
+    for (int32 i = 0; i < additional; ++i)
+        threads.emplace_back(work);
+    work();
+    for (std::thread& t : threads)
+        t.join();
+
+    background_thread_count.fetch_sub(additional);
+    return additional + 1;
+}
@@ -0,0 +1,148 @@
+//! \file      job_system.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_JOB_SYSTEM_HPP
+#define MANGO_JOB_SYSTEM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mango/types.hpp>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mango
+{
+    //! \brief A function executed by the \a job_system.
+    using job = std::function<void()>;
+
+    //! \brief Counts the unfinished jobs submitted with it, so they can be waited for.
+    //! \details A \a job_counter has to outlive all jobs submitted with it.
+    class job_counter
+    {
+      public:
+        job_counter()
+            : m_pending(0)
+        {
+        }
+
+        //! \brief Checks if all jobs submitted with the \a job_counter are finished.
+        //! \return True if all jobs are finished, else false.
+        inline bool finished() const
+        {
+            return m_pending.load(std::memory_order_acquire) == 0;
+        }
+
+      private:
+        friend class job_system;
+        //! \brief The number of unfinished jobs.
+        std::atomic<int32> m_pending;
+    };
+
+    //! \brief A work stealing thread pool executing \a jobs.
+    //! \details Every worker thread and the threads submitting jobs have their own queue.
+    //! Threads take the newest job from their own queue and steal the oldest ones from the others when it is empty.
+    //! Threads waiting for a \a job_counter help executing jobs instead of blocking.
+    class job_system
+    {
+      public:
+        //! \brief Constructs the \a job_system and starts the worker threads.
+        //! \param[in] worker_count The number of worker threads. Zero or negative values use one thread less than the hardware supports.
+        job_system(int32 worker_count = 0);
+        ~job_system();
+
+        //! \brief Returns the number of threads executing jobs when waiting. That are the workers and the waiting thread.
+        //! \return The number of threads executing jobs.
+        inline int32 get_concurrency() const
+        {
+            return static_cast<int32>(m_workers.size()) + 1;
+        }
+
+        //! \brief Submits a \a job to be executed by any thread.
+        //! \param[in] j The \a job to execute.
+        //! \param[in] counter The \a job_counter to count the \a job with.
+        void submit(job j, job_counter& counter);
+
+        //! \brief Waits until all jobs counted by a \a job_counter are finished. Executes jobs while waiting.
+        //! \param[in] counter The \a job_counter to wait for.
+        void wait(job_counter& counter);
+
+        //! \brief Executes a function over a range of indices in parallel and waits for it.
+        //! \details The range is split into batches, one batch is executed by the calling thread.
+        //! \param[in] count The number of indices. The range is [0, count).
+        //! \param[in] batch_size The minimum number of indices per batch.
+        //! \param[in] func The function to execute for each batch. Signature: void(int32 begin, int32 end).
+        void parallel_for(int32 count, int32 batch_size, const std::function<void(int32 begin, int32 end)>& func);
+
+      private:
+        //! \brief A \a job with the \a job_counter counting it.
+        struct counted_job
+        {
+            job function;         //!< The function to execute.
+            job_counter* counter; //!< The \a job_counter to decrement after execution.
+        };
+
+        //! \brief A queue of \a counted_jobs.
+        struct job_queue
+        {
+            std::mutex mutex;             //!< Mutex guarding the jobs.
+            std::deque<counted_job> jobs; //!< The jobs, new ones are pushed to the back.
+        };
+
+        //! \brief Returns the queue index of the calling thread, registers a new queue for unknown threads.
+        //! \return The queue index of the calling thread.
+        int32 get_queue_index();
+
+        //! \brief Tries to take a job, first from the own queue and then from the other ones.
+        //! \param[in] queue_index The queue index of the calling thread.
+        //! \param[out] j The \a counted_job taken.
+        //! \return True if a job was taken, else false.
+        bool try_take_job(int32 queue_index, counted_job& j);
+
+        //! \brief Executes a \a counted_job and decrements its counter.
+        //! \param[in] j The \a counted_job to execute.
+        void execute(counted_job& j);
+
+        //! \brief The loop executed by the worker threads.
+        //! \param[in] queue_index The queue index of the worker.
+        void worker_loop(int32 queue_index);
+
+        //! \brief The maximum number of queues. Limits the number of threads submitting jobs.
+        static const int32 max_queues = 64;
+
+        //! \brief The unique id of the \a job_system, used to identify the queues of threads.
+        uint32 m_id;
+        //! \brief The worker threads.
+        std::vector<std::thread> m_workers;
+        //! \brief The job queues, the first ones belong to the workers.
+        std::unique_ptr<job_queue[]> m_queues;
+        //! \brief The number of registered queues.
+        std::atomic<int32> m_queue_count;
+        //! \brief The number of jobs in all queues.
+        std::atomic<int32> m_queued_jobs;
+        //! \brief Mutex for sleeping workers.
+        std::mutex m_sleep_mutex;
+        //! \brief Condition variable to wake sleeping workers.
+        std::condition_variable m_wake_condition;
+        //! \brief True if the workers should stop, else false.
+        bool m_stop;
+    };
+
+    //! \brief Executes a function for each index of a range on background threads and waits for it.
+    //! \details Meant for long running work like decoding and compressing images, where a single call can take seconds.
+    //! That work is not done in the \a job_system, since the main thread helps executing jobs while waiting for the ecs systems and would stall.
+    //! The calling thread takes part, the additional threads are limited across all concurrent calls to half of the hardware threads,
+    //! so concurrent loads do not multiply the thread count and the \a job_system workers keep cores to run on.
+    //! \param[in] count The number of indices. The range is [0, count).
+    //! \param[in] func The function to execute for each index. Signature: void(int32 index).
+    //! \return The number of threads that executed the function, including the calling thread.
+    int32 parallel_for_background(int32 count, const std::function<void(int32 index)>& func);
+} // namespace mango
+
+#endif // MANGO_JOB_SYSTEM_HPP
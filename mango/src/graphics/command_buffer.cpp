@@ -209,6 +209,17 @@ void bind_buffer(const void* data)
 }
 const execute_function bind_buffer_command::execute = &bind_buffer;
 
+void update_buffer_data(const void* data)
+{
+    NAMED_PROFILE_ZONE("Update Buffer Data");
+    const update_buffer_data_command* cmd = static_cast<const update_buffer_data_command*>(data);
+    MANGO_ASSERT(cmd->offset >= 0, "Buffer offset has to be greater than 0!");
+    MANGO_ASSERT(cmd->size >= 0, "Buffer data size has to be greater than 0!");
+    GL_NAMED_PROFILE_ZONE("Update Buffer Data");
+    glNamedBufferSubData(cmd->buffer_name, static_cast<g_intptr>(cmd->offset), static_cast<g_sizeiptr>(cmd->size), cmd->data);
+}
+const execute_function update_buffer_data_command::execute = &update_buffer_data;
+
 void bind_texture(const void* data)
 {
     NAMED_PROFILE_ZONE("Bind Texture");
@@ -375,17 +386,32 @@ void draw_elements(const void* data)
     if (cmd->instance_count > 1)
     {
         GL_NAMED_PROFILE_ZONE("Draw Elements Instanced");
-        glDrawElementsInstanced(static_cast<g_enum>(cmd->topology), static_cast<g_sizei>(cmd->count), static_cast<g_enum>(cmd->type), (g_byte*)NULL + cmd->first,
-                                static_cast<g_sizei>(cmd->instance_count));
+        glDrawElementsInstancedBaseVertex(static_cast<g_enum>(cmd->topology), static_cast<g_sizei>(cmd->count), static_cast<g_enum>(cmd->type), (g_byte*)NULL + cmd->first,
+                                          static_cast<g_sizei>(cmd->instance_count), static_cast<g_int>(cmd->base_vertex));
     }
     else
     {
         GL_NAMED_PROFILE_ZONE("Draw Elements");
-        glDrawElements(static_cast<g_enum>(cmd->topology), static_cast<g_sizei>(cmd->count), static_cast<g_enum>(cmd->type), (g_byte*)NULL + cmd->first);
+        glDrawElementsBaseVertex(static_cast<g_enum>(cmd->topology), static_cast<g_sizei>(cmd->count), static_cast<g_enum>(cmd->type), (g_byte*)NULL + cmd->first,
+                                 static_cast<g_int>(cmd->base_vertex));
     }
 }
 const execute_function draw_elements_command::execute = &draw_elements;
 
+void multi_draw_elements_indirect(const void* data)
+{
+    NAMED_PROFILE_ZONE("Multi Draw Elements Indirect");
+    const multi_draw_elements_indirect_command* cmd = static_cast<const multi_draw_elements_indirect_command*>(data);
+    MANGO_ASSERT(cmd->offset >= 0, "The offset has to be greater than 0!");
+    MANGO_ASSERT(cmd->draw_count >= 0, "The draw count has to be greater than 0!");
+
+    GL_NAMED_PROFILE_ZONE("Multi Draw Elements Indirect");
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, cmd->indirect_buffer_name);
+    glMultiDrawElementsIndirect(static_cast<g_enum>(cmd->topology), static_cast<g_enum>(cmd->type), (g_byte*)NULL + cmd->offset, static_cast<g_sizei>(cmd->draw_count),
+                                sizeof(draw_elements_indirect_parameters));
+}
+const execute_function multi_draw_elements_indirect_command::execute = &multi_draw_elements_indirect;
+
 void dispatch_compute(const void* data)
 {
     NAMED_PROFILE_ZONE("Dispatch Compute");
@@ -7,10 +7,14 @@
 #ifndef MANGO_COMMAND_BUFFER_HPP
 #define MANGO_COMMAND_BUFFER_HPP
 
+#include <algorithm>
+#include <cstring>
 #include <graphics/graphics_common.hpp>
 #include <graphics/graphics_state.hpp>
 #include <mango/assert.hpp>
 #include <memory/linear_allocator.hpp>
+#include <type_traits>
+#include <vector>
 
 namespace mango
 {
@@ -106,6 +110,16 @@ namespace mango
     END_COMMAND(bind_buffer);
     //! \endcond
 
+    //! \brief Command updating (a part of) the data of a buffer.
+    BEGIN_COMMAND(update_buffer_data);
+    g_uint buffer_name; //!< Gl name of the buffer.
+    int64 offset;       //!< Offset in the buffer to start the update from.
+    int64 size;         //!< Size of the data to update.
+    const void* data;   //!< Pointer to the data. Usually points to the commands spare memory.
+    //! \cond NO_COND
+    END_COMMAND(update_buffer_data);
+    //! \endcond
+
     //! \brief Command binding a texture.
     BEGIN_COMMAND(bind_texture);
     int32 binding;          //!< Texture binding point.
@@ -200,11 +214,33 @@ namespace mango
     int32 first;                 //!< Offset.
     int32 count;                 //!< Number of indices.
     index_type type;             //!< Index type.
+    int32 base_vertex;           //!< Value added to the indices.
     int32 instance_count;        //!< Number of instances.
     //! \cond NO_COND
     END_COMMAND(draw_elements);
     //! \endcond
 
+    //! \brief Parameters of a single draw in the indirect buffer of a \a multi_draw_elements_indirect_command.
+    struct draw_elements_indirect_parameters
+    {
+        g_uint count;          //!< Number of indices.
+        g_uint instance_count; //!< Number of instances.
+        g_uint first_index;    //!< Offset in the index buffer in indices.
+        g_int base_vertex;     //!< Value added to the indices.
+        g_uint base_instance;  //!< The first instance.
+    };
+
+    //! \brief Command drawing multiple indexed draws with the parameters stored in an indirect buffer.
+    BEGIN_COMMAND(multi_draw_elements_indirect);
+    primitive_topology topology; //!< Topology type.
+    index_type type;             //!< Index type.
+    g_uint indirect_buffer_name; //!< Gl name of the buffer storing the \a draw_elements_indirect_parameters.
+    int64 offset;                //!< Offset in the indirect buffer to the parameters of the first draw.
+    int32 draw_count;            //!< Number of draws.
+    //! \cond NO_COND
+    END_COMMAND(multi_draw_elements_indirect);
+    //! \endcond
+
     //! \brief Command dispatching a compute shader.
     BEGIN_COMMAND(dispatch_compute);
     int32 num_x_groups; //!< Number of dispatch groups in x direction.
@@ -378,7 +414,8 @@ namespace mango
             delete[] m_keys;
             delete[] m_packages;
             delete[] m_indices;
-            m_allocator.reset();
+            delete[] m_sort_keys;
+            delete[] m_sort_indices;
         }
 
         //! \brief Creates a \a command_buffer with a specific key.
@@ -398,6 +435,9 @@ namespace mango
         {
             package p = package_create<T>(spare_memory_size);
 
+            if (m_idx == m_capacity)
+                grow(2 * m_capacity);
+
             m_keys[m_idx]     = k;
             m_packages[m_idx] = p;
             m_indices[m_idx]  = m_idx;
@@ -449,18 +489,146 @@ namespace mango
             {
             }
             //! \brief Comparison operator. Sorts ascending.
-            bool operator()(key i, key j) const
+            bool operator()(int64 i, int64 j) const
             {
                 return sorting_array[i] < sorting_array[j];
             }
         };
 
         //! \brief Sorts the \a command_buffer by key.
+        //! \details Uses radix_sort() for \a min_key and \a max_key buffers and comparison_sort() for all other key types.
         void sort()
+        {
+            sort(std::integral_constant<bool, std::is_same<K, min_key>::value || std::is_same<K, max_key>::value>());
+        }
+
+        //! \brief Sorts the \a command_buffer by key with a stable comparison sort.
+        void comparison_sort()
         {
             std::stable_sort(&m_indices[0], m_indices + m_idx, sort_indices(m_keys));
         }
 
+        //! \brief Sorts the \a command_buffer by key with a stable least significant digit radix sort.
+        //! \details Keys and indices are sorted together in the scratch buffers owned by the \a command_buffer, so no memory is allocated.
+        //! Passes where all keys share the same digit are skipped, which is common for the upper bits of \a max_key.
+        void radix_sort()
+        {
+            if (m_idx < 2)
+                return;
+
+            const int64 digit_count = sizeof(key);
+            int64 histograms[digit_count][256];
+            memset(histograms, 0, sizeof(histograms));
+
+            key* src_keys      = m_sort_keys;
+            key* dst_keys      = m_sort_keys + m_capacity;
+            int64* src_indices = m_indices;
+            int64* dst_indices = m_sort_indices;
+
+            for (int64 i = 0; i < m_idx; ++i)
+            {
+                key k       = m_keys[m_indices[i]];
+                src_keys[i] = k;
+                for (int64 d = 0; d < digit_count; ++d)
+                    histograms[d][(k >> (d * 8)) & 0xff]++;
+            }
+
+            for (int64 d = 0; d < digit_count; ++d)
+            {
+                int64* histogram = histograms[d];
+                if (histogram[(src_keys[0] >> (d * 8)) & 0xff] == m_idx)
+                    continue; // All keys have the same digit.
+
+                int64 offset = 0;
+                for (int32 b = 0; b < 256; ++b)
+                {
+                    int64 count  = histogram[b];
+                    histogram[b] = offset;
+                    offset += count;
+                }
+
+                for (int64 i = 0; i < m_idx; ++i)
+                {
+                    key k               = src_keys[i];
+                    int64 target        = histogram[(k >> (d * 8)) & 0xff]++;
+                    dst_keys[target]    = k;
+                    dst_indices[target] = src_indices[i];
+                }
+
+                std::swap(src_keys, dst_keys);
+                std::swap(src_indices, dst_indices);
+            }
+
+            if (src_indices != m_indices)
+                memcpy(m_indices, src_indices, m_idx * sizeof(int64));
+        }
+
+        //! \brief Removes commands setting state that is already set by the commands executed before.
+        //! \details Should be called after sort(). Walks the packages in execution order and tracks the bound shader program, vertex array, textures, buffers and face culling.
+        //! Commands not known to leave this state untouched reset the tracked state, so they never cause wrong eliminations.
+        //! The packages get relinked, so this should only be used for \a command_buffers that are invalidated after execution.
+        //! \return The number of eliminated commands.
+        int64 eliminate_redundant_state()
+        {
+            int64 eliminated = 0;
+            redundant_state_filter filter;
+            filter.reset();
+
+            for (int64 i = 0; i < m_idx; ++i)
+            {
+                package* link = &m_packages[m_indices[i]];
+                while (*link != nullptr)
+                {
+                    m_current = *link;
+                    if (filter.redundant(load_execute_function(), load_command()))
+                    {
+                        *link = *read_next(); // skip the command
+                        eliminated++;
+                    }
+                    else
+                        link = read_next();
+                }
+            }
+
+            return eliminated;
+        }
+
+        //! \brief Returns the key of a command in execution order.
+        //! \param[in] i The position of the command in execution order.
+        //! \return The key of the command executed at position \a i.
+        key sorted_key(int64 i) const
+        {
+            MANGO_ASSERT(i >= 0 && i < m_idx, "Command index out of bounds!");
+            return m_keys[m_indices[i]];
+        }
+
+        //! \brief Returns the number of recorded commands, excluding appended ones.
+        //! \return The number of recorded commands.
+        int64 size() const
+        {
+            return m_idx;
+        }
+
+        //! \brief Removes a recorded command and all commands appended to it.
+        //! \details The package memory is not freed before the next invalidation.
+        //! This is used to patch \a command_buffers that are not invalidated every frame.
+        //! \param[in] command_index The index of the command to remove. Directly after creating a command its index is size() - 1.
+        void remove(int64 command_index)
+        {
+            MANGO_ASSERT(command_index >= 0 && command_index < m_idx, "Command index out of bounds!");
+            if (m_packages[command_index] == nullptr)
+                return;
+            m_packages[command_index] = nullptr;
+            m_removed++;
+        }
+
+        //! \brief Returns the number of removed commands, still occupying memory until the next invalidation.
+        //! \return The number of removed commands.
+        int64 removed_count() const
+        {
+            return m_removed;
+        }
+
         //! \brief Executes the \a command_buffer.
         //! \details Executes in order when sort was called before.
         void execute()
@@ -468,6 +636,8 @@ namespace mango
             for (int64 i = 0; i < m_idx; ++i)
             {
                 m_current = m_packages[m_indices[i]];
+                if (m_current == nullptr)
+                    continue; // removed
                 do
                 {
                     const void* cmd = load_command();
@@ -494,39 +664,249 @@ namespace mango
             return m_dirty;
         }
 
+        //! \brief Returns the memory used by the commands recorded since the last invalidation.
+        //! \details Segment memory is not included.
+        //! \return The used memory in bytes.
+        int64 bytes_used() const
+        {
+            int64 used = 0;
+            for (int32 i = 0; i <= m_page; ++i)
+                used += m_pages[i]->used_memory();
+            return used;
+        }
+
+        //! \brief Returns the highest memory usage of all frames recorded so far.
+        //! \return The high-water mark in bytes.
+        int64 high_water_mark() const
+        {
+            return std::max(m_high_water_mark, bytes_used());
+        }
+
+        //! \brief Returns the memory reserved for commands in all pages.
+        //! \return The reserved memory in bytes.
+        int64 bytes_reserved() const
+        {
+            int64 reserved = 0;
+            for (auto& p : m_pages)
+                reserved += p->used_memory() + p->available_memory();
+            return reserved;
+        }
+
         //! \brief Contructs the \a command_buffer.
         //! \details Normally not called directly,  use create() instead.
-        //! \param[in] size The size of the \a command_buffer in bytes.
+        //! The \a command_buffer grows by chaining additional pages when \a size is exceeded.
+        //! \param[in] size The initial size of the \a command_buffer in bytes.
         command_buffer(int64 size)
-            : m_allocator(size)
+            : m_page(0)
+            , m_page_size(size)
+            , m_high_water_mark(0)
+            , m_capacity(std::max(size / 4, int64(1)))
             , m_idx(0)
+            , m_removed(0)
             , m_dirty(true)
         {
-            m_keys     = new key[size / 4];
-            m_packages = new package[size / 4];
-            m_indices  = new int64[size / 4];
-            m_allocator.init();
+            m_keys         = new key[m_capacity];
+            m_packages     = new package[m_capacity];
+            m_indices      = new int64[m_capacity];
+            m_sort_keys    = new key[2 * m_capacity];
+            m_sort_indices = new int64[m_capacity];
+            add_page(m_page_size);
         }
 
       private:
+        //! \brief State tracked to find redundant commands in eliminate_redundant_state().
+        struct redundant_state_filter
+        {
+            int64 shader_program;                                           //!< Bound shader program, -1 if unknown.
+            int64 vertex_array;                                             //!< Bound vertex array, -1 if unknown.
+            int64 face_culling;                                             //!< Face culling enabled, -1 if unknown.
+            int64 cull_face;                                                //!< Face to cull, -1 if unknown.
+            int64 texture_names[graphics_state::max_texture_bindings];      //!< Bound textures, -1 if unknown.
+            int64 sampler_locations[graphics_state::max_texture_bindings];  //!< Sampler locations of bound textures, -1 if unknown.
+            int64 buffer_names[graphics_state::max_buffer_slots];           //!< Bound buffers, -1 if unknown.
+            int64 buffer_offsets[graphics_state::max_buffer_slots];         //!< Offsets of bound buffers.
+            int64 buffer_sizes[graphics_state::max_buffer_slots];           //!< Sizes of bound buffers.
+            buffer_target buffer_targets[graphics_state::max_buffer_slots]; //!< Targets of bound buffers.
+
+            //! \brief Marks all tracked state as unknown.
+            void reset()
+            {
+                shader_program = vertex_array = face_culling = cull_face = -1;
+                reset_textures();
+                for (int32 i = 0; i < graphics_state::max_buffer_slots; ++i)
+                    buffer_names[i] = -1;
+            }
+
+            //! \brief Marks all tracked texture bindings as unknown.
+            void reset_textures()
+            {
+                for (int32 i = 0; i < graphics_state::max_texture_bindings; ++i)
+                    texture_names[i] = sampler_locations[i] = -1;
+            }
+
+            //! \brief Checks if a command is redundant and updates the tracked state if not.
+            //! \param[in] function The execute function of the command, used to identify the command type.
+            //! \param[in] command The command.
+            //! \return True if the command does not change anything and can be eliminated, else False.
+            bool redundant(execute_function function, const void* command)
+            {
+                if (function == bind_shader_program_command::execute)
+                {
+                    int64 program = static_cast<const bind_shader_program_command*>(command)->shader_program_name;
+                    if (shader_program == program)
+                        return true;
+                    shader_program = program;
+                    reset_textures(); // Sampler uniforms are program state.
+                    return false;
+                }
+                if (function == bind_vertex_array_command::execute)
+                {
+                    int64 name = static_cast<const bind_vertex_array_command*>(command)->vertex_array_name;
+                    if (vertex_array == name)
+                        return true;
+                    vertex_array = name;
+                    return false;
+                }
+                if (function == bind_texture_command::execute)
+                {
+                    const bind_texture_command* cmd = static_cast<const bind_texture_command*>(command);
+                    if (cmd->binding < 0 || cmd->binding >= graphics_state::max_texture_bindings)
+                        return false;
+                    if (texture_names[cmd->binding] == cmd->texture_name && sampler_locations[cmd->binding] == cmd->sampler_location)
+                        return true;
+                    texture_names[cmd->binding]     = cmd->texture_name;
+                    sampler_locations[cmd->binding] = cmd->sampler_location;
+                    return false;
+                }
+                if (function == bind_buffer_command::execute)
+                {
+                    const bind_buffer_command* cmd = static_cast<const bind_buffer_command*>(command);
+                    if (cmd->index < 0 || cmd->index >= graphics_state::max_buffer_slots)
+                        return false;
+                    if (buffer_names[cmd->index] == cmd->buffer_name && buffer_targets[cmd->index] == cmd->target && buffer_offsets[cmd->index] == cmd->offset &&
+                        buffer_sizes[cmd->index] == cmd->size)
+                        return true;
+                    buffer_names[cmd->index]   = cmd->buffer_name;
+                    buffer_targets[cmd->index] = cmd->target;
+                    buffer_offsets[cmd->index] = cmd->offset;
+                    buffer_sizes[cmd->index]   = cmd->size;
+                    return false;
+                }
+                if (function == set_face_culling_command::execute)
+                {
+                    int64 enabled = static_cast<const set_face_culling_command*>(command)->enabled ? 1 : 0;
+                    if (face_culling == enabled)
+                        return true;
+                    face_culling = enabled;
+                    return false;
+                }
+                if (function == set_cull_face_command::execute)
+                {
+                    int64 face = static_cast<int64>(static_cast<const set_cull_face_command*>(command)->face);
+                    if (cull_face == face)
+                        return true;
+                    cull_face = face;
+                    return false;
+                }
+                if (function == draw_arrays_command::execute || function == draw_elements_command::execute || function == multi_draw_elements_indirect_command::execute ||
+                    function == set_viewport_command::execute || function == set_depth_test_command::execute || function == set_depth_func_command::execute ||
+                    function == set_depth_write_command::execute || function == set_polygon_mode_command::execute || function == set_polygon_offset_command::execute ||
+                    function == set_blending_command::execute || function == set_blend_factors_command::execute || function == bind_framebuffer_command::execute ||
+                    function == update_buffer_data_command::execute || function == add_memory_barrier_command::execute)
+                    return false; // These do not touch the tracked state.
+
+                // Unknown influence on the tracked state.
+                reset();
+                return false;
+            }
+        };
+
+        //! \brief Sorts the \a command_buffer with the radix sort.
+        void sort(std::true_type)
+        {
+            radix_sort();
+        }
+
+        //! \brief Sorts the \a command_buffer with the comparison sort.
+        void sort(std::false_type)
+        {
+            comparison_sort();
+        }
+
         //! \brief Clears the \a command_buffer.
-        //! \details Resets the linear allocator and the command index.
+        //! \details Resets the pages and the command index.
+        //! If the last frame needed more than one page, the pages are replaced by a single one sized to the high-water mark.
         void clear()
         {
-            m_idx = 0;
-            m_allocator.reset();
+            m_high_water_mark = high_water_mark();
+            m_idx             = 0;
+            m_removed         = 0;
+            if (m_pages.size() > 1)
+            {
+                m_page_size = std::max(m_page_size, m_high_water_mark);
+                m_pages.clear();
+                add_page(m_page_size);
+            }
+            else
+                m_pages[0]->reset();
+            m_page = 0;
+        }
+
+        //! \brief Adds a new page to the \a command_buffer.
+        //! \param[in] size The size of the page in bytes.
+        void add_page(int64 size)
+        {
+            m_pages.push_back(mango::make_unique<linear_allocator>(size));
+            m_pages.back()->init();
+        }
+
+        //! \brief Grows the key, package and index lists.
+        //! \param[in] capacity The new number of commands the lists can hold.
+        void grow(int64 capacity)
+        {
+            key* keys          = new key[capacity];
+            package* packages  = new package[capacity];
+            int64* indices     = new int64[capacity];
+            memcpy(keys, m_keys, m_idx * sizeof(key));
+            memcpy(packages, m_packages, m_idx * sizeof(package));
+            memcpy(indices, m_indices, m_idx * sizeof(int64));
+            delete[] m_keys;
+            delete[] m_packages;
+            delete[] m_indices;
+            delete[] m_sort_keys;
+            delete[] m_sort_indices;
+            m_keys         = keys;
+            m_packages     = packages;
+            m_indices      = indices;
+            m_sort_keys    = new key[2 * capacity];
+            m_sort_indices = new int64[capacity];
+            m_capacity     = capacity;
         }
 
-        //! \brief Allocator used to store the commands.
-        linear_allocator m_allocator;
+        //! \brief Pages used to store the commands. Package pointers stay valid until the next invalidation.
+        std::vector<unique_ptr<linear_allocator>> m_pages;
+        //! \brief Index of the page currently allocated from.
+        int32 m_page;
+        //! \brief Size of newly added pages in bytes.
+        int64 m_page_size;
+        //! \brief Highest memory usage of all frames in bytes.
+        int64 m_high_water_mark;
         //! \brief List of keys.
         key* m_keys;
         //! \brief List of command packages.
         package* m_packages;
         //! \brief List of indices.
         int64* m_indices;
+        //! \brief Scratch keys used by the radix sort. Holds two arrays of \a m_capacity keys.
+        key* m_sort_keys;
+        //! \brief Scratch indices used by the radix sort.
+        int64* m_sort_indices;
+        //! \brief Maximum number of commands, size of the key, package and index lists.
+        int64 m_capacity;
         //! \brief CUrrent command index.
         int64 m_idx;
+        //! \brief Number of removed commands.
+        int64 m_removed;
         //! \brief Dirty flag.
         bool m_dirty;
 
@@ -547,9 +927,14 @@ namespace mango
         template <typename T>
         package package_create(uint64 spare_memory)
         {
-            void* mem = m_allocator.allocate(calculate_size<T>(spare_memory));
-            MANGO_ASSERT(mem, "Command Buffer is too small!");
-            m_current = mem;
+            int64 size = calculate_size<T>(spare_memory);
+            while (m_pages[m_page]->available_memory() < size)
+            {
+                m_page++;
+                if (m_page == static_cast<int32>(m_pages.size()))
+                    add_page(std::max(m_page_size, size));
+            }
+            m_current = m_pages[m_page]->allocate(size);
             return m_current;
         }
 
@@ -4,6 +4,7 @@
 //! \date      2020
 //! \copyright Apache License 2.0
 
+#include <algorithm>
 #include <graphics/gpu_buffer.hpp>
 #include <mango/profile.hpp>
 #include <util/helpers.hpp>
@@ -17,9 +18,13 @@ bool gpu_buffer::init(int64 frame_size, buffer_technique technique)
     PROFILE_ZONE;
     m_frame_size = frame_size;
     m_technique  = technique;
-    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &m_uniform_buffer_alignment);
-    int32 off = m_frame_size % m_uniform_buffer_alignment;
-    m_frame_size += off;
+    // Written data is bound as uniform or shader storage buffer, so offsets have to satisfy both alignments.
+    g_int uniform_buffer_alignment;
+    g_int shader_storage_buffer_alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &shader_storage_buffer_alignment);
+    m_offset_alignment = std::max(uniform_buffer_alignment, shader_storage_buffer_alignment);
+    m_frame_size       = ((m_frame_size + m_offset_alignment - 1) / m_offset_alignment) * m_offset_alignment;
     MANGO_LOG_DEBUG("Frame Size: {0} Byte!", m_frame_size);
 
     m_gpu_buffer_size      = m_frame_size + (static_cast<int8>(m_technique) + 1) * m_frame_size;
@@ -70,9 +75,9 @@ g_sync* gpu_buffer::end_frame()
 int64 gpu_buffer::write_data(int64 size, void* data)
 {
     PROFILE_ZONE;
-    int64 to_add = m_uniform_buffer_alignment;
+    int64 to_add = m_offset_alignment;
     while (to_add < static_cast<int64>(size))
-        to_add += m_uniform_buffer_alignment;
+        to_add += m_offset_alignment;
 
     MANGO_ASSERT(m_local_offset < m_frame_size - to_add, "Frame size is too small.");
     memcpy(static_cast<g_byte*>(m_mapping) + m_global_offset, data, size);
@@ -21,12 +21,20 @@ namespace mango
 
 //! \brief Slot for the model data uniform buffer.
 #define UB_SLOT_MODEL_DATA 2
-//! \brief Slot for the material uniform buffer.
-#define UB_SLOT_MATERIAL_DATA 3
+//! \brief Slot for the shader storage buffer with the material table.
+#define SSB_SLOT_MATERIAL_TABLE 3
 //! \brief Slot for the material uniform buffer.
 #define UB_SLOT_LIGHT_DATA 4
 //! \brief Slot for the cubemap step uniform buffer.
 #define UB_SLOT_CUBEMAP_DATA 5
+//! \brief Slot for the shader storage buffer with the per instance model data of instanced draws.
+#define SSB_SLOT_INSTANCE_DATA 7
+//! \brief Slot for the shader storage buffer with the per draw data of multi draw indirect calls.
+#define SSB_SLOT_INDIRECT_DRAW_DATA 8
+//! \brief Slot for the shader storage buffer with the bounds tested in the occlusion culling compute shader.
+#define SSB_SLOT_OCCLUSION_BOUNDS 9
+//! \brief Slot for the shader storage buffer the occlusion culling compute shader writes the visibility to.
+#define SSB_SLOT_OCCLUSION_VISIBILITY 10
 
 // Shared buffer binding points
 
@@ -79,6 +87,7 @@ namespace mango
         g_sync* end_frame();
 
         //! \brief Gives the \a gpu_buffer data to write into memory.
+        //! \details The returned offset can be bound as uniform and as shader storage buffer.
         //! \param[in] size The size of data in bytes.
         //! \param[in] data Pointer to the data to write into the buffer memory.
         //! \return The offset in the buffer the data is written to.
@@ -117,8 +126,8 @@ namespace mango
         int64 m_local_offset;
         //! \brief The last local offset (last frame offset).
         int64 m_last_offset;
-        //! \brief Uniform buffer alignment. Queried from OpenGl.
-        g_int m_uniform_buffer_alignment;
+        //! \brief Offset alignment of written data, the larger of the uniform and shader storage buffer alignment. Queried from OpenGl.
+        g_int m_offset_alignment;
 
         //! \brief The internal buffer.
         buffer_ptr m_gpu_buffer;
@@ -542,6 +542,11 @@ namespace mango
         depth_component16  = 0x81a5,
         depth_component24  = 0x81a6,
         depth_component32  = 0x81a7,
+        // compressed internal formats
+        compressed_red_rgtc1             = 0x8dbb,
+        compressed_rg_rgtc2              = 0x8dbd,
+        compressed_rgba_bptc_unorm       = 0x8e8c,
+        compressed_srgb_alpha_bptc_unorm = 0x8e8d,
         // pixel formats
         depth_component = 0x1902,
         stencil_index   = 0x1901,
@@ -726,6 +731,10 @@ namespace mango
             number_of_components = 4;
             normalized           = true;
             return GL_UNSIGNED_INT;
+        case format::t_int_2_10_10_10_rev:
+            number_of_components = 4;
+            normalized           = true;
+            return GL_INT_2_10_10_10_REV;
         default:
             MANGO_ASSERT(false, "Invalid format! Could also be, that I did not think of adding this here!");
             return GL_NONE;
@@ -907,6 +916,34 @@ namespace mango
         }
     }
 
+    //! \brief Returns the size of one 4x4 block of a compressed internal format.
+    //! \param[in] internal_format The compressed internal format.
+    //! \return The size of one block in bytes or 0 if the format is not compressed.
+    inline int32 get_compressed_block_size(const format& internal_format)
+    {
+        switch (internal_format)
+        {
+        case format::compressed_red_rgtc1:
+            return 8;
+        case format::compressed_rg_rgtc2:
+        case format::compressed_rgba_bptc_unorm:
+        case format::compressed_srgb_alpha_bptc_unorm:
+            return 16;
+        default:
+            return 0;
+        }
+    }
+
+    //! \brief Returns the size of one mipmap level of a compressed \a texture.
+    //! \param[in] internal_format The compressed internal format.
+    //! \param[in] width The width of the level in pixels.
+    //! \param[in] height The height of the level in pixels.
+    //! \return The size of the level in bytes.
+    inline int64 get_compressed_level_size(const format& internal_format, int32 width, int32 height)
+    {
+        return static_cast<int64>((width + 3) / 4) * static_cast<int64>((height + 3) / 4) * get_compressed_block_size(internal_format);
+    }
+
     //! \brief Returns internal format, format and type for an image depending on a few infos.
     //! \param[in] srgb True if image is in standard color space, else False.
     //! \param[in] components The number of components in the image.
@@ -1475,7 +1512,8 @@ namespace mango
         transform_feedback_barrier_bit,
         atomic_counter_barrier_bit,
         shader_storage_barrier_bit,
-        query_buffer_barrier_bit
+        query_buffer_barrier_bit,
+        client_mapped_buffer_barrier_bit
     };
     //! \brief Converts a \a memory_barrier_bit to an OpenGl enumeration value.
     //! \param[in] barrier_bit The \a memory_barrier_bit to convert.
@@ -1512,12 +1550,29 @@ namespace mango
             return GL_SHADER_STORAGE_BARRIER_BIT;
         case memory_barrier_bit::query_buffer_barrier_bit:
             return GL_QUERY_BUFFER_BARRIER_BIT;
+        case memory_barrier_bit::client_mapped_buffer_barrier_bit:
+            return GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT;
         default:
             MANGO_LOG_WARN("Unknown memory barrier bit.");
             return GL_NONE;
         }
     }
 
+    //! \brief Checks if an OpenGl extension is supported by the current context.
+    //! \param[in] name The name of the extension.
+    //! \return True if the extension is supported, else False.
+    inline bool is_gl_extension_supported(const string& name)
+    {
+        g_int count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (g_int i = 0; i < count; ++i)
+        {
+            if (name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<g_uint>(i))))
+                return true;
+        }
+        return false;
+    }
+
 } // namespace mango
 
 #endif // MANGO_GRAPHICS_COMMON_HPP
\ No newline at end of file
@@ -118,7 +118,7 @@ namespace mango
         const static int32 max_texture_bindings = 16; // TODO Paul: We should really define these things somewhere else. And query from OpenGL.
 
         //! \brief The maximum number of buffer slot (not really, just supported by the state).
-        const static int32 max_buffer_slots = 8; // TODO Paul: We should really define these things somewhere else. And query from OpenGL.
+        const static int32 max_buffer_slots = 16; // TODO Paul: We should really define these things somewhere else. And query from OpenGL.
 
         //! \brief Structure to cache the state of the graphics pipeline.
         struct internal_state
@@ -4,6 +4,7 @@
 //! \date      2020
 //! \copyright Apache License 2.0
 
+#include <algorithm>
 #include <glad/glad.h>
 #include <graphics/impl/texture_impl.hpp>
 
@@ -18,6 +19,7 @@ texture_impl::texture_impl(const texture_configuration& configuration)
     , m_generate_mipmaps(configuration.generate_mipmaps)
     , m_is_cubemap(configuration.is_cubemap)
     , m_layers(configuration.layers)
+    , m_bindless_handle(0)
 {
     g_enum type = GL_TEXTURE_2D;
 
@@ -45,10 +47,27 @@ texture_impl::~texture_impl()
 void texture_impl::release()
 {
     MANGO_ASSERT(is_created(), "Texture not created!");
+    if (m_bindless_handle)
+    {
+        glMakeTextureHandleNonResidentARB(m_bindless_handle);
+        m_bindless_handle = 0;
+    }
     glDeleteTextures(1, &m_name);
     m_name = 0; // This is needed for is_created();
 }
 
+uint64 texture_impl::get_bindless_handle()
+{
+    MANGO_ASSERT(is_created(), "Texture not created!");
+    MANGO_ASSERT(GLAD_GL_ARB_bindless_texture, "Bindless textures are not supported!");
+    if (!m_bindless_handle)
+    {
+        m_bindless_handle = glGetTextureHandleARB(m_name);
+        glMakeTextureHandleResidentARB(m_bindless_handle);
+    }
+    return m_bindless_handle;
+}
+
 void texture_impl::set_data(format internal_format, int32 width, int32 height, format pixel_format, format type, const void* data, int32 layer)
 {
     MANGO_ASSERT(is_created(), "Texture not created!");
@@ -105,3 +124,34 @@ void texture_impl::set_data(format internal_format, int32 width, int32 height, f
         }
     }
 }
+
+void texture_impl::set_compressed_data(format internal_format, int32 width, int32 height, int32 levels, const void* data)
+{
+    MANGO_ASSERT(is_created(), "Texture not created!");
+    MANGO_ASSERT(width > 0, "Texture width is invalid!");
+    MANGO_ASSERT(height > 0, "Texture height is invalid!");
+    MANGO_ASSERT(levels > 0 && levels <= calculate_mip_count(width, height), "Texture level count is invalid!");
+    MANGO_ASSERT(!m_is_cubemap && m_layers == 1, "Compressed data is only supported for two dimensional textures!");
+    MANGO_ASSERT(get_compressed_block_size(internal_format) > 0, "Texture format is not compressed!");
+    MANGO_ASSERT(data, "Compressed texture data is null!");
+    m_width            = width;
+    m_height           = height;
+    m_format           = internal_format;
+    m_internal_format  = internal_format;
+    m_component_type   = format::t_unsigned_byte;
+    m_generate_mipmaps = levels;
+
+    glTextureStorage2D(m_name, static_cast<g_sizei>(levels), static_cast<g_enum>(internal_format), static_cast<g_sizei>(width), static_cast<g_sizei>(height));
+
+    // The levels are uploaded one after another, the smaller ones are not generated.
+    const uint8* level_data = static_cast<const uint8*>(data);
+    for (int32 level = 0; level < levels; ++level)
+    {
+        const int32 level_width  = std::max(width >> level, 1);
+        const int32 level_height = std::max(height >> level, 1);
+        const int64 level_size   = get_compressed_level_size(internal_format, level_width, level_height);
+        glCompressedTextureSubImage2D(m_name, level, 0, 0, static_cast<g_sizei>(level_width), static_cast<g_sizei>(level_height), static_cast<g_enum>(internal_format),
+                                      static_cast<g_sizei>(level_size), level_data);
+        level_data += level_size;
+    }
+}
@@ -85,7 +85,10 @@ namespace mango
             return m_layers;
         }
 
+        uint64 get_bindless_handle() override;
+
         void set_data(format internal_format, int32 width, int32 height, format pixel_format, format type, const void* data, int32 layer) override;
+        void set_compressed_data(format internal_format, int32 width, int32 height, int32 levels, const void* data) override;
         void release() override;
 
       private:
@@ -115,6 +118,8 @@ namespace mango
         bool m_is_cubemap;
         //! \brief The number of layers.
         int32 m_layers;
+        //! \brief The resident bindless handle, 0 if not requested yet.
+        uint64 m_bindless_handle;
     };
 } // namespace mango
 
@@ -123,6 +123,10 @@ namespace mango
         //! \brief Returns the number of layers of the \a texture.
         //! \return The number of layers.
         virtual int32 layers() = 0;
+        //! \brief Returns the bindless handle of the \a texture and makes it resident on first use.
+        //! \details Needs GL_ARB_bindless_texture. After the first call the parameters and storage of the \a texture are immutable.
+        //! \return The resident bindless handle of the \a texture.
+        virtual uint64 get_bindless_handle() = 0;
 
         //! \brief Sets the data of the \a texture.
         //! \param[in] internal_format The internal \a texture \a format to use. Has to be \a r8, \a r16, \a r16f, \a r32f, \a r8i, \a r16i, \a r32i, \a r8ui, \a r16ui, \a r32ui, \a rg8, \a rg16,
@@ -139,6 +143,16 @@ namespace mango
         //! \param[in] layer The layer of the \a texture to set the data. Has to be a positive value.
         virtual void set_data(format internal_format, int32 width, int32 height, format pixel_format, format type, const void* data,  int32 layer = 0) = 0;
 
+        //! \brief Sets the data of the \a texture from block compressed data including all mipmap levels.
+        //! \details Only supported for two dimensional textures. The mipmaps are not generated, the levels have to be included in the data.
+        //! \param[in] internal_format The compressed internal \a texture \a format to use. Has to be \a compressed_red_rgtc1, \a compressed_rg_rgtc2,
+        //! \a compressed_rgba_bptc_unorm or \a compressed_srgb_alpha_bptc_unorm.
+        //! \param[in] width The width of the \a texture. Has to be a positive value.
+        //! \param[in] height The height of the \a texture. Has to be a positive value.
+        //! \param[in] levels The number of mipmap levels in the data. Has to be a positive value.
+        //! \param[in] data The compressed levels, tightly packed and starting with the biggest one.
+        virtual void set_compressed_data(format internal_format, int32 width, int32 height, int32 levels, const void* data) = 0;
+
         //! \brief Releases the \a texture.
         virtual void release() = 0;
 
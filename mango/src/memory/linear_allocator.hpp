@@ -24,6 +24,20 @@ namespace mango
 
         void reset() override;
 
+        //! \brief Returns the memory already allocated since the last reset.
+        //! \return The used memory in bytes.
+        inline int64 used_memory() const
+        {
+            return m_offset;
+        }
+
+        //! \brief Returns the memory still available for allocations.
+        //! \return The available memory in bytes.
+        inline int64 available_memory() const
+        {
+            return m_total_size - m_offset;
+        }
+
       private:
         //! \brief The current offset from the memory start.
         int64 m_offset;
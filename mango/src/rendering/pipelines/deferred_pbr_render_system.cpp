@@ -4,6 +4,7 @@
 //! \date      2020
 //! \copyright Apache License 2.0
 
+#include <algorithm>
 #include <core/window_system_impl.hpp>
 #include <glad/glad.h>
 #include <graphics/buffer.hpp>
@@ -15,6 +16,7 @@
 #include <mango/profile.hpp>
 #include <mango/scene.hpp>
 #include <rendering/pipelines/deferred_pbr_render_system.hpp>
+#include <scene/culling.hpp>
 #include <util/helpers.hpp>
 
 using namespace mango;
@@ -35,9 +37,43 @@ texture_ptr default_texture_array;
 //! \brief Default material.
 material_ptr default_material;
 
+//! \brief Checks if a sync placed by a \a fence_sync_command is signaled.
+//! \param[in] sync The sync to check.
+//! \param[in] wait True to wait until the sync is signaled, False to only check.
+//! \return True if the sync is signaled or was never placed, else False.
+static bool is_sync_signaled(g_sync sync, bool wait)
+{
+    if (!glIsSync(sync))
+        return true;
+    g_enum wait_return = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (wait && wait_return == GL_TIMEOUT_EXPIRED)
+        wait_return = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+    return wait_return == GL_ALREADY_SIGNALED || wait_return == GL_CONDITION_SATISFIED;
+}
+
 deferred_pbr_render_system::deferred_pbr_render_system(const shared_ptr<context_impl>& context)
     : render_system_impl(context)
+    , m_retained_slot_count(0)
+    , m_retained_slot_size(0)
+    , m_retained_commands_changed(false)
+    , m_retained_start_command(-1)
+    , m_retained_start_viewport(0)
+    , m_retained_start_wireframe(false)
+    , m_retained_static_meshes(false)
+    , m_frame_number(0)
+    , m_material_table_dirty_begin(0)
+    , m_material_table_dirty_end(0)
+    , m_material_table_capacity(0)
+    , m_multi_draw_indirect(false)
+    , m_bindless_textures(false)
+    , m_occlusion_mapping(nullptr)
+    , m_occlusion_culling(false)
 {
+    for (int32 i = 0; i < occlusion_buffer_parts; ++i)
+    {
+        m_occlusion_syncs[i]   = nullptr;
+        m_occlusion_pending[i] = false;
+    }
 }
 
 deferred_pbr_render_system::~deferred_pbr_render_system() {}
@@ -99,14 +135,16 @@ bool deferred_pbr_render_system::create_renderer_resources()
     m_renderer_info.canvas.width  = w;
     m_renderer_info.canvas.height = h;
 
-    m_begin_render_commands   = command_buffer<min_key>::create(512);
-    m_global_binding_commands = command_buffer<min_key>::create(256);
-    m_gbuffer_commands        = command_buffer<max_key>::create(524288 * 2); // 1.0 MiB?
-    m_transparent_commands    = command_buffer<max_key>::create(524288 * 2); // 1.0 MiB?
-    m_lighting_pass_commands  = command_buffer<min_key>::create(512);
-    m_exposure_commands       = command_buffer<min_key>::create(512);
-    m_composite_commands      = command_buffer<min_key>::create(256);
-    m_finish_render_commands  = command_buffer<min_key>::create(256);
+    m_begin_render_commands     = command_buffer<min_key>::create(512);
+    m_global_binding_commands   = command_buffer<min_key>::create(256);
+    m_gbuffer_commands          = command_buffer<max_key>::create(524288 * 2); // 1.0 MiB?
+    m_retained_gbuffer_commands = command_buffer<max_key>::create(524288 * 2); // 1.0 MiB?
+    m_transparent_commands      = command_buffer<max_key>::create(524288 * 2); // 1.0 MiB?
+    m_occlusion_commands        = command_buffer<min_key>::create(2048);
+    m_lighting_pass_commands    = command_buffer<min_key>::create(512);
+    m_exposure_commands         = command_buffer<min_key>::create(512);
+    m_composite_commands        = command_buffer<min_key>::create(256);
+    m_finish_render_commands    = command_buffer<min_key>::create(256);
 
     texture_configuration attachment_config;
     attachment_config.generate_mipmaps        = 1;
@@ -190,6 +228,21 @@ bool deferred_pbr_render_system::create_renderer_resources()
     if (!m_frame_uniform_buffer->init(524288 * 2, buffer_technique::triple_buffering)) // Triple Buffering with 1 MiB per Frame.
         return false;
 
+    // retained mesh buffer
+    g_int uniform_buffer_alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
+    int64 alignment      = static_cast<int64>(uniform_buffer_alignment);
+    m_retained_slot_size = ((static_cast<int64>(sizeof(model_data)) + alignment - 1) / alignment) * alignment;
+    if (!grow_retained_mesh_buffer())
+        return false;
+
+    // material table buffer
+    m_material_table_capacity = 256;
+    buffer_configuration material_table_config(m_material_table_capacity * sizeof(material_table_entry), buffer_target::shader_storage_buffer, buffer_access::dynamic_storage);
+    m_material_table_buffer = buffer::create(material_table_config);
+    if (!check_creation(m_material_table_buffer.get(), "material table buffer"))
+        return false;
+
     // scene geometry pass
     shader_configuration shader_config;
     shader_config.path = "res/shader/forward/v_scene_gltf.glsl";
@@ -327,7 +380,39 @@ void deferred_pbr_render_system::configure(const render_configuration& configura
 {
     PROFILE_ZONE;
     m_vsync = configuration.is_vsync_enabled();
-    auto ws = m_shared_context->get_window_system_internal().lock();
+    if (m_retained_static_meshes && !configuration.is_retained_static_meshes_enabled())
+    {
+        for (auto& rm : m_retained_meshes)
+            m_free_retained_slots.push_back(rm.second.slot);
+        m_retained_meshes.clear();
+        m_retained_gbuffer_commands->invalidate();
+        m_retained_start_command = -1;
+    }
+    m_retained_static_meshes = configuration.is_retained_static_meshes_enabled();
+    m_multi_draw_indirect    = configuration.is_multi_draw_indirect_enabled();
+    bool bindless_textures   = m_multi_draw_indirect && configuration.is_bindless_textures_enabled();
+    if (bindless_textures && !is_gl_extension_supported("GL_ARB_bindless_texture"))
+    {
+        MANGO_LOG_WARN("Bindless textures are not supported. Falling back to texture binds!");
+        bindless_textures = false;
+    }
+    if (m_multi_draw_indirect && (!m_scene_geometry_pass_indirect || bindless_textures != m_bindless_textures) && !create_indirect_geometry_pass(bindless_textures))
+    {
+        MANGO_LOG_WARN("Multi draw indirect submission is not supported. Falling back to single draws!");
+        m_multi_draw_indirect = false;
+        bindless_textures     = false;
+    }
+    m_bindless_textures    = bindless_textures;
+    bool occlusion_culling = configuration.is_occlusion_culling_enabled();
+    if (occlusion_culling && !m_occlusion_test && !create_occlusion_culling_resources())
+    {
+        MANGO_LOG_WARN("Occlusion culling resources could not be created. Occlusion culling is disabled!");
+        occlusion_culling = false;
+    }
+    if (!occlusion_culling)
+        m_occluded_entities.clear();
+    m_occlusion_culling = occlusion_culling;
+    auto ws             = m_shared_context->get_window_system_internal().lock();
     MANGO_ASSERT(ws, "Window System is expired!");
     ws->set_vsync(m_vsync);
 
@@ -354,6 +439,100 @@ void deferred_pbr_render_system::configure(const render_configuration& configura
     }
 }
 
+bool deferred_pbr_render_system::create_indirect_geometry_pass(bool bindless_textures)
+{
+    PROFILE_ZONE;
+    // gl_DrawIDARB is needed to fetch the per draw data.
+    if (!is_gl_extension_supported("GL_ARB_shader_draw_parameters"))
+        return false;
+
+    shader_configuration shader_config;
+    shader_config.path = "res/shader/forward/v_scene_gltf.glsl";
+    shader_config.type = shader_type::vertex_shader;
+    shader_config.defines.push_back({ "GBUFFER_PREPASS", "" });
+    shader_config.defines.push_back({ "MULTI_DRAW_INDIRECT", "" });
+    shader_config.defines.push_back({ "VERTEX", "" });
+    shader_ptr d_vertex = shader::create(shader_config);
+    shader_config.defines.clear();
+    if (!check_creation(d_vertex.get(), "indirect geometry pass vertex shader"))
+        return false;
+
+    shader_config.path = "res/shader/forward/f_scene_gltf.glsl";
+    shader_config.type = shader_type::fragment_shader;
+    shader_config.defines.push_back({ "GBUFFER_PREPASS", "" });
+    shader_config.defines.push_back({ "MULTI_DRAW_INDIRECT", "" });
+    if (bindless_textures)
+        shader_config.defines.push_back({ "BINDLESS_TEXTURES", "" });
+    shader_config.defines.push_back({ "FRAGMENT", "" });
+    shader_ptr d_fragment = shader::create(shader_config);
+    shader_config.defines.clear();
+    if (!check_creation(d_fragment.get(), "indirect geometry pass fragment shader"))
+        return false;
+
+    m_scene_geometry_pass_indirect = shader_program::create_graphics_pipeline(d_vertex, nullptr, nullptr, nullptr, d_fragment);
+    return check_creation(m_scene_geometry_pass_indirect.get(), "indirect geometry pass shader program");
+}
+
+bool deferred_pbr_render_system::create_occlusion_culling_resources()
+{
+    PROFILE_ZONE;
+    shader_configuration shader_config;
+    shader_config.path        = "res/shader/occlusion_compute/c_hi_z_construction.glsl";
+    shader_config.type        = shader_type::compute_shader;
+    shader_ptr construct_hi_z = shader::create(shader_config);
+    if (!check_creation(construct_hi_z.get(), "hierarchical z construction compute shader"))
+        return false;
+
+    m_construct_hi_z = shader_program::create_compute_pipeline(construct_hi_z);
+    if (!check_creation(m_construct_hi_z.get(), "hierarchical z construction compute shader program"))
+        return false;
+
+    shader_config.path        = "res/shader/occlusion_compute/c_occlusion_test.glsl";
+    shader_config.type        = shader_type::compute_shader;
+    shader_ptr occlusion_test = shader::create(shader_config);
+    if (!check_creation(occlusion_test.get(), "occlusion test compute shader"))
+        return false;
+
+    m_occlusion_test = shader_program::create_compute_pipeline(occlusion_test);
+    if (!check_creation(m_occlusion_test.get(), "occlusion test compute shader program"))
+    {
+        m_occlusion_test = nullptr;
+        return false;
+    }
+
+    buffer_configuration b_config;
+    b_config.access    = buffer_access::mapped_access_read_write;
+    b_config.size      = occlusion_buffer_parts * occlusion_part_size;
+    b_config.target    = buffer_target::shader_storage_buffer;
+    m_occlusion_buffer = buffer::create(b_config);
+
+    m_occlusion_mapping = static_cast<uint8*>(m_occlusion_buffer->map(0, b_config.size, buffer_access::mapped_access_read_write));
+    if (!check_mapping(m_occlusion_mapping, "occlusion data") || !create_hi_z_texture(m_renderer_info.canvas.width, m_renderer_info.canvas.height))
+    {
+        m_occlusion_test = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool deferred_pbr_render_system::create_hi_z_texture(int32 width, int32 height)
+{
+    texture_configuration hi_z_config;
+    hi_z_config.generate_mipmaps        = calculate_mip_count(width, height);
+    hi_z_config.is_standard_color_space = false;
+    hi_z_config.texture_min_filter      = texture_parameter::filter_nearest;
+    hi_z_config.texture_mag_filter      = texture_parameter::filter_nearest;
+    hi_z_config.texture_wrap_s          = texture_parameter::wrap_clamp_to_edge;
+    hi_z_config.texture_wrap_t          = texture_parameter::wrap_clamp_to_edge;
+
+    m_hi_z_texture = texture::create(hi_z_config);
+    if (!check_creation(m_hi_z_texture.get(), "hierarchical z texture"))
+        return false;
+    m_hi_z_texture->set_data(format::r32f, width, height, format::red, format::t_float, nullptr);
+    return true;
+}
+
 void deferred_pbr_render_system::setup_cubemap_step(const cubemap_step_configuration& configuration)
 {
     if (m_pipeline_steps[mango::render_step::cubemap])
@@ -385,6 +564,11 @@ void deferred_pbr_render_system::begin_render()
 {
     PROFILE_ZONE;
     m_active_model.material_id            = 0;
+    m_active_model.material_index         = -1;
+    m_active_model.mesh_active            = false;
+    m_active_model.material_active        = false;
+    m_active_model.data_buffer_name       = 0;
+    m_frame_number++;
     m_renderer_info.last_frame.draw_calls = 0;
     m_renderer_info.last_frame.vertices   = 0;
     m_renderer_info.last_frame.triangles  = 0;
@@ -392,8 +576,28 @@ void deferred_pbr_render_system::begin_render()
     m_renderer_info.last_frame.primitives = 0;
     m_renderer_info.last_frame.materials  = 0;
 
+    m_renderer_info.last_frame.retained_primitives  = 0;
+    m_renderer_info.last_frame.patched_primitives   = 0;
+    m_renderer_info.last_frame.recorded_primitives  = 0;
+    m_renderer_info.last_frame.eliminated_commands  = 0;
+    m_renderer_info.last_frame.instanced_primitives = 0;
+    m_renderer_info.last_frame.indirect_primitives  = 0;
+    m_renderer_info.last_frame.uploaded_materials   = 0;
+
+    m_renderer_info.last_frame.visible_primitives       = 0;
+    m_renderer_info.last_frame.culled_primitives        = 0;
+    m_renderer_info.last_frame.culled_shadow_primitives = 0;
+    m_renderer_info.last_frame.occluded_primitives      = 0;
+    m_instancing_candidates.clear();
+    m_retired_retained_mesh_buffers.clear();
+
+    if (m_occlusion_culling)
+        read_occlusion_results();
+
     clear_framebuffers();
     setup_gbuffer_pass();
+    if (m_retained_static_meshes)
+        setup_retained_gbuffer_pass();
     if (m_lighting_pass_commands->dirty())
         setup_lighting_pass();
 
@@ -458,35 +662,62 @@ void deferred_pbr_render_system::clear_framebuffers()
 }
 
 void deferred_pbr_render_system::setup_gbuffer_pass()
+{
+    record_gbuffer_start(m_gbuffer_commands);
+}
+
+int64 deferred_pbr_render_system::record_gbuffer_start(const command_buffer_ptr<max_key>& draw_buffer)
 {
     max_key k = command_keys::create_key<max_key>(command_keys::key_template::max_key_material_front_to_back);
     command_keys::add_base_mode(k, command_keys::base_mode::to_front);
-    set_depth_test_command* sdt      = m_gbuffer_commands->create<set_depth_test_command>(k);
+    set_depth_test_command* sdt      = draw_buffer->create<set_depth_test_command>(k);
+    int64 command_index              = draw_buffer->size() - 1;
     sdt->enabled                     = true;
-    set_depth_func_command* sdf      = m_gbuffer_commands->append<set_depth_func_command, set_depth_test_command>(sdt);
+    set_depth_func_command* sdf      = draw_buffer->append<set_depth_func_command, set_depth_test_command>(sdt);
     sdf->operation                   = compare_operation::less;
-    set_cull_face_command* scf       = m_gbuffer_commands->append<set_cull_face_command, set_depth_func_command>(sdf);
+    set_cull_face_command* scf       = draw_buffer->append<set_cull_face_command, set_depth_func_command>(sdf);
     scf->face                        = polygon_face::face_back;
-    set_polygon_offset_command* spo  = m_gbuffer_commands->append<set_polygon_offset_command, set_cull_face_command>(scf);
+    set_polygon_offset_command* spo  = draw_buffer->append<set_polygon_offset_command, set_cull_face_command>(scf);
     spo->factor                      = 0.0f;
     spo->units                       = 0.0f;
-    bind_framebuffer_command* bf     = m_gbuffer_commands->append<bind_framebuffer_command, set_polygon_offset_command>(spo);
+    bind_framebuffer_command* bf     = draw_buffer->append<bind_framebuffer_command, set_polygon_offset_command>(spo);
     bf->framebuffer_name             = m_gbuffer->get_name();
-    bind_shader_program_command* bsp = m_gbuffer_commands->append<bind_shader_program_command, bind_framebuffer_command>(bf);
+    bind_shader_program_command* bsp = draw_buffer->append<bind_shader_program_command, bind_framebuffer_command>(bf);
     bsp->shader_program_name         = m_scene_geometry_pass->get_name();
-    set_viewport_command* sv         = m_gbuffer_commands->append<set_viewport_command, bind_shader_program_command>(bsp);
+    set_viewport_command* sv         = draw_buffer->append<set_viewport_command, bind_shader_program_command>(bsp);
     sv->x                            = m_renderer_info.canvas.x;
     sv->y                            = m_renderer_info.canvas.y;
     sv->width                        = m_renderer_info.canvas.width;
     sv->height                       = m_renderer_info.canvas.height;
-    set_blending_command* bl         = m_gbuffer_commands->append<set_blending_command, set_viewport_command>(sv);
+    set_blending_command* bl         = draw_buffer->append<set_blending_command, set_viewport_command>(sv);
     bl->enabled                      = false;
     if (m_wireframe)
     {
-        set_polygon_mode_command* spm = m_gbuffer_commands->append<set_polygon_mode_command, set_blending_command>(bl);
+        set_polygon_mode_command* spm = draw_buffer->append<set_polygon_mode_command, set_blending_command>(bl);
         spm->face                     = polygon_face::face_front_and_back;
         spm->mode                     = polygon_mode::line;
     }
+    return command_index;
+}
+
+void deferred_pbr_render_system::setup_retained_gbuffer_pass()
+{
+    glm::ivec4 viewport = glm::ivec4(m_renderer_info.canvas.x, m_renderer_info.canvas.y, m_renderer_info.canvas.width, m_renderer_info.canvas.height);
+    if (m_retained_start_command >= 0 && m_retained_start_viewport == viewport && m_retained_start_wireframe == m_wireframe)
+        return;
+    if (m_retained_start_command >= 0)
+        m_retained_gbuffer_commands->remove(m_retained_start_command);
+    m_retained_start_command    = record_gbuffer_start(m_retained_gbuffer_commands);
+    m_retained_start_viewport   = viewport;
+    m_retained_start_wireframe  = m_wireframe;
+    m_retained_commands_changed = true;
+}
+
+void deferred_pbr_render_system::reset_retained_gbuffer_commands()
+{
+    m_retained_gbuffer_commands->invalidate();
+    m_retained_start_command = -1;
+    setup_retained_gbuffer_pass();
 }
 
 void deferred_pbr_render_system::setup_lighting_pass()
@@ -649,6 +880,13 @@ void deferred_pbr_render_system::finish_render(float dt)
         return;
     }
 
+    // Record the opaque draws before the shadow step executes.
+    record_instancing_candidates(shadow_command_buffer);
+
+    // Upload the changed materials and bind the material table.
+    if (!upload_material_table())
+        MANGO_LOG_ERROR("Material table could not be uploaded!");
+
     static float camera_exposure = 1.0f; // TODO Paul: Does the static variable here make sense?
     if (camera.camera_info && !m_lighting_pass_data.debug_view_enabled)
         camera_exposure = apply_exposure(camera); // with last frames data.
@@ -692,6 +930,10 @@ void deferred_pbr_render_system::finish_render(float dt)
         step_cubemap->execute(m_frame_uniform_buffer);
     }
 
+    // Occlusion culling compute shaders.
+    if (m_occlusion_culling && camera.camera_info)
+        calculate_occlusion(camera);
+
     // Auto exposure compute shaders.
     if (camera.camera_info && camera.camera_info->physical.adaptive_exposure && !m_lighting_pass_data.debug_view_enabled)
         calculate_auto_exposure(dt);
@@ -709,6 +951,10 @@ void deferred_pbr_render_system::finish_render(float dt)
 
     end_frame_and_sync();
 
+    if (m_retained_static_meshes)
+        release_unused_retained_meshes();
+    release_unused_materials();
+
     // Execute commands.
     execute_commands(cubemap_command_buffer, shadow_command_buffer, fxaa_command_buffer);
 }
@@ -760,6 +1006,156 @@ void deferred_pbr_render_system::finalize_lighting_pass(const std::shared_ptr<sh
     da->instance_count      = 1;
 }
 
+void deferred_pbr_render_system::calculate_occlusion(camera_data& camera)
+{
+    int32 part        = static_cast<int32>(m_frame_number % occlusion_buffer_parts);
+    int32 query_count = static_cast<int32>(m_occlusion_entities[part].size());
+    if (query_count == 0)
+        return;
+
+    // Hierarchical z construction, the first level copies the gbuffer depth.
+    bind_shader_program_command* bsp = m_occlusion_commands->create<bind_shader_program_command>(command_keys::no_sort);
+    bsp->shader_program_name         = m_construct_hi_z->get_name();
+
+    int32 level_count = m_hi_z_texture->mipmaps();
+    int32 width       = m_hi_z_texture->get_width();
+    int32 height      = m_hi_z_texture->get_height();
+    for (int32 level = 0; level < level_count; ++level)
+    {
+        bind_texture_command* bt = m_occlusion_commands->create<bind_texture_command>(command_keys::no_sort);
+        bt->binding              = 0;
+        bt->sampler_location     = 0;
+        bt->texture_name         = level == 0 ? m_gbuffer->get_attachment(framebuffer_attachment::depth_attachment)->get_name() : m_hi_z_texture->get_name();
+
+        bind_image_texture_command* bit = m_occlusion_commands->create<bind_image_texture_command>(command_keys::no_sort);
+        bit->binding                    = 0;
+        bit->texture_name               = m_hi_z_texture->get_name();
+        bit->level                      = level;
+        bit->layered                    = false;
+        bit->layer                      = 0;
+        bit->access                     = base_access::write_only;
+        bit->element_format             = format::r32f;
+
+        glm::ivec2 params                = glm::ivec2(glm::max(level - 1, 0), 0);
+        bind_single_uniform_command* bsu = m_occlusion_commands->create<bind_single_uniform_command>(command_keys::no_sort, sizeof(params));
+        bsu->count                       = 1;
+        bsu->location                    = 1;
+        bsu->type                        = shader_resource_type::ivec2;
+        bsu->uniform_value               = m_occlusion_commands->map_spare<bind_single_uniform_command>();
+        memcpy(bsu->uniform_value, &params, sizeof(params));
+
+        dispatch_compute_command* dc = m_occlusion_commands->create<dispatch_compute_command>(command_keys::no_sort);
+        dc->num_x_groups             = (glm::max(width >> level, 1) + 7) / 8;
+        dc->num_y_groups             = (glm::max(height >> level, 1) + 7) / 8;
+        dc->num_z_groups             = 1;
+
+        add_memory_barrier_command* amb = m_occlusion_commands->create<add_memory_barrier_command>(command_keys::no_sort);
+        amb->barrier_bit                = memory_barrier_bit::texture_fetch_barrier_bit;
+    }
+
+    // Occlusion test of the bounds written this frame.
+    bsp                      = m_occlusion_commands->create<bind_shader_program_command>(command_keys::no_sort);
+    bsp->shader_program_name = m_occlusion_test->get_name();
+
+    bind_texture_command* bt = m_occlusion_commands->create<bind_texture_command>(command_keys::no_sort);
+    bt->binding              = 0;
+    bt->sampler_location     = 0;
+    bt->texture_name         = m_hi_z_texture->get_name();
+
+    glm::mat4 view_projection        = camera.camera_info->view_projection;
+    bind_single_uniform_command* bsu = m_occlusion_commands->create<bind_single_uniform_command>(command_keys::no_sort, sizeof(view_projection));
+    bsu->count                       = 1;
+    bsu->location                    = 1;
+    bsu->type                        = shader_resource_type::mat4;
+    bsu->uniform_value               = m_occlusion_commands->map_spare<bind_single_uniform_command>();
+    memcpy(bsu->uniform_value, &view_projection, sizeof(view_projection));
+
+    glm::ivec2 params  = glm::ivec2(query_count, level_count);
+    bsu                = m_occlusion_commands->create<bind_single_uniform_command>(command_keys::no_sort, sizeof(params));
+    bsu->count         = 1;
+    bsu->location      = 2;
+    bsu->type          = shader_resource_type::ivec2;
+    bsu->uniform_value = m_occlusion_commands->map_spare<bind_single_uniform_command>();
+    memcpy(bsu->uniform_value, &params, sizeof(params));
+
+    int64 part_offset       = part * occlusion_part_size;
+    bind_buffer_command* bb = m_occlusion_commands->create<bind_buffer_command>(command_keys::no_sort);
+    bb->index               = SSB_SLOT_OCCLUSION_BOUNDS;
+    bb->buffer_name         = m_occlusion_buffer->get_name();
+    bb->offset              = part_offset;
+    bb->target              = buffer_target::shader_storage_buffer;
+    bb->size                = query_count * sizeof(occlusion_bounds);
+
+    bb              = m_occlusion_commands->create<bind_buffer_command>(command_keys::no_sort);
+    bb->index       = SSB_SLOT_OCCLUSION_VISIBILITY;
+    bb->buffer_name = m_occlusion_buffer->get_name();
+    bb->offset      = part_offset + max_occlusion_queries * sizeof(occlusion_bounds);
+    bb->target      = buffer_target::shader_storage_buffer;
+    bb->size        = query_count * sizeof(uint32);
+
+    dispatch_compute_command* dc = m_occlusion_commands->create<dispatch_compute_command>(command_keys::no_sort);
+    dc->num_x_groups             = (query_count + 63) / 64;
+    dc->num_y_groups             = 1;
+    dc->num_z_groups             = 1;
+
+    // The results are read back through the persistent mapping, once the sync is signaled.
+    add_memory_barrier_command* amb = m_occlusion_commands->create<add_memory_barrier_command>(command_keys::no_sort);
+    amb->barrier_bit                = memory_barrier_bit::client_mapped_buffer_barrier_bit;
+
+    fence_sync_command* fs = m_occlusion_commands->create<fence_sync_command>(command_keys::no_sort);
+    fs->sync               = &m_occlusion_syncs[part];
+
+    m_occlusion_pending[part] = true;
+}
+
+void deferred_pbr_render_system::read_occlusion_results()
+{
+    PROFILE_ZONE;
+    int32 current = static_cast<int32>(m_frame_number % occlusion_buffer_parts);
+
+    // Newest first. The gpu finishes the tests in order, so older results are outdated then.
+    for (int32 age = 1; age < occlusion_buffer_parts; ++age)
+    {
+        int32 part = (current + occlusion_buffer_parts - age) % occlusion_buffer_parts;
+        if (!m_occlusion_pending[part] || !is_sync_signaled(m_occlusion_syncs[part], false))
+            continue;
+
+        const uint32* visibility            = reinterpret_cast<const uint32*>(m_occlusion_mapping + part * occlusion_part_size + max_occlusion_queries * sizeof(occlusion_bounds));
+        const std::vector<entity>& entities = m_occlusion_entities[part];
+        m_occluded_entities.clear();
+        for (int32 i = 0; i < static_cast<int32>(entities.size()); ++i)
+        {
+            if (visibility[i] == 0)
+                m_occluded_entities.insert(entities[i]);
+        }
+
+        for (int32 older = age; older < occlusion_buffer_parts; ++older)
+            m_occlusion_pending[(current + occlusion_buffer_parts - older) % occlusion_buffer_parts] = false;
+        break;
+    }
+
+    // The part written this frame can still be in use, if its results were never read back.
+    if (m_occlusion_pending[current])
+    {
+        is_sync_signaled(m_occlusion_syncs[current], true);
+        m_occlusion_pending[current] = false;
+    }
+    m_occlusion_entities[current].clear();
+}
+
+void deferred_pbr_render_system::add_occlusion_query(entity mesh_entity, const axis_aligned_bounding_box& world_bounds)
+{
+    int32 part                    = static_cast<int32>(m_frame_number % occlusion_buffer_parts);
+    std::vector<entity>& entities = m_occlusion_entities[part];
+    if (static_cast<int32>(entities.size()) >= max_occlusion_queries)
+        return;
+
+    occlusion_bounds* bounds = reinterpret_cast<occlusion_bounds*>(m_occlusion_mapping + part * occlusion_part_size) + entities.size();
+    bounds->bounds_min       = glm::vec4(world_bounds.min, 0.0f);
+    bounds->bounds_max       = glm::vec4(world_bounds.max, 0.0f);
+    entities.push_back(mesh_entity);
+}
+
 void deferred_pbr_render_system::calculate_auto_exposure(float dt)
 {
     bind_shader_program_command* bsp = m_exposure_commands->create<bind_shader_program_command>(command_keys::no_sort);
@@ -917,6 +1313,9 @@ void deferred_pbr_render_system::execute_commands(const command_buffer_ptr<min_k
             shadow_command_buffer->sort();
         // This has to sort the commands so that the max_key_to_start is executed before the objects get rendered (and these would be perfect by material and from front to back).
         m_gbuffer_commands->sort();
+        if (m_retained_commands_changed)
+            m_retained_gbuffer_commands->sort();
+        m_retained_commands_changed = false;
         // m_lighting_pass_commands->sort(); // They do not need to be sorted atm.
         // cubemap_command_buffer->sort(); // They do not need to be sorted atm.
         m_transparent_commands->sort();
@@ -924,6 +1323,16 @@ void deferred_pbr_render_system::execute_commands(const command_buffer_ptr<min_k
         // m_composite_commands->sort(); // They do not need to be sorted atm.
         // m_finish_render_commands->sort(); // They do not need to be sorted.
     }
+    {
+        NAMED_PROFILE_ZONE("Eliminate Redundant State")
+        // Only for buffers that get invalidated after execution, the elimination relinks the commands.
+        int64 eliminated = 0;
+        if (shadow_command_buffer)
+            eliminated += shadow_command_buffer->eliminate_redundant_state();
+        eliminated += m_gbuffer_commands->eliminate_redundant_state();
+        eliminated += m_transparent_commands->eliminate_redundant_state();
+        m_renderer_info.last_frame.eliminated_commands = static_cast<int32>(eliminated);
+    }
     {
         NAMED_PROFILE_ZONE("Deferred Renderer Begin")
         GL_NAMED_PROFILE_ZONE("Deferred Renderer Begin");
@@ -948,6 +1357,17 @@ void deferred_pbr_render_system::execute_commands(const command_buffer_ptr<min_k
         m_gbuffer_commands->execute();
         m_gbuffer_commands->invalidate();
     }
+    {
+        NAMED_PROFILE_ZONE("Retained GBuffer Commands Execute")
+        GL_NAMED_PROFILE_ZONE("Retained GBuffer Commands Execute");
+        m_retained_gbuffer_commands->execute(); // Not invalidated, the commands are patched.
+    }
+    {
+        NAMED_PROFILE_ZONE("Occlusion Commands Execute")
+        GL_NAMED_PROFILE_ZONE("Occlusion Commands Execute");
+        m_occlusion_commands->execute();
+        m_occlusion_commands->invalidate();
+    }
     {
         NAMED_PROFILE_ZONE("Lighting Commands Execute")
         GL_NAMED_PROFILE_ZONE("Lighting Commands Execute");
@@ -1006,6 +1426,12 @@ void deferred_pbr_render_system::set_viewport(int32 x, int32 y, int32 width, int
     m_hdr_buffer->resize(width, height);
     m_post_buffer->resize(width, height);
     m_begin_render_commands->invalidate();
+    if (m_hi_z_texture && !create_hi_z_texture(width, height))
+    {
+        MANGO_LOG_WARN("Hierarchical z texture could not be resized. Occlusion culling is disabled!");
+        m_occlusion_culling = false;
+        m_occluded_entities.clear();
+    }
 
     m_renderer_info.canvas.x      = x;
     m_renderer_info.canvas.y      = y;
@@ -1026,21 +1452,38 @@ render_pipeline deferred_pbr_render_system::get_base_render_pipeline()
     return render_pipeline::deferred_pbr;
 }
 
-void deferred_pbr_render_system::begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents)
+void deferred_pbr_render_system::begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents, entity mesh_entity, mesh_visibility visibility,
+                                            const axis_aligned_bounding_box* world_bounds)
 {
     PROFILE_ZONE;
 
-    model_data d{ model_matrix, std140_mat3(glm::mat3(glm::transpose(glm::inverse(model_matrix)))), has_normals, has_tangents, 0, 0 };
-
-    int64 offset                     = m_frame_uniform_buffer->write_data(sizeof(d), &d);
-    m_active_model.model_data_offset = offset;
+    // The model_data is written on demand, retained meshes do not need it every frame.
+    m_active_model.model_data_offset = -1;
+    m_active_model.mesh_entity       = mesh_entity;
+    m_active_model.model_matrix      = model_matrix;
+    m_active_model.visibility        = visibility;
+    m_active_model.has_normals       = has_normals;
+    m_active_model.has_tangents      = has_tangents;
     m_active_model.position          = glm::vec3(model_matrix[3]);
+    m_active_model.mesh_active       = true;
+
+    if (m_occlusion_culling && world_bounds && is_valid(*world_bounds) && mesh_entity != invalid_entity && (visibility & mesh_visibility::camera) != mesh_visibility::none)
+    {
+        // Tested every frame, so skipped meshes get drawn again as soon as they get visible.
+        add_occlusion_query(mesh_entity, *world_bounds);
+        if (m_occluded_entities.count(mesh_entity) > 0)
+        {
+            m_active_model.visibility = visibility & mesh_visibility::shadow;
+            m_renderer_info.last_frame.occluded_primitives++;
+        }
+    }
 }
 
 void deferred_pbr_render_system::end_mesh()
 {
-    m_active_model.model_data_offset    = -1;
-    m_active_model.material_data_offset = -1;
+    m_active_model.model_data_offset = -1;
+    m_active_model.mesh_active       = false;
+    m_active_model.material_active   = false;
     m_renderer_info.last_frame.meshes++;
 }
 
@@ -1062,7 +1505,8 @@ void deferred_pbr_render_system::use_material(const material_ptr& mat)
         shadow_command_buffer = std::static_pointer_cast<shadow_map_step>(m_pipeline_steps[mango::render_step::shadow_map])->get_shadow_commands();
     }
 
-    material_data d;
+    material_data& d = m_active_model.material;
+    d                = material_data();
 
     d.base_color     = static_cast<glm::vec4>(m->base_color);
     d.emissive_color = static_cast<glm::vec3>(m->emissive_color);
@@ -1125,16 +1569,163 @@ void deferred_pbr_render_system::use_material(const material_ptr& mat)
     d.alpha_mode   = static_cast<g_int>(m->alpha_rendering);
     d.alpha_cutoff = static_cast<g_float>(m->alpha_cutoff);
 
+    if (m_bindless_textures)
+    {
+        // Makes the textures resident on first use.
+        uint64* handles = m_active_model.texture_handles;
+        handles[0]      = (m->use_base_color_texture ? m->base_color_texture : default_texture)->get_bindless_handle();
+        handles[1]      = (m->use_roughness_metallic_texture ? m->roughness_metallic_texture : default_texture)->get_bindless_handle();
+        handles[2]      = (m->use_occlusion_texture ? m->occlusion_texture : default_texture)->get_bindless_handle();
+        handles[3]      = (m->use_normal_texture ? m->normal_texture : default_texture)->get_bindless_handle();
+        handles[4]      = (m->use_emissive_color_texture ? m->emissive_color_texture : default_texture)->get_bindless_handle();
+    }
+
     m_active_model.blend        = m->alpha_rendering == alpha_mode::mode_blend;
     m_active_model.face_culling = !m->double_sided;
 
-    int64 offset                        = m_frame_uniform_buffer->write_data(sizeof(d), &d);
-    m_active_model.material_data_offset = offset;
+    // The material is only uploaded when it changed, the model_data references it by index.
+    int32 material_index = update_material_table(m);
+    if (material_index != m_active_model.material_index)
+        m_active_model.model_data_offset = -1;
+    m_active_model.material_index  = material_index;
+    m_active_model.material_active = true;
 
     m_active_model.material_id = m_active_model.create_material_id(d);
 }
 
-void deferred_pbr_render_system::draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count)
+void deferred_pbr_render_system::write_active_model_data()
+{
+    g_uint frame_buffer_name = m_frame_uniform_buffer->buffer_name();
+    if (m_active_model.data_buffer_name != frame_buffer_name)
+    {
+        m_active_model.model_data_offset = -1;
+        m_active_model.data_buffer_name  = frame_buffer_name;
+    }
+    if (m_active_model.model_data_offset < 0)
+    {
+        const glm::mat4& model_matrix = m_active_model.model_matrix;
+        model_data d{ model_matrix, std140_mat3(glm::mat3(glm::transpose(glm::inverse(model_matrix)))), m_active_model.has_normals, m_active_model.has_tangents, false,
+                      m_active_model.material_index };
+
+        m_active_model.model_data_offset = m_frame_uniform_buffer->write_data(sizeof(d), &d);
+    }
+}
+
+int32 deferred_pbr_render_system::update_material_table(const material_ptr& mat)
+{
+    auto it      = m_material_slots.find(mat.get());
+    bool created = it == m_material_slots.end();
+    if (created)
+    {
+        material_table_slot slot;
+        if (!m_free_material_indices.empty())
+        {
+            slot.index = m_free_material_indices.back();
+            m_free_material_indices.pop_back();
+        }
+        else
+        {
+            slot.index = static_cast<int32>(m_material_table.size());
+            m_material_table.emplace_back();
+        }
+        it = m_material_slots.emplace(mat.get(), slot).first;
+    }
+    material_table_slot& slot = it->second;
+    slot.last_frame           = m_frame_number;
+    // A new material can get the address of a destroyed one, it takes over the entry.
+    if (created || slot.owner.expired())
+        slot.owner = mat;
+
+    material_table_entry& entry = m_material_table[slot.index];
+    uint64 texture_handles[6]   = { 0 };
+    if (m_bindless_textures)
+        memcpy(texture_handles, m_active_model.texture_handles, sizeof(m_active_model.texture_handles));
+
+    bool changed = created || memcmp(&entry.material, &m_active_model.material, sizeof(material_data)) != 0 || memcmp(entry.texture_handles, texture_handles, sizeof(texture_handles)) != 0;
+    if (changed)
+    {
+        entry.material = m_active_model.material;
+        memcpy(entry.texture_handles, texture_handles, sizeof(texture_handles));
+        if (m_material_table_dirty_begin >= m_material_table_dirty_end)
+        {
+            m_material_table_dirty_begin = slot.index;
+            m_material_table_dirty_end   = slot.index + 1;
+        }
+        else
+        {
+            m_material_table_dirty_begin = std::min(m_material_table_dirty_begin, slot.index);
+            m_material_table_dirty_end   = std::max(m_material_table_dirty_end, slot.index + 1);
+        }
+    }
+
+    return slot.index;
+}
+
+bool deferred_pbr_render_system::upload_material_table()
+{
+    PROFILE_ZONE;
+    int32 table_size = static_cast<int32>(m_material_table.size());
+    if (table_size > m_material_table_capacity)
+    {
+        int32 capacity = std::max(2 * m_material_table_capacity, table_size);
+
+        buffer_configuration b_config(capacity * sizeof(material_table_entry), buffer_target::shader_storage_buffer, buffer_access::dynamic_storage);
+        buffer_ptr grown_buffer = buffer::create(b_config);
+        if (!check_creation(grown_buffer.get(), "material table buffer"))
+            return false;
+
+        // The buffer changed, so the whole table has to be uploaded again.
+        m_material_table_buffer      = grown_buffer;
+        m_material_table_capacity    = capacity;
+        m_material_table_dirty_begin = 0;
+        m_material_table_dirty_end   = table_size;
+    }
+
+    if (m_material_table_dirty_begin < m_material_table_dirty_end)
+    {
+        int64 offset = m_material_table_dirty_begin * sizeof(material_table_entry);
+        int64 size   = (m_material_table_dirty_end - m_material_table_dirty_begin) * sizeof(material_table_entry);
+
+        // The update is executed with the global bindings, before anything is drawn.
+        update_buffer_data_command* ubd = m_global_binding_commands->create<update_buffer_data_command>(command_keys::no_sort, size);
+        g_byte* data                    = static_cast<g_byte*>(m_global_binding_commands->map_spare<update_buffer_data_command>());
+        memcpy(data, &m_material_table[m_material_table_dirty_begin], size);
+        ubd->buffer_name = m_material_table_buffer->get_name();
+        ubd->offset      = offset;
+        ubd->size        = size;
+        ubd->data        = data;
+
+        m_renderer_info.last_frame.uploaded_materials += m_material_table_dirty_end - m_material_table_dirty_begin;
+        m_material_table_dirty_begin = 0;
+        m_material_table_dirty_end   = 0;
+    }
+
+    bind_buffer_command* bb = m_global_binding_commands->create<bind_buffer_command>(command_keys::no_sort);
+    bb->target              = buffer_target::shader_storage_buffer;
+    bb->index               = SSB_SLOT_MATERIAL_TABLE;
+    bb->size                = m_material_table_capacity * sizeof(material_table_entry);
+    bb->buffer_name         = m_material_table_buffer->get_name();
+    bb->offset              = 0;
+
+    return true;
+}
+
+void deferred_pbr_render_system::release_unused_materials()
+{
+    PROFILE_ZONE;
+    for (auto it = m_material_slots.begin(); it != m_material_slots.end();)
+    {
+        if (!it->second.owner.expired() && m_frame_number - it->second.last_frame < material_release_frames)
+        {
+            ++it;
+            continue;
+        }
+        m_free_material_indices.push_back(it->second.index);
+        it = m_material_slots.erase(it);
+    }
+}
+
+void deferred_pbr_render_system::draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count, int32 base_vertex)
 {
     PROFILE_ZONE;
 
@@ -1156,8 +1747,18 @@ void deferred_pbr_render_system::draw_mesh(const vertex_array_ptr& vertex_array,
     if (camera.active_camera_entity == invalid_entity)
         return;
 
-    if (m_active_model.blend)
+    // Culled meshes are only recorded for the passes they are visible in.
+    bool camera_visible = (m_active_model.visibility & mesh_visibility::camera) != mesh_visibility::none;
+    bool shadow_visible = (m_active_model.visibility & mesh_visibility::shadow) != mesh_visibility::none;
+
+    bool retained = false;
+    if (camera_visible && m_retained_static_meshes && !m_active_model.blend && m_active_model.mesh_entity != invalid_entity)
+        retained = draw_retained_mesh(vertex_array, topology, first, count, type, instance_count, base_vertex);
+
+    if (camera_visible && m_active_model.blend)
     {
+        write_active_model_data();
+
         max_key k      = command_keys::create_key<max_key>(command_keys::key_template::max_key_back_to_front);
         float distance = glm::distance(m_active_model.position, camera.transform->position);
         float depth    = glm::clamp(distance / (camera.camera_info->z_far - camera.camera_info->z_near), 0.0f, 1.0f); // TODO Paul: Do the correct calculation...
@@ -1215,6 +1816,7 @@ void deferred_pbr_render_system::draw_mesh(const vertex_array_ptr& vertex_array,
             de->first                 = first;
             de->count                 = count;
             de->type                  = type;
+            de->base_vertex           = base_vertex;
             de->instance_count        = instance_count;
             m_renderer_info.last_frame.draw_calls++;
             m_renderer_info.last_frame.vertices += (instance_count * count);
@@ -1232,6 +1834,7 @@ void deferred_pbr_render_system::draw_mesh(const vertex_array_ptr& vertex_array,
                 de->first          = first;
                 de->count          = count;
                 de->type           = type;
+                de->base_vertex    = base_vertex;
                 de->instance_count = instance_count;
                 m_renderer_info.last_frame.draw_calls++;
                 m_renderer_info.last_frame.vertices += (instance_count * count);
@@ -1247,133 +1850,371 @@ void deferred_pbr_render_system::draw_mesh(const vertex_array_ptr& vertex_array,
         cleanup_texture_bindings(m_transparent_commands, bva);
 #endif // MANGO_DEBUG
     }
-    else
+
+    int64 gbuffer_candidate = -1;
+    if (camera_visible && !m_active_model.blend && !retained)
     {
-        // Normal GBuffer rendering
+        // Normal GBuffer rendering, recorded in finish_render() to merge identical draws.
         max_key k = command_keys::create_key<max_key>(command_keys::key_template::max_key_material_front_to_back);
         command_keys::add_material(k, m_active_model.material_id);
         float distance = glm::distance(m_active_model.position, camera.transform->position);
         float depth    = glm::clamp(distance / (camera.camera_info->z_far - camera.camera_info->z_near), 0.0f, 1.0f); // TODO Paul: Do the correct calculation...
         command_keys::add_depth(k, depth, command_keys::key_template::max_key_material_front_to_back);
 
-        bind_texture_command* bt = begin_mesh_draw(m_gbuffer_commands, k);
+        gbuffer_candidate = add_instancing_candidate(vertex_array, topology, first, count, type, instance_count, base_vertex, k, false);
+        m_renderer_info.last_frame.primitives++;
+        m_renderer_info.last_frame.materials++;
+    }
 
-        set_face_culling_command* sfc = m_gbuffer_commands->append<set_face_culling_command, bind_texture_command>(bt);
-        sfc->enabled                  = m_active_model.face_culling;
+    // Same for shadow buffer
+    if (shadow_command_buffer && shadow_visible)
+    {
+        max_key k = command_keys::create_key<max_key>(command_keys::key_template::max_key_material_front_to_back);
+        command_keys::add_material(k, m_active_model.material_id);
+        float distance = glm::distance(m_active_model.position, camera.transform->position);
+        float depth    = glm::clamp(distance / (camera.camera_info->z_far - camera.camera_info->z_near), 0.0f, 1.0f); // TODO Paul: Do the correct calculation...
+        command_keys::add_depth(k, depth, command_keys::key_template::max_key_material_front_to_back);
 
-        bind_vertex_array_command* bva = m_gbuffer_commands->append<bind_vertex_array_command, set_face_culling_command>(sfc);
-        bva->vertex_array_name         = vertex_array->get_name();
+        add_instancing_candidate(vertex_array, topology, first, count, type, instance_count, base_vertex, k, true, gbuffer_candidate);
+    }
+}
 
-        if (type == index_type::none)
+int64 deferred_pbr_render_system::add_instancing_candidate(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count,
+                                                           int32 base_vertex, max_key mesh_key, bool shadow_pass, int64 data_owner)
+{
+    int64 index = static_cast<int64>(m_instancing_candidates.size());
+    m_instancing_candidates.emplace_back();
+    instancing_candidate& c = m_instancing_candidates.back();
+
+    memset(&c.state, 0, sizeof(instancing_state));
+    c.state.material_index    = m_active_model.material_index;
+    c.state.texture_names[0]  = m_active_model.base_color_texture_name;
+    c.state.texture_names[1]  = m_active_model.roughness_metallic_texture_name;
+    c.state.texture_names[2]  = m_active_model.occlusion_texture_name;
+    c.state.texture_names[3]  = m_active_model.normal_texture_name;
+    c.state.texture_names[4]  = m_active_model.emissive_color_texture_name;
+    c.state.vertex_array_name = vertex_array->get_name();
+    c.state.first             = first;
+    c.state.count             = count;
+    c.state.instance_count    = instance_count;
+    c.state.base_vertex       = base_vertex;
+    c.state.topology          = topology;
+    c.state.type              = type;
+    c.state.shadow_pass       = shadow_pass;
+    c.state.face_culling      = m_active_model.face_culling;
+    c.state.has_normals       = m_active_model.has_normals;
+    c.state.has_tangents      = m_active_model.has_tangents;
+
+    c.key          = mesh_key;
+    c.model_matrix = m_active_model.model_matrix;
+    c.data_owner   = data_owner < 0 ? index : data_owner;
+    c.recorded     = false;
+
+    // Retained meshes already have their data in the retained mesh buffer.
+    bool written        = m_active_model.model_data_offset >= 0;
+    c.data_buffer_name  = written ? m_active_model.data_buffer_name : m_frame_uniform_buffer->buffer_name();
+    c.model_data_offset = written ? m_active_model.model_data_offset : -1;
+
+    return index;
+}
+
+void deferred_pbr_render_system::record_instancing_candidates(const command_buffer_ptr<max_key>& shadow_command_buffer)
+{
+    PROFILE_ZONE;
+    if (m_multi_draw_indirect)
+        record_indirect_draws();
+
+    m_instancing_order.clear();
+    for (int64 i = 0; i < static_cast<int64>(m_instancing_candidates.size()); ++i)
+    {
+        if (!m_instancing_candidates[i].recorded)
+            m_instancing_order.push_back(i);
+    }
+    int64 candidate_count = static_cast<int64>(m_instancing_order.size());
+
+    // Sort by state, so that identical draws form runs. In a run the smallest key comes first.
+    std::sort(m_instancing_order.begin(), m_instancing_order.end(), [this](int64 a, int64 b) {
+        const instancing_candidate& ca = m_instancing_candidates[a];
+        const instancing_candidate& cb = m_instancing_candidates[b];
+        int32 cmp                      = memcmp(&ca.state, &cb.state, sizeof(instancing_state));
+        return cmp < 0 || (cmp == 0 && ca.key < cb.key);
+    });
+
+    for (int64 i = 0; i < candidate_count;)
+    {
+        const instancing_candidate& c             = m_instancing_candidates[m_instancing_order[i]];
+        const command_buffer_ptr<max_key>& buffer = c.state.shadow_pass ? shadow_command_buffer : m_gbuffer_commands;
+
+        int64 run = 1;
+        if (c.state.instance_count == 1)
         {
-            draw_arrays_command* da = m_gbuffer_commands->append<draw_arrays_command, bind_vertex_array_command>(bva);
-            da->topology            = topology;
-            da->first               = first;
-            da->count               = count;
-            da->instance_count      = instance_count;
-            m_renderer_info.last_frame.draw_calls++;
-            m_renderer_info.last_frame.primitives++;
-            m_renderer_info.last_frame.vertices += (instance_count * count);
-            m_renderer_info.last_frame.triangles += (instance_count * count / 3);
-            m_renderer_info.last_frame.materials++;
-#ifdef MANGO_DEBUG
-            bva                    = m_gbuffer_commands->append<bind_vertex_array_command, draw_arrays_command>(da);
-            bva->vertex_array_name = 0;
-#endif // MANGO_DEBUG
+            while (i + run < candidate_count && run < max_instances_per_draw &&
+                   memcmp(&c.state, &m_instancing_candidates[m_instancing_order[i + run]].state, sizeof(instancing_state)) == 0)
+                run++;
         }
-        else
+
+        if (run == 1)
         {
-            draw_elements_command* de = m_gbuffer_commands->append<draw_elements_command, bind_vertex_array_command>(bva);
-            de->topology              = topology;
-            de->first                 = first;
-            de->count                 = count;
-            de->type                  = type;
-            de->instance_count        = instance_count;
-            m_renderer_info.last_frame.draw_calls++;
-            m_renderer_info.last_frame.primitives++;
-            m_renderer_info.last_frame.vertices += (instance_count * count);
-            m_renderer_info.last_frame.triangles += (instance_count * count / 3);
-            m_renderer_info.last_frame.materials++;
-#ifdef MANGO_DEBUG
-            bva                    = m_gbuffer_commands->append<bind_vertex_array_command, draw_elements_command>(de);
-            bva->vertex_array_name = 0;
-#endif // MANGO_DEBUG
+            write_candidate_data(m_instancing_order[i]);
+            record_opaque_draw(buffer, m_instancing_candidates[m_instancing_order[i]], c.state.instance_count, -1);
+            i++;
+            continue;
         }
 
-#ifdef MANGO_DEBUG
-        cleanup_texture_bindings(m_gbuffer_commands, bva);
-#endif // MANGO_DEBUG
+        m_instance_data.resize(run);
+        for (int64 r = 0; r < run; ++r)
+        {
+            const glm::mat4& model_matrix    = m_instancing_candidates[m_instancing_order[i + r]].model_matrix;
+            m_instance_data[r].model_matrix  = model_matrix;
+            m_instance_data[r].normal_matrix = glm::mat4(glm::mat3(glm::transpose(glm::inverse(model_matrix))));
+        }
+
+        // The model_data of an instanced draw only carries the per draw values.
+        instancing_candidate instanced = c;
+        model_data d{ glm::mat4(1.0f), std140_mat3(glm::mat3(1.0f)), c.state.has_normals, c.state.has_tangents, true, c.state.material_index };
+        instanced.data_buffer_name  = m_frame_uniform_buffer->buffer_name();
+        instanced.model_data_offset = m_frame_uniform_buffer->write_data(sizeof(d), &d);
+        int64 instance_data_offset  = m_frame_uniform_buffer->write_data(run * sizeof(instance_data), m_instance_data.data());
+
+        record_opaque_draw(buffer, instanced, static_cast<int32>(run), instance_data_offset);
+        if (!c.state.shadow_pass)
+            m_renderer_info.last_frame.instanced_primitives += static_cast<int32>(run);
+        i += run;
     }
 
-    // Same for shadow buffer
-    if (shadow_command_buffer)
+    m_instancing_candidates.clear();
+}
+
+void deferred_pbr_render_system::record_indirect_draws()
+{
+    PROFILE_ZONE;
+    m_indirect_order.clear();
+    for (int64 i = 0; i < static_cast<int64>(m_instancing_candidates.size()); ++i)
     {
-        max_key k = command_keys::create_key<max_key>(command_keys::key_template::max_key_material_front_to_back);
-        command_keys::add_material(k, m_active_model.material_id);
-        float distance = glm::distance(m_active_model.position, camera.transform->position);
-        float depth    = glm::clamp(distance / (camera.camera_info->z_far - camera.camera_info->z_near), 0.0f, 1.0f); // TODO Paul: Do the correct calculation...
-        command_keys::add_depth(k, depth, command_keys::key_template::max_key_material_front_to_back);
+        const instancing_state& state = m_instancing_candidates[i].state;
+        if (!state.shadow_pass && state.type != index_type::none && state.instance_count == 1)
+            m_indirect_order.push_back(i);
+    }
+    if (m_indirect_order.empty())
+        return;
+
+    // Sort so that draws which can be packed into one call form runs.
+    auto batch_compare = [this](int64 a, int64 b) -> int32 {
+        const instancing_state& sa = m_instancing_candidates[a].state;
+        const instancing_state& sb = m_instancing_candidates[b].state;
+        if (sa.vertex_array_name != sb.vertex_array_name)
+            return sa.vertex_array_name < sb.vertex_array_name ? -1 : 1;
+        if (sa.type != sb.type)
+            return sa.type < sb.type ? -1 : 1;
+        if (sa.topology != sb.topology)
+            return sa.topology < sb.topology ? -1 : 1;
+        if (sa.face_culling != sb.face_culling)
+            return sa.face_culling < sb.face_culling ? -1 : 1;
+        // Bindless textures are read from the material table, so they do not need to be the same.
+        if (m_bindless_textures)
+            return 0;
+        return memcmp(sa.texture_names, sb.texture_names, sizeof(sa.texture_names));
+    };
+    std::sort(m_indirect_order.begin(), m_indirect_order.end(), [this, &batch_compare](int64 a, int64 b) {
+        int32 cmp = batch_compare(a, b);
+        return cmp < 0 || (cmp == 0 && m_instancing_candidates[a].key < m_instancing_candidates[b].key);
+    });
+
+    // All calls are recorded in one package sorted behind the single draws. It restores the default geometry pass afterwards.
+    max_key k = command_keys::create_key<max_key>(command_keys::key_template::max_key_material_front_to_back);
+    command_keys::add_base_mode(k, command_keys::base_mode::to_back);
+    bind_shader_program_command* bsp = m_gbuffer_commands->create<bind_shader_program_command>(k);
+    bsp->shader_program_name         = m_scene_geometry_pass_indirect->get_name();
 
-        bind_texture_command* bt = begin_mesh_draw(shadow_command_buffer, k, true);
+    multi_draw_elements_indirect_command* mdei = nullptr;
+    int64 order_count                          = static_cast<int64>(m_indirect_order.size());
+    for (int64 i = 0; i < order_count;)
+    {
+        int64 batch = 1;
+        while (i + batch < order_count && batch < max_draws_per_indirect_call && batch_compare(m_indirect_order[i], m_indirect_order[i + batch]) == 0)
+            batch++;
 
-        bind_vertex_array_command* bva = shadow_command_buffer->append<bind_vertex_array_command, bind_texture_command>(bt);
-        bva->vertex_array_name         = vertex_array->get_name();
+        const instancing_state& state = m_instancing_candidates[m_indirect_order[i]].state;
+        int64 index_size              = state.type == index_type::ubyte ? 1 : (state.type == index_type::ushort ? 2 : 4);
 
-        if (type == index_type::none)
+        m_indirect_draw_data.resize(batch);
+        m_indirect_parameters.resize(batch);
+        for (int64 b = 0; b < batch; ++b)
         {
-            draw_arrays_command* da = shadow_command_buffer->append<draw_arrays_command, bind_vertex_array_command>(bva);
-            da->topology            = topology;
-            da->first               = first;
-            da->count               = count;
-            da->instance_count      = instance_count;
-            m_renderer_info.last_frame.draw_calls++;
-            m_renderer_info.last_frame.vertices += (instance_count * count);
-            m_renderer_info.last_frame.triangles += (instance_count * count / 3);
-#ifdef MANGO_DEBUG
-            bva                    = shadow_command_buffer->append<bind_vertex_array_command, draw_arrays_command>(da);
-            bva->vertex_array_name = 0;
-#endif // MANGO_DEBUG
+            instancing_candidate& c       = m_instancing_candidates[m_indirect_order[i + b]];
+            const glm::mat4& model_matrix = c.model_matrix;
+            model_data d{ model_matrix, std140_mat3(glm::mat3(glm::transpose(glm::inverse(model_matrix)))), c.state.has_normals, c.state.has_tangents, false, c.state.material_index };
+            m_indirect_draw_data[b].model = d;
+
+            draw_elements_indirect_parameters& p = m_indirect_parameters[b];
+            p.count                              = static_cast<g_uint>(c.state.count);
+            p.instance_count                     = 1;
+            p.first_index                        = static_cast<g_uint>(c.state.first / index_size);
+            p.base_vertex                        = c.state.base_vertex;
+            p.base_instance                      = 0;
+
+            c.recorded = true;
         }
+
+        bind_buffer_command* bb;
+        if (mdei)
+            bb = m_gbuffer_commands->append<bind_buffer_command, multi_draw_elements_indirect_command>(mdei);
         else
+            bb = m_gbuffer_commands->append<bind_buffer_command, bind_shader_program_command>(bsp);
+        bb->target      = buffer_target::shader_storage_buffer;
+        bb->index       = SSB_SLOT_INDIRECT_DRAW_DATA;
+        bb->size        = batch * sizeof(indirect_draw_data);
+        bb->buffer_name = m_frame_uniform_buffer->buffer_name();
+        bb->offset      = m_frame_uniform_buffer->write_data(bb->size, m_indirect_draw_data.data());
+
+        set_face_culling_command* sfc;
+        if (m_bindless_textures)
         {
-            draw_elements_command* de = shadow_command_buffer->append<draw_elements_command, bind_vertex_array_command>(bva);
-            de->topology              = topology;
-            de->first                 = first;
-            de->count                 = count;
-            de->type                  = type;
-            de->instance_count        = instance_count;
-            m_renderer_info.last_frame.draw_calls++;
-            m_renderer_info.last_frame.vertices += (instance_count * count);
-            m_renderer_info.last_frame.triangles += (instance_count * count / 3);
+            sfc = m_gbuffer_commands->append<set_face_culling_command, bind_buffer_command>(bb);
+        }
+        else
+        {
+            m_active_model.base_color_texture_name         = state.texture_names[0];
+            m_active_model.roughness_metallic_texture_name = state.texture_names[1];
+            m_active_model.occlusion_texture_name          = state.texture_names[2];
+            m_active_model.normal_texture_name             = state.texture_names[3];
+            m_active_model.emissive_color_texture_name     = state.texture_names[4];
+            bind_texture_command* bt                       = bind_material_textures(m_gbuffer_commands, bb);
+            sfc                                            = m_gbuffer_commands->append<set_face_culling_command, bind_texture_command>(bt);
+        }
+        sfc->enabled = state.face_culling;
+
+        bind_vertex_array_command* bva = m_gbuffer_commands->append<bind_vertex_array_command, set_face_culling_command>(sfc);
+        bva->vertex_array_name         = state.vertex_array_name;
+
+        mdei                       = m_gbuffer_commands->append<multi_draw_elements_indirect_command, bind_vertex_array_command>(bva);
+        mdei->topology             = state.topology;
+        mdei->type                 = state.type;
+        mdei->indirect_buffer_name = m_frame_uniform_buffer->buffer_name();
+        mdei->offset               = m_frame_uniform_buffer->write_data(batch * sizeof(draw_elements_indirect_parameters), m_indirect_parameters.data());
+        mdei->draw_count           = static_cast<int32>(batch);
+
+        for (int64 b = 0; b < batch; ++b)
+        {
+            int32 count = m_instancing_candidates[m_indirect_order[i + b]].state.count;
+            m_renderer_info.last_frame.vertices += count;
+            m_renderer_info.last_frame.triangles += count / 3;
+        }
+        m_renderer_info.last_frame.draw_calls++;
+        m_renderer_info.last_frame.indirect_primitives += static_cast<int32>(batch);
+        i += batch;
+    }
+
+    bsp                      = m_gbuffer_commands->append<bind_shader_program_command, multi_draw_elements_indirect_command>(mdei);
+    bsp->shader_program_name = m_scene_geometry_pass->get_name();
+
 #ifdef MANGO_DEBUG
-            bva                    = shadow_command_buffer->append<bind_vertex_array_command, draw_elements_command>(de);
-            bva->vertex_array_name = 0;
+    bind_vertex_array_command* bva = m_gbuffer_commands->append<bind_vertex_array_command, bind_shader_program_command>(bsp);
+    bva->vertex_array_name         = 0;
+    cleanup_texture_bindings(m_gbuffer_commands, bva);
 #endif // MANGO_DEBUG
-        }
+}
+
+void deferred_pbr_render_system::write_candidate_data(int64 index)
+{
+    instancing_candidate& owner = m_instancing_candidates[m_instancing_candidates[index].data_owner];
+    if (owner.model_data_offset < 0)
+    {
+        const glm::mat4& model_matrix = owner.model_matrix;
+        model_data d{ model_matrix, std140_mat3(glm::mat3(glm::transpose(glm::inverse(model_matrix)))), owner.state.has_normals, owner.state.has_tangents, false,
+                      owner.state.material_index };
+
+        owner.model_data_offset = m_frame_uniform_buffer->write_data(sizeof(d), &d);
+    }
+
+    instancing_candidate& c = m_instancing_candidates[index];
+    c.data_buffer_name      = owner.data_buffer_name;
+    c.model_data_offset     = owner.model_data_offset;
+}
 
+void deferred_pbr_render_system::record_opaque_draw(const command_buffer_ptr<max_key>& draw_buffer, const instancing_candidate& candidate, int32 instance_count, int64 instance_data_offset)
+{
+    const instancing_state& state = candidate.state;
+
+    // begin_mesh_draw() binds from the model cache.
+    m_active_model.data_buffer_name                = candidate.data_buffer_name;
+    m_active_model.model_data_offset               = candidate.model_data_offset;
+    m_active_model.base_color_texture_name         = state.texture_names[0];
+    m_active_model.roughness_metallic_texture_name = state.texture_names[1];
+    m_active_model.occlusion_texture_name          = state.texture_names[2];
+    m_active_model.normal_texture_name             = state.texture_names[3];
+    m_active_model.emissive_color_texture_name     = state.texture_names[4];
+
+    bind_texture_command* bt = begin_mesh_draw(draw_buffer, candidate.key, state.shadow_pass, instance_data_offset, instance_count * sizeof(instance_data));
+
+    bind_vertex_array_command* bva;
+    if (!state.shadow_pass)
+    {
+        set_face_culling_command* sfc = draw_buffer->append<set_face_culling_command, bind_texture_command>(bt);
+        sfc->enabled                  = state.face_culling;
+
+        bva = draw_buffer->append<bind_vertex_array_command, set_face_culling_command>(sfc);
+    }
+    else
+        bva = draw_buffer->append<bind_vertex_array_command, bind_texture_command>(bt);
+    bva->vertex_array_name = state.vertex_array_name;
+
+    if (state.type == index_type::none)
+    {
+        draw_arrays_command* da = draw_buffer->append<draw_arrays_command, bind_vertex_array_command>(bva);
+        da->topology            = state.topology;
+        da->first               = state.first;
+        da->count               = state.count;
+        da->instance_count      = instance_count;
 #ifdef MANGO_DEBUG
-        cleanup_texture_bindings(shadow_command_buffer, bva);
+        bva                    = draw_buffer->append<bind_vertex_array_command, draw_arrays_command>(da);
+        bva->vertex_array_name = 0;
 #endif // MANGO_DEBUG
     }
+    else
+    {
+        draw_elements_command* de = draw_buffer->append<draw_elements_command, bind_vertex_array_command>(bva);
+        de->topology              = state.topology;
+        de->first                 = state.first;
+        de->count                 = state.count;
+        de->type                  = state.type;
+        de->base_vertex           = state.base_vertex;
+        de->instance_count        = instance_count;
+#ifdef MANGO_DEBUG
+        bva                    = draw_buffer->append<bind_vertex_array_command, draw_elements_command>(de);
+        bva->vertex_array_name = 0;
+#endif // MANGO_DEBUG
+    }
+    m_renderer_info.last_frame.draw_calls++;
+    m_renderer_info.last_frame.vertices += (instance_count * state.count);
+    m_renderer_info.last_frame.triangles += (instance_count * state.count / 3);
+
+#ifdef MANGO_DEBUG
+    cleanup_texture_bindings(draw_buffer, bva);
+#endif // MANGO_DEBUG
 }
 
-bind_texture_command* deferred_pbr_render_system::begin_mesh_draw(const command_buffer_ptr<max_key>& draw_buffer, max_key mesh_key, bool simplified)
+bind_texture_command* deferred_pbr_render_system::begin_mesh_draw(const command_buffer_ptr<max_key>& draw_buffer, max_key mesh_key, bool simplified, int64 instance_data_offset,
+                                                                   int64 instance_data_size)
 {
-    // material data buffer
+    // model data buffer, the material is read from the material table.
     bind_buffer_command* bb = draw_buffer->create<bind_buffer_command>(mesh_key);
     bb->target              = buffer_target::uniform_buffer;
-    bb->index               = UB_SLOT_MATERIAL_DATA;
-    bb->size                = sizeof(material_data);
-    bb->buffer_name         = m_frame_uniform_buffer->buffer_name();
-    bb->offset              = m_active_model.material_data_offset;
+    bb->index               = UB_SLOT_MODEL_DATA;
+    bb->size                = sizeof(model_data);
+    bb->buffer_name         = m_active_model.data_buffer_name;
+    bb->offset              = m_active_model.model_data_offset;
 
-    // model data buffer
-    bb              = draw_buffer->append<bind_buffer_command, bind_buffer_command>(bb);
-    bb->target      = buffer_target::uniform_buffer;
-    bb->index       = UB_SLOT_MODEL_DATA;
-    bb->size        = sizeof(model_data);
-    bb->buffer_name = m_frame_uniform_buffer->buffer_name();
-    bb->offset      = m_active_model.model_data_offset;
+    if (instance_data_offset >= 0)
+    {
+        // instance data buffer
+        bb              = draw_buffer->append<bind_buffer_command, bind_buffer_command>(bb);
+        bb->target      = buffer_target::shader_storage_buffer;
+        bb->index       = SSB_SLOT_INSTANCE_DATA;
+        bb->size        = instance_data_size;
+        bb->buffer_name = m_frame_uniform_buffer->buffer_name();
+        bb->offset      = instance_data_offset;
+    }
 
     if (!simplified)
         return bind_material_textures(draw_buffer, bb);
@@ -1412,6 +2253,247 @@ bind_texture_command* deferred_pbr_render_system::bind_material_textures(const c
     return bt;
 }
 
+bool deferred_pbr_render_system::draw_retained_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count,
+                                                    int32 base_vertex)
+{
+    PROFILE_ZONE;
+    auto it      = m_retained_meshes.find(m_active_model.mesh_entity);
+    bool created = it == m_retained_meshes.end();
+    if (created)
+    {
+        if (m_free_retained_slots.empty() && !grow_retained_mesh_buffer())
+            return false;
+
+        retained_mesh new_mesh;
+        new_mesh.slot          = m_free_retained_slots.back();
+        new_mesh.command_index = -1;
+        m_free_retained_slots.pop_back();
+        it = m_retained_meshes.emplace(m_active_model.mesh_entity, new_mesh).first;
+    }
+    retained_mesh& mesh = it->second;
+    mesh.last_frame     = m_frame_number;
+
+    g_uint texture_names[5] = { m_active_model.base_color_texture_name, m_active_model.roughness_metallic_texture_name, m_active_model.occlusion_texture_name,
+                                m_active_model.normal_texture_name, m_active_model.emissive_color_texture_name };
+
+    bool data_changed = created || mesh.model_matrix != m_active_model.model_matrix || mesh.has_normals != m_active_model.has_normals || mesh.has_tangents != m_active_model.has_tangents ||
+                        mesh.material_index != m_active_model.material_index;
+    bool commands_changed = mesh.command_index < 0 || mesh.material_id != m_active_model.material_id || memcmp(mesh.texture_names, texture_names, sizeof(texture_names)) != 0 ||
+                            mesh.face_culling != m_active_model.face_culling || mesh.vertex_array_name != vertex_array->get_name() || mesh.topology != topology || mesh.first != first ||
+                            mesh.count != count || mesh.type != type || mesh.instance_count != instance_count || mesh.base_vertex != base_vertex;
+
+    if (data_changed)
+    {
+        mesh.model_matrix   = m_active_model.model_matrix;
+        mesh.has_normals    = m_active_model.has_normals;
+        mesh.has_tangents   = m_active_model.has_tangents;
+        mesh.material_index = m_active_model.material_index;
+        patch_retained_mesh(mesh);
+        m_renderer_info.last_frame.patched_primitives++;
+    }
+
+    if (commands_changed)
+    {
+        mesh.material_id = m_active_model.material_id;
+        memcpy(mesh.texture_names, texture_names, sizeof(texture_names));
+        mesh.face_culling      = m_active_model.face_culling;
+        mesh.vertex_array_name = vertex_array->get_name();
+        mesh.topology          = topology;
+        mesh.first             = first;
+        mesh.count             = count;
+        mesh.type              = type;
+        mesh.instance_count    = instance_count;
+        mesh.base_vertex       = base_vertex;
+        if (mesh.command_index >= 0)
+            m_retained_gbuffer_commands->remove(mesh.command_index);
+        record_retained_mesh(mesh);
+        m_renderer_info.last_frame.recorded_primitives++;
+    }
+
+    // Other passes (shadows) bind the data from the slot as well.
+    m_active_model.data_buffer_name  = m_retained_mesh_buffer->get_name();
+    m_active_model.model_data_offset = mesh.slot * m_retained_slot_size;
+
+    m_renderer_info.last_frame.draw_calls++;
+    m_renderer_info.last_frame.primitives++;
+    m_renderer_info.last_frame.vertices += (instance_count * count);
+    m_renderer_info.last_frame.triangles += (instance_count * count / 3);
+    m_renderer_info.last_frame.materials++;
+    m_renderer_info.last_frame.retained_primitives++;
+
+    return true;
+}
+
+void deferred_pbr_render_system::record_retained_mesh(retained_mesh& mesh)
+{
+    // Retained commands are only sorted by material, depth would be outdated as soon as the camera moves.
+    max_key k = command_keys::create_key<max_key>(command_keys::key_template::max_key_material_front_to_back);
+    command_keys::add_material(k, mesh.material_id);
+
+    int64 slot_offset  = mesh.slot * m_retained_slot_size;
+    g_uint buffer_name = m_retained_mesh_buffer->get_name();
+
+    bind_buffer_command* bb = m_retained_gbuffer_commands->create<bind_buffer_command>(k);
+    mesh.command_index      = m_retained_gbuffer_commands->size() - 1;
+    bb->target              = buffer_target::uniform_buffer;
+    bb->index               = UB_SLOT_MODEL_DATA;
+    bb->size                = sizeof(model_data);
+    bb->buffer_name         = buffer_name;
+    bb->offset              = slot_offset;
+
+    bind_texture_command* bt = m_retained_gbuffer_commands->append<bind_texture_command, bind_buffer_command>(bb);
+    bt->binding = bt->sampler_location = 0;
+    bt->texture_name                   = mesh.texture_names[0];
+    for (int32 i = 1; i < 5; ++i)
+    {
+        bt          = m_retained_gbuffer_commands->append<bind_texture_command, bind_texture_command>(bt);
+        bt->binding = bt->sampler_location = i;
+        bt->texture_name                   = mesh.texture_names[i];
+    }
+
+    set_face_culling_command* sfc = m_retained_gbuffer_commands->append<set_face_culling_command, bind_texture_command>(bt);
+    sfc->enabled                  = mesh.face_culling;
+
+    bind_vertex_array_command* bva = m_retained_gbuffer_commands->append<bind_vertex_array_command, set_face_culling_command>(sfc);
+    bva->vertex_array_name         = mesh.vertex_array_name;
+
+    if (mesh.type == index_type::none)
+    {
+        draw_arrays_command* da = m_retained_gbuffer_commands->append<draw_arrays_command, bind_vertex_array_command>(bva);
+        da->topology            = mesh.topology;
+        da->first               = mesh.first;
+        da->count               = mesh.count;
+        da->instance_count      = mesh.instance_count;
+#ifdef MANGO_DEBUG
+        bva                    = m_retained_gbuffer_commands->append<bind_vertex_array_command, draw_arrays_command>(da);
+        bva->vertex_array_name = 0;
+#endif // MANGO_DEBUG
+    }
+    else
+    {
+        draw_elements_command* de = m_retained_gbuffer_commands->append<draw_elements_command, bind_vertex_array_command>(bva);
+        de->topology              = mesh.topology;
+        de->first                 = mesh.first;
+        de->count                 = mesh.count;
+        de->type                  = mesh.type;
+        de->base_vertex           = mesh.base_vertex;
+        de->instance_count        = mesh.instance_count;
+#ifdef MANGO_DEBUG
+        bva                    = m_retained_gbuffer_commands->append<bind_vertex_array_command, draw_elements_command>(de);
+        bva->vertex_array_name = 0;
+#endif // MANGO_DEBUG
+    }
+
+#ifdef MANGO_DEBUG
+    cleanup_texture_bindings(m_retained_gbuffer_commands, bva);
+#endif // MANGO_DEBUG
+
+    m_retained_commands_changed = true;
+}
+
+void deferred_pbr_render_system::patch_retained_mesh(const retained_mesh& mesh)
+{
+    model_data d{ mesh.model_matrix, std140_mat3(glm::mat3(glm::transpose(glm::inverse(mesh.model_matrix)))), mesh.has_normals, mesh.has_tangents, false, mesh.material_index };
+
+    // The update is executed with the global bindings, before anything is drawn.
+    update_buffer_data_command* ubd = m_global_binding_commands->create<update_buffer_data_command>(command_keys::no_sort, m_retained_slot_size);
+    g_byte* data                    = static_cast<g_byte*>(m_global_binding_commands->map_spare<update_buffer_data_command>());
+    memset(data, 0, m_retained_slot_size);
+    memcpy(data, &d, sizeof(model_data));
+    ubd->buffer_name = m_retained_mesh_buffer->get_name();
+    ubd->offset      = mesh.slot * m_retained_slot_size;
+    ubd->size        = m_retained_slot_size;
+    ubd->data        = data;
+}
+
+bool deferred_pbr_render_system::grow_retained_mesh_buffer()
+{
+    PROFILE_ZONE;
+    int64 slot_count = m_retained_slot_count > 0 ? 2 * m_retained_slot_count : 1024;
+
+    buffer_configuration b_config(slot_count * m_retained_slot_size, buffer_target::uniform_buffer, buffer_access::dynamic_storage);
+    buffer_ptr grown_buffer = buffer::create(b_config);
+    if (!check_creation(grown_buffer.get(), "retained mesh buffer"))
+        return false;
+
+    if (m_retained_mesh_buffer)
+        m_retired_retained_mesh_buffers.push_back(m_retained_mesh_buffer);
+    m_retained_mesh_buffer = grown_buffer;
+    for (int64 i = slot_count - 1; i >= m_retained_slot_count; --i)
+        m_free_retained_slots.push_back(i);
+    m_retained_slot_count = slot_count;
+
+    // The buffer changed, so all data has to be written and all recorded commands recorded again.
+    reset_retained_gbuffer_commands();
+    for (auto& rm : m_retained_meshes)
+    {
+        patch_retained_mesh(rm.second);
+        if (rm.second.command_index >= 0)
+            record_retained_mesh(rm.second);
+    }
+    return true;
+}
+
+void deferred_pbr_render_system::release_unused_retained_meshes()
+{
+    PROFILE_ZONE;
+    int64 recorded = 0;
+    for (auto it = m_retained_meshes.begin(); it != m_retained_meshes.end();)
+    {
+        retained_mesh& mesh = it->second;
+        if (mesh.last_frame == m_frame_number)
+        {
+            recorded++;
+            ++it;
+            continue;
+        }
+        // Not drawn this frame (culled, removed or not retained anymore), so the commands must not be executed.
+        if (mesh.command_index >= 0)
+        {
+            m_retained_gbuffer_commands->remove(mesh.command_index);
+            mesh.command_index = -1;
+        }
+        if (m_frame_number - mesh.last_frame < retained_mesh_release_frames)
+        {
+            ++it;
+            continue;
+        }
+        m_free_retained_slots.push_back(mesh.slot);
+        it = m_retained_meshes.erase(it);
+    }
+
+    // Removed commands still occupy memory, so everything is recorded again when they outnumber the alive ones.
+    int64 removed = m_retained_gbuffer_commands->removed_count();
+    if (removed > 64 && removed > recorded)
+    {
+        reset_retained_gbuffer_commands();
+        for (auto& rm : m_retained_meshes)
+        {
+            if (rm.second.command_index >= 0)
+                record_retained_mesh(rm.second);
+        }
+    }
+}
+
+int32 deferred_pbr_render_system::get_shadow_view_projections(glm::mat4* view_projections, int32 max_count)
+{
+    auto step_shadow_map = std::static_pointer_cast<shadow_map_step>(m_pipeline_steps[mango::render_step::shadow_map]);
+    if (!step_shadow_map)
+        return 0;
+
+    int32 count = glm::min(step_shadow_map->get_cascade_count(), max_count);
+    for (int32 i = 0; i < count; ++i)
+        view_projections[i] = step_shadow_map->get_cascade_view_projection(i);
+    return count;
+}
+
+void deferred_pbr_render_system::submit_culling_info(int32 visible, int32 culled, int32 culled_shadow)
+{
+    m_renderer_info.last_frame.visible_primitives += visible;
+    m_renderer_info.last_frame.culled_primitives += culled;
+    m_renderer_info.last_frame.culled_shadow_primitives += culled_shadow;
+}
+
 void deferred_pbr_render_system::submit_light(light_id id, mango_light* light)
 {
     PROFILE_ZONE;
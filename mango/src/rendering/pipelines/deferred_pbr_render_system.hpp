@@ -14,6 +14,9 @@
 #include <rendering/steps/fxaa_step.hpp>
 #include <rendering/steps/pipeline_step.hpp>
 #include <rendering/steps/shadow_map_step.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace mango
 {
@@ -42,11 +45,14 @@ namespace mango
         virtual void destroy() override;
         virtual render_pipeline get_base_render_pipeline() override;
 
-        void begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents) override;
+        void begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents, entity mesh_entity = invalid_entity, mesh_visibility visibility = mesh_visibility::all,
+                        const axis_aligned_bounding_box* world_bounds = nullptr) override;
         void end_mesh() override;
         void use_material(const material_ptr& mat) override;
-        void draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count) override;
+        void draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count, int32 base_vertex) override;
         void submit_light(light_id id, mango_light* light) override;
+        int32 get_shadow_view_projections(glm::mat4* view_projections, int32 max_count) override;
+        void submit_culling_info(int32 visible, int32 culled, int32 culled_shadow) override;
         void on_ui_widget() override;
 
         framebuffer_ptr get_backbuffer() override
@@ -70,8 +76,13 @@ namespace mango
         command_buffer_ptr<min_key> m_global_binding_commands;
         //! \brief The \a command_buffer storing commands regarding rendering to the gbuffer.
         command_buffer_ptr<max_key> m_gbuffer_commands;
+        //! \brief The \a command_buffer storing retained commands rendering opaque objects to the gbuffer.
+        //! \details This one is not invalidated every frame, the commands of single meshes are patched instead.
+        command_buffer_ptr<max_key> m_retained_gbuffer_commands;
         //! \brief The \a command_buffer storing commands to render transparent objects.
         command_buffer_ptr<max_key> m_transparent_commands;
+        //! \brief The \a command_buffer storing commands regarding the occlusion culling compute passes. Executed right after the gbuffer is filled.
+        command_buffer_ptr<min_key> m_occlusion_commands;
         //! \brief The \a command_buffer storing commands to issue lighting calculations for gbuffer objects.
         command_buffer_ptr<min_key> m_lighting_pass_commands;
         //! \brief The \a command_buffer storing commands regarding automatic exposure calculations.
@@ -85,6 +96,11 @@ namespace mango
         //! \details This fills the g-buffer for later use in the lighting pass.
         shader_program_ptr m_scene_geometry_pass;
 
+        //! \brief The \a shader_program for the deferred geometry pass with multi draw indirect submission.
+        //! \details Reads the model data per draw from a shader storage buffer. Only created if multi draw indirect submission is enabled and supported.
+        //! With bindless textures enabled the material textures are sampled by the handles in the material table.
+        shader_program_ptr m_scene_geometry_pass_indirect;
+
         //! \brief The \a shader_program for the transparency pass.
         //! \details This is a seperate forward pass.
         shader_program_ptr m_transparent_pass;
@@ -107,6 +123,17 @@ namespace mango
         //! \brief The mapped luminance data from the histogram calculation.
         luminance_data* m_luminance_data_mapping;
 
+        //! \brief The \a shader_program for the hierarchical z construction.
+        //! \details Builds the depth pyramid level by level from the gbuffer depth.
+        shader_program_ptr m_construct_hi_z;
+
+        //! \brief The \a shader_program for the occlusion test.
+        //! \details Tests the bounds of the drawn meshes against the depth pyramid.
+        shader_program_ptr m_occlusion_test;
+
+        //! \brief The hierarchical z texture. Each texel stores the farthest depth of the texels below it.
+        texture_ptr m_hi_z_texture;
+
         //! \brief The \a shader_program for the composing pass.
         //! \details Takes the output in the hdr_buffer and does the final composing to get it to the screen.
         shader_program_ptr m_composing_pass;
@@ -134,12 +161,19 @@ namespace mango
 
             std140_bool has_normals;  //!< Specifies if the next mesh has normals as a vertex attribute.
             std140_bool has_tangents; //!< Specifies if the next mesh has tangents as a vertex attribute.
+            std140_bool instanced;    //!< Specifies if the model and normal matrices are read from the instance data buffer.
 
-            std140_float padding0; //!< Padding needed for st140 layout.
-            std140_float padding1; //!< Padding needed for st140 layout.
+            std140_int material_index; //!< The index of the material in the material table.
+        };
+
+        //! \brief Shader storage buffer struct for the model data of one instance of an instanced draw.
+        struct instance_data
+        {
+            std140_mat4 model_matrix;  //!< The model matrix.
+            std140_mat4 normal_matrix; //!< The normal matrix. A mat4 to keep the std430 layout simple.
         };
 
-        //! \brief Uniform buffer struct for material data.
+        //! \brief Shader storage buffer struct for material data.
         struct material_data
         {
             std140_vec4 base_color;     //!< The base color (rgba). Also used as reflection color for metallic surfaces.
@@ -161,6 +195,13 @@ namespace mango
             std140_float padding1; //!< Padding needed for st140 layout.
         };
 
+        //! \brief Shader storage buffer struct for one entry of the material table.
+        struct material_table_entry
+        {
+            material_data material;    //!< The material_data.
+            uint64 texture_handles[6]; //!< The bindless handles of the material textures, 0 if bindless textures are disabled. The last one is padding.
+        };
+
         //! \brief Uniform buffer structure for the lighting pass of the deferred pipeline.
         struct lighting_pass_data
         {
@@ -195,8 +236,15 @@ namespace mango
         //! \brief Structure used to cache the \a commands regarding the rendering of the current model/mesh.
         struct model_cache
         {
-            int64 model_data_offset;                //!< Caches the offset of the model_data.
-            int64 material_data_offset;             //!< Caches the offset of the material_data.
+            int64 model_data_offset;                //!< Caches the offset of the model_data, -1 if not written yet.
+            g_uint data_buffer_name;                //!< Caches the name of the buffer the model_data is written to.
+            entity mesh_entity;                     //!< Caches the entity of the mesh, or the invalid_entity.
+            glm::mat4 model_matrix;                 //!< Caches the model matrix.
+            mesh_visibility visibility;             //!< Caches the passes the mesh is visible in.
+            bool has_normals;                       //!< Caches if the mesh has normals as a vertex attribute.
+            bool has_tangents;                      //!< Caches if the mesh has tangents as a vertex attribute.
+            material_data material;                 //!< Caches the material_data.
+            int32 material_index;                   //!< Caches the index of the material in the material table.
             int8 material_id;                       //!< Caches the material_id.
             glm::vec3 position;                     //!< Caches the transform position (used for example for transparency sorting).
             g_uint base_color_texture_name;         //!< Caches the name of the materials base color texture, or the default one if not existent.
@@ -204,14 +252,17 @@ namespace mango
             g_uint occlusion_texture_name;          //!< Caches the name of the materials occlusion texture, or the default one if not existent.
             g_uint normal_texture_name;             //!< Caches the name of the materials normal texture, or the default one if not existent.
             g_uint emissive_color_texture_name;     //!< Caches the name of the materials emissive color texture, or the default one if not existent.
+            uint64 texture_handles[5];              //!< Caches the bindless handles of the material textures in the order of the names. Only set if bindless textures are enabled.
             bool blend;                             //!< Caches if material needs blending.
             bool face_culling;                      //!< Caches if faces have to be culled for rendering that material.
+            bool mesh_active;                       //!< True if a mesh was begun and not ended yet.
+            bool material_active;                   //!< True if a material is in use for the current mesh.
 
             //! \brief Returns the validation state of the \a model_cache.
             //! \return True if \a model_cache is valid, else False.
             inline bool valid()
             {
-                return model_data_offset >= 0 && material_data_offset >= 0;
+                return mesh_active && material_active;
             }
 
             //! \brief Creates an id from the cache and the given \a material_data.
@@ -229,6 +280,170 @@ namespace mango
 
         } m_active_model; //!< Active model_cache.
 
+        //! \brief Structure caching the retained commands and data of an opaque mesh primitive.
+        struct retained_mesh
+        {
+            int64 slot;                  //!< The slot in the retained mesh buffer storing the model_data.
+            int64 command_index;         //!< The index of the commands in the retained gbuffer \a command_buffer, or -1 if not recorded.
+            int64 last_frame;            //!< The number of the frame the mesh was drawn the last time.
+            glm::mat4 model_matrix;      //!< The model matrix written to the slot.
+            bool has_normals;            //!< True if the mesh has normals as a vertex attribute.
+            bool has_tangents;           //!< True if the mesh has tangents as a vertex attribute.
+            int32 material_index;        //!< The index of the material in the material table written to the slot.
+            int8 material_id;            //!< The material_id used for sorting.
+            g_uint texture_names[5];     //!< The names of the material textures (base color, roughness metallic, occlusion, normal, emissive).
+            bool face_culling;           //!< True if faces have to be culled.
+            g_uint vertex_array_name;    //!< The gl name of the vertex array.
+            primitive_topology topology; //!< The topology used for drawing.
+            int32 first;                 //!< The first index to draw.
+            int32 count;                 //!< The number of indices to draw.
+            index_type type;             //!< The index type.
+            int32 instance_count;        //!< The number of instances to draw.
+            int32 base_vertex;           //!< The value added to the indices.
+        };
+
+        //! \brief The number of frames a \a retained_mesh keeps its slot without being drawn.
+        //! \details Culled meshes only lose their commands, so they do not need to be written again when they get visible.
+        static const int64 retained_mesh_release_frames = 120;
+
+        //! \brief The \a retained_meshes drawn in the last frames, stored by entity.
+        std::unordered_map<entity, retained_mesh> m_retained_meshes;
+        //! \brief The unused slots in the retained mesh buffer.
+        std::vector<int64> m_free_retained_slots;
+        //! \brief Buffer storing the model_data of all \a retained_meshes.
+        buffer_ptr m_retained_mesh_buffer;
+        //! \brief The retained mesh buffers replaced by bigger ones this frame. Kept alive until the next frame, because recorded patches may still reference them.
+        std::vector<buffer_ptr> m_retired_retained_mesh_buffers;
+        //! \brief Number of slots in the retained mesh buffer.
+        int64 m_retained_slot_count;
+        //! \brief The size of a slot in the retained mesh buffer. Aligned for uniform buffer binding.
+        int64 m_retained_slot_size;
+        //! \brief True if commands in the retained gbuffer \a command_buffer were added or removed and it needs to be sorted again.
+        bool m_retained_commands_changed;
+        //! \brief The index of the state commands starting the retained gbuffer \a command_buffer, or -1 if not recorded.
+        int64 m_retained_start_command;
+        //! \brief The viewport the retained start commands were recorded with.
+        glm::ivec4 m_retained_start_viewport;
+        //! \brief True if the retained start commands were recorded for wireframe rendering.
+        bool m_retained_start_wireframe;
+        //! \brief True if retained rendering of static meshes is enabled.
+        bool m_retained_static_meshes;
+        //! \brief The number of the current frame.
+        int64 m_frame_number;
+
+        //! \brief Structure caching the material table entry of a \a material.
+        struct material_table_slot
+        {
+            int32 index;                   //!< The index of the entry in the material table.
+            int64 last_frame;              //!< The number of the frame the material was used the last time.
+            std::weak_ptr<material> owner; //!< The \a material, expired when it was destroyed.
+        };
+
+        //! \brief The number of frames a \a material_table_slot is kept without the material being drawn.
+        //! \details Culled or hidden materials keep their entry, so it does not need to be uploaded again when they get visible.
+        static const int64 material_release_frames = 120;
+
+        //! \brief The \a material_table_slots of the materials used in the last frames, stored by the address of the \a material.
+        std::unordered_map<const material*, material_table_slot> m_material_slots;
+        //! \brief The material table. Only the changed entries are uploaded to the material table buffer.
+        std::vector<material_table_entry> m_material_table;
+        //! \brief The unused indices in the material table.
+        std::vector<int32> m_free_material_indices;
+        //! \brief The first changed entry of the material table not uploaded yet.
+        int32 m_material_table_dirty_begin;
+        //! \brief One behind the last changed entry of the material table not uploaded yet.
+        int32 m_material_table_dirty_end;
+        //! \brief Shader storage buffer storing the material table.
+        buffer_ptr m_material_table_buffer;
+        //! \brief Number of entries fitting in the material table buffer.
+        int32 m_material_table_capacity;
+
+        //! \brief The state of a draw deciding if it can be merged with others into one instanced draw.
+        //! \details Compared bytewise, so it has to be zero initialized.
+        struct instancing_state
+        {
+            int32 material_index;        //!< The index of the material in the material table.
+            g_uint texture_names[5];     //!< The names of the material textures (base color, roughness metallic, occlusion, normal, emissive).
+            g_uint vertex_array_name;    //!< The gl name of the vertex array.
+            int32 first;                 //!< The first index to draw.
+            int32 count;                 //!< The number of indices to draw.
+            int32 instance_count;        //!< The number of instances to draw.
+            int32 base_vertex;           //!< The value added to the indices.
+            primitive_topology topology; //!< The topology used for drawing.
+            index_type type;             //!< The index type.
+            bool shadow_pass;            //!< True if the draw goes to the shadow \a command_buffer, else to the gbuffer one.
+            bool face_culling;           //!< True if faces have to be culled.
+            bool has_normals;            //!< True if the mesh has normals as a vertex attribute.
+            bool has_tangents;           //!< True if the mesh has tangents as a vertex attribute.
+        };
+
+        //! \brief Shader storage buffer struct for the data of a single draw of a multi draw indirect call.
+        struct indirect_draw_data
+        {
+            model_data model; //!< The model_data. The material is read from the material table.
+        };
+
+        //! \brief Structure storing an opaque draw until it is known if it can be merged with others into one instanced draw.
+        struct instancing_candidate
+        {
+            instancing_state state;      //!< The state of the draw.
+            max_key key;                 //!< The key used for sorting.
+            glm::mat4 model_matrix;      //!< The model matrix.
+            int64 data_owner;            //!< The index of the candidate owning the model_data. Draws of the same mesh in different passes share the data.
+            g_uint data_buffer_name;     //!< The name of the buffer the model_data is written to.
+            int64 model_data_offset;     //!< The offset of the model_data, -1 if not written yet.
+            bool recorded;               //!< True if the draw was already recorded with a multi draw indirect call.
+        };
+
+        //! \brief The opaque draws of the current frame, recorded in finish_render().
+        std::vector<instancing_candidate> m_instancing_candidates;
+        //! \brief Scratch list of candidate indices sorted by their \a instancing_state.
+        std::vector<int64> m_instancing_order;
+        //! \brief Scratch list of instance_data written for an instanced draw.
+        std::vector<instance_data> m_instance_data;
+        //! \brief The maximum number of instances merged into one instanced draw.
+        static const int64 max_instances_per_draw = 256;
+        //! \brief Scratch list of candidate indices sorted for multi draw indirect batches.
+        std::vector<int64> m_indirect_order;
+        //! \brief Scratch list of indirect_draw_data written for a multi draw indirect call.
+        std::vector<indirect_draw_data> m_indirect_draw_data;
+        //! \brief Scratch list of draw parameters written for a multi draw indirect call.
+        std::vector<draw_elements_indirect_parameters> m_indirect_parameters;
+        //! \brief The maximum number of draws in one multi draw indirect call.
+        static const int64 max_draws_per_indirect_call = 256;
+        //! \brief True if opaque gbuffer draws are submitted with multi draw indirect calls.
+        bool m_multi_draw_indirect;
+        //! \brief True if the multi draw indirect calls sample the material textures by bindless handles instead of binding them.
+        bool m_bindless_textures;
+
+        //! \brief Shader storage buffer struct for the world space bounds of a mesh tested for occlusion.
+        struct occlusion_bounds
+        {
+            std140_vec4 bounds_min; //!< The minimum of the bounds (xyz).
+            std140_vec4 bounds_max; //!< The maximum of the bounds (xyz).
+        };
+
+        //! \brief The number of parts of the occlusion buffer. One is written per frame, the older ones are read back when the gpu is done with them.
+        static const int32 occlusion_buffer_parts = 3;
+        //! \brief The maximum number of meshes tested for occlusion per frame.
+        static const int32 max_occlusion_queries = 16384;
+        //! \brief The size of one part of the occlusion buffer. The occlusion_bounds are followed by one visibility value per query.
+        static const int64 occlusion_part_size = max_occlusion_queries * (sizeof(occlusion_bounds) + sizeof(uint32));
+        //! \brief Buffer storing the occlusion_bounds and the test results of the last frames.
+        buffer_ptr m_occlusion_buffer;
+        //! \brief The persistent mapping of the occlusion buffer.
+        uint8* m_occlusion_mapping;
+        //! \brief The entities tested for occlusion per part of the occlusion buffer.
+        std::vector<entity> m_occlusion_entities[occlusion_buffer_parts];
+        //! \brief The syncs placed after the occlusion tests per part of the occlusion buffer.
+        g_sync m_occlusion_syncs[occlusion_buffer_parts];
+        //! \brief True if the results in a part of the occlusion buffer were not read back yet.
+        bool m_occlusion_pending[occlusion_buffer_parts];
+        //! \brief The entities found occluded in the last read back test results.
+        std::unordered_set<entity> m_occluded_entities;
+        //! \brief True if hierarchical z occlusion culling is enabled.
+        bool m_occlusion_culling;
+
         //! \brief Optional additional steps of the deferred pipeline.
         shared_ptr<pipeline_step> m_pipeline_steps[mango::render_step::number_of_step_types];
 
@@ -237,6 +452,21 @@ namespace mango
 
         bool create_renderer_resources() override;
 
+        //! \brief Creates the \a shader_program for the geometry pass with multi draw indirect submission.
+        //! \param[in] bindless_textures True if the material textures should be sampled by bindless handles.
+        //! \return True on success, False if multi draw indirect submission is not supported.
+        bool create_indirect_geometry_pass(bool bindless_textures);
+
+        //! \brief Creates the \a shader_programs, the buffer and the hierarchical z texture for occlusion culling.
+        //! \return True on success, else False.
+        bool create_occlusion_culling_resources();
+
+        //! \brief Creates the hierarchical z texture.
+        //! \param[in] width The width of the first level. Has to be the width of the gbuffer.
+        //! \param[in] height The height of the first level. Has to be the height of the gbuffer.
+        //! \return True on success, else False.
+        bool create_hi_z_texture(int32 width, int32 height);
+
         //! \brief Binds the uniform buffer of the renderer.
         //! \param[in,out] camera The \a camera_data of the current camera.
         //! \param[in] camera_exposure The current exposure value.
@@ -255,6 +485,17 @@ namespace mango
         void clear_framebuffers();
         //! \brief GBuffer pass setup done in begin_render().
         void setup_gbuffer_pass();
+        //! \brief Records the state commands starting the gbuffer pass.
+        //! \details They use the max_key_to_start, so they are executed before all draws after sorting.
+        //! \param[in] draw_buffer The \a command_buffer to record the commands to.
+        //! \return The index of the recorded commands in \a draw_buffer.
+        int64 record_gbuffer_start(const command_buffer_ptr<max_key>& draw_buffer);
+        //! \brief Records the start commands of the retained gbuffer \a command_buffer again, if the gbuffer state changed.
+        //! \details The retained commands are executed on their own and can not rely on the state of the previous \a command_buffer.
+        void setup_retained_gbuffer_pass();
+        //! \brief Invalidates the retained gbuffer \a command_buffer and records its start commands.
+        //! \details The commands of the \a retained_meshes have to be recorded again afterwards.
+        void reset_retained_gbuffer_commands();
         //! \brief Lighting pass setup done in begin_render().
         void setup_lighting_pass();
         //! \brief Transparent pass setup done in begin_render().
@@ -263,6 +504,17 @@ namespace mango
         //! \brief Lighting pass finalization done in finish_render().
         //! \param[in] step_shadow_map The shared pointer to the \a shadow_map_step, or null.
         void finalize_lighting_pass(const std::shared_ptr<shadow_map_step>& step_shadow_map);
+        //! \brief Hierarchical z construction and occlusion test compute passes done in finish_render().
+        //! \details Tests the bounds added this frame against this frames gbuffer depth. The results are read back in one of the next frames.
+        //! \param[in] camera The \a camera_data of the current camera.
+        void calculate_occlusion(camera_data& camera);
+        //! \brief Reads back the newest available occlusion test results. Done in begin_render().
+        //! \details Meshes are tested every frame, so meshes skipped because of older results are drawn again as soon as they get visible.
+        void read_occlusion_results();
+        //! \brief Adds a mesh to the occlusion tests of this frame.
+        //! \param[in] mesh_entity The \a entity of the mesh.
+        //! \param[in] world_bounds The world space \a axis_aligned_bounding_box of the mesh.
+        void add_occlusion_query(entity mesh_entity, const axis_aligned_bounding_box& world_bounds);
         //! \brief Auto exposure compute passes done in finish_render().
         //! \param[in] dt Past time since last call.
         void calculate_auto_exposure(float dt);
@@ -278,12 +530,88 @@ namespace mango
         //! \param[in] fxaa_command_buffer The shared pointer to the \a command_buffer of the \a fxaa_step, or null.
         void execute_commands(const command_buffer_ptr<min_key>& ibl_command_buffer, const command_buffer_ptr<max_key>& shadow_command_buffer, const command_buffer_ptr<min_key>& fxaa_command_buffer);
 
+        //! \brief Writes the model_data of the active model to the frame uniform buffer, if not done yet.
+        void write_active_model_data();
+
+        //! \brief Updates the material table entry of a \a material with the material of the active model.
+        //! \details The entry is only marked for upload, if it changed.
+        //! \param[in] mat The \a material to update the entry for.
+        //! \return The index of the entry in the material table.
+        int32 update_material_table(const material_ptr& mat);
+        //! \brief Uploads the changed entries of the material table and binds the material table buffer.
+        //! \details Done in finish_render() with the global bindings, before anything is drawn.
+        //! \return True on success, else False.
+        bool upload_material_table();
+        //! \brief Releases the material table entries of destroyed materials and of the ones not used for material_release_frames.
+        void release_unused_materials();
+
+        //! \brief Draws the active model with retained commands.
+        //! \details Patches the data and records the commands again only if the mesh changed since the last frame.
+        //! \param[in] vertex_array The \a vertex_array_ptr for the draw call.
+        //! \param[in] topology The topology used for drawing the bound vertex data.
+        //! \param[in] first The first index to start drawing from.
+        //! \param[in] count The number of indices to draw.
+        //! \param[in] type The \a index_type of the values in the index buffer.
+        //! \param[in] instance_count The number of instances to draw.
+        //! \param[in] base_vertex The value added to the indices.
+        //! \return True on success, False if the mesh has to be drawn without retained commands.
+        bool draw_retained_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count, int32 base_vertex);
+        //! \brief Records the retained commands of a \a retained_mesh.
+        //! \param[in,out] mesh The \a retained_mesh to record the commands for.
+        void record_retained_mesh(retained_mesh& mesh);
+        //! \brief Writes the model_data of a \a retained_mesh to its slot.
+        //! \param[in] mesh The \a retained_mesh to write.
+        void patch_retained_mesh(const retained_mesh& mesh);
+        //! \brief Doubles the number of slots in the retained mesh buffer.
+        //! \details All \a retained_meshes are written and recorded again.
+        //! \return True on success, else False.
+        bool grow_retained_mesh_buffer();
+        //! \brief Removes the commands of the \a retained_meshes not drawn this frame and compacts the retained gbuffer \a command_buffer if necessary.
+        //! \details The slots of \a retained_meshes not drawn for retained_mesh_release_frames are released.
+        void release_unused_retained_meshes();
+
+        //! \brief Adds an \a instancing_candidate for the active model.
+        //! \param[in] vertex_array The \a vertex_array_ptr for the draw call.
+        //! \param[in] topology The topology used for drawing the bound vertex data.
+        //! \param[in] first The first index to start drawing from.
+        //! \param[in] count The number of indices to draw.
+        //! \param[in] type The \a index_type of the values in the index buffer.
+        //! \param[in] instance_count The number of instances to draw.
+        //! \param[in] base_vertex The value added to the indices.
+        //! \param[in] mesh_key The key used for sorting later on.
+        //! \param[in] shadow_pass True if the draw goes to the shadow \a command_buffer, else to the gbuffer one.
+        //! \param[in] data_owner The index of the candidate to share the model_data with, or -1.
+        //! \return The index of the added candidate.
+        int64 add_instancing_candidate(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count, int32 base_vertex,
+                                       max_key mesh_key, bool shadow_pass, int64 data_owner = -1);
+        //! \brief Records the \a instancing_candidates of the frame.
+        //! \details Runs of candidates with the same \a instancing_state are merged into one instanced draw.
+        //! \param[in] shadow_command_buffer The shared pointer to the \a command_buffer of the \a shadow_map_step, or null.
+        void record_instancing_candidates(const command_buffer_ptr<max_key>& shadow_command_buffer);
+        //! \brief Records the indexed gbuffer \a instancing_candidates with multi draw indirect calls.
+        //! \details Candidates sharing vertex array, index type, topology, textures and face culling are packed into one call.
+        //! With bindless textures enabled the textures do not break the calls.
+        //! The recorded candidates are marked, so record_instancing_candidates() skips them.
+        void record_indirect_draws();
+        //! \brief Writes the model_data of an \a instancing_candidate, if not done yet.
+        //! \param[in] index The index of the candidate.
+        void write_candidate_data(int64 index);
+        //! \brief Records the commands for an \a instancing_candidate.
+        //! \param[in,out] draw_buffer The command_buffer to add the commands to.
+        //! \param[in] candidate The \a instancing_candidate to draw. The model_data has to be written.
+        //! \param[in] instance_count The number of instances to draw.
+        //! \param[in] instance_data_offset The offset of the instance_data in the frame uniform buffer, or -1 if the draw is not instanced.
+        void record_opaque_draw(const command_buffer_ptr<max_key>& draw_buffer, const instancing_candidate& candidate, int32 instance_count, int64 instance_data_offset);
+
         //! \brief Sets up commands for a new mesh.
         //! \param[in,out] draw_buffer The command_buffer to add the commands to.
         //! \param[in] mesh_key The key used for sorting later on.
         //! \param[in] simplified True if mesh should bound for shadow mapping, else false.
+        //! \param[in] instance_data_offset The offset of the instance_data in the frame uniform buffer, or -1 if the draw is not instanced.
+        //! \param[in] instance_data_size The size of the instance_data in bytes.
         //! \return The last \a bind_texture_command to append to.
-        bind_texture_command* begin_mesh_draw(const command_buffer_ptr<max_key>& draw_buffer, max_key mesh_key, bool simplified = false);
+        bind_texture_command* begin_mesh_draw(const command_buffer_ptr<max_key>& draw_buffer, max_key mesh_key, bool simplified = false, int64 instance_data_offset = -1,
+                                              int64 instance_data_size = 0);
         //! \brief Sets up commands for a material.
         //! \param[in,out] draw_buffer The command_buffer to add the commands to.
         //! \param[in] last_command The previous command to append to.
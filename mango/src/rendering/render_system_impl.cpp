@@ -99,10 +99,11 @@ void render_system_impl::set_viewport(int32 x, int32 y, int32 width, int32 heigh
     m_current_render_system->set_viewport(x, y, width, height);
 }
 
-void render_system_impl::begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents)
+void render_system_impl::begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents, entity mesh_entity, mesh_visibility visibility,
+                                    const axis_aligned_bounding_box* world_bounds)
 {
     MANGO_ASSERT(m_current_render_system, "Current render sytem not valid!");
-    m_current_render_system->begin_mesh(model_matrix, has_normals, has_tangents);
+    m_current_render_system->begin_mesh(model_matrix, has_normals, has_tangents, mesh_entity, visibility, world_bounds);
 }
 
 void render_system_impl::end_mesh()
@@ -117,13 +118,13 @@ void render_system_impl::use_material(const material_ptr& mat)
     m_current_render_system->use_material(mat);
 }
 
-void render_system_impl::draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count)
+void render_system_impl::draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count, int32 base_vertex)
 {
     MANGO_ASSERT(m_current_render_system, "Current render sytem not valid!");
     MANGO_ASSERT(first >= 0, "The first index has to be greater than 0!");
     MANGO_ASSERT(count >= 0, "The index count has to be greater than 0!");
     MANGO_ASSERT(instance_count >= 0, "The instance count has to be greater than 0!");
-    m_current_render_system->draw_mesh(vertex_array, topology, first, count, type, instance_count);
+    m_current_render_system->draw_mesh(vertex_array, topology, first, count, type, instance_count, base_vertex);
 }
 
 void render_system_impl::submit_light(light_id id, mango_light* light)
@@ -132,6 +133,19 @@ void render_system_impl::submit_light(light_id id, mango_light* light)
     m_current_render_system->submit_light(id, light);
 }
 
+int32 render_system_impl::get_shadow_view_projections(glm::mat4* view_projections, int32 max_count)
+{
+    MANGO_ASSERT(m_current_render_system, "Current render sytem not valid!");
+    MANGO_ASSERT(max_count >= 0, "The maximum count has to be positive!");
+    return m_current_render_system->get_shadow_view_projections(view_projections, max_count);
+}
+
+void render_system_impl::submit_culling_info(int32 visible, int32 culled, int32 culled_shadow)
+{
+    MANGO_ASSERT(m_current_render_system, "Current render sytem not valid!");
+    m_current_render_system->submit_culling_info(visible, culled, culled_shadow);
+}
+
 framebuffer_ptr render_system_impl::get_backbuffer()
 {
     MANGO_ASSERT(m_current_render_system, "Current render sytem not valid!");
@@ -14,6 +14,7 @@
 #include <glm/glm.hpp>
 #include <graphics/command_buffer.hpp>
 #include <mango/render_system.hpp>
+#include <mango/scene_ecs.hpp>
 #include <queue>
 #include <rendering/light_stack.hpp>
 
@@ -41,6 +42,18 @@ namespace mango
             int32 vertices;   //!< The number of vertices.
             int32 triangles;  //!< The number of triangles (approx.).
             int32 materials;  //!< The number of materials.
+
+            int32 retained_primitives;      //!< The number of primitives drawn with retained commands.
+            int32 patched_primitives;       //!< The number of retained primitives with patched data.
+            int32 recorded_primitives;      //!< The number of retained primitives with (re)recorded commands.
+            int32 eliminated_commands;      //!< The number of redundant state commands eliminated after sorting.
+            int32 instanced_primitives;     //!< The number of primitives merged into instanced draws.
+            int32 indirect_primitives;      //!< The number of primitives submitted with multi draw indirect calls.
+            int32 uploaded_materials;       //!< The number of changed materials uploaded to the material table.
+            int32 visible_primitives;       //!< The number of primitives inside the camera frustum.
+            int32 culled_primitives;        //!< The number of primitives culled against the camera frustum.
+            int32 culled_shadow_primitives; //!< The number of primitives culled against all shadow cascade frustums.
+            int32 occluded_primitives;      //!< The number of primitives skipped, because they were occluded in the last frame.
         } last_frame;         //!< Measured stats from the last rendered frame.
     };
 
@@ -51,6 +64,16 @@ namespace mango
         float luminance;       //!< Smoothed out average luminance.
     };
 
+    //! \brief The passes a mesh is visible in. Determined by the culling before the mesh is submitted.
+    enum class mesh_visibility : uint8
+    {
+        none   = 0,      //!< Not visible at all.
+        camera = 1 << 0, //!< Visible for the active camera.
+        shadow = 1 << 1, //!< Visible in at least one shadow cascade.
+        all    = 3       //!< Visible everywhere. Used when nothing is culled.
+    };
+    MANGO_ENABLE_BITMASK_OPERATIONS(mesh_visibility)
+
     enum class light_type : uint8;
     struct light_data;
     struct environment_light_data;
@@ -104,7 +127,11 @@ namespace mango
         //! \param[in] model_matrix The model matrix to use.
         //! \param[in] has_normals Specifies if the following mesh primitives have normals as a vertex attribute.
         //! \param[in] has_tangents Specifies if the following mesh primitives have tangents as a vertex attribute.
-        virtual void begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents);
+        //! \param[in] mesh_entity The \a entity of the mesh. Used to keep commands of unchanged meshes over multiple frames. Can be the \a invalid_entity.
+        //! \param[in] visibility The \a mesh_visibility of the mesh. Primitives are only recorded for the passes they are visible in.
+        //! \param[in] world_bounds The world space \a axis_aligned_bounding_box of the mesh, or null. Used for occlusion culling.
+        virtual void begin_mesh(const glm::mat4& model_matrix, bool has_normals, bool has_tangents, entity mesh_entity = invalid_entity, mesh_visibility visibility = mesh_visibility::all,
+                                const axis_aligned_bounding_box* world_bounds = nullptr);
 
         //! \brief End the model rendering.
         //! \details Should be called after all mesh primitives are drawn.
@@ -121,13 +148,27 @@ namespace mango
         //! \param[in] count The number of indices to draw. Has to be a positive value.
         //! \param[in] type The \a index_type of the values in the index buffer.
         //! \param[in] instance_count The number of instances to draw. Has to be a positive value. For normal drawing pass 1.
-        virtual void draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count = 1);
+        //! \param[in] base_vertex The value added to the indices. Used by primitives sharing their vertex buffer with others.
+        virtual void draw_mesh(const vertex_array_ptr& vertex_array, primitive_topology topology, int32 first, int32 count, index_type type, int32 instance_count = 1, int32 base_vertex = 0);
 
         //! \brief Submits a light to the \a render_system.
         //! \param[in] id The id of the submitted \a mango_light.
         //! \param[in] light The \a mango_light to submit.
         virtual void submit_light(light_id id, mango_light* light);
 
+        //! \brief Retrieves the view projection matrices of the shadow cascades.
+        //! \details Used to cull shadow casters before they are submitted. These are the matrices of the last cascade update.
+        //! \param[out] view_projections Array to store the matrices in. Needs space for \a max_count matrices.
+        //! \param[in] max_count The maximum number of matrices to retrieve.
+        //! \return The number of retrieved matrices. Zero if shadow casters can not be culled.
+        virtual int32 get_shadow_view_projections(glm::mat4* view_projections, int32 max_count);
+
+        //! \brief Adds the results of the culling done before submitting the meshes to the \a renderer_info.
+        //! \param[in] visible The number of primitives inside the camera frustum.
+        //! \param[in] culled The number of primitives culled against the camera frustum.
+        //! \param[in] culled_shadow The number of primitives culled against all shadow cascade frustums.
+        virtual void submit_culling_info(int32 visible, int32 culled, int32 culled_shadow);
+
         //! \brief Returns the backbuffer of the a render_system.
         //! \return The backbuffer.
         virtual framebuffer_ptr get_backbuffer();
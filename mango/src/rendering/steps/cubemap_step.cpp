@@ -150,6 +150,7 @@ void cubemap_step::execute(gpu_buffer_ptr frame_uniform_buffer)
     de->first                 = 0;
     de->count                 = 18;
     de->type                  = index_type::ubyte;
+    de->base_vertex           = 0;
     de->instance_count        = 1;
 
 #ifdef MANGO_DEBUG
@@ -244,6 +244,7 @@ void shadow_map_step::update_cascades(float dt, float camera_near, float camera_
 
         m_shadow_data.view_projection_matrices[casc] = projection * view;
     }
+    m_cascades_valid = true;
 }
 
 void shadow_map_step::on_ui_widget()
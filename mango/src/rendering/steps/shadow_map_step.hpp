@@ -53,6 +53,24 @@ namespace mango
         //! reduce quality.
         void update_cascades(float dt, float camera_near, float camera_far, const glm::mat4& camera_view_projection, const glm::vec3& directional_direction);
 
+        //! \brief Returns the number of shadow cascades with valid view projection matrices.
+        //! \return The number of cascades, zero if the cascades were not updated yet.
+        inline int32 get_cascade_count()
+        {
+            return m_cascades_valid ? static_cast<int32>(m_shadow_data.cascade_count) : 0;
+        }
+
+        //! \brief Returns the view projection matrix of a shadow cascade.
+        //! \details The matrix is the one calculated in the last update_cascades() call.
+        //! \param[in] cascade The cascade to get the matrix for. Has to be smaller than get_cascade_count().
+        //! \return The view projection matrix of the cascade.
+        inline glm::mat4 get_cascade_view_projection(int32 cascade)
+        {
+            MANGO_ASSERT(cascade >= 0 && cascade < get_cascade_count(), "Cascade index is out of bounds!");
+            std140_mat4& m = m_shadow_data.view_projection_matrices[cascade];
+            return glm::mat4(m[0], m[1], m[2], m[3]);
+        }
+
         //! \brief The maximum number of cascades.
         static const int32 max_shadow_mapping_cascades = 4; // TODO Paul: We should move this.
 
@@ -74,6 +92,8 @@ namespace mango
 
         //! \brief Dirty bit for cascade count update.
         bool m_dirty_cascades;
+        //! \brief True if the cascade view projection matrices were calculated at least once.
+        bool m_cascades_valid = false;
 
         //! \brief Uniform buffer struct for shadow data.
         struct shadow_data
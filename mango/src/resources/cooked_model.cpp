@@ -0,0 +1,1029 @@
+//! \file      cooked_model.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <core/job_system.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/matrix_decompose.hpp>
+#include <graphics/graphics_common.hpp>
+#include <iomanip>
+#include <iterator>
+#include <map>
+#include <mango/log.hpp>
+#include <mango/profile.hpp>
+#include <mango/scene_ecs.hpp>
+#include <resources/cooked_model.hpp>
+#include <resources/resource_system.hpp>
+#include <resources/texture_compression.hpp>
+#include <resources/vertex_quantization.hpp>
+#include <sstream>
+#include <util/hashing.hpp>
+#include <util/helpers.hpp>
+
+using namespace mango;
+
+//! \brief The alignment of the tables and the binary data in cooked models.
+static const uint64 cooked_alignment = 16;
+
+//! \brief Appends bytes to a block of memory, aligned to cooked_alignment.
+//! \param[in,out] memory The memory to append to.
+//! \param[in] bytes The bytes to append.
+//! \param[in] size The number of bytes.
+//! \return The offset of the bytes in the memory.
+static uint64 append_aligned(std::vector<uint8>& memory, const void* bytes, ptr_size size)
+{
+    memory.resize((memory.size() + cooked_alignment - 1) & ~(cooked_alignment - 1));
+    const uint64 offset = memory.size();
+    if (size > 0)
+        memory.insert(memory.end(), static_cast<const uint8*>(bytes), static_cast<const uint8*>(bytes) + size);
+    return offset;
+}
+
+//! \brief Appends a table to the memory of a cooked model.
+//! \param[in,out] memory The memory to append to.
+//! \param[in] elements The elements of the table.
+//! \return The \a cooked_range of the table.
+template <typename T>
+static cooked_range append_table(std::vector<uint8>& memory, const std::vector<T>& elements)
+{
+    cooked_range range;
+    range.offset = append_aligned(memory, elements.data(), elements.size() * sizeof(T));
+    range.count  = elements.size();
+    return range;
+}
+
+//! \brief Returns the gl enum of a sampler parameter or -1 if it is not specified.
+//! \param[in] value The value in the gltf sampler.
+//! \return The gl enum or -1.
+static int32 sampler_parameter(int value)
+{
+    return value > 0 ? value : -1;
+}
+
+//! \brief Image usage flag for colors in standard color space (base color, emissive).
+static const uint8 image_usage_standard_color = 1 << 0;
+//! \brief Image usage flag for colors in linear space (metallic roughness, packed occlusion).
+static const uint8 image_usage_linear_color = 1 << 1;
+//! \brief Image usage flag for tangent space normals.
+static const uint8 image_usage_normal = 1 << 2;
+//! \brief Image usage flag for occlusion in the red channel.
+static const uint8 image_usage_occlusion = 1 << 3;
+
+//! \brief Adds an image usage flag to the image of a gltf texture.
+//! \param[in] m The model loaded by tinygltf.
+//! \param[in] texture_index The index of the texture. Negative if there is none.
+//! \param[in] usage The usage flag to add.
+//! \param[in,out] usages The usages of all images.
+static void add_image_usage(const tinygltf::Model& m, int texture_index, uint8 usage, std::vector<uint8>& usages)
+{
+    if (texture_index < 0 || texture_index >= static_cast<int32>(m.textures.size()))
+        return;
+    const int source = m.textures[texture_index].source;
+    if (source >= 0 && source < static_cast<int32>(usages.size()))
+        usages[source] |= usage;
+}
+
+//! \brief Block compresses all images of a gltf model, that are used by materials and have 8 bit components.
+//! \details Normals are compressed to bc5, separate occlusion to bc4 and everything else to bc7. The images are compressed in parallel with parallel_for_background().
+//! \param[in] m The model loaded by tinygltf.
+//! \param[out] compressions The \a texture_compression of every image. \a texture_compression::none for images that are not compressed.
+//! \param[out] compressed The compressed mipmap levels of every image.
+static void compress_images(const tinygltf::Model& m, std::vector<texture_compression>& compressions, std::vector<std::vector<uint8>>& compressed)
+{
+    PROFILE_ZONE;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<uint8> usages(m.images.size(), 0);
+    for (const tinygltf::Material& material : m.materials)
+    {
+        const int metallic_roughness = material.pbrMetallicRoughness.metallicRoughnessTexture.index;
+        const int occlusion          = material.occlusionTexture.index;
+        add_image_usage(m, material.pbrMetallicRoughness.baseColorTexture.index, image_usage_standard_color, usages);
+        add_image_usage(m, material.emissiveTexture.index, image_usage_standard_color, usages);
+        add_image_usage(m, metallic_roughness, image_usage_linear_color, usages);
+        add_image_usage(m, material.normalTexture.index, image_usage_normal, usages);
+        add_image_usage(m, occlusion, occlusion == metallic_roughness ? image_usage_linear_color : image_usage_occlusion, usages);
+    }
+
+    compressions.assign(m.images.size(), texture_compression::none);
+    compressed.assign(m.images.size(), std::vector<uint8>());
+    std::vector<int32> to_compress;
+    for (int32 i = 0; i < static_cast<int32>(m.images.size()); ++i)
+    {
+        const tinygltf::Image& image = m.images[i];
+        if (usages[i] == 0 || image.bits != 8 || image.component < 1 || image.component > 4)
+            continue;
+        if (image.image.empty() || image.image.size() != static_cast<ptr_size>(image.width) * image.height * image.component)
+            continue;
+        // Images with mixed usages keep all channels.
+        if (usages[i] == image_usage_normal)
+            compressions[i] = texture_compression::bc5;
+        else if (usages[i] == image_usage_occlusion)
+            compressions[i] = texture_compression::bc4;
+        else
+            compressions[i] = texture_compression::bc7;
+        to_compress.push_back(i);
+    }
+
+    const int32 count        = static_cast<int32>(to_compress.size());
+    const int32 thread_count = parallel_for_background(count, [&](int32 i) {
+        const int32 index            = to_compress[i];
+        const tinygltf::Image& image = m.images[index];
+        const ptr_size pixel_count   = static_cast<ptr_size>(image.width) * image.height;
+
+        // Missing channels are filled like the uncompressed formats are sampled.
+        std::vector<uint8> rgba(pixel_count * 4, 0);
+        for (ptr_size p = 0; p < pixel_count; ++p)
+        {
+            for (int32 c = 0; c < image.component; ++c)
+                rgba[p * 4 + c] = image.image[p * image.component + c];
+            if (image.component < 4)
+                rgba[p * 4 + 3] = 255;
+        }
+
+        const int32 levels = calculate_mip_count(image.width, image.height);
+        compressed[index].resize(static_cast<ptr_size>(get_compressed_size(compressions[index], image.width, image.height, levels)));
+        compress_texture(compressions[index], rgba.data(), image.width, image.height, levels, (usages[index] & image_usage_standard_color) != 0, compressed[index].data());
+    });
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    MANGO_LOG_INFO("Compressed {0} images on {1} threads in {2} ms.", count, thread_count, duration.count());
+}
+
+//! \brief The number of vertex attributes cooked into interleaved vertex streams.
+//! \details The attribute locations in the shaders are position, normal, texcoord and tangent.
+static const int32 cooked_vertex_attribute_count = 4;
+
+//! \brief Checks that a gltf accessor has a buffer and all its elements are inside of it.
+//! \param[in] m The loaded gltf model.
+//! \param[in] accessor The accessor to check.
+//! \return True if the accessor can be read, else false.
+static bool is_accessor_readable(const tinygltf::Model& m, const tinygltf::Accessor& accessor)
+{
+    if (accessor.bufferView < 0 || accessor.bufferView >= static_cast<int>(m.bufferViews.size()) || accessor.count == 0)
+        return false;
+    const tinygltf::BufferView& view = m.bufferViews[accessor.bufferView];
+    if (view.buffer < 0 || view.buffer >= static_cast<int>(m.buffers.size()) || view.byteOffset + view.byteLength > m.buffers[view.buffer].data.size())
+        return false;
+
+    const int32 component_size = tinygltf::GetComponentSizeInBytes(static_cast<uint32>(accessor.componentType));
+    const int32 components     = tinygltf::GetNumComponentsInType(static_cast<uint32>(accessor.type));
+    const int32 stride         = accessor.ByteStride(view);
+    if (component_size <= 0 || components <= 0 || stride <= 0)
+        return false;
+    return accessor.byteOffset + (accessor.count - 1) * static_cast<ptr_size>(stride) + static_cast<ptr_size>(component_size * components) <= view.byteLength;
+}
+
+//! \brief Reads one element of a gltf accessor as floats.
+//! \details Normalized integers are converted to [0, 1] or [-1, 1]. The accessor has to be readable.
+//! \param[in] m The loaded gltf model.
+//! \param[in] accessor The accessor to read.
+//! \param[in] element The index of the element.
+//! \param[out] values The four components of the element, missing ones are zero.
+static void read_accessor_element(const tinygltf::Model& m, const tinygltf::Accessor& accessor, ptr_size element, float* values)
+{
+    const tinygltf::BufferView& view = m.bufferViews[accessor.bufferView];
+    const uint8* bytes               = m.buffers[view.buffer].data.data() + view.byteOffset + accessor.byteOffset + element * accessor.ByteStride(view);
+    const int32 components           = std::min(tinygltf::GetNumComponentsInType(static_cast<uint32>(accessor.type)), 4);
+    for (int32 c = 0; c < 4; ++c)
+    {
+        values[c] = 0.0f;
+        if (c >= components)
+            continue;
+        switch (accessor.componentType)
+        {
+        case TINYGLTF_COMPONENT_TYPE_FLOAT:
+            memcpy(&values[c], bytes + c * sizeof(float), sizeof(float));
+            break;
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+            values[c] = accessor.normalized ? bytes[c] / 255.0f : bytes[c];
+            break;
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+        {
+            const int8 value = static_cast<int8>(bytes[c]);
+            values[c]        = accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        {
+            uint16 value;
+            memcpy(&value, bytes + c * sizeof(uint16), sizeof(uint16));
+            values[c] = accessor.normalized ? value / 65535.0f : value;
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        {
+            int16 value;
+            memcpy(&value, bytes + c * sizeof(int16), sizeof(int16));
+            values[c] = accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+            break;
+        }
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        {
+            uint32 value;
+            memcpy(&value, bytes + c * sizeof(uint32), sizeof(uint32));
+            values[c] = static_cast<float>(value);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+}
+
+//! \brief Normalizes the first three components of a vector, zero vectors stay zero.
+//! \param[in,out] values The vector to normalize.
+static void normalize_direction(float* values)
+{
+    const float length = std::sqrt(values[0] * values[0] + values[1] * values[1] + values[2] * values[2]);
+    if (length <= 0.0f)
+        return;
+    for (int32 c = 0; c < 3; ++c)
+        values[c] /= length;
+}
+
+//! \brief Packs the vertex attributes of a primitive into one interleaved and quantized vertex stream.
+//! \details Positions stay 32 bit floats, normals and tangents get packed to signed normalized 10:10:10:2 and texture coordinates to unsigned normalized 16 bit, if they are all in [0, 1].
+//! \param[in] m The loaded gltf model.
+//! \param[in] accessors The accessors of the attributes per location, -1 for missing attributes. There has to be a position.
+//! \param[out] stream The interleaved vertices.
+//! \param[out] attributes The \a cooked_attributes of the stream.
+//! \return The size of one vertex in bytes, 0 if the accessors can not be packed.
+static int32 pack_vertex_stream(const tinygltf::Model& m, const int* accessors, std::vector<uint8>& stream, std::vector<cooked_attribute>& attributes)
+{
+    const ptr_size vertex_count = m.accessors[accessors[0]].count;
+    for (int32 location = 0; location < cooked_vertex_attribute_count; ++location)
+    {
+        if (accessors[location] < 0)
+            continue;
+        const tinygltf::Accessor& accessor = m.accessors[accessors[location]];
+        if (!is_accessor_readable(m, accessor) || accessor.count != vertex_count)
+            return 0;
+    }
+
+    float values[4];
+    // Texture coordinates outside of [0, 1] are repeated and keep the full precision.
+    bool texcoords_in_unit_range = true;
+    for (ptr_size v = 0; accessors[2] >= 0 && v < vertex_count && texcoords_in_unit_range; ++v)
+    {
+        read_accessor_element(m, m.accessors[accessors[2]], v, values);
+        texcoords_in_unit_range = values[0] >= 0.0f && values[0] <= 1.0f && values[1] >= 0.0f && values[1] <= 1.0f;
+    }
+
+    const format texcoord_format    = texcoords_in_unit_range ? format::rg16 : format::rg32f;
+    const int32 texcoord_size       = static_cast<int32>(texcoords_in_unit_range ? 2 * sizeof(uint16) : 2 * sizeof(float));
+    const format location_formats[] = { format::rgb32f, format::t_int_2_10_10_10_rev, texcoord_format, format::t_int_2_10_10_10_rev };
+    const int32 location_sizes[]    = { 3 * sizeof(float), sizeof(uint32), texcoord_size, sizeof(uint32) };
+
+    int32 stride = 0;
+    attributes.clear();
+    for (int32 location = 0; location < cooked_vertex_attribute_count; ++location)
+    {
+        if (accessors[location] < 0)
+            continue;
+        cooked_attribute attribute;
+        attribute.location = location;
+        attribute.offset   = static_cast<uint32>(stride);
+        attribute.format   = static_cast<uint32>(location_formats[location]);
+        attributes.push_back(attribute);
+        stride += location_sizes[location];
+    }
+
+    stream.resize(vertex_count * static_cast<ptr_size>(stride));
+    for (ptr_size v = 0; v < vertex_count; ++v)
+    {
+        uint8* vertex = stream.data() + v * static_cast<ptr_size>(stride);
+        for (const cooked_attribute& attribute : attributes)
+        {
+            read_accessor_element(m, m.accessors[accessors[attribute.location]], v, values);
+            uint8* destination = vertex + attribute.offset;
+            if (attribute.location == 0 || attribute.format == static_cast<uint32>(format::rg32f))
+            {
+                memcpy(destination, values, location_sizes[attribute.location]);
+            }
+            else if (attribute.location == 2)
+            {
+                const uint16 texcoord[2] = { quantize_unorm16(values[0]), quantize_unorm16(values[1]) };
+                memcpy(destination, texcoord, sizeof(texcoord));
+            }
+            else
+            {
+                // Only the sign of the tangent w is used in the shaders, it is stored exactly.
+                normalize_direction(values);
+                const float w       = attribute.location == 3 ? (values[3] < 0.0f ? -1.0f : 1.0f) : 0.0f;
+                const uint32 packed = pack_snorm_10_10_10_2(values[0], values[1], values[2], w);
+                memcpy(destination, &packed, sizeof(uint32));
+            }
+        }
+    }
+    return stride;
+}
+
+//! \brief Continues a source hash with the external files referenced by the uris of a gltf json document.
+//! \details Buffers and images in external files are not part of the gltf file, so changes to them have to change the hash as well.
+//! Embedded data uris are part of the document already. Missing files are hashed by their uri only.
+//! \param[in] json The gltf json document.
+//! \param[in] size The size of the document in bytes.
+//! \param[in] directory The directory of the gltf file including the separator, the uris are relative to it.
+//! \param[in] hash The hash to continue.
+//! \return The continued hash.
+static uint64 hash_external_uris(const char* json, ptr_size size, const string& directory, uint64 hash)
+{
+    const string key = "\"uri\"";
+    const char* end  = json + size;
+    for (const char* c = std::search(json, end, key.begin(), key.end()); c != end; c = std::search(c, end, key.begin(), key.end()))
+    {
+        c += key.size();
+        while (c != end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n' || *c == ':'))
+            ++c;
+        if (c == end || *c != '"')
+            continue;
+
+        // Json escapes the slashes optionally and uris encode special characters with percent escapes.
+        string uri;
+        for (++c; c != end && *c != '"'; ++c)
+        {
+            if (*c == '\\' && c + 1 != end)
+                ++c;
+            if (*c == '%' && end - c > 2 && std::isxdigit(static_cast<unsigned char>(c[1])) && std::isxdigit(static_cast<unsigned char>(c[2])))
+            {
+                uri.push_back(static_cast<char>(std::stoi(string(c + 1, 2), nullptr, 16)));
+                c += 2;
+                continue;
+            }
+            uri.push_back(*c);
+        }
+        if (uri.compare(0, 5, "data:") == 0)
+            continue;
+
+        hash = fnv1a_hash::hash(uri.data(), uri.size(), hash);
+        mapped_file file;
+        if (file.open(directory + uri))
+            hash = fnv1a_hash::hash(file.data(), static_cast<ptr_size>(file.size()), hash);
+    }
+    return hash;
+}
+
+cooked_model::cooked_model()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_header(nullptr)
+{
+}
+
+bool cooked_model::load(const string& path)
+{
+    PROFILE_ZONE;
+    std::ifstream source(path, std::ios::binary);
+    if (!source)
+    {
+        MANGO_LOG_ERROR("Could not open model file {0}!", path);
+        return false;
+    }
+    std::vector<char> content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+    uint64 source_hash = fnv1a_hash::hash(content.data(), content.size());
+
+    // Binary files start with a 12 byte header and the json chunk length and type.
+    const char* json       = content.data();
+    ptr_size json_size     = content.size();
+    const uint32 glb_magic = 0x46546c67; // glTF
+    uint32 magic           = 0;
+    if (content.size() >= 20)
+        memcpy(&magic, content.data(), sizeof(magic));
+    if (magic == glb_magic)
+    {
+        uint32 chunk_length = 0;
+        memcpy(&chunk_length, content.data() + 12, sizeof(chunk_length));
+        json      = content.data() + 20;
+        json_size = std::min(static_cast<ptr_size>(chunk_length), content.size() - 20);
+    }
+    source_hash = hash_external_uris(json, json_size, path.substr(0, path.find_last_of("\\/") + 1), source_hash);
+    content.clear();
+    content.shrink_to_fit();
+
+    std::stringstream cache_path;
+    cache_path << model_cache_directory << std::hex << std::setw(16) << std::setfill('0') << source_hash << ".mcm";
+    if (read(cache_path.str(), source_hash))
+    {
+        MANGO_LOG_DEBUG("Model {0} loaded from cache {1}.", path, cache_path.str());
+        return true;
+    }
+
+    tinygltf::Model gltf_model;
+    if (!resource_system::parse_model(path.c_str(), gltf_model) || !cook(gltf_model, source_hash))
+        return false;
+
+    // A failed write only costs the next load time.
+    if (!create_directories(model_cache_directory) || !write(cache_path.str()))
+        MANGO_LOG_WARN("Could not write model cache {0}!", cache_path.str());
+    return true;
+}
+
+bool cooked_model::cook(const tinygltf::Model& m, uint64 source_hash)
+{
+    PROFILE_ZONE;
+    if (m.scenes.empty())
+    {
+        MANGO_LOG_DEBUG("No scenes in the gltf model found! Can not load invalid gltf.");
+        return false;
+    }
+
+    std::vector<uint8> data;
+    std::vector<char> strings;
+    auto add_string = [&strings](const string& str) {
+        cooked_range range;
+        range.offset = strings.size();
+        range.count  = str.size();
+        strings.insert(strings.end(), str.begin(), str.end());
+        return range;
+    };
+
+    std::vector<texture_compression> compressions;
+    std::vector<std::vector<uint8>> compressed;
+    compress_images(m, compressions, compressed);
+
+    std::vector<cooked_image> images(m.images.size());
+    for (ptr_size i = 0; i < m.images.size(); ++i)
+    {
+        const tinygltf::Image& image = m.images[i];
+        images[i].width              = image.width;
+        images[i].height             = image.height;
+        images[i].components         = image.component;
+        images[i].bits               = image.bits;
+        images[i].compression        = static_cast<uint32>(compressions[i]);
+        if (compressions[i] == texture_compression::none)
+        {
+            images[i].bytes.offset = append_aligned(data, image.image.data(), image.image.size());
+            images[i].bytes.count  = image.image.size();
+            images[i].levels       = 1;
+        }
+        else
+        {
+            images[i].bytes.offset = append_aligned(data, compressed[i].data(), compressed[i].size());
+            images[i].bytes.count  = compressed[i].size();
+            images[i].levels       = calculate_mip_count(image.width, image.height);
+        }
+    }
+    compressed.clear();
+
+    std::vector<cooked_texture> textures(m.textures.size());
+    for (ptr_size i = 0; i < m.textures.size(); ++i)
+    {
+        const tinygltf::Texture& tex = m.textures[i];
+        const bool has_image         = tex.source >= 0 && tex.source < static_cast<int32>(m.images.size()) && !m.images[tex.source].image.empty();
+        textures[i].image            = has_image ? tex.source : -1;
+        textures[i].min_filter       = -1;
+        textures[i].mag_filter       = -1;
+        textures[i].wrap_s           = -1;
+        textures[i].wrap_t           = -1;
+        if (tex.sampler >= 0)
+        {
+            const tinygltf::Sampler& sampler = m.samplers[tex.sampler];
+            textures[i].min_filter           = sampler_parameter(sampler.minFilter);
+            textures[i].mag_filter           = sampler_parameter(sampler.magFilter);
+            textures[i].wrap_s               = sampler_parameter(sampler.wrapS);
+            textures[i].wrap_t               = sampler_parameter(sampler.wrapT);
+        }
+    }
+
+    std::vector<cooked_material> materials(m.materials.size());
+    for (ptr_size i = 0; i < m.materials.size(); ++i)
+    {
+        const tinygltf::Material& p_m = m.materials[i];
+        cooked_material& material     = materials[i];
+        auto& pbr                     = p_m.pbrMetallicRoughness;
+        memset(&material, 0, sizeof(cooked_material));
+        material.name = add_string(p_m.name);
+        for (int32 c = 0; c < 4; ++c)
+            material.base_color[c] = static_cast<float>(pbr.baseColorFactor[c]);
+        for (int32 c = 0; c < 3; ++c)
+            material.emissive_color[c] = static_cast<float>(p_m.emissiveFactor[c]);
+        material.metallic                   = static_cast<float>(pbr.metallicFactor);
+        material.roughness                  = static_cast<float>(pbr.roughnessFactor);
+        material.base_color_texture         = pbr.baseColorTexture.index;
+        material.metallic_roughness_texture = pbr.metallicRoughnessTexture.index;
+        material.occlusion_texture          = p_m.occlusionTexture.index;
+        material.normal_texture             = p_m.normalTexture.index;
+        material.emissive_texture           = p_m.emissiveTexture.index;
+        material.double_sided               = p_m.doubleSided ? 1 : 0;
+        material.alpha_rendering            = static_cast<uint8>(alpha_mode::mode_opaque);
+        material.alpha_cutoff               = 1.0f;
+        if (p_m.alphaMode.compare("MASK") == 0)
+        {
+            material.alpha_rendering = static_cast<uint8>(alpha_mode::mode_mask);
+            material.alpha_cutoff    = static_cast<float>(p_m.alphaCutoff);
+        }
+        if (p_m.alphaMode.compare("BLEND") == 0)
+            material.alpha_rendering = static_cast<uint8>(alpha_mode::mode_blend);
+    }
+
+    // Index buffer views are copied once, the vertex attributes are packed into one stream per accessor combination.
+    // All indices of the model go to one buffer and the streams to one buffer per vertex format, so primitives can share their vertex arrays.
+    std::vector<uint8> indices;
+    std::map<int, int32> index_offsets;
+    std::map<std::array<int, cooked_vertex_attribute_count>, int32> vertex_streams;
+    std::map<std::vector<uint32>, int32> vertex_format_indices;
+    std::vector<std::vector<uint8>> vertex_formats;
+    std::vector<int32> vertex_format_attributes;
+    std::vector<uint8> stream;
+    std::vector<cooked_attribute> stream_attributes;
+    std::vector<cooked_buffer_view> buffer_views;
+    auto add_buffer_view = [&data, &buffer_views](const uint8* bytes, ptr_size size, uint32 target) {
+        cooked_buffer_view buffer_view;
+        buffer_view.bytes.offset = append_aligned(data, bytes, size);
+        buffer_view.bytes.count  = size;
+        buffer_view.target       = target;
+        buffer_view.padding      = 0;
+        buffer_views.push_back(buffer_view);
+    };
+
+    std::vector<cooked_mesh> meshes(m.meshes.size());
+    std::vector<cooked_primitive> primitives;
+    std::vector<cooked_attribute> attributes;
+    for (ptr_size i = 0; i < m.meshes.size(); ++i)
+    {
+        meshes[i].first_primitive = static_cast<int32>(primitives.size());
+        for (const tinygltf::Primitive& primitive : m.meshes[i].primitives)
+        {
+            cooked_primitive p;
+            memset(&p, 0, sizeof(cooked_primitive));
+            p.topology           = primitive.mode; // cast is okay.
+            p.material           = primitive.material;
+            p.index_type         = static_cast<int32>(index_type::none);
+            p.index_buffer_view  = -1;
+            p.vertex_buffer_view = -1;
+
+            std::array<int, cooked_vertex_attribute_count> accessors = { { -1, -1, -1, -1 } };
+            bool sparse                                              = false;
+            for (auto& attrib : primitive.attributes)
+            {
+                int32 location = -1;
+                if (attrib.first.compare("POSITION") == 0)
+                    location = 0;
+                if (attrib.first.compare("NORMAL") == 0)
+                    location = 1;
+                if (attrib.first.compare("TEXCOORD_0") == 0)
+                    location = 2;
+                if (attrib.first.compare("TANGENT") == 0)
+                    location = 3;
+                if (location < 0 || attrib.second < 0 || attrib.second >= static_cast<int>(m.accessors.size()))
+                {
+                    MANGO_LOG_DEBUG("Vertex attribute array is ignored: {0}!", attrib.first);
+                    continue;
+                }
+                sparse |= m.accessors[attrib.second].sparse.isSparse;
+                accessors[location] = attrib.second;
+            }
+
+            if (sparse)
+            {
+                MANGO_LOG_ERROR("Models with sparse accessors are currently not supported! Primitive is skipped!");
+                continue;
+            }
+            if (accessors[0] < 0)
+            {
+                MANGO_LOG_ERROR("Primitive without positions! Primitive is skipped!");
+                continue;
+            }
+
+            const tinygltf::Accessor& position = m.accessors[accessors[0]];
+            // Position accessors are required to have min and max values.
+            if (position.minValues.size() == 3 && position.maxValues.size() == 3)
+            {
+                p.has_bounds = 1;
+                for (int32 c = 0; c < 3; ++c)
+                {
+                    p.bounds_min[c] = static_cast<float>(position.minValues[c]);
+                    p.bounds_max[c] = static_cast<float>(position.maxValues[c]);
+                }
+            }
+            p.has_normals  = accessors[1] >= 0 ? 1 : 0;
+            p.has_tangents = accessors[3] >= 0 ? 1 : 0;
+            p.count        = static_cast<int32>(position.count); // TODO Paul: Is int32 big enough?
+
+            if (primitive.indices >= 0)
+            {
+                const tinygltf::Accessor& index_accessor = m.accessors[primitive.indices];
+                if (!is_accessor_readable(m, index_accessor))
+                {
+                    MANGO_LOG_ERROR("Invalid index accessor! Primitive is skipped!");
+                    continue;
+                }
+
+                // Views start at multiples of the largest index size, so the accessor offsets stay aligned.
+                auto it = index_offsets.find(index_accessor.bufferView);
+                if (it == index_offsets.end())
+                {
+                    const tinygltf::BufferView& view = m.bufferViews[index_accessor.bufferView];
+                    const int32 offset               = static_cast<int32>(indices.size() + (sizeof(uint32) - 1)) & ~static_cast<int32>(sizeof(uint32) - 1);
+                    const uint8* bytes               = m.buffers[view.buffer].data.data() + view.byteOffset;
+                    indices.resize(static_cast<ptr_size>(offset));
+                    indices.insert(indices.end(), bytes, bytes + view.byteLength);
+                    it = index_offsets.insert({ index_accessor.bufferView, offset }).first;
+                }
+                p.first             = it->second + static_cast<int32>(index_accessor.byteOffset); // TODO Paul: Is int32 big enough?
+                p.count             = static_cast<int32>(index_accessor.count);                   // TODO Paul: Is int32 big enough?
+                p.index_type        = index_accessor.componentType;
+                p.index_buffer_view = 0;
+            }
+
+            // Primitives with the same accessors share their vertex stream.
+            auto it = vertex_streams.find(accessors);
+            if (it != vertex_streams.end())
+            {
+                const cooked_primitive& shared = primitives[it->second];
+                p.base_vertex                  = shared.base_vertex;
+                p.vertex_buffer_view           = shared.vertex_buffer_view;
+                p.vertex_stride                = shared.vertex_stride;
+                p.first_attribute              = shared.first_attribute;
+                p.attribute_count              = shared.attribute_count;
+            }
+            else
+            {
+                p.vertex_stride = pack_vertex_stream(m, accessors.data(), stream, stream_attributes);
+                if (p.vertex_stride == 0)
+                {
+                    MANGO_LOG_ERROR("Invalid vertex attribute accessors! Primitive is skipped!");
+                    continue;
+                }
+
+                // The vertex format is the list of locations and formats, the offsets and the stride follow from it.
+                std::vector<uint32> vertex_format;
+                for (const cooked_attribute& attribute : stream_attributes)
+                {
+                    vertex_format.push_back(static_cast<uint32>(attribute.location));
+                    vertex_format.push_back(attribute.format);
+                }
+                auto format_it = vertex_format_indices.find(vertex_format);
+                if (format_it == vertex_format_indices.end())
+                {
+                    format_it = vertex_format_indices.insert({ vertex_format, static_cast<int32>(vertex_formats.size()) }).first;
+                    vertex_format_attributes.push_back(static_cast<int32>(attributes.size()));
+                    vertex_formats.emplace_back();
+                    attributes.insert(attributes.end(), stream_attributes.begin(), stream_attributes.end());
+                }
+                std::vector<uint8>& vertices = vertex_formats[format_it->second];
+                p.base_vertex                = static_cast<int32>(vertices.size() / static_cast<ptr_size>(p.vertex_stride)); // TODO Paul: Is int32 big enough?
+                p.vertex_buffer_view         = format_it->second;
+                p.first_attribute            = vertex_format_attributes[format_it->second];
+                p.attribute_count            = static_cast<int32>(stream_attributes.size());
+                vertices.insert(vertices.end(), stream.begin(), stream.end());
+                vertex_streams.insert({ accessors, static_cast<int32>(primitives.size()) });
+            }
+            primitives.push_back(p);
+        }
+        meshes[i].primitive_count = static_cast<int32>(primitives.size()) - meshes[i].first_primitive;
+    }
+
+    // The index buffer is the first buffer view, followed by the vertex buffers.
+    const int32 first_vertex_buffer_view = index_offsets.empty() ? 0 : 1;
+    if (!index_offsets.empty())
+        add_buffer_view(indices.data(), indices.size(), 1);
+    for (const std::vector<uint8>& vertices : vertex_formats)
+        add_buffer_view(vertices.data(), vertices.size(), 0);
+    for (cooked_primitive& p : primitives)
+        p.vertex_buffer_view += first_vertex_buffer_view;
+
+    std::vector<cooked_camera> cameras(m.cameras.size());
+    for (ptr_size i = 0; i < m.cameras.size(); ++i)
+    {
+        const tinygltf::Camera& camera = m.cameras[i];
+        if (camera.type == "perspective")
+        {
+            cameras[i].type   = static_cast<uint32>(camera_type::perspective_camera);
+            cameras[i].z_near = static_cast<float>(camera.perspective.znear);
+            cameras[i].z_far  = camera.perspective.zfar > 0.0 ? static_cast<float>(camera.perspective.zfar) : 10000.0f; // Infinite?
+            cameras[i].x      = static_cast<float>(camera.perspective.yfov);
+            cameras[i].y      = camera.perspective.aspectRatio > 0.0 ? static_cast<float>(camera.perspective.aspectRatio) : 16.0f / 9.0f;
+        }
+        else // orthographic
+        {
+            cameras[i].type   = static_cast<uint32>(camera_type::orthographic_camera);
+            cameras[i].z_near = static_cast<float>(camera.orthographic.znear);
+            cameras[i].z_far  = camera.orthographic.zfar > 0.0 ? static_cast<float>(camera.orthographic.zfar) : 10000.0f; // Infinite?
+            cameras[i].x      = static_cast<float>(camera.orthographic.xmag);
+            cameras[i].y      = static_cast<float>(camera.orthographic.ymag);
+        }
+    }
+
+    std::vector<cooked_node> nodes(m.nodes.size());
+    std::vector<int32> node_indices;
+    for (ptr_size i = 0; i < m.nodes.size(); ++i)
+    {
+        const tinygltf::Node& n = m.nodes[i];
+        cooked_node& node       = nodes[i];
+        memset(&node, 0, sizeof(cooked_node));
+        node.name = add_string(n.name);
+
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::quat rotation = glm::quat(glm::vec3(0.0f));
+        glm::vec3 scale    = glm::vec3(1.0f);
+        if (n.matrix.size() == 16)
+        {
+            glm::mat4 input = glm::make_mat4(n.matrix.data());
+            glm::vec3 s;
+            glm::vec4 p;
+            glm::decompose(input, scale, rotation, position, s, p);
+        }
+        else
+        {
+            if (n.translation.size() == 3)
+                position = glm::vec3(n.translation[0], n.translation[1], n.translation[2]);
+            if (n.rotation.size() == 4)
+                rotation = glm::quat(static_cast<float>(n.rotation[3]), static_cast<float>(n.rotation[0]), static_cast<float>(n.rotation[1]), static_cast<float>(n.rotation[2]));
+            if (n.scale.size() == 3)
+                scale = glm::vec3(n.scale[0], n.scale[1], n.scale[2]);
+        }
+        memcpy(node.position, &position.x, sizeof(node.position));
+        node.rotation[0] = rotation.x;
+        node.rotation[1] = rotation.y;
+        node.rotation[2] = rotation.z;
+        node.rotation[3] = rotation.w;
+        memcpy(node.scale, &scale.x, sizeof(node.scale));
+
+        MANGO_ASSERT(n.mesh < static_cast<int32>(m.meshes.size()), "Invalid gltf mesh!");
+        MANGO_ASSERT(n.camera < static_cast<int32>(m.cameras.size()), "Invalid gltf camera!");
+        node.mesh        = n.mesh;
+        node.camera      = n.camera;
+        node.first_child = static_cast<int32>(node_indices.size());
+        node.child_count = static_cast<int32>(n.children.size());
+        for (int child : n.children)
+        {
+            MANGO_ASSERT(child < static_cast<int32>(m.nodes.size()), "Invalid gltf node!");
+            node_indices.push_back(child);
+        }
+    }
+
+    // load the default scene or the first one.
+    cooked_model_header header;
+    memset(&header, 0, sizeof(cooked_model_header));
+    const tinygltf::Scene& scene = m.scenes[m.defaultScene > -1 ? m.defaultScene : 0];
+    header.scene_nodes.offset    = node_indices.size();
+    header.scene_nodes.count     = scene.nodes.size();
+    node_indices.insert(node_indices.end(), scene.nodes.begin(), scene.nodes.end());
+
+    header.magic       = cooked_model_magic;
+    header.version     = cooked_model_version;
+    header.source_hash = source_hash;
+
+    m_file.close();
+    m_memory.clear();
+    m_memory.resize(sizeof(cooked_model_header));
+    header.tables[static_cast<uint8>(cooked_table::buffer_views)] = append_table(m_memory, buffer_views);
+    header.tables[static_cast<uint8>(cooked_table::images)]       = append_table(m_memory, images);
+    header.tables[static_cast<uint8>(cooked_table::textures)]     = append_table(m_memory, textures);
+    header.tables[static_cast<uint8>(cooked_table::materials)]    = append_table(m_memory, materials);
+    header.tables[static_cast<uint8>(cooked_table::attributes)]   = append_table(m_memory, attributes);
+    header.tables[static_cast<uint8>(cooked_table::primitives)]   = append_table(m_memory, primitives);
+    header.tables[static_cast<uint8>(cooked_table::meshes)]       = append_table(m_memory, meshes);
+    header.tables[static_cast<uint8>(cooked_table::cameras)]      = append_table(m_memory, cameras);
+    header.tables[static_cast<uint8>(cooked_table::nodes)]        = append_table(m_memory, nodes);
+    header.tables[static_cast<uint8>(cooked_table::node_indices)] = append_table(m_memory, node_indices);
+    header.tables[static_cast<uint8>(cooked_table::strings)]      = append_table(m_memory, strings);
+    header.tables[static_cast<uint8>(cooked_table::data)]         = append_table(m_memory, data);
+    memcpy(m_memory.data(), &header, sizeof(cooked_model_header));
+
+    return setup(m_memory.data(), m_memory.size(), source_hash);
+}
+
+bool cooked_model::read(const string& path, uint64 source_hash)
+{
+    PROFILE_ZONE;
+    m_memory.clear();
+    if (!m_file.open(path))
+        return false;
+    if (!setup(m_file.data(), m_file.size(), source_hash))
+    {
+        m_file.close();
+        return false;
+    }
+    return true;
+}
+
+bool cooked_model::write(const string& path) const
+{
+    PROFILE_ZONE;
+    MANGO_ASSERT(m_header, "Writing invalid cooked model!");
+    // Written to a temporary file first, so other loads never map partially written files.
+    const string temporary_path = path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        if (!file)
+            return false;
+        file.write(reinterpret_cast<const char*>(m_data), static_cast<std::streamsize>(m_size));
+        if (!file)
+            return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(temporary_path.c_str(), path.c_str()) == 0;
+}
+
+//! \brief Returns the records of a table of a cooked model file.
+//! \param[in] data The data of the file.
+//! \param[in] header The header of the file.
+//! \param[in] table The \a cooked_table.
+//! \return Pointer to the first record.
+template <typename T>
+static const T* get_records(const uint8* data, const cooked_model_header& header, cooked_table table)
+{
+    return reinterpret_cast<const T*>(data + header.tables[static_cast<uint8>(table)].offset);
+}
+
+//! \brief Checks that all indices of the records of a cooked model file reference existing records.
+//! \details The tables have to be inside the file already. Nodes have to form trees, so building the model terminates.
+//! \param[in] data The data of the file.
+//! \param[in] header The header of the file.
+//! \return True if all indices are valid, else false.
+static bool validate_record_indices(const uint8* data, const cooked_model_header& header)
+{
+    auto count          = [&header](cooked_table table) { return static_cast<int64>(header.tables[static_cast<uint8>(table)].count); };
+    auto in_table       = [&count](int64 index, cooked_table table) { return index >= 0 && index < count(table); };
+    auto optional_index = [&in_table](int64 index, cooked_table table) { return index < 0 || in_table(index, table); };
+    auto range_in_table = [&count](int64 first, int64 range_count, cooked_table table) { return first >= 0 && range_count >= 0 && first + range_count <= count(table); };
+    auto valid_name     = [&count](const cooked_range& name) {
+        return name.offset <= static_cast<uint64>(count(cooked_table::strings)) && name.count <= static_cast<uint64>(count(cooked_table::strings)) - name.offset;
+    };
+
+    const cooked_buffer_view* buffer_views = get_records<cooked_buffer_view>(data, header, cooked_table::buffer_views);
+    const cooked_image* images             = get_records<cooked_image>(data, header, cooked_table::images);
+    for (int64 i = 0; i < count(cooked_table::images); ++i)
+    {
+        // Uncompressed images have to contain all their pixels.
+        const cooked_image& image = images[i];
+        if (image.compression != static_cast<uint32>(texture_compression::none) || image.bytes.count == 0)
+            continue;
+        if (image.width <= 0 || image.height <= 0 || image.components < 1 || image.components > 4 || (image.bits != 8 && image.bits != 16))
+            return false;
+        if (image.bytes.count != static_cast<uint64>(image.width) * static_cast<uint64>(image.height) * static_cast<uint64>(image.components * image.bits / 8))
+            return false;
+    }
+
+    const cooked_texture* textures = get_records<cooked_texture>(data, header, cooked_table::textures);
+    for (int64 i = 0; i < count(cooked_table::textures); ++i)
+    {
+        if (!optional_index(textures[i].image, cooked_table::images))
+            return false;
+    }
+
+    const cooked_material* materials = get_records<cooked_material>(data, header, cooked_table::materials);
+    for (int64 i = 0; i < count(cooked_table::materials); ++i)
+    {
+        const cooked_material& material = materials[i];
+        const int32 texture_indices[]   = { material.base_color_texture, material.metallic_roughness_texture, material.occlusion_texture, material.normal_texture, material.emissive_texture };
+        if (!valid_name(material.name))
+            return false;
+        for (int32 texture_index : texture_indices)
+        {
+            if (!optional_index(texture_index, cooked_table::textures))
+                return false;
+        }
+    }
+
+    const cooked_attribute* attributes = get_records<cooked_attribute>(data, header, cooked_table::attributes);
+    const cooked_primitive* primitives = get_records<cooked_primitive>(data, header, cooked_table::primitives);
+    for (int64 i = 0; i < count(cooked_table::primitives); ++i)
+    {
+        const cooked_primitive& primitive = primitives[i];
+        if (!in_table(primitive.vertex_buffer_view, cooked_table::buffer_views) || buffer_views[primitive.vertex_buffer_view].target != 0 || primitive.vertex_stride <= 0)
+            return false;
+        if (!optional_index(primitive.material, cooked_table::materials) || primitive.first < 0 || primitive.count < 0)
+            return false;
+        if (!range_in_table(primitive.first_attribute, primitive.attribute_count, cooked_table::attributes))
+            return false;
+        for (int32 a = 0; a < primitive.attribute_count; ++a)
+        {
+            if (attributes[primitive.first_attribute + a].offset >= static_cast<uint32>(primitive.vertex_stride))
+                return false;
+        }
+
+        // Draws must stay inside the buffers.
+        const uint64 vertex_count = buffer_views[primitive.vertex_buffer_view].bytes.count / static_cast<uint64>(primitive.vertex_stride);
+        if (primitive.base_vertex < 0 || static_cast<uint64>(primitive.base_vertex) > vertex_count)
+            return false;
+        if (primitive.index_buffer_view < 0)
+        {
+            if (static_cast<uint64>(primitive.count) > vertex_count - static_cast<uint64>(primitive.base_vertex))
+                return false;
+            continue;
+        }
+        if (!in_table(primitive.index_buffer_view, cooked_table::buffer_views) || buffer_views[primitive.index_buffer_view].target != 1)
+            return false;
+        uint64 index_size = 0;
+        if (primitive.index_type == static_cast<int32>(index_type::ubyte))
+            index_size = 1;
+        if (primitive.index_type == static_cast<int32>(index_type::ushort))
+            index_size = 2;
+        if (primitive.index_type == static_cast<int32>(index_type::uint))
+            index_size = 4;
+        if (index_size == 0 || static_cast<uint64>(primitive.first) + static_cast<uint64>(primitive.count) * index_size > buffer_views[primitive.index_buffer_view].bytes.count)
+            return false;
+    }
+
+    const cooked_mesh* meshes = get_records<cooked_mesh>(data, header, cooked_table::meshes);
+    for (int64 i = 0; i < count(cooked_table::meshes); ++i)
+    {
+        if (!range_in_table(meshes[i].first_primitive, meshes[i].primitive_count, cooked_table::primitives))
+            return false;
+    }
+
+    // Every node can be the child of one parent only and roots can not be children, so there are no cycles.
+    const int32* node_indices = get_records<int32>(data, header, cooked_table::node_indices);
+    for (int64 i = 0; i < count(cooked_table::node_indices); ++i)
+    {
+        if (!in_table(node_indices[i], cooked_table::nodes))
+            return false;
+    }
+    std::vector<uint8> has_parent(static_cast<ptr_size>(count(cooked_table::nodes)), 0);
+    const cooked_node* nodes = get_records<cooked_node>(data, header, cooked_table::nodes);
+    for (int64 i = 0; i < count(cooked_table::nodes); ++i)
+    {
+        const cooked_node& node = nodes[i];
+        if (!valid_name(node.name) || !optional_index(node.mesh, cooked_table::meshes) || !optional_index(node.camera, cooked_table::cameras))
+            return false;
+        if (!range_in_table(node.first_child, node.child_count, cooked_table::node_indices))
+            return false;
+        for (int32 c = 0; c < node.child_count; ++c)
+        {
+            uint8& child_has_parent = has_parent[static_cast<ptr_size>(node_indices[node.first_child + c])];
+            if (child_has_parent)
+                return false;
+            child_has_parent = 1;
+        }
+    }
+    for (uint64 i = 0; i < header.scene_nodes.count; ++i)
+    {
+        if (has_parent[static_cast<ptr_size>(node_indices[header.scene_nodes.offset + i])])
+            return false;
+    }
+    return true;
+}
+
+bool cooked_model::setup(const uint8* data, uint64 size, uint64 source_hash)
+{
+    m_data   = nullptr;
+    m_size   = 0;
+    m_header = nullptr;
+    if (size < sizeof(cooked_model_header))
+        return false;
+
+    const cooked_model_header* header = reinterpret_cast<const cooked_model_header*>(data);
+    if (header->magic != cooked_model_magic || header->version != cooked_model_version || header->source_hash != source_hash)
+        return false;
+
+    // Tables have to be inside the data, so broken files are never read out of bounds.
+    const uint64 element_sizes[] = {
+        sizeof(cooked_buffer_view), sizeof(cooked_image), sizeof(cooked_texture), sizeof(cooked_material), sizeof(cooked_attribute), sizeof(cooked_primitive),
+        sizeof(cooked_mesh),        sizeof(cooked_camera), sizeof(cooked_node),   sizeof(int32),           1,                        1
+    };
+    for (uint8 i = 0; i < static_cast<uint8>(cooked_table::count); ++i)
+    {
+        const cooked_range& table = header->tables[i];
+        if (table.offset > size || table.count > (size - table.offset) / element_sizes[i])
+            return false;
+    }
+    const uint64 node_index_count = header->tables[static_cast<uint8>(cooked_table::node_indices)].count;
+    if (header->scene_nodes.offset > node_index_count || header->scene_nodes.count > node_index_count - header->scene_nodes.offset)
+        return false;
+    const uint64 data_size = header->tables[static_cast<uint8>(cooked_table::data)].count;
+    auto inside_data       = [data_size](const cooked_range& bytes) { return bytes.offset <= data_size && bytes.count <= data_size - bytes.offset; };
+    const cooked_buffer_view* buffer_views = reinterpret_cast<const cooked_buffer_view*>(data + header->tables[static_cast<uint8>(cooked_table::buffer_views)].offset);
+    for (uint64 i = 0; i < header->tables[static_cast<uint8>(cooked_table::buffer_views)].count; ++i)
+    {
+        if (!inside_data(buffer_views[i].bytes))
+            return false;
+    }
+    const cooked_image* images = reinterpret_cast<const cooked_image*>(data + header->tables[static_cast<uint8>(cooked_table::images)].offset);
+    for (uint64 i = 0; i < header->tables[static_cast<uint8>(cooked_table::images)].count; ++i)
+    {
+        if (!inside_data(images[i].bytes))
+            return false;
+        // Compressed images have to contain all their levels.
+        const cooked_image& image = images[i];
+        if (image.compression > static_cast<uint32>(texture_compression::bc7))
+            return false;
+        const texture_compression compression = static_cast<texture_compression>(image.compression);
+        if (compression == texture_compression::none)
+            continue;
+        if (image.width <= 0 || image.height <= 0 || image.levels <= 0 || image.levels > calculate_mip_count(image.width, image.height))
+            return false;
+        if (static_cast<int64>(image.bytes.count) != get_compressed_size(compression, image.width, image.height, image.levels))
+            return false;
+    }
+    if (!validate_record_indices(data, *header))
+        return false;
+
+    m_data   = data;
+    m_size   = size;
+    m_header = header;
+    return true;
+}
@@ -0,0 +1,266 @@
+//! \file      cooked_model.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_COOKED_MODEL_HPP
+#define MANGO_COOKED_MODEL_HPP
+
+#include <mango/types.hpp>
+#include <util/mapped_file.hpp>
+#include <vector>
+
+namespace tinygltf
+{
+    class Model;
+} // namespace tinygltf
+
+namespace mango
+{
+    //! \brief The directory cooked models are cached in.
+    const string model_cache_directory = "cache/models/";
+    //! \brief The magic number at the start of cooked model files.
+    const uint32 cooked_model_magic = 0x4c444d43; // CMDL
+    //! \brief The version of the cooked model format. Files with other versions are cooked again.
+    const uint32 cooked_model_version = 4;
+
+    //! \brief The tables of a cooked model file.
+    enum class cooked_table : uint8
+    {
+        buffer_views, //!< \a cooked_buffer_views.
+        images,       //!< \a cooked_images.
+        textures,     //!< \a cooked_textures.
+        materials,    //!< \a cooked_materials.
+        attributes,   //!< \a cooked_attributes.
+        primitives,   //!< \a cooked_primitives.
+        meshes,       //!< \a cooked_meshes.
+        cameras,      //!< \a cooked_cameras.
+        nodes,        //!< \a cooked_nodes.
+        node_indices, //!< int32 node indices, referenced by the children of \a cooked_nodes and the scene roots.
+        strings,      //!< The characters of all names.
+        data,         //!< The binary data of buffer views and images.
+        count         //!< The number of tables.
+    };
+
+    //! \brief A range in a cooked model file.
+    struct cooked_range
+    {
+        uint64 offset; //!< The offset in bytes from the start of the file or table.
+        uint64 count;  //!< The number of elements or bytes.
+    };
+
+    //! \brief The header of a cooked model file.
+    struct cooked_model_header
+    {
+        uint32 magic;                                                 //!< Always cooked_model_magic.
+        uint32 version;                                               //!< The cooked_model_version the file was written with.
+        uint64 source_hash;                                           //!< The hash of the source file.
+        cooked_range tables[static_cast<uint8>(cooked_table::count)]; //!< The tables, offsets are relative to the file start.
+        cooked_range scene_nodes;                                     //!< The root nodes of the scene in the node indices.
+    };
+
+    //! \brief A gpu buffer of a cooked model.
+    struct cooked_buffer_view
+    {
+        cooked_range bytes; //!< The bytes in the data table.
+        uint32 target;      //!< 0 for vertex buffers, 1 for index buffers.
+        uint32 padding;     //!< Unused.
+    };
+
+    //! \brief A decoded and block compressed image of a cooked model.
+    struct cooked_image
+    {
+        cooked_range bytes; //!< The pixels or the compressed levels in the data table. Empty if the image could not be decoded.
+        int32 width;        //!< The width in pixels.
+        int32 height;       //!< The height in pixels.
+        int32 components;   //!< The number of components per pixel in the source.
+        int32 bits;         //!< The number of bits per component in the source.
+        uint32 compression; //!< The texture_compression. The bytes contain all mipmap levels if the image is compressed.
+        int32 levels;       //!< The number of mipmap levels in the bytes.
+    };
+
+    //! \brief A texture of a cooked model.
+    struct cooked_texture
+    {
+        int32 image;      //!< The index of the \a cooked_image. -1 if there is none.
+        int32 min_filter; //!< The gl minification filter. -1 for the default.
+        int32 mag_filter; //!< The gl magnification filter. -1 for the default.
+        int32 wrap_s;     //!< The gl wrapping in s direction. -1 for the default.
+        int32 wrap_t;     //!< The gl wrapping in t direction. -1 for the default.
+    };
+
+    //! \brief A material of a cooked model. Texture indices are -1 if there is no texture.
+    struct cooked_material
+    {
+        cooked_range name;                //!< The name in the strings table.
+        float base_color[4];              //!< The base color factor.
+        float emissive_color[3];          //!< The emissive color factor.
+        float metallic;                   //!< The metallic factor.
+        float roughness;                  //!< The roughness factor.
+        float alpha_cutoff;               //!< The alpha cutoff for masked materials.
+        int32 base_color_texture;         //!< The base color \a cooked_texture.
+        int32 metallic_roughness_texture; //!< The metallic roughness \a cooked_texture.
+        int32 occlusion_texture;          //!< The occlusion \a cooked_texture.
+        int32 normal_texture;             //!< The normal \a cooked_texture.
+        int32 emissive_texture;           //!< The emissive \a cooked_texture.
+        uint8 alpha_rendering;            //!< The alpha_mode.
+        uint8 double_sided;               //!< 1 if the material is double sided, else 0.
+        uint8 padding[2];                 //!< Unused.
+    };
+
+    //! \brief A vertex attribute of a \a cooked_primitive.
+    struct cooked_attribute
+    {
+        int32 location; //!< The attribute location in the shaders.
+        uint32 offset;  //!< The offset of the attribute in the interleaved vertex.
+        uint32 format;  //!< The attribute format.
+    };
+
+    //! \brief A mesh primitive of a cooked model.
+    struct cooked_primitive
+    {
+        int32 topology;           //!< The primitive_topology.
+        int32 first;              //!< The first index, byte offset in the index buffer.
+        int32 count;              //!< The number of indices or vertices.
+        int32 base_vertex;        //!< The first vertex of the primitive in the shared vertex buffer.
+        int32 index_type;         //!< The index_type.
+        int32 index_buffer_view;  //!< The \a cooked_buffer_view with the indices of the model. -1 for non indexed primitives.
+        int32 vertex_buffer_view; //!< The \a cooked_buffer_view with the interleaved vertices of all primitives with the same vertex format.
+        int32 vertex_stride;      //!< The size of one interleaved vertex in bytes.
+        int32 material;           //!< The \a cooked_material. -1 if there is none.
+        int32 first_attribute;    //!< The first \a cooked_attribute.
+        int32 attribute_count;    //!< The number of \a cooked_attributes.
+        float bounds_min[3];      //!< The minimum corner of the vertex positions.
+        float bounds_max[3];      //!< The maximum corner of the vertex positions.
+        uint8 has_bounds;         //!< 1 if the bounds are known, else 0.
+        uint8 has_normals;        //!< 1 if the primitive has normals, else 0.
+        uint8 has_tangents;       //!< 1 if the primitive has tangents, else 0.
+        uint8 padding;            //!< Unused.
+    };
+
+    //! \brief A mesh of a cooked model.
+    struct cooked_mesh
+    {
+        int32 first_primitive; //!< The first \a cooked_primitive.
+        int32 primitive_count; //!< The number of \a cooked_primitives.
+    };
+
+    //! \brief A camera of a cooked model.
+    struct cooked_camera
+    {
+        uint32 type;  //!< The camera_type.
+        float z_near; //!< Distance of the near plane.
+        float z_far;  //!< Distance of the far plane.
+        float x;      //!< The vertical field of view in radians or the magnification in x direction.
+        float y;      //!< The aspect ratio or the magnification in y direction.
+    };
+
+    //! \brief A node of a cooked model.
+    struct cooked_node
+    {
+        cooked_range name; //!< The name in the strings table.
+        float position[3]; //!< The local position.
+        float rotation[4]; //!< The local rotation quaternion (x, y, z, w).
+        float scale[3];    //!< The local scale.
+        int32 mesh;        //!< The \a cooked_mesh. -1 if there is none.
+        int32 camera;      //!< The \a cooked_camera. -1 if there is none.
+        int32 first_child; //!< The first child in the node indices.
+        int32 child_count; //!< The number of children.
+    };
+
+    //! \brief A model in the cooked format, that can be used without parsing the source file.
+    //! \details All the data of a cooked model is stored in one block of memory, either mapped from a cached file or cooked from a gltf model.
+    //! The layout is the one of the file, so cooked models can be written and mapped without conversion. The format uses the native byte order.
+    class cooked_model
+    {
+      public:
+        cooked_model();
+
+        //! \brief Loads a model from the cache or cooks it from the gltf file and stores it in the cache.
+        //! \details Does not access the gpu, so it can be called from any thread. The cache is keyed by the hash of the gltf file content and the external files it references.
+        //! \param[in] path The path to the gltf or glb file.
+        //! \return True on success, else false.
+        bool load(const string& path);
+
+        //! \brief Cooks a model loaded by tinygltf.
+        //! \param[in] m The model loaded by tinygltf.
+        //! \param[in] source_hash The hash of the source file.
+        //! \return True on success, else false.
+        bool cook(const tinygltf::Model& m, uint64 source_hash);
+
+        //! \brief Maps a cooked model file.
+        //! \param[in] path The path to the cooked model file.
+        //! \param[in] source_hash The expected hash of the source file.
+        //! \return True if the file is valid and matches the hash, else false.
+        bool read(const string& path, uint64 source_hash);
+
+        //! \brief Writes the cooked model to a file.
+        //! \param[in] path The path to the file.
+        //! \return True on success, else false.
+        bool write(const string& path) const;
+
+        //! \brief Returns the elements of a table.
+        //! \param[in] table The table.
+        //! \return Pointer to the first element.
+        template <typename T>
+        inline const T* get(cooked_table table) const
+        {
+            return reinterpret_cast<const T*>(m_data + m_header->tables[static_cast<uint8>(table)].offset);
+        }
+
+        //! \brief Returns the number of elements of a table.
+        //! \param[in] table The table.
+        //! \return The number of elements.
+        inline int32 count(cooked_table table) const
+        {
+            return static_cast<int32>(m_header->tables[static_cast<uint8>(table)].count);
+        }
+
+        //! \brief Returns a pointer into the data table.
+        //! \param[in] bytes The range in the data table.
+        //! \return Pointer to the data.
+        inline const uint8* get_data(const cooked_range& bytes) const
+        {
+            return get<uint8>(cooked_table::data) + bytes.offset;
+        }
+
+        //! \brief Returns a name from the strings table.
+        //! \param[in] name The range in the strings table.
+        //! \return The name.
+        inline string get_name(const cooked_range& name) const
+        {
+            return string(get<char>(cooked_table::strings) + name.offset, static_cast<ptr_size>(name.count));
+        }
+
+        //! \brief Returns the root nodes of the scene.
+        //! \param[out] count The number of root nodes.
+        //! \return Pointer to the first root node index.
+        inline const int32* get_scene_nodes(int32& count) const
+        {
+            count = static_cast<int32>(m_header->scene_nodes.count);
+            return get<int32>(cooked_table::node_indices) + m_header->scene_nodes.offset;
+        }
+
+      private:
+        //! \brief Validates the data and sets up the header.
+        //! \param[in] data The data of the cooked model.
+        //! \param[in] size The size of the data in bytes.
+        //! \param[in] source_hash The expected hash of the source file.
+        //! \return True if the data is valid, else false.
+        bool setup(const uint8* data, uint64 size, uint64 source_hash);
+
+        //! \brief The mapped file, if the model was read from the cache.
+        mapped_file m_file;
+        //! \brief The memory, if the model was cooked.
+        std::vector<uint8> m_memory;
+        //! \brief The data of the cooked model, either mapped or in m_memory.
+        const uint8* m_data;
+        //! \brief The size of the data in bytes.
+        uint64 m_size;
+        //! \brief The header at the start of the data.
+        const cooked_model_header* m_header;
+    };
+} // namespace mango
+
+#endif // MANGO_COOKED_MODEL_HPP
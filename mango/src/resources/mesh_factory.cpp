@@ -64,12 +64,24 @@ void plane_factory::create_mesh_primitive_component(mesh_primitive_component* co
 {
     component->vertex_array_object = create_vertex_array(component->count);
     component->first               = 0;
+    component->base_vertex         = 0;
     component->instance_count      = 1;
     component->type_index          = index_type::uint;
     component->topology            = primitive_topology::triangle_strip;
     component->has_normals         = m_generate_normals;
     component->has_tangents        = false;
     component->tp                  = mesh_primitive_type::plane;
+
+    // Same spanning vectors as in append().
+    glm::vec3 diff_x = glm::cross(m_face_normal, GLOBAL_UP);
+    if (glm::all(glm::equal(GLOBAL_UP, glm::abs(m_face_normal))))
+        diff_x = glm::cross(m_face_normal, GLOBAL_FORWARD);
+    glm::vec3 diff_y = glm::cross(m_face_normal, diff_x);
+
+    glm::vec3 center            = m_offset * m_face_normal;
+    glm::vec3 extends           = 0.5f * (glm::abs(diff_x) + glm::abs(diff_y));
+    component->local_bounds.min = center - extends;
+    component->local_bounds.max = center + extends;
 }
 
 void plane_factory::append(std::vector<float>& vertex_data, std::vector<uint32>& index_data, bool restart, bool seal)
@@ -158,12 +170,15 @@ void box_factory::create_mesh_primitive_component(mesh_primitive_component* comp
 {
     component->vertex_array_object = create_vertex_array(component->count);
     component->first               = 0;
+    component->base_vertex         = 0;
     component->instance_count      = 1;
     component->type_index          = index_type::uint;
     component->topology            = primitive_topology::triangle_strip;
     component->has_normals         = m_generate_normals;
     component->has_tangents        = false;
     component->tp                  = mesh_primitive_type::box;
+    component->local_bounds.min    = glm::vec3(-0.5f);
+    component->local_bounds.max    = glm::vec3(0.5f);
 }
 
 void box_factory::append(std::vector<float>& vertex_data, std::vector<uint32>& index_data, bool restart, bool seal)
@@ -208,12 +223,15 @@ void sphere_factory::create_mesh_primitive_component(mesh_primitive_component* c
 {
     component->vertex_array_object = create_vertex_array(component->count);
     component->first               = 0;
+    component->base_vertex         = 0;
     component->instance_count      = 1;
     component->type_index          = index_type::uint;
     component->topology            = primitive_topology::triangle_strip;
     component->has_normals         = m_generate_normals;
     component->has_tangents        = false;
     component->tp                  = mesh_primitive_type::sphere;
+    component->local_bounds.min    = glm::vec3(-1.0f);
+    component->local_bounds.max    = glm::vec3(1.0f);
 }
 
 void sphere_factory::append(std::vector<float>& vertex_data, std::vector<uint32>& index_data, bool restart, bool seal)
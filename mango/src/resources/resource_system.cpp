@@ -4,6 +4,8 @@
 //! \date      2020
 //! \copyright Apache License 2.0
 
+#include <chrono>
+#include <core/job_system.hpp>
 #include <mango/log.hpp>
 #include <mango/profile.hpp>
 #include <resources/resource_system.hpp>
@@ -18,6 +20,17 @@
 
 using namespace mango;
 
+//! \brief An image of a gltf model, that is decoded after parsing.
+struct deferred_image
+{
+    int32 index;                        //!< The index of the image in the model.
+    std::vector<unsigned char> encoded; //!< The encoded image data.
+};
+
+static bool defer_image_data(tinygltf::Image* image, const int image_idx, string* err, string* warn, int req_width, int req_height, const unsigned char* bytes, int size, void* user_data);
+static bool decode_image(tinygltf::Image& image, const std::vector<unsigned char>& encoded);
+static void decode_images(tinygltf::Model& model, std::vector<deferred_image>& deferred, const char* path);
+
 resource_system::resource_system(const shared_ptr<context_impl>& context)
     : m_shared_context(context)
     , m_allocator(1073741824) // 1 GiB TODO Paul: Size???
@@ -210,32 +223,169 @@ model_resource* resource_system::load_model_from_file(const model_resource_confi
     void* mem         = m_allocator.allocate(sizeof(model_resource));
     model_resource* m = new (mem) model_resource;
 
+    if (!parse_model(configuration.path, m->gltf_model))
+        return nullptr;
+
+    return m;
+}
+
+bool resource_system::parse_model(const char* path, tinygltf::Model& model)
+{
+    PROFILE_ZONE;
+
+    // The images are only collected while parsing and decoded in parallel afterwards.
+    std::vector<deferred_image> deferred;
     tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(defer_image_data, &deferred);
     string err;
     string warn;
-    auto ext = string(configuration.path).substr(string(configuration.path).find_last_of(".") + 1);
+    auto ext = string(path).substr(string(path).find_last_of(".") + 1);
     bool ret = false;
     if (ext == "gltf")
-        ret = loader.LoadASCIIFromFile(&(m->gltf_model), &err, &warn, configuration.path);
+        ret = loader.LoadASCIIFromFile(&model, &err, &warn, path);
     else if (ext == "glb")
-        ret = loader.LoadBinaryFromFile(&(m->gltf_model), &err, &warn, configuration.path);
+        ret = loader.LoadBinaryFromFile(&model, &err, &warn, path);
 
     if (!warn.empty())
     {
-        MANGO_LOG_WARN("Warning on loading gltf file {0}:\n {1}", configuration.path, warn);
+        MANGO_LOG_WARN("Warning on loading gltf file {0}:\n {1}", path, warn);
     }
 
     if (!err.empty())
     {
-        MANGO_LOG_ERROR("Error on loading gltf file {0}:\n {1}", configuration.path, err);
-        return nullptr;
+        MANGO_LOG_ERROR("Error on loading gltf file {0}:\n {1}", path, err);
+        return false;
     }
 
     if (!ret)
     {
         MANGO_LOG_ERROR("Failed parsing gltf! Model is not valid!");
-        return nullptr;
+        return false;
     }
 
-    return m;
+    decode_images(model, deferred, path);
+
+    return true;
+}
+
+//! \brief Image loader callback for tinygltf, that only stores the encoded data.
+//! \param[in,out] image The image to load. Not modified.
+//! \param[in] image_idx The index of the image in the model.
+//! \param[out] err Not used.
+//! \param[out] warn Not used.
+//! \param[in] req_width Not used.
+//! \param[in] req_height Not used.
+//! \param[in] bytes The encoded image data.
+//! \param[in] size The size of the encoded image data in bytes.
+//! \param[in,out] user_data The list of \a deferred_images to append to.
+//! \return Always true.
+static bool defer_image_data(tinygltf::Image* image, const int image_idx, string* err, string* warn, int req_width, int req_height, const unsigned char* bytes, int size, void* user_data)
+{
+    MANGO_UNUSED(image);
+    MANGO_UNUSED(err);
+    MANGO_UNUSED(warn);
+    MANGO_UNUSED(req_width);
+    MANGO_UNUSED(req_height);
+    std::vector<deferred_image>& deferred = *static_cast<std::vector<deferred_image>*>(user_data);
+    deferred.push_back({ image_idx, std::vector<unsigned char>(bytes, bytes + size) });
+    return true;
+}
+
+//! \brief Decodes an image of a gltf model with stb_image.
+//! \param[out] image The image to store the decoded data in.
+//! \param[in] encoded The encoded image data.
+//! \return True on success, else false.
+static bool decode_image(tinygltf::Image& image, const std::vector<unsigned char>& encoded)
+{
+    PROFILE_ZONE;
+    int width = 0, height = 0, components = 0;
+    int bits            = 8;
+    unsigned char* data = nullptr;
+    const int size      = static_cast<int>(encoded.size());
+
+    if (stbi_is_16_bit_from_memory(encoded.data(), size))
+    {
+        data = reinterpret_cast<unsigned char*>(stbi_load_16_from_memory(encoded.data(), size, &width, &height, &components, 0));
+        if (data)
+            bits = 16;
+    }
+    if (!data)
+        data = stbi_load_from_memory(encoded.data(), size, &width, &height, &components, 0);
+    if (!data)
+        return false;
+
+    image.width      = width;
+    image.height     = height;
+    image.component  = components;
+    image.bits       = bits;
+    image.pixel_type = bits == 16 ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT : TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    image.image.assign(data, data + static_cast<ptr_size>(width) * height * components * (bits / 8));
+    stbi_image_free(data);
+    return true;
+}
+
+//! \brief Decodes the images of a gltf model concurrently.
+//! \details Only images used by textures are decoded. Images referencing the same file are decoded once.
+//! The decoding runs on the background threads of parallel_for_background(), which are shared with other loads.
+//! \param[in,out] model The model to decode the images of.
+//! \param[in] deferred The \a deferred_images collected while parsing.
+//! \param[in] path The path of the model, used for logging.
+static void decode_images(tinygltf::Model& model, std::vector<deferred_image>& deferred, const char* path)
+{
+    PROFILE_ZONE;
+    if (deferred.empty())
+        return;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<bool> used(model.images.size(), false);
+    for (const tinygltf::Texture& tex : model.textures)
+    {
+        if (tex.source >= 0 && tex.source < static_cast<int32>(used.size()))
+            used[tex.source] = true;
+    }
+
+    // Images shared across materials or referencing the same file are decoded once and copied afterwards.
+    std::vector<int32> to_decode;
+    std::vector<std::pair<int32, int32>> duplicates; // (deferred index, decoded deferred index)
+    std::unordered_map<string, int32> uri_to_deferred;
+    for (int32 i = 0; i < static_cast<int32>(deferred.size()); ++i)
+    {
+        const int32 index = deferred[i].index;
+        if (index < 0 || index >= static_cast<int32>(used.size()) || !used[index])
+            continue;
+        const string& uri = model.images[index].uri;
+        if (!uri.empty())
+        {
+            auto it = uri_to_deferred.find(uri);
+            if (it != uri_to_deferred.end())
+            {
+                duplicates.push_back({ i, it->second });
+                continue;
+            }
+            uri_to_deferred.insert({ uri, i });
+        }
+        to_decode.push_back(i);
+    }
+
+    const int32 count        = static_cast<int32>(to_decode.size());
+    const int32 thread_count = parallel_for_background(count, [&](int32 i) {
+        const deferred_image& d = deferred[to_decode[i]];
+        if (!decode_image(model.images[d.index], d.encoded))
+            MANGO_LOG_ERROR("Could not decode image {0} of gltf file {1}!", d.index, path);
+    });
+
+    for (const std::pair<int32, int32>& duplicate : duplicates)
+    {
+        tinygltf::Image& image        = model.images[deferred[duplicate.first].index];
+        const tinygltf::Image& source = model.images[deferred[duplicate.second].index];
+        image.width                   = source.width;
+        image.height                  = source.height;
+        image.component               = source.component;
+        image.bits                    = source.bits;
+        image.pixel_type              = source.pixel_type;
+        image.image                   = source.image;
+    }
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    MANGO_LOG_INFO("Decoded {0} images of gltf file {1} on {2} threads in {3} ms.", count, path, thread_count, duration.count());
 }
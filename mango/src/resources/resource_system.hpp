@@ -61,6 +61,13 @@ namespace mango
         //! \param[in] resource The \a model_resource to release.
         void release(const model_resource* resource);
 
+        //! \brief Parses a gltf model from file, images are decoded as well.
+        //! \details The model is not cached, so this can be called from any thread.
+        //! \param[in] path The path to the gltf or glb file.
+        //! \param[out] model The model to load into.
+        //! \return True on success, else false.
+        static bool parse_model(const char* path, tinygltf::Model& model);
+
       private:
         //! \brief Mangos internal context for shared usage in the \a resource_system.
         shared_ptr<context_impl> m_shared_context;
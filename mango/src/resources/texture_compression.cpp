@@ -0,0 +1,456 @@
+//! \file      texture_compression.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mango/profile.hpp>
+#include <resources/texture_compression.hpp>
+#include <vector>
+
+using namespace mango;
+
+//! \brief The interpolation weights of four bit bc7 indices, in 64ths.
+static const int32 bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+//! \brief The number of entries in the table converting linear values back to standard color space.
+static const int32 linear_to_srgb_table_size = 4096;
+
+//! \brief Returns the table converting 8 bit standard color space values to linear values in [0, 1].
+//! \return Pointer to the 256 table entries.
+static const float* get_srgb_to_linear_table()
+{
+    static const std::vector<float> table = []() {
+        std::vector<float> result(256);
+        for (int32 i = 0; i < 256; ++i)
+        {
+            const float v = static_cast<float>(i) / 255.0f;
+            result[i]     = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return table.data();
+}
+
+//! \brief Returns the table converting linear values in [0, 1] to 8 bit standard color space values.
+//! \return Pointer to the linear_to_srgb_table_size table entries.
+static const uint8* get_linear_to_srgb_table()
+{
+    static const std::vector<uint8> table = []() {
+        std::vector<uint8> result(linear_to_srgb_table_size);
+        for (int32 i = 0; i < linear_to_srgb_table_size; ++i)
+        {
+            const float v = static_cast<float>(i) / static_cast<float>(linear_to_srgb_table_size - 1);
+            const float s = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+            result[i]     = static_cast<uint8>(std::min(std::max(s * 255.0f + 0.5f, 0.0f), 255.0f));
+        }
+        return result;
+    }();
+    return table.data();
+}
+
+//! \brief Writes bits into a compressed block, starting at the least significant bit of the first byte.
+struct block_writer
+{
+    uint8* output;  //!< The block to write to. Has to be zero initialized.
+    int32 position; //!< The next bit to write.
+
+    //! \brief Writes the lowest bits of a value.
+    //! \param[in] value The value to write.
+    //! \param[in] bits The number of bits to write.
+    void write(uint32 value, int32 bits)
+    {
+        for (int32 i = 0; i < bits; ++i, ++position)
+        {
+            if ((value >> i) & 1)
+                output[position >> 3] |= static_cast<uint8>(1 << (position & 7));
+        }
+    }
+};
+
+//! \brief Quantizes two bc7 mode 6 endpoints to seven bits per channel and one p-bit per endpoint.
+//! \param[in] endpoints The two rgba endpoints in [0, 255].
+//! \param[out] quantized The seven bit channels of the endpoints.
+//! \param[out] p_bits The p-bits of the endpoints.
+static void quantize_bc7_endpoints(const float endpoints[2][4], uint8 quantized[2][4], uint8 p_bits[2])
+{
+    for (int32 e = 0; e < 2; ++e)
+    {
+        float best_error = 1e30f;
+        for (uint8 p = 0; p < 2; ++p)
+        {
+            uint8 q[4];
+            float error = 0.0f;
+            for (int32 c = 0; c < 4; ++c)
+            {
+                const float v = std::min(std::max(std::floor((endpoints[e][c] - p) * 0.5f + 0.5f), 0.0f), 127.0f);
+                const float d = v * 2.0f + p - endpoints[e][c];
+                q[c]          = static_cast<uint8>(v);
+                error += d * d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                p_bits[e]  = p;
+                memcpy(quantized[e], q, sizeof(q));
+            }
+        }
+    }
+}
+
+//! \brief Finds the best bc7 mode 6 index of every pixel for quantized endpoints.
+//! \param[in] pixels The 16 rgba8 pixels of the block.
+//! \param[in] quantized The seven bit channels of the endpoints.
+//! \param[in] p_bits The p-bits of the endpoints.
+//! \param[out] indices The four bit index of every pixel.
+//! \return The summed squared error of the block.
+static int32 find_bc7_indices(const uint8* pixels, const uint8 quantized[2][4], const uint8 p_bits[2], uint8 indices[16])
+{
+    int32 palette[16][4];
+    for (int32 c = 0; c < 4; ++c)
+    {
+        const int32 e0 = (quantized[0][c] << 1) | p_bits[0];
+        const int32 e1 = (quantized[1][c] << 1) | p_bits[1];
+        for (int32 k = 0; k < 16; ++k)
+            palette[k][c] = ((64 - bc7_weights[k]) * e0 + bc7_weights[k] * e1 + 32) >> 6;
+    }
+
+    int32 total_error = 0;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        const uint8* pixel = pixels + i * 4;
+        int32 best_error   = 0x7fffffff;
+        for (int32 k = 0; k < 16; ++k)
+        {
+            int32 error = 0;
+            for (int32 c = 0; c < 4; ++c)
+            {
+                const int32 d = palette[k][c] - pixel[c];
+                error += d * d;
+            }
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[i] = static_cast<uint8>(k);
+            }
+        }
+        total_error += best_error;
+    }
+    return total_error;
+}
+
+//! \brief Fits the endpoints to fixed indices with least squares.
+//! \param[in] pixels The 16 rgba8 pixels of the block.
+//! \param[in] indices The four bit index of every pixel.
+//! \param[out] endpoints The two rgba endpoints in [0, 255].
+//! \return False if all pixels use the same weight and the endpoints can not be fitted, else true.
+static bool fit_bc7_endpoints(const uint8* pixels, const uint8 indices[16], float endpoints[2][4])
+{
+    float a = 0.0f, b = 0.0f, c = 0.0f;
+    float x0[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float x1[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int32 i = 0; i < 16; ++i)
+    {
+        const float w = static_cast<float>(bc7_weights[indices[i]]) / 64.0f;
+        a += (1.0f - w) * (1.0f - w);
+        b += (1.0f - w) * w;
+        c += w * w;
+        for (int32 ch = 0; ch < 4; ++ch)
+        {
+            x0[ch] += (1.0f - w) * pixels[i * 4 + ch];
+            x1[ch] += w * pixels[i * 4 + ch];
+        }
+    }
+    const float determinant = a * c - b * b;
+    if (std::abs(determinant) < 1e-6f)
+        return false;
+    for (int32 ch = 0; ch < 4; ++ch)
+    {
+        endpoints[0][ch] = std::min(std::max((c * x0[ch] - b * x1[ch]) / determinant, 0.0f), 255.0f);
+        endpoints[1][ch] = std::min(std::max((a * x1[ch] - b * x0[ch]) / determinant, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+void mango::compress_bc7_block(const uint8* pixels, uint8* output)
+{
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int32 i = 0; i < 16; ++i)
+    {
+        for (int32 c = 0; c < 4; ++c)
+            mean[c] += pixels[i * 4 + c];
+    }
+    for (int32 c = 0; c < 4; ++c)
+        mean[c] /= 16.0f;
+
+    float covariance[4][4] = {};
+    for (int32 i = 0; i < 16; ++i)
+    {
+        for (int32 r = 0; r < 4; ++r)
+        {
+            for (int32 c = 0; c < 4; ++c)
+                covariance[r][c] += (pixels[i * 4 + r] - mean[r]) * (pixels[i * 4 + c] - mean[c]);
+        }
+    }
+
+    // The principal axis is found by power iteration, starting with the channel with the biggest variance.
+    int32 largest = 0;
+    for (int32 c = 1; c < 4; ++c)
+    {
+        if (covariance[c][c] > covariance[largest][largest])
+            largest = c;
+    }
+    float axis[4] = { covariance[largest][0], covariance[largest][1], covariance[largest][2], covariance[largest][3] };
+    for (int32 iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4];
+        float length = 0.0f;
+        for (int32 r = 0; r < 4; ++r)
+        {
+            next[r] = covariance[r][0] * axis[0] + covariance[r][1] * axis[1] + covariance[r][2] * axis[2] + covariance[r][3] * axis[3];
+            length  = std::max(length, std::abs(next[r]));
+        }
+        if (length < 1e-6f)
+            break;
+        for (int32 r = 0; r < 4; ++r)
+            axis[r] = next[r] / length;
+    }
+    const float axis_length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3]);
+    for (int32 c = 0; c < 4; ++c)
+        axis[c] = axis_length > 1e-6f ? axis[c] / axis_length : 0.0f;
+
+    float t_min = 0.0f, t_max = 0.0f;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        float t = 0.0f;
+        for (int32 c = 0; c < 4; ++c)
+            t += (pixels[i * 4 + c] - mean[c]) * axis[c];
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+    }
+
+    float endpoints[2][4];
+    for (int32 c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = std::min(std::max(mean[c] + t_min * axis[c], 0.0f), 255.0f);
+        endpoints[1][c] = std::min(std::max(mean[c] + t_max * axis[c], 0.0f), 255.0f);
+    }
+
+    uint8 quantized[2][4];
+    uint8 p_bits[2];
+    uint8 indices[16];
+    quantize_bc7_endpoints(endpoints, quantized, p_bits);
+    int32 error = find_bc7_indices(pixels, quantized, p_bits, indices);
+
+    // Refining the endpoints to the chosen indices is only kept if it reduces the error.
+    for (int32 iteration = 0; iteration < 2 && error > 0; ++iteration)
+    {
+        float refined[2][4];
+        if (!fit_bc7_endpoints(pixels, indices, refined))
+            break;
+        uint8 refined_quantized[2][4];
+        uint8 refined_p_bits[2];
+        uint8 refined_indices[16];
+        quantize_bc7_endpoints(refined, refined_quantized, refined_p_bits);
+        const int32 refined_error = find_bc7_indices(pixels, refined_quantized, refined_p_bits, refined_indices);
+        if (refined_error >= error)
+            break;
+        error = refined_error;
+        memcpy(quantized, refined_quantized, sizeof(quantized));
+        memcpy(p_bits, refined_p_bits, sizeof(p_bits));
+        memcpy(indices, refined_indices, sizeof(indices));
+    }
+
+    // The most significant bit of the first index is implicit zero, so the endpoints are swapped if required.
+    if (indices[0] & 8)
+    {
+        for (int32 c = 0; c < 4; ++c)
+            std::swap(quantized[0][c], quantized[1][c]);
+        std::swap(p_bits[0], p_bits[1]);
+        for (int32 i = 0; i < 16; ++i)
+            indices[i] = static_cast<uint8>(15 - indices[i]);
+    }
+
+    memset(output, 0, 16);
+    block_writer writer = { output, 0 };
+    writer.write(1 << 6, 7); // mode 6
+    for (int32 c = 0; c < 4; ++c)
+    {
+        writer.write(quantized[0][c], 7);
+        writer.write(quantized[1][c], 7);
+    }
+    writer.write(p_bits[0], 1);
+    writer.write(p_bits[1], 1);
+    writer.write(indices[0], 3);
+    for (int32 i = 1; i < 16; ++i)
+        writer.write(indices[i], 4);
+}
+
+void mango::compress_bc4_block(const uint8* pixels, int32 channel, uint8* output)
+{
+    uint8 low  = 255;
+    uint8 high = 0;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        low  = std::min(low, pixels[i * 4 + channel]);
+        high = std::max(high, pixels[i * 4 + channel]);
+    }
+
+    // With the first endpoint bigger than the second one, there are six interpolated values.
+    memset(output, 0, 8);
+    output[0] = high;
+    output[1] = low;
+    if (high == low)
+        return;
+
+    float palette[8];
+    palette[0] = high;
+    palette[1] = low;
+    for (int32 k = 2; k < 8; ++k)
+        palette[k] = ((8 - k) * high + (k - 1) * low) / 7.0f;
+
+    uint64 bits = 0;
+    for (int32 i = 0; i < 16; ++i)
+    {
+        const float value = pixels[i * 4 + channel];
+        uint64 best       = 0;
+        for (int32 k = 1; k < 8; ++k)
+        {
+            if (std::abs(palette[k] - value) < std::abs(palette[best] - value))
+                best = static_cast<uint64>(k);
+        }
+        bits |= best << (3 * i);
+    }
+    for (int32 i = 0; i < 6; ++i)
+        output[2 + i] = static_cast<uint8>(bits >> (8 * i));
+}
+
+void mango::compress_bc5_block(const uint8* pixels, uint8* output)
+{
+    compress_bc4_block(pixels, 0, output);
+    compress_bc4_block(pixels, 1, output + 8);
+}
+
+format mango::get_compressed_format(texture_compression compression, bool standard_color_space)
+{
+    switch (compression)
+    {
+    case texture_compression::bc4:
+        return format::compressed_red_rgtc1;
+    case texture_compression::bc5:
+        return format::compressed_rg_rgtc2;
+    case texture_compression::bc7:
+        return standard_color_space ? format::compressed_srgb_alpha_bptc_unorm : format::compressed_rgba_bptc_unorm;
+    default:
+        MANGO_ASSERT(false, "Texture compression is not supported!");
+        return format::invalid;
+    }
+}
+
+int64 mango::get_compressed_size(texture_compression compression, int32 width, int32 height, int32 levels)
+{
+    const format internal = get_compressed_format(compression, false);
+    int64 size            = 0;
+    for (int32 level = 0; level < levels; ++level)
+        size += get_compressed_level_size(internal, std::max(width >> level, 1), std::max(height >> level, 1));
+    return size;
+}
+
+//! \brief Compresses one mipmap level of an image.
+//! \param[in] compression The \a texture_compression.
+//! \param[in] rgba The rgba8 pixels of the level.
+//! \param[in] width The width of the level in pixels.
+//! \param[in] height The height of the level in pixels.
+//! \param[out] output The memory to store the compressed blocks in.
+static void compress_level(texture_compression compression, const uint8* rgba, int32 width, int32 height, uint8* output)
+{
+    const int32 block_size = get_compressed_block_size(get_compressed_format(compression, false));
+    uint8 block[64];
+    for (int32 by = 0; by < height; by += 4)
+    {
+        for (int32 bx = 0; bx < width; bx += 4)
+        {
+            // Blocks at the border repeat the last pixels.
+            for (int32 y = 0; y < 4; ++y)
+            {
+                const int32 py = std::min(by + y, height - 1);
+                for (int32 x = 0; x < 4; ++x)
+                {
+                    const int32 px = std::min(bx + x, width - 1);
+                    memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<ptr_size>(py) * width + px) * 4, 4);
+                }
+            }
+
+            if (compression == texture_compression::bc4)
+                compress_bc4_block(block, 0, output);
+            else if (compression == texture_compression::bc5)
+                compress_bc5_block(block, output);
+            else
+                compress_bc7_block(block, output);
+            output += block_size;
+        }
+    }
+}
+
+//! \brief Creates the next mipmap level of an image with a box filter.
+//! \param[in] rgba The rgba8 pixels of the level.
+//! \param[in] width The width of the level in pixels.
+//! \param[in] height The height of the level in pixels.
+//! \param[in] standard_color_space True if the color channels are in standard color space and have to be filtered in linear space, else false.
+//! \param[out] result The rgba8 pixels of the next level.
+static void downsample_level(const uint8* rgba, int32 width, int32 height, bool standard_color_space, std::vector<uint8>& result)
+{
+    const int32 next_width  = std::max(width >> 1, 1);
+    const int32 next_height = std::max(height >> 1, 1);
+    const float* to_linear  = get_srgb_to_linear_table();
+    const uint8* to_srgb    = get_linear_to_srgb_table();
+    result.resize(static_cast<ptr_size>(next_width) * next_height * 4);
+    for (int32 y = 0; y < next_height; ++y)
+    {
+        const uint8* row0 = rgba + static_cast<ptr_size>(std::min(y * 2, height - 1)) * width * 4;
+        const uint8* row1 = rgba + static_cast<ptr_size>(std::min(y * 2 + 1, height - 1)) * width * 4;
+        for (int32 x = 0; x < next_width; ++x)
+        {
+            const int32 x0          = std::min(x * 2, width - 1) * 4;
+            const int32 x1          = std::min(x * 2 + 1, width - 1) * 4;
+            const uint8* samples[4] = { row0 + x0, row0 + x1, row1 + x0, row1 + x1 };
+            uint8* target           = result.data() + (static_cast<ptr_size>(y) * next_width + x) * 4;
+            for (int32 c = 0; c < 4; ++c)
+            {
+                if (standard_color_space && c < 3)
+                {
+                    const float sum = to_linear[samples[0][c]] + to_linear[samples[1][c]] + to_linear[samples[2][c]] + to_linear[samples[3][c]];
+                    target[c]       = to_srgb[static_cast<int32>(sum * 0.25f * (linear_to_srgb_table_size - 1) + 0.5f)];
+                }
+                else
+                    target[c] = static_cast<uint8>((samples[0][c] + samples[1][c] + samples[2][c] + samples[3][c] + 2) / 4);
+            }
+        }
+    }
+}
+
+void mango::compress_texture(texture_compression compression, const uint8* rgba, int32 width, int32 height, int32 levels, bool standard_color_space, uint8* output)
+{
+    PROFILE_ZONE;
+    MANGO_ASSERT(compression != texture_compression::none, "Texture compression is none!");
+    const format internal = get_compressed_format(compression, false);
+    std::vector<uint8> mip;
+    std::vector<uint8> next_mip;
+    const uint8* current = rgba;
+    for (int32 level = 0; level < levels; ++level)
+    {
+        compress_level(compression, current, width, height, output);
+        output += get_compressed_level_size(internal, width, height);
+        if (level + 1 == levels)
+            break;
+
+        downsample_level(current, width, height, standard_color_space, next_mip);
+        mip.swap(next_mip);
+        current = mip.data();
+        width   = std::max(width >> 1, 1);
+        height  = std::max(height >> 1, 1);
+    }
+}
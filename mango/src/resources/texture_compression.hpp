@@ -0,0 +1,66 @@
+//! \file      texture_compression.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_TEXTURE_COMPRESSION_HPP
+#define MANGO_TEXTURE_COMPRESSION_HPP
+
+#include <graphics/graphics_common.hpp>
+
+namespace mango
+{
+    //! \brief The block compression used for a texture.
+    enum class texture_compression : uint8
+    {
+        none, //!< Not compressed.
+        bc4,  //!< One channel, 8 bytes per block. Used for occlusion.
+        bc5,  //!< Two channels, 16 bytes per block. Used for normals, z is reconstructed in the shaders.
+        bc7   //!< Four channels, 16 bytes per block. Used for colors.
+    };
+
+    //! \brief Returns the internal \a format of a \a texture_compression.
+    //! \param[in] compression The \a texture_compression.
+    //! \param[in] standard_color_space True if the texture is used in standard color space, else false. Only \a texture_compression::bc7 has a standard color space format.
+    //! \return The compressed internal \a format.
+    format get_compressed_format(texture_compression compression, bool standard_color_space);
+
+    //! \brief Returns the size of a compressed texture with all its mipmap levels.
+    //! \param[in] compression The \a texture_compression.
+    //! \param[in] width The width of the texture in pixels.
+    //! \param[in] height The height of the texture in pixels.
+    //! \param[in] levels The number of mipmap levels.
+    //! \return The size in bytes.
+    int64 get_compressed_size(texture_compression compression, int32 width, int32 height, int32 levels);
+
+    //! \brief Compresses one channel of a 4x4 block to bc4.
+    //! \param[in] pixels The 16 rgba8 pixels of the block in row major order.
+    //! \param[in] channel The channel to compress.
+    //! \param[out] output The 8 bytes of the compressed block.
+    void compress_bc4_block(const uint8* pixels, int32 channel, uint8* output);
+
+    //! \brief Compresses the red and green channel of a 4x4 block to bc5.
+    //! \param[in] pixels The 16 rgba8 pixels of the block in row major order.
+    //! \param[out] output The 16 bytes of the compressed block.
+    void compress_bc5_block(const uint8* pixels, uint8* output);
+
+    //! \brief Compresses a 4x4 block to bc7.
+    //! \details Only mode 6 is used. The endpoints are fitted along the principal axis of the block and refined once.
+    //! \param[in] pixels The 16 rgba8 pixels of the block in row major order.
+    //! \param[out] output The 16 bytes of the compressed block.
+    void compress_bc7_block(const uint8* pixels, uint8* output);
+
+    //! \brief Compresses an image and all its mipmap levels.
+    //! \details The mipmaps are generated with a box filter, in linear space for textures in standard color space. Does not access the gpu.
+    //! \param[in] compression The \a texture_compression. Can not be \a texture_compression::none.
+    //! \param[in] rgba The rgba8 pixels of the image.
+    //! \param[in] width The width of the image in pixels.
+    //! \param[in] height The height of the image in pixels.
+    //! \param[in] levels The number of mipmap levels to compress.
+    //! \param[in] standard_color_space True if the image is in standard color space, else false.
+    //! \param[out] output The memory to store the levels in, tightly packed. Has to be get_compressed_size() bytes big.
+    void compress_texture(texture_compression compression, const uint8* rgba, int32 width, int32 height, int32 levels, bool standard_color_space, uint8* output);
+} // namespace mango
+
+#endif // MANGO_TEXTURE_COMPRESSION_HPP
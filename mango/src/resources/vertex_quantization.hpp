@@ -0,0 +1,48 @@
+//! \file      vertex_quantization.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_VERTEX_QUANTIZATION_HPP
+#define MANGO_VERTEX_QUANTIZATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <mango/types.hpp>
+
+namespace mango
+{
+    //! \brief Quantizes a value in [-1, 1] to a signed normalized integer.
+    //! \param[in] value The value to quantize. Gets clamped.
+    //! \param[in] bits The number of bits of the integer.
+    //! \return The two's complement bits of the integer.
+    inline uint32 quantize_snorm(float value, int32 bits)
+    {
+        const int32 max       = (1 << (bits - 1)) - 1;
+        const int32 quantized = static_cast<int32>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * max));
+        return static_cast<uint32>(quantized) & ((1u << bits) - 1);
+    }
+
+    //! \brief Packs a vector to the signed normalized 10:10:10:2 vertex format.
+    //! \details The layout is the one of format::t_int_2_10_10_10_rev, x is stored in the lowest bits.
+    //! \param[in] x The x component in [-1, 1].
+    //! \param[in] y The y component in [-1, 1].
+    //! \param[in] z The z component in [-1, 1].
+    //! \param[in] w The w component, -1, 0 or 1.
+    //! \return The packed vector.
+    inline uint32 pack_snorm_10_10_10_2(float x, float y, float z, float w)
+    {
+        return quantize_snorm(x, 10) | (quantize_snorm(y, 10) << 10) | (quantize_snorm(z, 10) << 20) | (quantize_snorm(w, 2) << 30);
+    }
+
+    //! \brief Quantizes a value in [0, 1] to an unsigned normalized 16 bit integer.
+    //! \param[in] value The value to quantize. Gets clamped.
+    //! \return The quantized value.
+    inline uint16 quantize_unorm16(float value)
+    {
+        return static_cast<uint16>(std::floor(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f));
+    }
+} // namespace mango
+
+#endif // MANGO_VERTEX_QUANTIZATION_HPP
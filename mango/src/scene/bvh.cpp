@@ -0,0 +1,411 @@
+//! \file      bvh.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <algorithm>
+#include <scene/bvh.hpp>
+
+using namespace mango;
+
+//! \brief The number of bins the split candidates are evaluated with.
+static const int32 bvh_bin_count = 16;
+//! \brief The maximum number of items in a leaf. Larger ranges are always split.
+static const int32 bvh_max_leaf_items = 8;
+//! \brief The factor the cost may grow by refitting, before refit() requests a new build.
+static const float bvh_rebuild_cost_factor = 1.5f;
+
+//! \brief Grows an \a axis_aligned_bounding_box to enclose another one.
+//! \param[in,out] box The \a axis_aligned_bounding_box to grow.
+//! \param[in] other The \a axis_aligned_bounding_box to enclose.
+static inline void grow(axis_aligned_bounding_box& box, const axis_aligned_bounding_box& other)
+{
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+//! \brief Computes the surface area of an \a axis_aligned_bounding_box.
+//! \param[in] box The \a axis_aligned_bounding_box.
+//! \return The surface area, zero for empty boxes.
+static inline float surface_area(const axis_aligned_bounding_box& box)
+{
+    if (!is_valid(box))
+        return 0.0f;
+    glm::vec3 size = box.max - box.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+//! \brief Tests an \a axis_aligned_bounding_box against the planes of a \a frustum.
+//! \param[in] box The valid \a axis_aligned_bounding_box to test.
+//! \param[in] f The \a frustum to test against.
+//! \param[in,out] plane_mask The planes to test, one bit per plane. Planes the box is completely inside are removed.
+//! \return False if the box is completely outside of a plane, else true.
+static inline bool test_planes(const axis_aligned_bounding_box& box, const frustum& f, uint32& plane_mask)
+{
+    glm::vec3 center  = (box.max + box.min) * 0.5f;
+    glm::vec3 extends = (box.max - box.min) * 0.5f;
+    for (int32 p = 0; p < 6; ++p)
+    {
+        if ((plane_mask & (1u << p)) == 0)
+            continue;
+        const glm::vec4& plane = f.planes[p];
+        float distance         = glm::dot(glm::vec3(plane), center) + plane.w;
+        float radius           = glm::dot(glm::abs(glm::vec3(plane)), extends);
+        if (distance + radius < 0.0f)
+            return false;
+        if (distance - radius >= 0.0f)
+            plane_mask &= ~(1u << p);
+    }
+    return true;
+}
+
+//! \brief The mark of items found visible while culling.
+static const uint8 visible_mark = 1;
+//! \brief The mark of items collected to be culled in a batch.
+static const uint8 candidate_mark = 2;
+
+//! \brief Intersects a ray with an \a axis_aligned_bounding_box.
+//! \param[in] box The valid \a axis_aligned_bounding_box to intersect.
+//! \param[in] origin The origin of the ray.
+//! \param[in] inverse_direction The component wise inverse of the ray direction.
+//! \param[in] max_distance Hits with a larger entry parameter are ignored.
+//! \param[out] entry The ray parameter where the box is entered. Zero if the origin is inside.
+//! \return True if the box is hit closer than max_distance, else false.
+static inline bool intersect_box(const axis_aligned_bounding_box& box, const glm::vec3& origin, const glm::vec3& inverse_direction, float max_distance, float& entry)
+{
+    glm::vec3 t_0    = (box.min - origin) * inverse_direction;
+    glm::vec3 t_1    = (box.max - origin) * inverse_direction;
+    glm::vec3 t_near = glm::min(t_0, t_1);
+    glm::vec3 t_far  = glm::max(t_0, t_1);
+    entry            = glm::max(glm::max(t_near.x, t_near.y), glm::max(t_near.z, 0.0f));
+    float exit       = glm::min(glm::min(t_far.x, t_far.y), t_far.z);
+    return entry <= exit && entry < max_distance;
+}
+
+bounding_volume_hierarchy::bounding_volume_hierarchy()
+    : m_built_cost(0.0f)
+    , m_needs_refit(false)
+    , m_needs_build(false)
+{
+}
+
+void bounding_volume_hierarchy::build(const axis_aligned_bounding_box* bounds, int32 count)
+{
+    MANGO_ASSERT(count >= 0, "The item count has to be positive!");
+    m_nodes.clear();
+    m_leaf_items.clear();
+    m_unbounded_items.clear();
+    m_item_bounds.assign(bounds, bounds + count);
+    m_visible_marks.assign(static_cast<ptr_size>(count), 0);
+    m_built_cost  = 0.0f;
+    m_needs_refit = false;
+    m_needs_build = false;
+
+    std::vector<glm::vec3> centers(static_cast<ptr_size>(count));
+    m_leaf_items.reserve(static_cast<ptr_size>(count));
+    for (int32 i = 0; i < count; ++i)
+    {
+        if (!is_valid(m_item_bounds[i]))
+        {
+            m_unbounded_items.push_back(i);
+            continue;
+        }
+        m_leaf_items.push_back(i);
+        centers[i] = (m_item_bounds[i].max + m_item_bounds[i].min) * 0.5f;
+    }
+    if (m_leaf_items.empty())
+        return;
+
+    //! \brief A range of items that still has to be split.
+    struct build_task
+    {
+        int32 node;  //!< The index of the node.
+        int32 begin; //!< The first entry in m_leaf_items.
+        int32 end;   //!< One after the last entry in m_leaf_items.
+    };
+    std::vector<build_task> tasks;
+    m_nodes.reserve(m_leaf_items.size() * 2);
+    m_nodes.push_back({ axis_aligned_bounding_box(), 0, 0 });
+    tasks.push_back({ 0, 0, static_cast<int32>(m_leaf_items.size()) });
+
+    int32 bin_counts[bvh_bin_count];
+    axis_aligned_bounding_box bin_bounds[bvh_bin_count];
+    float right_costs[bvh_bin_count];
+    while (!tasks.empty())
+    {
+        build_task task = tasks.back();
+        tasks.pop_back();
+
+        axis_aligned_bounding_box node_bounds;
+        axis_aligned_bounding_box center_bounds;
+        for (int32 i = task.begin; i < task.end; ++i)
+        {
+            const int32 item = m_leaf_items[i];
+            grow(node_bounds, m_item_bounds[item]);
+            center_bounds.min = glm::min(center_bounds.min, centers[item]);
+            center_bounds.max = glm::max(center_bounds.max, centers[item]);
+        }
+        const int32 item_count    = task.end - task.begin;
+        m_nodes[task.node].bounds = node_bounds;
+        m_nodes[task.node].first  = task.begin;
+        m_nodes[task.node].count  = item_count;
+        if (item_count == 1)
+            continue;
+
+        // Find the cheapest split between bins along any axis.
+        int32 best_axis  = -1;
+        int32 best_split = 0;
+        float best_cost  = std::numeric_limits<float>::max();
+        for (int32 axis = 0; axis < 3; ++axis)
+        {
+            const float extent = center_bounds.max[axis] - center_bounds.min[axis];
+            if (extent <= 0.0f)
+                continue;
+            const float bin_scale = static_cast<float>(bvh_bin_count) / extent;
+            for (int32 b = 0; b < bvh_bin_count; ++b)
+            {
+                bin_counts[b] = 0;
+                bin_bounds[b] = axis_aligned_bounding_box();
+            }
+            for (int32 i = task.begin; i < task.end; ++i)
+            {
+                const int32 item = m_leaf_items[i];
+                const int32 bin  = glm::min(static_cast<int32>((centers[item][axis] - center_bounds.min[axis]) * bin_scale), bvh_bin_count - 1);
+                bin_counts[bin]++;
+                grow(bin_bounds[bin], m_item_bounds[item]);
+            }
+
+            axis_aligned_bounding_box right;
+            int32 right_count = 0;
+            for (int32 b = bvh_bin_count - 1; b > 0; --b)
+            {
+                grow(right, bin_bounds[b]);
+                right_count += bin_counts[b];
+                right_costs[b] = surface_area(right) * static_cast<float>(right_count);
+            }
+            axis_aligned_bounding_box left;
+            int32 left_count = 0;
+            for (int32 b = 0; b < bvh_bin_count - 1; ++b)
+            {
+                grow(left, bin_bounds[b]);
+                left_count += bin_counts[b];
+                const float cost = surface_area(left) * static_cast<float>(left_count) + right_costs[b + 1];
+                if (left_count > 0 && left_count < item_count && cost < best_cost)
+                {
+                    best_axis  = axis;
+                    best_split = b;
+                    best_cost  = cost;
+                }
+            }
+        }
+
+        // Traversing a node costs about as much as testing an item.
+        const float node_area = surface_area(node_bounds);
+        if (item_count <= bvh_max_leaf_items && (best_axis < 0 || node_area * static_cast<float>(item_count) <= node_area + best_cost))
+            continue;
+
+        int32* begin = m_leaf_items.data() + task.begin;
+        int32* end   = m_leaf_items.data() + task.end;
+        int32* mid   = begin + item_count / 2; // All centers are equal without a best axis.
+        if (best_axis >= 0)
+        {
+            const float bin_scale = static_cast<float>(bvh_bin_count) / (center_bounds.max[best_axis] - center_bounds.min[best_axis]);
+            mid                   = std::partition(begin, end, [&centers, &center_bounds, best_axis, best_split, bin_scale](int32 item) {
+                return glm::min(static_cast<int32>((centers[item][best_axis] - center_bounds.min[best_axis]) * bin_scale), bvh_bin_count - 1) <= best_split;
+            });
+        }
+
+        const int32 left_child   = static_cast<int32>(m_nodes.size());
+        m_nodes[task.node].first = left_child;
+        m_nodes[task.node].count = 0;
+        m_nodes.push_back({ axis_aligned_bounding_box(), 0, 0 });
+        m_nodes.push_back({ axis_aligned_bounding_box(), 0, 0 });
+        const int32 split = task.begin + static_cast<int32>(mid - begin);
+        tasks.push_back({ left_child, task.begin, split });
+        tasks.push_back({ left_child + 1, split, task.end });
+    }
+
+    m_built_cost = compute_cost();
+}
+
+void bounding_volume_hierarchy::update(int32 item, const axis_aligned_bounding_box& box)
+{
+    MANGO_ASSERT(item >= 0 && item < size(), "Item index out of range!");
+    axis_aligned_bounding_box& current = m_item_bounds[item];
+    if (current.min == box.min && current.max == box.max)
+        return;
+
+    if (is_valid(current) != is_valid(box))
+        m_needs_build = true; // the item has to move between the tree and the unbounded items
+    current       = box;
+    m_needs_refit = true;
+}
+
+bool bounding_volume_hierarchy::refit()
+{
+    if (m_needs_build)
+        return false;
+    if (!m_needs_refit)
+        return true;
+    m_needs_refit = false;
+
+    // Children are stored after their parents, so iterating backwards refits them first.
+    for (int32 i = static_cast<int32>(m_nodes.size()) - 1; i >= 0; --i)
+    {
+        bvh_node& node = m_nodes[i];
+        node.bounds    = axis_aligned_bounding_box();
+        if (node.count > 0)
+        {
+            for (int32 j = node.first; j < node.first + node.count; ++j)
+                grow(node.bounds, m_item_bounds[m_leaf_items[j]]);
+        }
+        else
+        {
+            grow(node.bounds, m_nodes[node.first].bounds);
+            grow(node.bounds, m_nodes[node.first + 1].bounds);
+        }
+    }
+
+    return compute_cost() <= m_built_cost * bvh_rebuild_cost_factor;
+}
+
+int32 bounding_volume_hierarchy::cull(const frustum* frustums, int32 frustum_count, int32* visible_items)
+{
+    MANGO_ASSERT(frustum_count >= 0, "The frustum count has to be positive!");
+    if (frustum_count == 0)
+        return 0;
+
+    // Items of leaves completely inside a frustum are visible, the items of the other leaves are collected and culled in batches.
+    int32 visible_count = 0;
+    auto mark_visible   = [this, visible_items, &visible_count](int32 item) {
+        if (m_visible_marks[item] == visible_mark)
+            return;
+        m_visible_marks[item]          = visible_mark;
+        visible_items[visible_count++] = item;
+    };
+    for (int32 item : m_unbounded_items)
+        mark_visible(item);
+    m_candidate_volumes.clear();
+    m_candidate_items.clear();
+
+    //! \brief A node that still has to be tested.
+    struct cull_task
+    {
+        int32 node;        //!< The index of the node.
+        uint32 plane_mask; //!< The planes the parent was not completely inside.
+    };
+    std::vector<cull_task> tasks;
+    for (int32 f = 0; f < frustum_count && !m_nodes.empty(); ++f)
+    {
+        tasks.push_back({ 0, 0x3f });
+        while (!tasks.empty())
+        {
+            cull_task task = tasks.back();
+            tasks.pop_back();
+            const bvh_node& node = m_nodes[task.node];
+            if (task.plane_mask != 0 && !test_planes(node.bounds, frustums[f], task.plane_mask))
+                continue;
+
+            if (node.count == 0)
+            {
+                tasks.push_back({ node.first + 1, task.plane_mask });
+                tasks.push_back({ node.first, task.plane_mask });
+                continue;
+            }
+            for (int32 i = node.first; i < node.first + node.count; ++i)
+            {
+                const int32 item = m_leaf_items[i];
+                if (task.plane_mask == 0)
+                {
+                    mark_visible(item);
+                }
+                else if (m_visible_marks[item] == 0)
+                {
+                    m_visible_marks[item] = candidate_mark;
+                    m_candidate_volumes.add(m_item_bounds[item]);
+                    m_candidate_items.push_back(item);
+                }
+            }
+        }
+    }
+
+    // Candidates are tested against all frustums, an item is visible if it is visible in any of them.
+    m_candidate_visible.resize(m_candidate_items.size());
+    const int32 candidate_visible_count = m_candidate_volumes.cull(frustums, frustum_count, m_candidate_visible.data());
+    for (int32 i = 0; i < candidate_visible_count; ++i)
+        mark_visible(m_candidate_items[m_candidate_visible[i]]);
+
+    std::sort(visible_items, visible_items + visible_count);
+    for (int32 i = 0; i < visible_count; ++i)
+        m_visible_marks[visible_items[i]] = 0;
+    for (int32 item : m_candidate_items)
+        m_visible_marks[item] = 0;
+    return visible_count;
+}
+
+int32 bounding_volume_hierarchy::intersect_ray(const glm::vec3& origin, const glm::vec3& direction, float& distance) const
+{
+    int32 closest = -1;
+    distance      = std::numeric_limits<float>::max();
+    if (m_nodes.empty())
+        return closest;
+
+    const glm::vec3 inverse_direction = 1.0f / direction;
+    float entry;
+    if (!intersect_box(m_nodes[0].bounds, origin, inverse_direction, distance, entry))
+        return closest;
+
+    std::vector<int32> nodes;
+    nodes.push_back(0);
+    while (!nodes.empty())
+    {
+        const bvh_node& node = m_nodes[nodes.back()];
+        nodes.pop_back();
+        if (node.count > 0)
+        {
+            for (int32 i = node.first; i < node.first + node.count; ++i)
+            {
+                const int32 item = m_leaf_items[i];
+                if (intersect_box(m_item_bounds[item], origin, inverse_direction, distance, entry))
+                {
+                    closest  = item;
+                    distance = entry;
+                }
+            }
+            continue;
+        }
+
+        // Visit the closer child first, so more of the farther subtree can be skipped.
+        float left_entry, right_entry;
+        bool left  = intersect_box(m_nodes[node.first].bounds, origin, inverse_direction, distance, left_entry);
+        bool right = intersect_box(m_nodes[node.first + 1].bounds, origin, inverse_direction, distance, right_entry);
+        if (left && right && left_entry < right_entry)
+        {
+            nodes.push_back(node.first + 1);
+            nodes.push_back(node.first);
+        }
+        else if (left && right)
+        {
+            nodes.push_back(node.first);
+            nodes.push_back(node.first + 1);
+        }
+        else if (left || right)
+            nodes.push_back(left ? node.first : node.first + 1);
+    }
+    return closest;
+}
+
+float bounding_volume_hierarchy::compute_cost() const
+{
+    if (m_nodes.empty())
+        return 0.0f;
+    const float root_area = surface_area(m_nodes[0].bounds);
+    if (root_area <= 0.0f)
+        return 0.0f;
+
+    float cost = 0.0f;
+    for (const bvh_node& node : m_nodes)
+        cost += surface_area(node.bounds) * static_cast<float>(glm::max(node.count, 1));
+    return cost / root_area;
+}
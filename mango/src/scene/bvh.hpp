@@ -0,0 +1,131 @@
+//! \file      bvh.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_BVH_HPP
+#define MANGO_BVH_HPP
+
+#include <mango/scene_ecs.hpp>
+#include <mango/types.hpp>
+#include <scene/culling.hpp>
+#include <vector>
+
+namespace mango
+{
+    //! \brief A bounding volume hierarchy over \a axis_aligned_bounding_boxes.
+    //! \details Items are identified by their index in the array given to build(). The hierarchy is built top down with binned
+    //! surface area heuristic splits. Moving items are handled by refitting the node bounds, when the quality degraded too much
+    //! the hierarchy has to be built again. Items with empty bounds are not stored in the tree and are always visible.
+    class bounding_volume_hierarchy
+    {
+      public:
+        bounding_volume_hierarchy();
+
+        //! \brief Builds the hierarchy. Replaces all previous items.
+        //! \param[in] bounds Pointer to the bounds of the items.
+        //! \param[in] count The number of items.
+        void build(const axis_aligned_bounding_box* bounds, int32 count);
+
+        //! \brief Updates the bounds of an item. refit() has to be called before the next query.
+        //! \param[in] item The index of the item.
+        //! \param[in] box The new bounds of the item.
+        void update(int32 item, const axis_aligned_bounding_box& box);
+
+        //! \brief Refits the node bounds to the updated items.
+        //! \return False if the hierarchy should be built again, because the quality degraded or items got or lost valid bounds, else true.
+        bool refit();
+
+        //! \brief Returns the number of items.
+        //! \return The number of items.
+        inline int32 size() const
+        {
+            return static_cast<int32>(m_item_bounds.size());
+        }
+
+        //! \brief Returns the number of nodes.
+        //! \return The number of nodes.
+        inline int32 get_node_count() const
+        {
+            return static_cast<int32>(m_nodes.size());
+        }
+
+        //! \brief Returns the bounds of an item.
+        //! \param[in] item The index of the item.
+        //! \return The bounds of the item.
+        inline const axis_aligned_bounding_box& get_item_bounds(int32 item) const
+        {
+            return m_item_bounds[item];
+        }
+
+        //! \brief Culls all items against a set of frustums.
+        //! \details An item is visible if it is visible in at least one of the frustums. Subtrees completely inside a frustum are not tested further,
+        //! the items of leaves intersecting a frustum are culled in batches by \a culling_volumes.
+        //! \param[in] frustums Pointer to the frustums to test against.
+        //! \param[in] frustum_count The number of frustums.
+        //! \param[out] visible_items Array to store the indices of the visible items in, in ascending order. Needs space for size() indices.
+        //! \return The number of visible items.
+        int32 cull(const frustum* frustums, int32 frustum_count, int32* visible_items);
+
+        //! \brief Sets the \a simd_level the items of leaves intersecting a frustum are culled with.
+        //! \details Levels the cpu does not support fall back to the best supported one.
+        //! \param[in] level The \a simd_level to use.
+        inline void set_simd_level(simd_level level)
+        {
+            m_candidate_volumes.set_simd_level(level);
+        }
+
+        //! \brief Returns the \a simd_level the items of leaves intersecting a frustum are culled with.
+        //! \return The \a simd_level used for culling.
+        inline simd_level get_simd_level() const
+        {
+            return m_candidate_volumes.get_simd_level();
+        }
+
+        //! \brief Finds the closest item whose bounds are hit by a ray.
+        //! \param[in] origin The origin of the ray.
+        //! \param[in] direction The direction of the ray. Does not have to be normalized.
+        //! \param[out] distance The ray parameter where the bounds are entered. Zero if the origin is inside.
+        //! \return The index of the closest item hit or -1 if nothing is hit.
+        int32 intersect_ray(const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+
+      private:
+        //! \brief A node of the \a bounding_volume_hierarchy.
+        struct bvh_node
+        {
+            axis_aligned_bounding_box bounds; //!< The bounds of all items in the subtree.
+            int32 first;                      //!< Leaves: The first entry in m_leaf_items. Inner nodes: The left child, the right one follows directly.
+            int32 count;                      //!< The number of items in a leaf, zero for inner nodes.
+        };
+
+        //! \brief Computes the surface area heuristic cost of the hierarchy, relative to the root.
+        //! \return The cost of the hierarchy.
+        float compute_cost() const;
+
+        //! \brief The nodes, the root is the first one. Children are always stored after their parents.
+        std::vector<bvh_node> m_nodes;
+        //! \brief The item indices referenced by the leaves.
+        std::vector<int32> m_leaf_items;
+        //! \brief The items with empty bounds, which are not stored in the tree.
+        std::vector<int32> m_unbounded_items;
+        //! \brief The bounds of all items.
+        std::vector<axis_aligned_bounding_box> m_item_bounds;
+        //! \brief Scratch marks of the items found visible while culling.
+        std::vector<uint8> m_visible_marks;
+        //! \brief The bounds of the items of leaves intersecting a frustum, collected while culling.
+        culling_volumes m_candidate_volumes;
+        //! \brief The item indices of the volumes in m_candidate_volumes.
+        std::vector<int32> m_candidate_items;
+        //! \brief Scratch memory for the indices of the visible volumes in m_candidate_volumes.
+        std::vector<int32> m_candidate_visible;
+        //! \brief The cost after the last build.
+        float m_built_cost;
+        //! \brief True if items were updated since the last refit, else false.
+        bool m_needs_refit;
+        //! \brief True if an update changed whether an item has valid bounds, else false.
+        bool m_needs_build;
+    };
+} // namespace mango
+
+#endif // MANGO_BVH_HPP
@@ -0,0 +1,356 @@
+//! \file      culling.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <scene/culling.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+//! \cond NO_COND
+#define MANGO_CULLING_X86 1
+//! \endcond
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif // _MSC_VER
+#include <immintrin.h>
+#endif // x86
+
+#if defined(MANGO_CULLING_X86) && !(defined(_MSC_VER) && !defined(__clang__))
+//! \cond NO_COND
+// GCC and Clang only allow intrinsics in functions compiled for the instruction set.
+#define MANGO_TARGET_SSE __attribute__((target("sse2")))
+#define MANGO_TARGET_AVX2 __attribute__((target("avx2")))
+//! \endcond
+#else
+//! \cond NO_COND
+#define MANGO_TARGET_SSE
+#define MANGO_TARGET_AVX2
+//! \endcond
+#endif
+
+using namespace mango;
+
+//! \brief The number of volumes tested in one iteration of the widest kernel. The arrays are padded to a multiple of this.
+static const int32 culling_batch_width = 8;
+
+//! \brief The planes of a \a frustum prepared for the culling kernels.
+struct culling_planes
+{
+    float normal_x[6];   //!< The x components of the plane normals.
+    float normal_y[6];   //!< The y components of the plane normals.
+    float normal_z[6];   //!< The z components of the plane normals.
+    float distance[6];   //!< The plane distances.
+    float absolute_x[6]; //!< The absolute x components of the plane normals.
+    float absolute_y[6]; //!< The absolute y components of the plane normals.
+    float absolute_z[6]; //!< The absolute z components of the plane normals.
+};
+
+//! \brief The structure of arrays data the culling kernels work on.
+struct culling_input
+{
+    const float* center_x;  //!< The x coordinates of the centers.
+    const float* center_y;  //!< The y coordinates of the centers.
+    const float* center_z;  //!< The z coordinates of the centers.
+    const float* extends_x; //!< The extends in x direction.
+    const float* extends_y; //!< The extends in y direction.
+    const float* extends_z; //!< The extends in z direction.
+    int32 size;             //!< The number of volumes.
+};
+
+static int32 cull_scalar(const culling_input& in, const culling_planes* planes, int32 plane_set_count, int32* visible_indices);
+#ifdef MANGO_CULLING_X86
+MANGO_TARGET_SSE static int32 cull_sse(const culling_input& in, const culling_planes* planes, int32 plane_set_count, int32* visible_indices);
+MANGO_TARGET_AVX2 static int32 cull_avx2(const culling_input& in, const culling_planes* planes, int32 plane_set_count, int32* visible_indices);
+#endif // MANGO_CULLING_X86
+
+frustum mango::frustum_from_view_projection(const glm::mat4& view_projection)
+{
+    // Rows of the matrix, glm is column major.
+    glm::vec4 row_x = glm::vec4(view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]);
+    glm::vec4 row_y = glm::vec4(view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]);
+    glm::vec4 row_z = glm::vec4(view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]);
+    glm::vec4 row_w = glm::vec4(view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]);
+
+    frustum result;
+    result.planes[0] = row_w + row_x; // left
+    result.planes[1] = row_w - row_x; // right
+    result.planes[2] = row_w + row_y; // bottom
+    result.planes[3] = row_w - row_y; // top
+    result.planes[4] = row_w + row_z; // near
+    result.planes[5] = row_w - row_z; // far
+
+    return result;
+}
+
+axis_aligned_bounding_box mango::transform_bounds(const axis_aligned_bounding_box& box, const glm::mat4& transformation)
+{
+    if (!is_valid(box))
+        return box;
+
+    glm::vec3 center  = glm::vec3(transformation * glm::vec4((box.max + box.min) * 0.5f, 1.0f));
+    glm::vec3 extends = (box.max - box.min) * 0.5f;
+
+    // The extends along each world axis are the sum of the absolute projected local extends.
+    glm::mat3 absolute = glm::mat3(glm::abs(glm::vec3(transformation[0])), glm::abs(glm::vec3(transformation[1])), glm::abs(glm::vec3(transformation[2])));
+    extends            = absolute * extends;
+
+    axis_aligned_bounding_box result;
+    result.min = center - extends;
+    result.max = center + extends;
+    return result;
+}
+
+bool mango::is_visible(const frustum& f, const axis_aligned_bounding_box& box)
+{
+    if (!is_valid(box))
+        return true;
+
+    for (int32 i = 0; i < 6; ++i)
+    {
+        const glm::vec4& plane = f.planes[i];
+        // The corner farthest along the plane normal.
+        glm::vec3 positive = glm::vec3(plane.x > 0.0f ? box.max.x : box.min.x, plane.y > 0.0f ? box.max.y : box.min.y, plane.z > 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+simd_level mango::get_supported_simd_level()
+{
+    static simd_level supported = []() {
+#if defined(MANGO_CULLING_X86) && defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        int max_leaf = info[0];
+        __cpuid(info, 1);
+        bool sse2    = (info[3] & (1 << 26)) != 0;
+        bool os_avx  = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6; // OSXSAVE, AVX and the OS saves the ymm registers.
+        bool avx2    = false;
+        if (os_avx && max_leaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+        return avx2 ? simd_level::avx2 : (sse2 ? simd_level::sse : simd_level::scalar);
+#elif defined(MANGO_CULLING_X86)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return simd_level::avx2;
+        if (__builtin_cpu_supports("sse2"))
+            return simd_level::sse;
+        return simd_level::scalar;
+#else
+        return simd_level::scalar;
+#endif
+    }();
+    return supported;
+}
+
+culling_volumes::culling_volumes()
+    : m_size(0)
+    , m_simd_level(get_supported_simd_level())
+{
+}
+
+void culling_volumes::clear()
+{
+    m_size = 0;
+}
+
+void culling_volumes::reserve(int32 capacity)
+{
+    ptr_size padded = static_cast<ptr_size>((capacity + culling_batch_width - 1) / culling_batch_width * culling_batch_width);
+    m_center_x.reserve(padded);
+    m_center_y.reserve(padded);
+    m_center_z.reserve(padded);
+    m_extends_x.reserve(padded);
+    m_extends_y.reserve(padded);
+    m_extends_z.reserve(padded);
+}
+
+int32 culling_volumes::add(const axis_aligned_bounding_box& box)
+{
+    // Grow by a whole batch, so the kernels never read past the end.
+    if (m_size == static_cast<int32>(m_center_x.size()))
+    {
+        ptr_size padded = m_center_x.size() + culling_batch_width;
+        m_center_x.resize(padded, 0.0f);
+        m_center_y.resize(padded, 0.0f);
+        m_center_z.resize(padded, 0.0f);
+        m_extends_x.resize(padded, 0.0f);
+        m_extends_y.resize(padded, 0.0f);
+        m_extends_z.resize(padded, 0.0f);
+    }
+
+    glm::vec3 center  = glm::vec3(0.0f);
+    glm::vec3 extends = glm::vec3(std::numeric_limits<float>::max());
+    if (is_valid(box))
+    {
+        center  = (box.max + box.min) * 0.5f;
+        extends = (box.max - box.min) * 0.5f;
+    }
+
+    m_center_x[m_size]  = center.x;
+    m_center_y[m_size]  = center.y;
+    m_center_z[m_size]  = center.z;
+    m_extends_x[m_size] = extends.x;
+    m_extends_y[m_size] = extends.y;
+    m_extends_z[m_size] = extends.z;
+
+    return m_size++;
+}
+
+void culling_volumes::set_simd_level(simd_level level)
+{
+    simd_level supported = get_supported_simd_level();
+    m_simd_level         = static_cast<uint8>(level) > static_cast<uint8>(supported) ? supported : level;
+}
+
+int32 culling_volumes::cull(const frustum* frustums, int32 frustum_count, int32* visible_indices) const
+{
+    MANGO_ASSERT(frustum_count >= 0, "The frustum count has to be positive!");
+    if (m_size == 0 || frustum_count == 0)
+        return 0;
+
+    std::vector<culling_planes> planes(static_cast<ptr_size>(frustum_count));
+    for (int32 f = 0; f < frustum_count; ++f)
+    {
+        for (int32 p = 0; p < 6; ++p)
+        {
+            const glm::vec4& plane  = frustums[f].planes[p];
+            planes[f].normal_x[p]   = plane.x;
+            planes[f].normal_y[p]   = plane.y;
+            planes[f].normal_z[p]   = plane.z;
+            planes[f].distance[p]   = plane.w;
+            planes[f].absolute_x[p] = glm::abs(plane.x);
+            planes[f].absolute_y[p] = glm::abs(plane.y);
+            planes[f].absolute_z[p] = glm::abs(plane.z);
+        }
+    }
+
+    culling_input in{ m_center_x.data(), m_center_y.data(), m_center_z.data(), m_extends_x.data(), m_extends_y.data(), m_extends_z.data(), m_size };
+
+#ifdef MANGO_CULLING_X86
+    if (m_simd_level == simd_level::avx2)
+        return cull_avx2(in, planes.data(), frustum_count, visible_indices);
+    if (m_simd_level == simd_level::sse)
+        return cull_sse(in, planes.data(), frustum_count, visible_indices);
+#endif // MANGO_CULLING_X86
+    return cull_scalar(in, planes.data(), frustum_count, visible_indices);
+}
+
+// A box with center c and extends e is outside of a plane (n, d), if dot(n, c) + d + dot(abs(n), e) < 0.
+
+static int32 cull_scalar(const culling_input& in, const culling_planes* planes, int32 plane_set_count, int32* visible_indices)
+{
+    int32 count = 0;
+    for (int32 i = 0; i < in.size; ++i)
+    {
+        bool visible = false;
+        for (int32 f = 0; f < plane_set_count && !visible; ++f)
+        {
+            const culling_planes& cp = planes[f];
+            bool inside              = true;
+            for (int32 p = 0; p < 6 && inside; ++p)
+            {
+                float distance = cp.normal_x[p] * in.center_x[i] + cp.normal_y[p] * in.center_y[i] + cp.normal_z[p] * in.center_z[i] + cp.distance[p];
+                float radius   = cp.absolute_x[p] * in.extends_x[i] + cp.absolute_y[p] * in.extends_y[i] + cp.absolute_z[p] * in.extends_z[i];
+                inside         = distance + radius >= 0.0f;
+            }
+            visible = inside;
+        }
+        if (visible)
+            visible_indices[count++] = i;
+    }
+    return count;
+}
+
+#ifdef MANGO_CULLING_X86
+MANGO_TARGET_SSE static int32 cull_sse(const culling_input& in, const culling_planes* planes, int32 plane_set_count, int32* visible_indices)
+{
+    const __m128 zero     = _mm_setzero_ps();
+    const __m128 all_ones = _mm_cmpeq_ps(zero, zero);
+
+    int32 count = 0;
+    for (int32 i = 0; i < in.size; i += 4)
+    {
+        __m128 center_x  = _mm_loadu_ps(in.center_x + i);
+        __m128 center_y  = _mm_loadu_ps(in.center_y + i);
+        __m128 center_z  = _mm_loadu_ps(in.center_z + i);
+        __m128 extends_x = _mm_loadu_ps(in.extends_x + i);
+        __m128 extends_y = _mm_loadu_ps(in.extends_y + i);
+        __m128 extends_z = _mm_loadu_ps(in.extends_z + i);
+
+        __m128 visible = zero;
+        for (int32 f = 0; f < plane_set_count; ++f)
+        {
+            const culling_planes& cp = planes[f];
+            __m128 inside            = all_ones;
+            for (int32 p = 0; p < 6; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(center_x, _mm_set1_ps(cp.normal_x[p])), _mm_mul_ps(center_y, _mm_set1_ps(cp.normal_y[p]))),
+                                             _mm_add_ps(_mm_mul_ps(center_z, _mm_set1_ps(cp.normal_z[p])), _mm_set1_ps(cp.distance[p])));
+                __m128 radius   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(extends_x, _mm_set1_ps(cp.absolute_x[p])), _mm_mul_ps(extends_y, _mm_set1_ps(cp.absolute_y[p]))),
+                                           _mm_mul_ps(extends_z, _mm_set1_ps(cp.absolute_z[p])));
+                inside          = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+            }
+            visible = _mm_or_ps(visible, inside);
+        }
+
+        int32 mask = _mm_movemask_ps(visible);
+        if (in.size - i < 4)
+            mask &= (1 << (in.size - i)) - 1; // padding
+        for (int32 b = 0; mask != 0; ++b, mask >>= 1)
+        {
+            if (mask & 1)
+                visible_indices[count++] = i + b;
+        }
+    }
+    return count;
+}
+
+MANGO_TARGET_AVX2 static int32 cull_avx2(const culling_input& in, const culling_planes* planes, int32 plane_set_count, int32* visible_indices)
+{
+    const __m256 zero     = _mm256_setzero_ps();
+    const __m256 all_ones = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+
+    int32 count = 0;
+    for (int32 i = 0; i < in.size; i += 8)
+    {
+        __m256 center_x  = _mm256_loadu_ps(in.center_x + i);
+        __m256 center_y  = _mm256_loadu_ps(in.center_y + i);
+        __m256 center_z  = _mm256_loadu_ps(in.center_z + i);
+        __m256 extends_x = _mm256_loadu_ps(in.extends_x + i);
+        __m256 extends_y = _mm256_loadu_ps(in.extends_y + i);
+        __m256 extends_z = _mm256_loadu_ps(in.extends_z + i);
+
+        __m256 visible = zero;
+        for (int32 f = 0; f < plane_set_count; ++f)
+        {
+            const culling_planes& cp = planes[f];
+            __m256 inside            = all_ones;
+            for (int32 p = 0; p < 6; ++p)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(center_x, _mm256_set1_ps(cp.normal_x[p])), _mm256_mul_ps(center_y, _mm256_set1_ps(cp.normal_y[p]))),
+                                                _mm256_add_ps(_mm256_mul_ps(center_z, _mm256_set1_ps(cp.normal_z[p])), _mm256_set1_ps(cp.distance[p])));
+                __m256 radius   = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(extends_x, _mm256_set1_ps(cp.absolute_x[p])), _mm256_mul_ps(extends_y, _mm256_set1_ps(cp.absolute_y[p]))),
+                                              _mm256_mul_ps(extends_z, _mm256_set1_ps(cp.absolute_z[p])));
+                inside          = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+            }
+            visible = _mm256_or_ps(visible, inside);
+        }
+
+        int32 mask = _mm256_movemask_ps(visible);
+        if (in.size - i < 8)
+            mask &= (1 << (in.size - i)) - 1; // padding
+        for (int32 b = 0; mask != 0; ++b, mask >>= 1)
+        {
+            if (mask & 1)
+                visible_indices[count++] = i + b;
+        }
+    }
+    return count;
+}
+#endif // MANGO_CULLING_X86
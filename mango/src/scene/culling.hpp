@@ -0,0 +1,131 @@
+//! \file      culling.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_CULLING_HPP
+#define MANGO_CULLING_HPP
+
+#include <mango/scene_ecs.hpp>
+#include <mango/types.hpp>
+#include <vector>
+
+namespace mango
+{
+    //! \brief A view frustum described by six planes.
+    struct frustum
+    {
+        //! \brief The planes in the order left, right, bottom, top, near, far.
+        //! \details The xyz components are the (not normalized) normal pointing inside, w is the distance.
+        glm::vec4 planes[6];
+    };
+
+    //! \brief Extracts the planes of a \a frustum from a view projection matrix.
+    //! \param[in] view_projection The view projection matrix mapping to the OpenGL clip space.
+    //! \return The \a frustum in the space the matrix transforms from. Usually world space.
+    frustum frustum_from_view_projection(const glm::mat4& view_projection);
+
+    //! \brief Checks if an \a axis_aligned_bounding_box has valid (not empty) extends.
+    //! \param[in] box The \a axis_aligned_bounding_box to check.
+    //! \return True if the box is valid, else false.
+    inline bool is_valid(const axis_aligned_bounding_box& box)
+    {
+        return box.min.x <= box.max.x && box.min.y <= box.max.y && box.min.z <= box.max.z;
+    }
+
+    //! \brief Transforms an \a axis_aligned_bounding_box.
+    //! \param[in] box The \a axis_aligned_bounding_box to transform.
+    //! \param[in] transformation The transformation matrix.
+    //! \return The \a axis_aligned_bounding_box enclosing the transformed box. Empty boxes stay empty.
+    axis_aligned_bounding_box transform_bounds(const axis_aligned_bounding_box& box, const glm::mat4& transformation);
+
+    //! \brief Checks if an \a axis_aligned_bounding_box is inside or intersects a \a frustum.
+    //! \details The test is conservative, boxes near the frustum corners can be visible although they are outside.
+    //! \param[in] f The \a frustum to test against.
+    //! \param[in] box The \a axis_aligned_bounding_box to test. Empty boxes are always visible.
+    //! \return True if the box is (potentially) visible, false if it is completely outside.
+    bool is_visible(const frustum& f, const axis_aligned_bounding_box& box);
+
+    //! \brief Instruction sets the batch culling is implemented with.
+    enum class simd_level : uint8
+    {
+        scalar, //!< No simd, one box per iteration.
+        sse,    //!< SSE, four boxes per iteration.
+        avx2    //!< AVX2, eight boxes per iteration.
+    };
+
+    //! \brief Detects the best \a simd_level the cpu supports.
+    //! \details The detection is done once, later calls return the cached result.
+    //! \return The best supported \a simd_level.
+    simd_level get_supported_simd_level();
+
+    //! \brief World space bounding volumes stored as structure of arrays to cull them in batches.
+    //! \details The boxes are stored as centers and extends. Testing a plane is then a few multiply adds without branches,
+    //! which are done for four or eight boxes at once depending on the \a simd_level.
+    class culling_volumes
+    {
+      public:
+        //! \brief Constructs empty \a culling_volumes using the best supported \a simd_level.
+        culling_volumes();
+
+        //! \brief Removes all volumes. Keeps the memory.
+        void clear();
+
+        //! \brief Reserves memory for a number of volumes.
+        //! \param[in] capacity The number of volumes to reserve memory for.
+        void reserve(int32 capacity);
+
+        //! \brief Adds a volume.
+        //! \param[in] box The world space \a axis_aligned_bounding_box. Empty boxes get the maximum extends and are never culled.
+        //! \return The index of the volume. Indices are assigned in ascending order, starting from zero.
+        int32 add(const axis_aligned_bounding_box& box);
+
+        //! \brief Returns the number of volumes.
+        //! \return The number of volumes.
+        inline int32 size() const
+        {
+            return m_size;
+        }
+
+        //! \brief Sets the \a simd_level to cull with.
+        //! \details Levels the cpu does not support fall back to the best supported one.
+        //! \param[in] level The \a simd_level to use.
+        void set_simd_level(simd_level level);
+
+        //! \brief Returns the \a simd_level used for culling.
+        //! \return The \a simd_level used for culling.
+        inline simd_level get_simd_level() const
+        {
+            return m_simd_level;
+        }
+
+        //! \brief Culls all volumes against a set of frustums.
+        //! \details A volume is visible if it is visible in at least one of the frustums.
+        //! \param[in] frustums Pointer to the frustums to test against.
+        //! \param[in] frustum_count The number of frustums.
+        //! \param[out] visible_indices Array to store the indices of the visible volumes in, in ascending order. Needs space for size() indices.
+        //! \return The number of visible volumes.
+        int32 cull(const frustum* frustums, int32 frustum_count, int32* visible_indices) const;
+
+      private:
+        //! \brief The x coordinates of the centers.
+        std::vector<float> m_center_x;
+        //! \brief The y coordinates of the centers.
+        std::vector<float> m_center_y;
+        //! \brief The z coordinates of the centers.
+        std::vector<float> m_center_z;
+        //! \brief The extends in x direction.
+        std::vector<float> m_extends_x;
+        //! \brief The extends in y direction.
+        std::vector<float> m_extends_y;
+        //! \brief The extends in z direction.
+        std::vector<float> m_extends_z;
+        //! \brief The number of volumes. The arrays are padded to a multiple of the widest batch.
+        int32 m_size;
+        //! \brief The \a simd_level used for culling.
+        simd_level m_simd_level;
+    };
+} // namespace mango
+
+#endif // MANGO_CULLING_HPP
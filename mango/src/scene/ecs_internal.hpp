@@ -7,6 +7,7 @@
 #ifndef MANGO_ECS_INTERNAL_HPP
 #define MANGO_ECS_INTERNAL_HPP
 
+#include <core/job_system.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/component_wise.hpp>
 #include <glm/gtx/matrix_decompose.hpp>
@@ -14,133 +15,533 @@
 #include <mango/scene_component_pool.hpp>
 #include <mango/scene_ecs.hpp>
 #include <mango/types.hpp>
+#include <scene/bvh.hpp>
+#include <scene/culling.hpp>
+#include <scene/transform_math.hpp>
+#include <vector>
 
 namespace mango
 {
+    //! \brief The components an \a ecsystem reads and writes.
+    //! \details Systems can be executed concurrently, if neither of them writes anything the other one accesses.
+    struct system_access
+    {
+        uint32 reads;  //!< Bitmask of the components read. Bits are set with component_bit().
+        uint32 writes; //!< Bitmask of the components written. Bits are set with component_bit().
+
+        //! \brief Checks if two \a ecsystems can not be executed concurrently.
+        //! \param[in] other The \a system_access of the other \a ecsystem.
+        //! \return True if one of the systems writes something the other one accesses, else false.
+        inline bool conflicts_with(const system_access& other) const
+        {
+            return (writes & (other.reads | other.writes)) != 0 || (other.writes & reads) != 0;
+        }
+    };
+
+    //! \brief Bit marking the submission to the \a render_system in a \a system_access, which is not thread safe.
+    const uint32 render_submission_bit = 1u << 31;
+
+    //! \brief Returns the bit of a component in a \a system_access.
+    //! \return The bit of the component.
+    template <typename component>
+    inline uint32 component_bit()
+    {
+        return 1u << type_name<component>::id();
+    }
+
+    //! \brief An \a ecsystem execution scheduled with its \a system_access.
+    struct scheduled_system
+    {
+        system_access access;          //!< The components accessed by the execution.
+        std::function<void()> execute; //!< The function executing the \a ecsystem.
+    };
+
+    //! \brief Executes \a ecsystems, systems not conflicting with any earlier one run concurrently.
+    //! \details Each system runs after all earlier systems it conflicts with are finished, the order of conflicting systems is kept.
+    //! \param[in] jobs The \a job_system to execute the systems with. Can be null to execute them on the calling thread in order.
+    //! \param[in] systems The \a scheduled_systems in the order they are declared.
+    inline void execute_systems(job_system* jobs, const std::vector<scheduled_system>& systems)
+    {
+        const int32 count = static_cast<int32>(systems.size());
+        if (!jobs)
+        {
+            for (int32 i = 0; i < count; ++i)
+                systems[i].execute();
+            return;
+        }
+
+        // A system runs in the phase after the last earlier one it conflicts with.
+        std::vector<int32> phases(count, 0);
+        int32 phase_count = 0;
+        for (int32 i = 0; i < count; ++i)
+        {
+            for (int32 j = 0; j < i; ++j)
+            {
+                if (systems[i].access.conflicts_with(systems[j].access))
+                    phases[i] = glm::max(phases[i], phases[j] + 1);
+            }
+            phase_count = glm::max(phase_count, phases[i] + 1);
+        }
+
+        for (int32 phase = 0; phase < phase_count; ++phase)
+        {
+            job_counter counter;
+            int32 own = -1;
+            for (int32 i = 0; i < count; ++i)
+            {
+                if (phases[i] != phase)
+                    continue;
+                if (own < 0)
+                    own = i;
+                else
+                    jobs->submit(systems[i].execute, counter);
+            }
+            systems[own].execute();
+            jobs->wait(counter);
+        }
+    }
+
+    //! \brief Executes a function for all components of a \a scene_component_pool in parallel.
+    //! \details The pool is split into ranges executed by the \a job_system. Components must not be added or removed while iterating.
+    //! \param[in] jobs The \a job_system to execute the ranges with. Can be null to iterate on the calling thread.
+    //! \param[in] pool The \a scene_component_pool to iterate.
+    //! \param[in] func The function to call for each \a component. Signature: void(component& c, int32 index).
+    template <typename component, typename function>
+    void parallel_for_each(job_system* jobs, scene_component_pool<component>& pool, function func)
+    {
+        const int32 count = static_cast<int32>(pool.size());
+        if (!jobs)
+        {
+            for (int32 i = 0; i < count; ++i)
+                func(pool.component_at(i), i);
+            return;
+        }
+        jobs->parallel_for(count, 256, [&pool, &func](int32 begin, int32 end) {
+            for (int32 i = begin; i < end; ++i)
+                func(pool.component_at(i), i);
+        });
+    }
+
     //! \brief An \a ecsystem for transformation updates.
+    //! \details Only recomputes the matrices of changed \a transform_components.
     class transformation_update_system : public ecsystem_1<transform_component>
     {
       public:
+        transformation_update_system()
+            : m_recomputed(0)
+        {
+        }
+
+        //! \brief Setup for the \a transformation_update_system.
+        //! \param[in] jobs The \a job_system to update the transformations in parallel with. Can be null.
+        void setup(job_system* jobs)
+        {
+            m_jobs = jobs;
+        }
+
+        //! \brief Returns the components the \a transformation_update_system accesses.
+        //! \return The \a system_access of the \a transformation_update_system.
+        static system_access get_access()
+        {
+            return { 0, component_bit<transform_component>() };
+        }
+
+        //! \brief Returns the number of matrices recomputed in the last execution.
+        //! \return The number of recomputed matrices.
+        inline int32 get_recomputed_count() const
+        {
+            return m_recomputed.load(std::memory_order_relaxed);
+        }
+
         void execute(float, scene_component_pool<transform_component>& transformations) override
         {
             NAMED_PROFILE_ZONE("Transformation Update");
-            transformations.for_each(
-                [&transformations](transform_component& c, int32&) {
-                    c.local_transformation_matrix = glm::translate(glm::mat4(1.0), c.position);
-                    c.local_transformation_matrix = c.local_transformation_matrix * glm::toMat4(c.rotation);
-                    c.local_transformation_matrix = glm::scale(c.local_transformation_matrix, c.scale);
-
-                    c.world_transformation_matrix = c.local_transformation_matrix;
-                },
-                false);
+            m_recomputed.store(0, std::memory_order_relaxed);
+            parallel_for_each(m_jobs, transformations, [this](transform_component& c, int32) {
+                c.world_changed = c.changed;
+                if (!c.changed)
+                    return;
+                c.world_transformation_matrix = compose_transformation(c.position, c.rotation, c.scale);
+                c.changed                     = false;
+                m_recomputed.fetch_add(1, std::memory_order_relaxed);
+            });
         }
+
+      private:
+        //! \brief The \a job_system to update the transformations in parallel with.
+        job_system* m_jobs = nullptr;
+        //! \brief The number of matrices recomputed in the last execution.
+        std::atomic<int32> m_recomputed;
     };
 
+    //! \brief Builds the flat scene hierarchy from the \a node_components.
+    //! \details The nodes are stored breadth first, so all nodes of one depth are stored before the deeper ones
+    //! and every parent is stored before its children. Costs one visit per node.
+    //! \param[in] nodes The \a scene_component_pool with the \a node_components.
+    //! \param[out] hierarchy The flat hierarchy. Previous content is replaced.
+    inline void build_hierarchy(scene_component_pool<node_component>& nodes, std::vector<hierarchy_node>& hierarchy)
+    {
+        hierarchy.clear();
+        hierarchy.reserve(nodes.size());
+        for (int32 i = 0; i < static_cast<int32>(nodes.size()); ++i)
+        {
+            if (nodes.component_at(i).parent_entity == invalid_entity)
+                hierarchy.push_back({ nodes.entity_at(i), -1 });
+        }
+
+        // The hierarchy itself is the queue of the breadth first traversal.
+        for (int32 parent_index = 0; parent_index < static_cast<int32>(hierarchy.size()); ++parent_index)
+        {
+            const node_component* parent = nodes.get_component_for_entity(hierarchy[parent_index].node_entity, true);
+            entity child                 = parent ? parent->child_entities : invalid_entity;
+            for (int32 i = 0; parent && i < parent->children_count && child != invalid_entity; ++i)
+            {
+                hierarchy.push_back({ child, parent_index });
+                const node_component* child_node = nodes.get_component_for_entity(child, true);
+                child                            = child_node ? child_node->next_sibling : invalid_entity;
+            }
+        }
+    }
+
+    //! \brief Builds a \a flat_hierarchy from the \a node_components.
+    //! \param[in] nodes The \a scene_component_pool with the \a node_components.
+    //! \param[out] hierarchy The \a flat_hierarchy. Previous content is replaced.
+    inline void build_hierarchy(scene_component_pool<node_component>& nodes, flat_hierarchy& hierarchy)
+    {
+        build_hierarchy(nodes, hierarchy.nodes);
+        hierarchy.indices.clear();
+        hierarchy.indices.reserve(hierarchy.nodes.size());
+        for (int32 i = 0; i < static_cast<int32>(hierarchy.nodes.size()); ++i)
+            hierarchy.indices[hierarchy.nodes[i].node_entity] = i;
+        hierarchy.removed_count = 0;
+    }
+
+    //! \brief Brings a \a flat_hierarchy up to date after nodes were attached, detached, added or removed.
+    //! \details The old entries of the changed subtrees are marked as removed and the subtrees are appended breadth first behind their parents,
+    //! so the cost is proportional to the size of the changed subtrees. The hierarchy is built again once the removed entries are the majority.
+    //! \param[in] nodes The \a scene_component_pool with the \a node_components.
+    //! \param[in] changed The entities whose \a node_component was added or removed or whose parent changed.
+    //! \param[in,out] hierarchy The \a flat_hierarchy to update.
+    inline void splice_hierarchy(scene_component_pool<node_component>& nodes, const std::vector<entity>& changed, flat_hierarchy& hierarchy)
+    {
+        auto remove_entry = [&hierarchy](entity e) {
+            auto it = hierarchy.indices.find(e);
+            if (it == hierarchy.indices.end())
+                return;
+            hierarchy.nodes[it->second] = { invalid_entity, -1 };
+            hierarchy.removed_count++;
+            hierarchy.indices.erase(it);
+        };
+        auto append_entry = [&hierarchy](entity e, int32 parent_index) {
+            hierarchy.indices[e] = static_cast<int32>(hierarchy.nodes.size());
+            hierarchy.nodes.push_back({ e, parent_index });
+        };
+
+        const int32 splice_begin = static_cast<int32>(hierarchy.nodes.size());
+        for (entity e : changed)
+        {
+            // Already appended with the subtree of a changed ancestor.
+            auto it = hierarchy.indices.find(e);
+            if (it != hierarchy.indices.end() && it->second >= splice_begin)
+                continue;
+
+            remove_entry(e);
+            const node_component* node = nodes.get_component_for_entity(e, true);
+            if (!node)
+                continue;
+            int32 parent_index = -1;
+            if (node->parent_entity != invalid_entity)
+            {
+                // Parents without an entry are new and append their subtree themselves.
+                auto parent = hierarchy.indices.find(node->parent_entity);
+                if (parent == hierarchy.indices.end())
+                    continue;
+                parent_index = parent->second;
+            }
+
+            // The appended entries are the queue of the breadth first traversal of the subtree.
+            const int32 first = static_cast<int32>(hierarchy.nodes.size());
+            append_entry(e, parent_index);
+            for (int32 index = first; index < static_cast<int32>(hierarchy.nodes.size()); ++index)
+            {
+                const node_component* parent = nodes.get_component_for_entity(hierarchy.nodes[index].node_entity, true);
+                entity child                 = parent ? parent->child_entities : invalid_entity;
+                for (int32 i = 0; parent && i < parent->children_count && child != invalid_entity; ++i)
+                {
+                    remove_entry(child);
+                    append_entry(child, index);
+                    const node_component* child_node = nodes.get_component_for_entity(child, true);
+                    child                            = child_node ? child_node->next_sibling : invalid_entity;
+                }
+            }
+        }
+
+        if (hierarchy.removed_count > static_cast<int32>(hierarchy.nodes.size()) / 2)
+            build_hierarchy(nodes, hierarchy);
+    }
+
     //! \brief An \a ecsystem for scene graph updates.
+    //! \details Propagates changes down the hierarchy, only world matrices of changed subtrees are recomputed.
+    //! Walks the flat hierarchy set in setup() in a single linear pass, parents are always updated before their children.
     class scene_graph_update_system : public ecsystem_2<node_component, transform_component>
     {
       public:
-        void execute(float, scene_component_pool<node_component>& nodes, scene_component_pool<transform_component>& transformations) override
+        //! \brief Setup for the \a scene_graph_update_system.
+        //! \param[in] hierarchy The flat hierarchy built with build_hierarchy(). Has to be valid during the execution.
+        void setup(const std::vector<hierarchy_node>* hierarchy)
+        {
+            m_hierarchy = hierarchy;
+        }
+
+        //! \brief Returns the number of matrices recomputed in the last execution.
+        //! \return The number of recomputed matrices.
+        inline int32 get_recomputed_count() const
+        {
+            return m_recomputed;
+        }
+
+        //! \brief Returns the components the \a scene_graph_update_system accesses.
+        //! \return The \a system_access of the \a scene_graph_update_system.
+        static system_access get_access()
+        {
+            return { component_bit<node_component>() | component_bit<transform_component>(), component_bit<transform_component>() };
+        }
+
+        void execute(float, scene_component_pool<node_component>&, scene_component_pool<transform_component>& transformations) override
         {
             NAMED_PROFILE_ZONE("Scene Graph Update");
-            nodes.for_each(
-                [&nodes, &transformations](node_component& c, int32& index) {
-                    node_component& parent_component = c;
-                    if (c.parent_entity == invalid_entity)
-                        return;
-                    entity e = nodes.entity_at(index);
-
-                    transform_component* child_transform  = transformations.get_component_for_entity(e);
-                    transform_component* parent_transform = transformations.get_component_for_entity(parent_component.parent_entity);
-                    if (nullptr != child_transform && nullptr != parent_transform)
-                    {
-                        child_transform->world_transformation_matrix = parent_transform->world_transformation_matrix * child_transform->local_transformation_matrix;
-                    }
-                },
-                false);
+            m_recomputed = 0;
+            if (!m_hierarchy)
+                return;
+
+            const std::vector<hierarchy_node>& hierarchy = *m_hierarchy;
+            m_node_transforms.resize(hierarchy.size());
+            for (int32 i = 0; i < static_cast<int32>(hierarchy.size()); ++i)
+            {
+                const hierarchy_node& node           = hierarchy[i];
+                transform_component* child_transform = node.node_entity != invalid_entity ? transformations.get_component_for_entity(node.node_entity, true) : nullptr;
+                m_node_transforms[i]                 = child_transform;
+                if (node.parent_index < 0 || nullptr == child_transform)
+                    continue;
+
+                const transform_component* parent_transform = m_node_transforms[node.parent_index];
+                if (nullptr == parent_transform)
+                    continue;
+                if (child_transform->world_changed) // changed in the transformation update, the world transformation is still the local one
+                    child_transform->world_transformation_matrix = multiply_transformations(parent_transform->world_transformation_matrix, child_transform->world_transformation_matrix);
+                else if (parent_transform->world_changed)
+                    child_transform->world_transformation_matrix = multiply_transformations(parent_transform->world_transformation_matrix,
+                                                                                            compose_transformation(child_transform->position, child_transform->rotation, child_transform->scale));
+                else
+                    continue;
+                child_transform->world_changed = true; // propagates to the children
+                m_recomputed++;
+            }
         }
+
+      private:
+        //! \brief The flat hierarchy to update.
+        const std::vector<hierarchy_node>* m_hierarchy = nullptr;
+        //! \brief The \a transform_components of the hierarchy nodes, resolved once per node during the execution.
+        std::vector<transform_component*> m_node_transforms;
+        //! \brief The number of matrices recomputed in the last execution.
+        int32 m_recomputed = 0;
+    };
+
+    //! \brief An \a ecsystem transforming the bounds of mesh primitives to world space.
+    //! \details Has to be executed after the \a scene_graph_update_system, since it requires the final world transformations.
+    class bounds_update_system : public ecsystem_2<mesh_primitive_component, transform_component>
+    {
+      public:
+        //! \brief Setup for the \a bounds_update_system.
+        //! \param[in] jobs The \a job_system to update the bounds in parallel with. Can be null.
+        void setup(job_system* jobs)
+        {
+            m_jobs = jobs;
+        }
+
+        //! \brief Returns the components the \a bounds_update_system accesses.
+        //! \return The \a system_access of the \a bounds_update_system.
+        static system_access get_access()
+        {
+            return { component_bit<mesh_primitive_component>() | component_bit<transform_component>(), component_bit<mesh_primitive_component>() };
+        }
+
+        void execute(float, scene_component_pool<mesh_primitive_component>& meshes, scene_component_pool<transform_component>& transformations) override
+        {
+            NAMED_PROFILE_ZONE("Bounds Update");
+            parallel_for_each(m_jobs, meshes, [&meshes, &transformations](mesh_primitive_component& c, int32 index) {
+                const int32 transform_index = transformations.index_of(meshes.entity_at(index));
+                if (transform_index < 0)
+                    return;
+                const transform_component& transform = transformations.component_at(transform_index);
+                if (transform.world_changed || !is_valid(c.world_bounds)) // invalid bounds were not computed yet
+                    c.world_bounds = transform_bounds(c.local_bounds, glm::mat4(transform.world_transformation_matrix));
+            });
+        }
+
+      private:
+        //! \brief The \a job_system to update the bounds in parallel with.
+        job_system* m_jobs = nullptr;
     };
 
     //! \brief An \a ecsystem for camera updates.
     class camera_update_system : public ecsystem_2<camera_component, transform_component>
     {
       public:
+        //! \brief Returns the components the \a camera_update_system accesses.
+        //! \return The \a system_access of the \a camera_update_system.
+        static system_access get_access()
+        {
+            return { component_bit<camera_component>() | component_bit<transform_component>(), component_bit<camera_component>() };
+        }
+
         void execute(float, scene_component_pool<camera_component>& cameras, scene_component_pool<transform_component>& transformations) override
         {
             NAMED_PROFILE_ZONE("Camera Update");
-            cameras.for_each(
-                [&cameras, &transformations](camera_component& c, int32& index) {
-                    entity e                       = cameras.entity_at(index);
-                    transform_component* transform = transformations.get_component_for_entity(e);
-                    if (transform)
-                    {
-                        glm::vec3 front = c.target - glm::vec3(transform->world_transformation_matrix[3]);
-                        if (glm::length(front) > 1e-5)
-                            front = glm::normalize(front);
-                        else
-                        {
-                            front    = GLOBAL_FORWARD;
-                            c.target = front * 0.1f; // We need this here.
-                        }
-                        auto right = glm::normalize(glm::cross(GLOBAL_UP, front));
-                        c.up       = glm::normalize(glm::cross(front, right));
-                        c.view     = glm::lookAt(glm::vec3(transform->world_transformation_matrix[3]), c.target, c.up);
-                        if (c.cam_type == camera_type::perspective_camera)
-                        {
-                            c.projection = glm::perspective(c.perspective.vertical_field_of_view, c.perspective.aspect, c.z_near, c.z_far);
-                        }
-                        else if (c.cam_type == camera_type::orthographic_camera)
-                        {
-                            const float distance_x = c.orthographic.x_mag;
-                            const float distance_y = c.orthographic.y_mag;
-                            c.projection           = glm::ortho(-distance_x * 0.5f, distance_x * 0.5f, -distance_y * 0.5f, distance_y * 0.5f, c.z_near, c.z_far);
-                        }
-                        c.view_projection = c.projection * c.view;
-                    }
-                },
-                false);
+            join(cameras, transformations, [](entity, camera_component& c, transform_component& transform) {
+                glm::vec3 front = c.target - glm::vec3(transform.world_transformation_matrix[3]);
+                if (glm::length(front) > 1e-5)
+                    front = glm::normalize(front);
+                else
+                {
+                    front    = GLOBAL_FORWARD;
+                    c.target = front * 0.1f; // We need this here.
+                }
+                auto right = glm::normalize(glm::cross(GLOBAL_UP, front));
+                c.up       = glm::normalize(glm::cross(front, right));
+                c.view     = glm::lookAt(glm::vec3(transform.world_transformation_matrix[3]), c.target, c.up);
+                if (c.cam_type == camera_type::perspective_camera)
+                {
+                    c.projection = glm::perspective(c.perspective.vertical_field_of_view, c.perspective.aspect, c.z_near, c.z_far);
+                }
+                else if (c.cam_type == camera_type::orthographic_camera)
+                {
+                    const float distance_x = c.orthographic.x_mag;
+                    const float distance_y = c.orthographic.y_mag;
+                    c.projection           = glm::ortho(-distance_x * 0.5f, distance_x * 0.5f, -distance_y * 0.5f, distance_y * 0.5f, c.z_near, c.z_far);
+                }
+                c.view_projection = c.projection * c.view;
+            });
         }
     };
 
     //! \brief An \a ecsystem for rendering meshes.
+    //! \details Culls the meshes with the \a bounding_volume_hierarchy of the scene, so only visible primitives are touched.
     class render_mesh_system : public ecsystem_3<mesh_primitive_component, material_component, transform_component>
     {
       public:
         //! \brief Setup for the \a render_mesh_system. Needs to be called before executing.
+        //! \details Builds the frustums of the camera and the shadow cascades the meshes are culled against.
         //! \param[in] rs The \a render_system to submit the meshes to.
-        void setup(shared_ptr<render_system_impl> rs)
+        //! \param[in] camera The \a camera_data of the active camera.
+        //! \param[in] mesh_bvh The \a bounding_volume_hierarchy over the world bounds of the mesh primitives. The item indices have to be the indices in the pool.
+        void setup(shared_ptr<render_system_impl> rs, const camera_data& camera, bounding_volume_hierarchy* mesh_bvh)
         {
-            m_rs = rs;
+            m_rs       = rs;
+            m_mesh_bvh = mesh_bvh;
+
+            m_cull_camera = camera.camera_info != nullptr;
+            if (m_cull_camera)
+                m_camera_frustum = frustum_from_view_projection(camera.camera_info->view_projection);
+
+            glm::mat4 shadow_view_projections[max_shadow_frustums];
+            m_shadow_frustum_count = m_rs->get_shadow_view_projections(shadow_view_projections, max_shadow_frustums);
+            for (int32 i = 0; i < m_shadow_frustum_count; ++i)
+                m_shadow_frustums[i] = frustum_from_view_projection(shadow_view_projections[i]);
+        }
+
+        //! \brief Returns the components the \a render_mesh_system accesses.
+        //! \return The \a system_access of the \a render_mesh_system.
+        static system_access get_access()
+        {
+            return { component_bit<mesh_primitive_component>() | component_bit<material_component>() | component_bit<transform_component>(), render_submission_bit };
         }
 
         void execute(float, scene_component_pool<mesh_primitive_component>& meshes, scene_component_pool<material_component>& materials,
                      scene_component_pool<transform_component>& transformations) override
         {
             PROFILE_ZONE;
-            meshes.for_each(
-                [this, &meshes, &materials, &transformations](mesh_primitive_component& c, int32& index) {
-                    if (!c.vertex_array_object)
-                        return;
-                    entity e                       = meshes.entity_at(index);
-                    transform_component* transform = transformations.get_component_for_entity(e);
-                    material_component* mat        = materials.get_component_for_entity(e);
-                    if (transform && mat) // TODO Paul: Should we really force materials?
-                    {
-                        auto m = *mat;
-                        auto p = c;
-
-                        m_rs->begin_mesh(transform->world_transformation_matrix, p.has_normals, p.has_tangents);
-                        m_rs->use_material(m.component_material);
-                        m_rs->draw_mesh(p.vertex_array_object, p.topology, p.first, p.count, p.type_index, p.instance_count);
-                        m_rs->end_mesh();
-                    }
-                },
-                false);
+            int32 mesh_count = static_cast<int32>(meshes.size());
+            MANGO_ASSERT(m_mesh_bvh && m_mesh_bvh->size() == mesh_count, "The mesh hierarchy is not up to date!");
+
+            // Without camera or cascades there is nothing to cull against.
+            m_camera_visible.resize(mesh_count);
+            m_shadow_visible.resize(mesh_count);
+            int32 camera_count = m_cull_camera ? m_mesh_bvh->cull(&m_camera_frustum, 1, m_camera_visible.data()) : all_visible(m_camera_visible.data(), mesh_count);
+            int32 shadow_count = m_shadow_frustum_count > 0 ? m_mesh_bvh->cull(m_shadow_frustums, m_shadow_frustum_count, m_shadow_visible.data())
+                                                            : all_visible(m_shadow_visible.data(), mesh_count);
+
+            // Both index lists are ascending, so they can be merged to submit in pool order.
+            int32 camera_idx = 0;
+            int32 shadow_idx = 0;
+            while (camera_idx < camera_count || shadow_idx < shadow_count)
+            {
+                int32 camera_candidate     = camera_idx < camera_count ? m_camera_visible[camera_idx] : mesh_count;
+                int32 shadow_candidate     = shadow_idx < shadow_count ? m_shadow_visible[shadow_idx] : mesh_count;
+                int32 candidate            = glm::min(camera_candidate, shadow_candidate);
+                mesh_visibility visibility = mesh_visibility::none;
+                if (camera_candidate == candidate)
+                {
+                    visibility |= mesh_visibility::camera;
+                    camera_idx++;
+                }
+                if (shadow_candidate == candidate)
+                {
+                    visibility |= mesh_visibility::shadow;
+                    shadow_idx++;
+                }
+
+                // TODO Paul: Should we really force materials?
+                mesh_primitive_component& p = meshes.component_at(candidate);
+                if (!p.vertex_array_object)
+                    continue;
+                entity mesh_entity             = meshes.entity_at(candidate);
+                material_component* mat        = materials.get_component_for_entity(mesh_entity, true);
+                transform_component* transform = transformations.get_component_for_entity(mesh_entity, true);
+                if (!mat || !transform)
+                    continue;
+
+                m_rs->begin_mesh(glm::mat4(transform->world_transformation_matrix), p.has_normals, p.has_tangents, mesh_entity, visibility, &p.world_bounds);
+                m_rs->use_material(mat->component_material);
+                m_rs->draw_mesh(p.vertex_array_object, p.topology, p.first, p.count, p.type_index, p.instance_count, p.base_vertex);
+                m_rs->end_mesh();
+            }
+
+            m_rs->submit_culling_info(camera_count, mesh_count - camera_count, mesh_count - shadow_count);
         }
 
       private:
+        //! \brief Fills an index list with all candidates.
+        //! \param[out] visible_indices The index list to fill.
+        //! \param[in] count The number of candidates.
+        //! \return The number of visible candidates, which is \a count.
+        int32 all_visible(int32* visible_indices, int32 count)
+        {
+            for (int32 i = 0; i < count; ++i)
+                visible_indices[i] = i;
+            return count;
+        }
+
+        //! \brief The maximum number of shadow cascade frustums.
+        static const int32 max_shadow_frustums = 4;
+
         //! \brief The \a render_system to submit the meshes to.
         shared_ptr<render_system_impl> m_rs;
+        //! \brief The \a bounding_volume_hierarchy over the world bounds of the mesh primitives.
+        bounding_volume_hierarchy* m_mesh_bvh = nullptr;
+        //! \brief True if there is an active camera to cull against, else false.
+        bool m_cull_camera = false;
+        //! \brief The frustum of the active camera.
+        frustum m_camera_frustum;
+        //! \brief The frustums of the shadow cascades.
+        frustum m_shadow_frustums[max_shadow_frustums];
+        //! \brief The number of valid frustums in m_shadow_frustums.
+        int32 m_shadow_frustum_count = 0;
+        //! \brief The pool indices of the primitives visible to the camera.
+        std::vector<int32> m_camera_visible;
+        //! \brief The pool indices of the primitives visible to at least one shadow cascade.
+        std::vector<int32> m_shadow_visible;
     };
 
     //! \brief An \a ecsystem for light submission.
@@ -154,6 +555,13 @@ namespace mango
             m_rs = rs;
         }
 
+        //! \brief Returns the components the \a light_submission_system accesses.
+        //! \return The \a system_access of the \a light_submission_system.
+        static system_access get_access()
+        {
+            return { component_bit<directional_light_component>() | component_bit<atmosphere_light_component>() | component_bit<skylight_component>(), render_submission_bit };
+        }
+
         void execute(float, scene_component_pool<directional_light_component>& d_lights, scene_component_pool<atmosphere_light_component>& a_lights,
                      scene_component_pool<skylight_component>& s_lights) override
         {
@@ -0,0 +1,143 @@
+//! \file      model_loading.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <algorithm>
+#include <graphics/buffer.hpp>
+#include <graphics/texture.hpp>
+#include <graphics/vertex_array.hpp>
+#include <mango/log.hpp>
+#include <mango/profile.hpp>
+#include <resources/texture_compression.hpp>
+#include <scene/model_loading.hpp>
+#include <set>
+
+using namespace mango;
+
+//! \brief Adds the upload of a \a cooked_texture, if it was not added before.
+//! \param[in] m The \a cooked_model.
+//! \param[in] texture_index The index of the \a cooked_texture. Negative if there is none.
+//! \param[in] standard_color_space True if the texture is used in standard color space, else false.
+//! \param[in,out] added The keys of the textures already added.
+//! \param[out] uploads The list to append the upload to.
+static void add_texture_upload(const cooked_model& m, int32 texture_index, bool standard_color_space, std::set<int>& added, std::vector<model_upload>& uploads)
+{
+    if (texture_index < 0 || texture_index >= m.count(cooked_table::textures))
+        return;
+    const int32 image_index = m.get<cooked_texture>(cooked_table::textures)[texture_index].image;
+    if (image_index < 0 || image_index >= m.count(cooked_table::images) || m.get<cooked_image>(cooked_table::images)[image_index].bytes.count == 0)
+        return;
+    if (!added.insert(get_model_texture_key(texture_index, standard_color_space)).second)
+        return;
+
+    model_upload upload;
+    upload.type                 = model_upload_type::texture;
+    upload.index                = texture_index;
+    upload.standard_color_space = standard_color_space;
+    upload.byte_size            = static_cast<int64>(m.get<cooked_image>(cooked_table::images)[image_index].bytes.count);
+    uploads.push_back(upload);
+}
+
+void mango::collect_model_uploads(const cooked_model& m, std::vector<model_upload>& uploads)
+{
+    PROFILE_ZONE;
+    const cooked_buffer_view* buffer_views = m.get<cooked_buffer_view>(cooked_table::buffer_views);
+    for (int32 i = 0; i < m.count(cooked_table::buffer_views); ++i)
+    {
+        model_upload upload;
+        upload.type                 = model_upload_type::buffer_view;
+        upload.index                = i;
+        upload.standard_color_space = false;
+        upload.byte_size            = static_cast<int64>(buffer_views[i].bytes.count);
+        uploads.push_back(upload);
+    }
+
+    std::set<int> added;
+    const cooked_material* materials = m.get<cooked_material>(cooked_table::materials);
+    for (int32 i = 0; i < m.count(cooked_table::materials); ++i)
+    {
+        const cooked_material& material = materials[i];
+        add_texture_upload(m, material.base_color_texture, true, added, uploads);
+        add_texture_upload(m, material.metallic_roughness_texture, false, added, uploads);
+        if (material.occlusion_texture != material.metallic_roughness_texture)
+            add_texture_upload(m, material.occlusion_texture, false, added, uploads);
+        add_texture_upload(m, material.normal_texture, false, added, uploads);
+        add_texture_upload(m, material.emissive_texture, true, added, uploads);
+    }
+}
+
+void mango::execute_model_upload(const cooked_model& m, const model_upload& upload, model_gpu_resources& resources)
+{
+    PROFILE_ZONE;
+    if (upload.type == model_upload_type::buffer_view)
+    {
+        const cooked_buffer_view& buffer_view = m.get<cooked_buffer_view>(cooked_table::buffer_views)[upload.index];
+
+        buffer_configuration buffer_config;
+        buffer_config.access = buffer_access::none;
+        buffer_config.size   = static_cast<int64>(buffer_view.bytes.count);
+        buffer_config.target = buffer_view.target == 0 ? buffer_target::vertex_buffer : buffer_target::index_buffer;
+        buffer_config.data   = static_cast<const void*>(m.get_data(buffer_view.bytes));
+        // TODO Paul: Interleaved buffers could be loaded two times ... BAD.
+
+        buffer_ptr result = buffer::create(buffer_config);
+        resources.buffers.insert({ upload.index, result });
+        if (buffer_view.target != 0)
+            return;
+
+        // All primitives with this vertex buffer have the same attributes, the model has one index buffer.
+        const cooked_primitive* primitives = m.get<cooked_primitive>(cooked_table::primitives);
+        const cooked_primitive* primitive  = std::find_if(primitives, primitives + m.count(cooked_table::primitives),
+                                                         [&upload](const cooked_primitive& p) { return p.vertex_buffer_view == upload.index; });
+        if (primitive == primitives + m.count(cooked_table::primitives))
+            return;
+
+        vertex_array_ptr vertex_array_object = vertex_array::create();
+        const cooked_buffer_view* views      = m.get<cooked_buffer_view>(cooked_table::buffer_views);
+        for (int32 i = 0; i < m.count(cooked_table::buffer_views); ++i)
+        {
+            auto it = resources.buffers.find(i);
+            if (views[i].target != 0 && it != resources.buffers.end())
+                vertex_array_object->bind_index_buffer(it->second);
+        }
+        vertex_array_object->bind_vertex_buffer(0, result, 0, primitive->vertex_stride);
+        const cooked_attribute* attributes = m.get<cooked_attribute>(cooked_table::attributes) + primitive->first_attribute;
+        for (int32 i = 0; i < primitive->attribute_count; ++i)
+            vertex_array_object->set_vertex_attribute(attributes[i].location, 0, static_cast<format>(attributes[i].format), attributes[i].offset);
+        resources.vertex_arrays.insert({ upload.index, vertex_array_object });
+        return;
+    }
+
+    const cooked_texture& tex = m.get<cooked_texture>(cooked_table::textures)[upload.index];
+    const cooked_image& image = m.get<cooked_image>(cooked_table::images)[tex.image];
+
+    const texture_compression compression = static_cast<texture_compression>(image.compression);
+
+    texture_configuration config;
+    config.is_standard_color_space = upload.standard_color_space;
+    config.generate_mipmaps        = compression == texture_compression::none ? calculate_mip_count(image.width, image.height) : image.levels;
+    config.texture_min_filter      = tex.min_filter < 0 ? texture_parameter::filter_linear_mipmap_linear : filter_parameter_from_gl(static_cast<g_enum>(tex.min_filter));
+    config.texture_mag_filter      = tex.mag_filter < 0 ? texture_parameter::filter_linear : filter_parameter_from_gl(static_cast<g_enum>(tex.mag_filter));
+    config.texture_wrap_s          = tex.wrap_s < 0 ? texture_parameter::wrap_repeat : wrap_parameter_from_gl(static_cast<g_enum>(tex.wrap_s));
+    config.texture_wrap_t          = tex.wrap_t < 0 ? texture_parameter::wrap_repeat : wrap_parameter_from_gl(static_cast<g_enum>(tex.wrap_t));
+
+    texture_ptr result = texture::create(config);
+
+    // Compressed images contain their mipmaps, the others generate them on the gpu.
+    if (compression != texture_compression::none)
+    {
+        result->set_compressed_data(get_compressed_format(compression, config.is_standard_color_space), image.width, image.height, image.levels, m.get_data(image.bytes));
+        resources.textures.insert({ get_model_texture_key(upload.index, upload.standard_color_space), result });
+        return;
+    }
+
+    format f;
+    format internal;
+    format type;
+    get_formats_and_types_for_image(config.is_standard_color_space, image.components, image.bits, f, internal, type, false);
+
+    result->set_data(internal, image.width, image.height, f, type, m.get_data(image.bytes));
+    resources.textures.insert({ get_model_texture_key(upload.index, upload.standard_color_space), result });
+}
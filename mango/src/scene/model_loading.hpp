@@ -0,0 +1,103 @@
+//! \file      model_loading.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_MODEL_LOADING_HPP
+#define MANGO_MODEL_LOADING_HPP
+
+#include <atomic>
+#include <graphics/graphics_common.hpp>
+#include <map>
+#include <mango/scene.hpp>
+#include <resources/cooked_model.hpp>
+#include <thread>
+#include <vector>
+
+namespace mango
+{
+    //! \brief The maximum number of bytes uploaded to the gpu for asynchronously loaded models per frame.
+    //! \details At least one upload is done every frame, so bigger resources are not blocked.
+    const int64 model_upload_budget = 32 * 1024 * 1024;
+
+    //! \brief The type of a \a model_upload.
+    enum class model_upload_type : uint8
+    {
+        buffer_view, //!< A \a cooked_buffer_view uploaded into a \a buffer.
+        texture      //!< A \a cooked_texture uploaded into a \a texture.
+    };
+
+    //! \brief A single gpu upload of model data.
+    struct model_upload
+    {
+        model_upload_type type;    //!< The type of the upload.
+        int32 index;               //!< The index of the \a cooked_buffer_view or \a cooked_texture.
+        bool standard_color_space; //!< Textures only: True if the texture is in standard color space, else false.
+        int64 byte_size;           //!< The number of bytes uploaded.
+    };
+
+    //! \brief The gpu resources of a \a cooked_model.
+    struct model_gpu_resources
+    {
+        std::map<int, buffer_ptr> buffers;             //!< The buffers mapped by their buffer view index.
+        std::map<int, vertex_array_ptr> vertex_arrays; //!< The vertex arrays mapped by the buffer view index of their vertex buffer.
+        std::map<int, texture_ptr> textures;           //!< The textures mapped by get_model_texture_key().
+    };
+
+    //! \brief Returns the key of a \a cooked_texture in \a model_gpu_resources.
+    //! \details Textures used in standard and in linear color space are uploaded twice.
+    //! \param[in] texture_index The index of the \a cooked_texture.
+    //! \param[in] standard_color_space True if the texture is used in standard color space, else false.
+    //! \return The key of the texture.
+    inline int get_model_texture_key(int32 texture_index, bool standard_color_space)
+    {
+        return texture_index * 2 + (standard_color_space ? 1 : 0);
+    }
+
+    //! \brief A model loaded in the background.
+    //! \details The worker thread loads the \a cooked_model and collects the uploads. Afterwards the scene uploads the data over multiple frames and builds the entities.
+    struct async_model_load
+    {
+        entity root;                       //!< The root entity of the model.
+        string path;                       //!< The path to the gltf file.
+        model_load_state state;            //!< The state of the load. Only accessed by the thread updating the scene.
+        std::thread worker;                //!< The thread loading the model.
+        std::atomic<bool> loaded;          //!< True if the worker is done, then model, valid and uploads can be accessed.
+        bool valid;                        //!< True if the model could be loaded, else false.
+        cooked_model model;                //!< The loaded model.
+        std::vector<model_upload> uploads; //!< All uploads of the model.
+        int32 next_upload;                 //!< The index of the next upload to execute.
+        model_gpu_resources resources;     //!< The gpu resources uploaded so far.
+
+        async_model_load()
+            : state(model_load_state::loading)
+            , loaded(false)
+            , valid(false)
+            , next_upload(0)
+        {
+        }
+
+        ~async_model_load()
+        {
+            if (worker.joinable())
+                worker.join();
+        }
+    };
+
+    //! \brief Collects all gpu uploads required for a \a cooked_model.
+    //! \details Does not access the gpu, so it can be called from any thread.
+    //! \param[in] m The \a cooked_model.
+    //! \param[out] uploads The list to append the uploads to. Buffer views come first, textures are deduplicated.
+    void collect_model_uploads(const cooked_model& m, std::vector<model_upload>& uploads);
+
+    //! \brief Executes a \a model_upload and stores the created resource.
+    //! \details Has to be called on the thread owning the graphics context. The data is uploaded directly from the \a cooked_model memory.
+    //! Vertex buffers also get the vertex array shared by all primitives with their vertex format. The index buffer has to be uploaded before.
+    //! \param[in] m The \a cooked_model.
+    //! \param[in] upload The \a model_upload to execute.
+    //! \param[in,out] resources The \a model_gpu_resources to store the created resource in.
+    void execute_model_upload(const cooked_model& m, const model_upload& upload, model_gpu_resources& resources);
+} // namespace mango
+
+#endif // MANGO_MODEL_LOADING_HPP
@@ -12,8 +12,10 @@
 #include <graphics/vertex_array.hpp>
 #include <mango/scene.hpp>
 #include <rendering/render_system_impl.hpp>
+#include <resources/cooked_model.hpp>
 #include <resources/resource_system.hpp>
 #include <scene/ecs_internal.hpp>
+#include <scene/model_loading.hpp>
 
 using namespace mango;
 
@@ -21,6 +23,8 @@ using namespace mango;
 transformation_update_system transformation_update;
 //! \brief The internal \a ecsystem for scene graph updates.
 scene_graph_update_system scene_graph_update;
+//! \brief The internal \a ecsystem for world space bounds updates.
+bounds_update_system bounds_update;
 //! \brief The internal \a ecsystem for camera updates.
 camera_update_system camera_update;
 //! \brief The internal \a ecsystem for mesh rendering.
@@ -28,17 +32,25 @@ render_mesh_system render_mesh;
 //! \brief The internal \a ecsystem for submitting lights.
 light_submission_system light_submission;
 
-static void update_scene_boundaries(glm::mat4& trafo, tinygltf::Model& m, tinygltf::Mesh& mesh, glm::vec3& min, glm::vec3& max);
-
-scene::scene(const string& name)
-    : m_nodes()
-    , m_transformations()
-    , m_mesh_primitives()
-    , m_materials()
-    , m_cameras()
-    , m_directional_lights()
-    , m_atmosphere_lights()
-    , m_skylights()
+static void update_scene_boundaries(glm::mat4& trafo, const cooked_model& m, const cooked_mesh& mesh, glm::vec3& min, glm::vec3& max);
+static void keep_world_transformation(transform_component& transform);
+
+scene::scene(const string& name, int32 pool_chunk_size)
+    : m_next_entity(1)
+    , m_recomputed_transformations(0)
+    , m_tags(pool_chunk_size)
+    , m_nodes(pool_chunk_size)
+    , m_transformations(pool_chunk_size)
+    , m_models(pool_chunk_size)
+    , m_mesh_primitives(pool_chunk_size)
+    , m_materials(pool_chunk_size)
+    , m_cameras(pool_chunk_size)
+    , m_directional_lights(pool_chunk_size)
+    , m_atmosphere_lights(pool_chunk_size)
+    , m_skylights(pool_chunk_size)
+    , m_mesh_bvh(new bounding_volume_hierarchy())
+    , m_root_entity(invalid_entity)
+    , m_scene_root(invalid_entity)
 {
     PROFILE_ZONE;
     MANGO_UNUSED(name);
@@ -46,9 +58,6 @@ scene::scene(const string& name)
     m_scene_boundaries.max = glm::vec3(-3.402823e+38f);
     m_scene_boundaries.min = glm::vec3(3.402823e+38f);
 
-    for (uint32 i = 1; i <= max_entities; ++i)
-        m_free_entities.push_back(i);
-
     m_root_entity           = create_empty();
     auto tag_component      = m_tags.get_component_for_entity(m_root_entity);
     tag_component->tag_name = "Root";
@@ -63,12 +72,20 @@ scene::~scene() {}
 entity scene::create_empty()
 {
     PROFILE_ZONE;
-    MANGO_ASSERT(!m_free_entities.empty(), "Reached maximum number of entities!");
-    entity new_entity = m_free_entities.front();
+    entity new_entity;
+    if (!m_free_entities.empty())
+    {
+        new_entity = m_free_entities.front();
+        m_free_entities.pop_front();
+    }
+    else
+    {
+        MANGO_ASSERT(m_next_entity != invalid_entity, "Reached maximum number of entities!");
+        new_entity = m_next_entity++;
+    }
     if (m_scene_root != invalid_entity)
         attach(new_entity, m_scene_root);
-    m_free_entities.pop_front();
-    MANGO_LOG_DEBUG("Created entity {0}, {1} left", new_entity, m_free_entities.size());
+    MANGO_LOG_DEBUG("Created entity {0}, {1} free", new_entity, m_free_entities.size());
     m_tags.create_component_for(new_entity);
     return new_entity;
 }
@@ -101,7 +118,38 @@ void scene::remove_entity(entity e)
     m_atmosphere_lights.remove_component_from(e);
     m_skylights.remove_component_from(e);
     m_free_entities.push_back(e);
-    MANGO_LOG_DEBUG("Removed entity {0}, {1} left", e, m_free_entities.size());
+    MANGO_LOG_DEBUG("Removed entity {0}, {1} free", e, m_free_entities.size());
+}
+
+std::vector<component_pool_memory_info> scene::get_component_pool_memory_info() const
+{
+    std::vector<component_pool_memory_info> result;
+    result.push_back(m_tags.get_memory_info());
+    result.push_back(m_nodes.get_memory_info());
+    result.push_back(m_transformations.get_memory_info());
+    result.push_back(m_models.get_memory_info());
+    result.push_back(m_mesh_primitives.get_memory_info());
+    result.push_back(m_materials.get_memory_info());
+    result.push_back(m_cameras.get_memory_info());
+    result.push_back(m_directional_lights.get_memory_info());
+    result.push_back(m_atmosphere_lights.get_memory_info());
+    result.push_back(m_skylights.get_memory_info());
+    return result;
+}
+
+void scene::shrink_component_pools()
+{
+    PROFILE_ZONE;
+    m_tags.shrink_to_fit();
+    m_nodes.shrink_to_fit();
+    m_transformations.shrink_to_fit();
+    m_models.shrink_to_fit();
+    m_mesh_primitives.shrink_to_fit();
+    m_materials.shrink_to_fit();
+    m_cameras.shrink_to_fit();
+    m_directional_lights.shrink_to_fit();
+    m_atmosphere_lights.shrink_to_fit();
+    m_skylights.shrink_to_fit();
 }
 
 entity scene::create_default_scene_camera()
@@ -146,6 +194,56 @@ entity scene::create_default_camera()
 }
 
 entity scene::create_entities_from_model(const string& path, entity gltf_root)
+{
+    PROFILE_ZONE;
+    gltf_root = create_model_root(path, gltf_root);
+    cooked_model m;
+    if (!m.load(path))
+        return invalid_entity;
+
+    // upload everything at once.
+    std::vector<model_upload> uploads;
+    collect_model_uploads(m, uploads);
+    model_gpu_resources resources;
+    for (const model_upload& upload : uploads)
+        execute_model_upload(m, upload, resources);
+
+    return build_model(m, gltf_root, resources) ? gltf_root : invalid_entity;
+}
+
+entity scene::create_entities_from_model_async(const string& path, entity gltf_root)
+{
+    PROFILE_ZONE;
+    gltf_root = create_model_root(path, gltf_root);
+
+    unique_ptr<async_model_load> load = mango::make_unique<async_model_load>();
+    load->root                        = gltf_root;
+    load->path                        = path;
+
+    async_model_load* worker_load = load.get();
+
+    load->worker = std::thread([worker_load]() {
+        worker_load->valid = worker_load->model.load(worker_load->path);
+        if (worker_load->valid)
+            collect_model_uploads(worker_load->model, worker_load->uploads);
+        worker_load->loaded.store(true, std::memory_order_release);
+    });
+
+    m_model_loads.push_back(std::move(load));
+    return gltf_root;
+}
+
+model_load_state scene::get_model_load_state(entity gltf_root) const
+{
+    for (const unique_ptr<async_model_load>& load : m_model_loads)
+    {
+        if (load->root == gltf_root)
+            return load->state;
+    }
+    return m_models.contains(gltf_root) ? model_load_state::finished : model_load_state::failed;
+}
+
+entity scene::create_model_root(const string& path, entity gltf_root)
 {
     PROFILE_ZONE;
     if (gltf_root == invalid_entity)
@@ -153,73 +251,45 @@ entity scene::create_entities_from_model(const string& path, entity gltf_root)
         gltf_root = create_empty();
     }
 
-    auto& model_comp                = m_models.create_component_for(gltf_root);
-    model_comp.model_file_path      = path;
-    shared_ptr<resource_system> res = m_shared_context->get_resource_system_internal().lock();
-    MANGO_ASSERT(res, "Resource System is expired!");
+    // A model still loading into the root is dropped.
+    for (unique_ptr<async_model_load>& load : m_model_loads)
+    {
+        if (load->root == gltf_root)
+            load->root = invalid_entity;
+    }
+
+    auto& model_comp                                     = m_models.create_component_for(gltf_root);
+    model_comp.model_file_path                           = path;
     auto start                                           = path.find_last_of("\\/") + 1;
-    auto name                                            = path.substr(start, path.find_last_of(".") - start);
     m_tags.get_component_for_entity(gltf_root)->tag_name = path.substr(start);
-    model_resource_configuration config;
-    config.path                  = path.c_str();
-    const model_resource* loaded = res->acquire(config);
-    if (!loaded)
-        return invalid_entity;
-
-    tinygltf::Model& m = const_cast<model_resource*>(loaded)->gltf_model;
+    return gltf_root;
+}
 
-    // load the default scene or the first one.
+bool scene::build_model(const cooked_model& m, entity gltf_root, const model_gpu_resources& resources)
+{
+    PROFILE_ZONE;
     glm::vec3 max_backup   = m_scene_boundaries.max;
     glm::vec3 min_backup   = m_scene_boundaries.min;
     m_scene_boundaries.max = glm::vec3(-3.402823e+38f);
     m_scene_boundaries.min = glm::vec3(3.402823e+38f);
-    if (m.scenes.size() <= 0)
-    {
-        MANGO_LOG_DEBUG("No scenes in the gltf model found! Can not load invalid gltf.");
-        return invalid_entity;
-    }
-
-    // load all model buffer views into buffers.
-    std::map<int, buffer_ptr> index_to_buffer_data;
-
-    for (int32 i = 0; i < static_cast<int32>(m.bufferViews.size()); ++i)
-    {
-        const tinygltf::BufferView& buffer_view = m.bufferViews[i];
-        if (buffer_view.target == 0)
-        {
-            MANGO_LOG_WARN("Buffer view target is zero!"); // We can continue here.
-        }
 
-        const tinygltf::Buffer& t_buffer = m.buffers[buffer_view.buffer];
-
-        buffer_configuration buffer_config;
-        buffer_config.access = buffer_access::none;
-        buffer_config.size   = buffer_view.byteLength;
-        buffer_config.target = (buffer_view.target == 0 || buffer_view.target == GL_ARRAY_BUFFER) ? buffer_target::vertex_buffer : buffer_target::index_buffer;
-
-        const unsigned char* buffer_start = t_buffer.data.data() + buffer_view.byteOffset;
-        const void* buffer_data           = static_cast<const void*>(buffer_start);
-        buffer_config.data                = buffer_data;
-        buffer_ptr buf                    = buffer::create(buffer_config);
-        // TODO Paul: Interleaved buffers could be loaded two times ... BAD.
-
-        index_to_buffer_data.insert({ i, buf });
-    }
-
-    int scene_id                 = m.defaultScene > -1 ? m.defaultScene : 0;
-    const tinygltf::Scene& scene = m.scenes[scene_id];
-    for (int32 i = 0; i < static_cast<int32>(scene.nodes.size()); ++i)
+    int32 scene_node_count;
+    const int32* scene_nodes = m.get_scene_nodes(scene_node_count);
+    for (int32 i = 0; i < scene_node_count; ++i)
     {
-        entity node = build_model_node(m, m.nodes.at(scene.nodes.at(i)), glm::mat4(1.0), index_to_buffer_data);
+        MANGO_ASSERT(scene_nodes[i] >= 0 && scene_nodes[i] < m.count(cooked_table::nodes), "Invalid cooked node!");
+        entity node = build_model_node(m, scene_nodes[i], glm::mat4(1.0), resources);
 
         attach(node, gltf_root);
     }
 
     // normalize scale
-    const glm::vec3 scale                                        = glm::vec3(10.0f / (glm::compMax(m_scene_boundaries.max - m_scene_boundaries.min)));
-    m_transformations.get_component_for_entity(gltf_root)->scale = scale;
-    model_comp.min_extends                                       = m_scene_boundaries.min;
-    model_comp.max_extends                                       = m_scene_boundaries.max;
+    auto& model_comp                                               = *m_models.get_component_for_entity(gltf_root);
+    const glm::vec3 scale                                          = glm::vec3(10.0f / (glm::compMax(m_scene_boundaries.max - m_scene_boundaries.min)));
+    m_transformations.get_component_for_entity(gltf_root)->scale   = scale;
+    m_transformations.get_component_for_entity(gltf_root)->changed = true;
+    model_comp.min_extends                                         = m_scene_boundaries.min;
+    model_comp.max_extends                                         = m_scene_boundaries.max;
 
     if (m_active.camera == invalid_entity)
     {
@@ -233,8 +303,58 @@ entity scene::create_entities_from_model(const string& path, entity gltf_root)
     m_scene_boundaries.min =
         glm::min(m_scene_boundaries.min, min_backup); // TODO Paul: This is just in case all other assets are still here, we need to do the calculation with all still existing entities.
 
-    res->release(loaded);
-    return gltf_root;
+    return true;
+}
+
+void scene::update_model_loads()
+{
+    PROFILE_ZONE;
+    int64 budget = model_upload_budget;
+    for (auto it = m_model_loads.begin(); it != m_model_loads.end();)
+    {
+        async_model_load& load = **it;
+        if (load.state == model_load_state::loading)
+        {
+            if (!load.loaded.load(std::memory_order_acquire))
+            {
+                ++it;
+                continue;
+            }
+            load.worker.join();
+            load.state = load.valid ? model_load_state::uploading : model_load_state::failed;
+        }
+
+        // The root could have been removed in the meantime.
+        if (!m_models.contains(load.root))
+        {
+            it = m_model_loads.erase(it);
+            continue;
+        }
+
+        if (load.state == model_load_state::uploading)
+        {
+            const int32 upload_count = static_cast<int32>(load.uploads.size());
+            while (load.next_upload < upload_count && budget > 0)
+            {
+                const model_upload& upload = load.uploads[load.next_upload++];
+                execute_model_upload(load.model, upload, load.resources);
+                budget -= upload.byte_size;
+            }
+            if (load.next_upload < upload_count)
+            {
+                ++it;
+                continue;
+            }
+            load.state = build_model(load.model, load.root, load.resources) ? model_load_state::finished : model_load_state::failed;
+        }
+
+        if (load.state == model_load_state::failed)
+        {
+            MANGO_LOG_ERROR("Could not load model from path '{0}'!", load.path);
+            m_models.remove_component_from(load.root);
+        }
+        it = m_model_loads.erase(it);
+    }
 }
 
 entity scene::create_skylight_from_hdr(const string& path)
@@ -316,10 +436,29 @@ entity scene::create_skylight_from_hdr(const string& path)
 void scene::update(float dt)
 {
     PROFILE_ZONE;
-    MANGO_UNUSED(dt);
-    transformation_update.execute(dt, m_transformations);
-    scene_graph_update.execute(dt, m_nodes, m_transformations);
-    camera_update.execute(dt, m_cameras, m_transformations);
+    update_model_loads();
+
+    shared_ptr<job_system> jobs = m_shared_context ? m_shared_context->get_job_system_internal().lock() : nullptr;
+    transformation_update.setup(jobs.get());
+    bounds_update.setup(jobs.get());
+    if (!m_hierarchy_changes.empty())
+    {
+        NAMED_PROFILE_ZONE("Hierarchy Splice");
+        splice_hierarchy(m_nodes, m_hierarchy_changes, m_hierarchy);
+        m_hierarchy_changes.clear();
+    }
+    scene_graph_update.setup(&m_hierarchy.nodes);
+
+    // The bounds and camera updates only read the transformations, so they run concurrently.
+    std::vector<scheduled_system> systems = {
+        { transformation_update_system::get_access(), [this, dt]() { transformation_update.execute(dt, m_transformations); } },
+        { scene_graph_update_system::get_access(), [this, dt]() { scene_graph_update.execute(dt, m_nodes, m_transformations); } },
+        { bounds_update_system::get_access(), [this, dt]() { bounds_update.execute(dt, m_mesh_primitives, m_transformations); } },
+        { camera_update_system::get_access(), [this, dt]() { camera_update.execute(dt, m_cameras, m_transformations); } },
+    };
+    execute_systems(jobs.get(), systems);
+
+    m_recomputed_transformations = transformation_update.get_recomputed_count() + scene_graph_update.get_recomputed_count();
 }
 
 void scene::render()
@@ -330,10 +469,48 @@ void scene::render()
 
     light_submission.setup(rs);
     light_submission.execute(0.0f, m_directional_lights, m_atmosphere_lights, m_skylights);
-    render_mesh.setup(rs);
+    update_mesh_bvh();
+    render_mesh.setup(rs, get_active_camera_data(), m_mesh_bvh.get());
     render_mesh.execute(0.0f, m_mesh_primitives, m_materials, m_transformations);
 }
 
+entity scene::pick(const glm::vec3& origin, const glm::vec3& direction)
+{
+    PROFILE_ZONE;
+    update_mesh_bvh();
+    float distance;
+    int32 item = m_mesh_bvh->intersect_ray(origin, direction, distance);
+    return item < 0 ? invalid_entity : m_mesh_primitives.entity_at(item);
+}
+
+void scene::update_mesh_bvh()
+{
+    PROFILE_ZONE;
+    const int32 count = static_cast<int32>(m_mesh_primitives.size());
+    bool build        = count != m_mesh_bvh->size();
+    for (int32 i = 0; i < count && !build; ++i)
+        build = m_mesh_bvh_entities[i] != m_mesh_primitives.entity_at(i);
+
+    if (!build)
+    {
+        // Only primitives with recomputed world bounds changed.
+        for (int32 i = 0; i < count; ++i)
+            m_mesh_bvh->update(i, m_mesh_primitives.component_at(i).world_bounds);
+        if (m_mesh_bvh->refit())
+            return;
+    }
+
+    NAMED_PROFILE_ZONE("Mesh Hierarchy Build");
+    std::vector<axis_aligned_bounding_box> bounds(static_cast<ptr_size>(count));
+    m_mesh_bvh_entities.resize(static_cast<ptr_size>(count));
+    for (int32 i = 0; i < count; ++i)
+    {
+        bounds[i]              = m_mesh_primitives.component_at(i).world_bounds;
+        m_mesh_bvh_entities[i] = m_mesh_primitives.entity_at(i);
+    }
+    m_mesh_bvh->build(bounds.data(), count);
+}
+
 void scene::attach(entity child, entity parent)
 {
     PROFILE_ZONE;
@@ -346,6 +523,7 @@ void scene::attach(entity child, entity parent)
     {
         m_nodes.create_component_for(parent);
         parent_node = m_nodes.get_component_for_entity(parent);
+        m_hierarchy_changes.push_back(parent);
     }
     node_component* child_node = m_nodes.get_component_for_entity(child, true);
     if (nullptr == child_node)
@@ -374,27 +552,7 @@ void scene::attach(entity child, entity parent)
     }
     parent_node->children_count++;
 
-    // reorder subtrees if necessary
-    if (m_nodes.size() > 1)
-    {
-        NAMED_PROFILE_ZONE("Reordering on entity attachment");
-        m_nodes.for_each(
-            [this](node_component, int32& index) {
-                entity possible_parent = m_nodes.entity_at(index);
-                for (int32 j = 0; j < index; ++j)
-                {
-                    const node_component& possible_child = m_nodes.component_at(j);
-
-                    if (possible_child.parent_entity == possible_parent)
-                    {
-                        m_nodes.move(index, j);
-                        ++index;
-                        break;
-                    }
-                }
-            },
-            true);
-    }
+    m_hierarchy_changes.push_back(child);
 
     transform_component* parent_transform = m_transformations.get_component_for_entity(parent);
     if (nullptr == parent_transform)
@@ -403,6 +561,8 @@ void scene::attach(entity child, entity parent)
     transform_component* child_transform = m_transformations.get_component_for_entity(child);
     if (nullptr == child_transform)
         m_transformations.create_component_for(child); // create transform component for child if non-existent
+    else
+        child_transform->changed = true; // the world transformation changes with the new parent
 }
 
 void scene::detach(entity node)
@@ -421,7 +581,7 @@ void scene::detach(entity node)
     if (nullptr != child_transform)
     {
         // Add transformation from parent before removing the parent
-        child_transform->local_transformation_matrix = child_transform->world_transformation_matrix;
+        keep_world_transformation(*child_transform);
     }
 
     node_component* parent_node = m_nodes.get_component_for_entity(child_node->parent_entity);
@@ -458,13 +618,22 @@ void scene::detach(entity node)
         }
     }
     parent_node->children_count--;
-    child_node->parent_entity = invalid_entity;
-
+    const entity parent          = child_node->parent_entity;
+    const bool remove_parent     = parent_node->children_count == 0 && parent_node->parent_entity == invalid_entity;
+    child_node->parent_entity    = invalid_entity;
+    child_node->next_sibling     = invalid_entity;
+    child_node->previous_sibling = invalid_entity;
+    m_hierarchy_changes.push_back(node);
+
+    // Removing components moves others in the pool, so the node pointers are not used afterwards.
     if (child_node->children_count == 0)
-        m_nodes.sort_remove_component_from(node); // Sorting necessarry?
+        m_nodes.remove_component_from(node);
 
-    if (parent_node->children_count == 0 && parent_node->parent_entity == invalid_entity)
-        m_nodes.sort_remove_component_from(child_node->parent_entity); // Sorting necessarry?
+    if (remove_parent)
+    {
+        m_nodes.remove_component_from(parent);
+        m_hierarchy_changes.push_back(parent);
+    }
 }
 
 void scene::delete_node(entity node)
@@ -483,12 +652,13 @@ void scene::delete_node(entity node)
     if (nullptr != child_transform)
     {
         // Add transformation from parent before removing the parent
-        child_transform->local_transformation_matrix = child_transform->world_transformation_matrix;
+        keep_world_transformation(*child_transform);
     }
 
     auto children_entity = child_node->child_entities;
     for (int32 i = 0; i < child_node->children_count; ++i)
     {
+        m_hierarchy_changes.push_back(children_entity); // the children become roots
         auto children_node              = m_nodes.get_component_for_entity(children_entity);
         children_entity                 = children_node->next_sibling;
         children_node->parent_entity    = invalid_entity;
@@ -535,84 +705,70 @@ void scene::delete_node(entity node)
         }
     }
     parent_node->children_count--;
+    const entity parent      = child_node->parent_entity;
+    const bool remove_parent = parent_node->children_count == 0 && parent_node->parent_entity == invalid_entity;
+    m_hierarchy_changes.push_back(node);
 
-    m_nodes.sort_remove_component_from(node); // Sorting necessary?
+    m_nodes.remove_component_from(node);
 
-    if (parent_node->children_count == 0 && parent_node->parent_entity == invalid_entity)
-        m_nodes.sort_remove_component_from(child_node->parent_entity); // Sorting necessary?
+    if (remove_parent)
+    {
+        m_nodes.remove_component_from(parent);
+        m_hierarchy_changes.push_back(parent);
+    }
 }
 
-entity scene::build_model_node(tinygltf::Model& m, tinygltf::Node& n, const glm::mat4& parent_world, const std::map<int, buffer_ptr>& buffer_map)
+entity scene::build_model_node(const cooked_model& m, int32 node_index, const glm::mat4& parent_world, const model_gpu_resources& resources)
 {
     PROFILE_ZONE;
+    const cooked_node& n                            = m.get<cooked_node>(cooked_table::nodes)[node_index];
     entity node                                     = create_empty();
-    m_tags.get_component_for_entity(node)->tag_name = n.name;
+    m_tags.get_component_for_entity(node)->tag_name = m.get_name(n.name);
     auto& transform                                 = m_transformations.create_component_for(node);
-    if (n.matrix.size() == 16)
-    {
-        glm::mat4 input = glm::make_mat4(n.matrix.data());
-        glm::vec3 s;
-        glm::vec4 p;
-        glm::decompose(input, transform.scale, transform.rotation, transform.position, s, p);
-    }
-    else
-    {
-        if (n.translation.size() == 3)
-        {
-            transform.position = glm::vec3(n.translation[0], n.translation[1], n.translation[2]);
-        }
-        if (n.rotation.size() == 4)
-        {
-            transform.rotation = glm::quat(static_cast<float>(n.rotation[3]), static_cast<float>(n.rotation[0]), static_cast<float>(n.rotation[1]), static_cast<float>(n.rotation[2]));
-        }
-        if (n.scale.size() == 3)
-        {
-            transform.scale = glm::vec3(n.scale[0], n.scale[1], n.scale[2]);
-        }
-    }
-
-    transform.rotation_hint = glm::degrees(glm::eulerAngles(transform.rotation));
-    glm::mat4 trafo         = glm::translate(glm::mat4(1.0), transform.position);
-    trafo                   = trafo * glm::toMat4(transform.rotation);
-    trafo                   = glm::scale(trafo, transform.scale);
+    transform.position                              = glm::make_vec3(n.position);
+    transform.rotation                              = glm::quat(n.rotation[3], n.rotation[0], n.rotation[1], n.rotation[2]);
+    transform.scale                                 = glm::make_vec3(n.scale);
 
-    trafo = parent_world * trafo;
+    glm::mat4 trafo = parent_world * glm::mat4(compose_transformation(transform.position, transform.rotation, transform.scale));
 
     if (n.mesh > -1)
     {
-        MANGO_ASSERT(n.mesh < static_cast<int32>(m.meshes.size()), "Invalid gltf mesh!");
-        build_model_mesh(node, m, m.meshes.at(n.mesh), buffer_map);
-        update_scene_boundaries(trafo, m, m.meshes.at(n.mesh), m_scene_boundaries.min, m_scene_boundaries.max);
+        MANGO_ASSERT(n.mesh < m.count(cooked_table::meshes), "Invalid cooked mesh!");
+        build_model_mesh(node, m, n.mesh, resources);
+        update_scene_boundaries(trafo, m, m.get<cooked_mesh>(cooked_table::meshes)[n.mesh], m_scene_boundaries.min, m_scene_boundaries.max);
     }
 
     if (n.camera > -1)
     {
-        MANGO_ASSERT(n.camera < static_cast<int32>(m.cameras.size()), "Invalid gltf camera!");
-        build_model_camera(node, m.cameras.at(n.camera));
+        MANGO_ASSERT(n.camera < m.count(cooked_table::cameras), "Invalid cooked camera!");
+        build_model_camera(node, m.get<cooked_camera>(cooked_table::cameras)[n.camera]);
     }
 
     // build child nodes.
-    for (int32 i = 0; i < static_cast<int32>(n.children.size()); ++i)
+    const int32* children = m.get<int32>(cooked_table::node_indices) + n.first_child;
+    for (int32 i = 0; i < n.child_count; ++i)
     {
-        MANGO_ASSERT(n.children[i] < static_cast<int32>(m.nodes.size()), "Invalid gltf node!");
+        MANGO_ASSERT(children[i] >= 0 && children[i] < m.count(cooked_table::nodes), "Invalid cooked node!");
 
-        entity child = build_model_node(m, m.nodes.at(n.children.at(i)), trafo, buffer_map);
+        entity child = build_model_node(m, children[i], trafo, resources);
         attach(child, node);
     }
 
     return node;
 }
 
-void scene::build_model_mesh(entity node, tinygltf::Model& m, tinygltf::Mesh& mesh, const std::map<int, buffer_ptr>& buffer_map)
+void scene::build_model_mesh(entity node, const cooked_model& m, int32 mesh_index, const model_gpu_resources& resources)
 {
     PROFILE_ZONE;
+    const cooked_mesh& mesh            = m.get<cooked_mesh>(cooked_table::meshes)[mesh_index];
+    const cooked_primitive* primitives = m.get<cooked_primitive>(cooked_table::primitives) + mesh.first_primitive;
 
-    for (int32 i = 0; i < static_cast<int32>(mesh.primitives.size()); ++i)
+    for (int32 i = 0; i < mesh.primitive_count; ++i)
     {
-        const tinygltf::Primitive& primitive = mesh.primitives[i];
+        const cooked_primitive& primitive = primitives[i];
 
         entity mesh_primitive_node = node;
-        if (mesh.primitives.size() > 1)
+        if (mesh.primitive_count > 1)
         {
             mesh_primitive_node = create_empty();
             // If this is the case this does not really have a name by default. We try give them namess by their materials later.
@@ -622,34 +778,26 @@ void scene::build_model_mesh(entity node, tinygltf::Model& m, tinygltf::Mesh& me
 
         auto& mesh_p = m_mesh_primitives.create_component_for(mesh_primitive_node);
 
-        mesh_p.vertex_array_object = vertex_array::create();
-        mesh_p.tp                  = mesh_primitive_type::custom;
-        mesh_p.topology            = static_cast<primitive_topology>(primitive.mode); // cast is okay.
-        mesh_p.instance_count      = 1;
-        bool has_indices           = true;
-
-        if (primitive.indices >= 0)
+        mesh_p.tp             = mesh_primitive_type::custom;
+        mesh_p.topology       = static_cast<primitive_topology>(primitive.topology); // cast is okay.
+        mesh_p.instance_count = 1;
+        mesh_p.first          = primitive.first;
+        mesh_p.count          = primitive.count;
+        mesh_p.base_vertex    = primitive.base_vertex;
+        mesh_p.type_index     = static_cast<index_type>(primitive.index_type);
+        mesh_p.has_normals    = primitive.has_normals != 0;
+        mesh_p.has_tangents   = primitive.has_tangents != 0;
+        if (primitive.has_bounds)
         {
-            const tinygltf::Accessor& index_accessor = m.accessors[primitive.indices];
-
-            mesh_p.first      = static_cast<int32>(index_accessor.byteOffset); // TODO Paul: Is int32 big enough?
-            mesh_p.count      = static_cast<int32>(index_accessor.count);      // TODO Paul: Is int32 big enough?
-            mesh_p.type_index = static_cast<index_type>(index_accessor.componentType);
-
-            auto it = buffer_map.find(index_accessor.bufferView);
-            if (it == buffer_map.end())
-            {
-                MANGO_LOG_ERROR("No buffer data for index bufferView {0}!", index_accessor.bufferView);
-                continue;
-            }
-            mesh_p.vertex_array_object->bind_index_buffer(it->second);
+            mesh_p.local_bounds.min = glm::make_vec3(primitive.bounds_min);
+            mesh_p.local_bounds.max = glm::make_vec3(primitive.bounds_max);
         }
-        else
+
+        // Non indexed primitives start at their first vertex in the shared vertex buffer.
+        if (primitive.index_buffer_view < 0)
         {
-            mesh_p.first      = 0;
-            mesh_p.type_index = index_type::none;
-            // p.count has to be set later.
-            has_indices = false;
+            mesh_p.first       = primitive.base_vertex;
+            mesh_p.base_vertex = 0;
         }
 
         auto& mat                          = m_materials.create_component_for(mesh_primitive_node);
@@ -658,104 +806,57 @@ void scene::build_model_mesh(entity node, tinygltf::Model& m, tinygltf::Mesh& me
         mat.component_material->metallic   = 0.0f;
         mat.component_material->roughness  = 1.0f;
 
-        load_material(mat, primitive, m);
+        load_material(mat, m, primitive.material, resources);
 
         if (!mat.material_name.empty() && node != mesh_primitive_node)
             m_tags.get_component_for_entity(mesh_primitive_node)->tag_name = mat.material_name + " Part";
 
-        int32 vb_idx        = 0;
-        mesh_p.has_normals  = false;
-        mesh_p.has_tangents = false;
-
-        for (auto& attrib : primitive.attributes)
+        // All primitives with the same vertex format share one vertex array, so their draws can be batched.
+        auto it = resources.vertex_arrays.find(primitive.vertex_buffer_view);
+        if (it == resources.vertex_arrays.end())
         {
-            const tinygltf::Accessor& accessor = m.accessors[attrib.second];
-            if (accessor.sparse.isSparse)
-            {
-                MANGO_LOG_ERROR("Models with sparse accessors are currently not supported! Undefined behavior!");
-                return;
-            }
-
-            format attribute_format = get_attribute_format(static_cast<format>(accessor.componentType), accessor.type % 32); // TODO Paul: Type is not handled properly here.
-
-            int attrib_array = -1;
-            if (attrib.first.compare("POSITION") == 0)
-                attrib_array = 0;
-            if (attrib.first.compare("NORMAL") == 0)
-            {
-                mesh_p.has_normals = true;
-                attrib_array       = 1;
-            }
-            if (attrib.first.compare("TEXCOORD_0") == 0)
-                attrib_array = 2;
-            if (attrib.first.compare("TANGENT") == 0)
-            {
-                mesh_p.has_tangents = true;
-                attrib_array        = 3;
-            }
-            if (attrib_array > -1)
-            {
-                auto it = buffer_map.find(accessor.bufferView);
-                if (it == buffer_map.end())
-                {
-                    MANGO_LOG_ERROR("No buffer data for bufferView {0}!", accessor.bufferView);
-                    continue;
-                }
-                int32 stride = accessor.ByteStride(m.bufferViews[accessor.bufferView]);
-                MANGO_ASSERT(stride > 0, "Broken gltf model! Attribute stride is {0}!", stride);
-                mesh_p.vertex_array_object->bind_vertex_buffer(vb_idx, it->second, accessor.byteOffset, stride);
-                mesh_p.vertex_array_object->set_vertex_attribute(attrib_array, vb_idx, attribute_format, 0);
-
-                if (attrib_array == 0 && !has_indices)
-                {
-                    mesh_p.count = static_cast<int32>(accessor.count); // TODO Paul: Is int32 big enough?
-                }
-
-                vb_idx++;
-            }
-            else
-            {
-                MANGO_LOG_DEBUG("Vertex attribute array is ignored: {0}!", attrib.first);
-            }
+            MANGO_LOG_ERROR("No vertex array for vertex bufferView {0}!", primitive.vertex_buffer_view);
+            mesh_p.vertex_array_object = vertex_array::create();
+            continue;
         }
+        mesh_p.vertex_array_object = it->second;
     }
 }
 
-void scene::build_model_camera(entity node, tinygltf::Camera& camera)
+void scene::build_model_camera(entity node, const cooked_camera& camera)
 {
     PROFILE_ZONE;
     auto& component_camera    = m_cameras.create_component_for(node);
-    component_camera.cam_type = camera.type == "perspective" ? camera_type::perspective_camera : camera_type::orthographic_camera;
+    component_camera.cam_type = static_cast<camera_type>(camera.type);
+    component_camera.z_near   = camera.z_near;
+    component_camera.z_far    = camera.z_far;
     if (component_camera.cam_type == camera_type::perspective_camera)
     {
-        component_camera.z_near                             = static_cast<float>(camera.perspective.znear);
-        component_camera.z_far                              = camera.perspective.zfar > 0.0 ? static_cast<float>(camera.perspective.zfar) : 10000.0f; // Infinite?
-        component_camera.perspective.vertical_field_of_view = static_cast<float>(camera.perspective.yfov);
-        component_camera.perspective.aspect                 = camera.perspective.aspectRatio > 0.0 ? static_cast<float>(camera.perspective.aspectRatio) : 16.0f / 9.0f;
+        component_camera.perspective.vertical_field_of_view = camera.x;
+        component_camera.perspective.aspect                 = camera.y;
     }
     else // orthographic
     {
-        component_camera.z_near             = static_cast<float>(camera.orthographic.znear);
-        component_camera.z_far              = camera.perspective.zfar > 0.0 ? static_cast<float>(camera.perspective.zfar) : 10000.0f; // Infinite?
-        component_camera.orthographic.x_mag = static_cast<float>(camera.orthographic.xmag);
-        component_camera.orthographic.y_mag = static_cast<float>(camera.orthographic.ymag);
+        component_camera.orthographic.x_mag = camera.x;
+        component_camera.orthographic.y_mag = camera.y;
     }
 }
 
-void scene::load_material(material_component& material, const tinygltf::Primitive& primitive, tinygltf::Model& m)
+void scene::load_material(material_component& material, const cooked_model& m, int32 material_index, const model_gpu_resources& resources)
 {
     PROFILE_ZONE;
-    if (primitive.material < 0)
+    if (material_index < 0)
         return;
 
-    const tinygltf::Material& p_m = m.materials[primitive.material];
-    if (!p_m.name.empty())
+    MANGO_ASSERT(material_index < m.count(cooked_table::materials), "Invalid cooked material!");
+    const cooked_material& p_m = m.get<cooked_material>(cooked_table::materials)[material_index];
+    material.material_name     = m.get_name(p_m.name);
+    if (!material.material_name.empty())
     {
-        MANGO_LOG_DEBUG("Loading material: {0}", p_m.name.c_str());
+        MANGO_LOG_DEBUG("Loading material: {0}", material.material_name.c_str());
     }
 
-    material.material_name                    = p_m.name;
-    material.component_material->double_sided = p_m.doubleSided;
+    material.component_material->double_sided = p_m.double_sided != 0;
 
     material.component_material->use_base_color_texture         = false;
     material.component_material->use_roughness_metallic_texture = false;
@@ -764,98 +865,45 @@ void scene::load_material(material_component& material, const tinygltf::Primitiv
     material.component_material->use_emissive_color_texture     = false;
     material.component_material->use_packed_occlusion           = false;
 
-    auto& pbr = p_m.pbrMetallicRoughness;
+    // The textures are already uploaded, textures without image data are missing.
+    auto find_texture = [&resources](int32 texture_index, bool standard_color_space) -> texture_ptr {
+        auto it = resources.textures.find(get_model_texture_key(texture_index, standard_color_space));
+        return it == resources.textures.end() ? nullptr : it->second;
+    };
 
-    // TODO Paul: Better structure?!
-
-    texture_configuration config;
-    config.generate_mipmaps        = 1;
-    config.is_standard_color_space = true;
-    config.texture_min_filter      = texture_parameter::filter_linear_mipmap_linear;
-    config.texture_mag_filter      = texture_parameter::filter_linear;
-    config.texture_wrap_s          = texture_parameter::wrap_repeat;
-    config.texture_wrap_t          = texture_parameter::wrap_repeat;
-
-    if (pbr.baseColorTexture.index < 0)
+    if (p_m.base_color_texture < 0)
     {
-        auto col                                = pbr.baseColorFactor;
-        material.component_material->base_color = glm::vec4((float)col[0], (float)col[1], (float)col[2], (float)col[3]);
+        material.component_material->base_color = glm::make_vec4(p_m.base_color);
     }
     else
     {
         material.component_material->use_base_color_texture = true;
         // base color
-        const tinygltf::Texture& base_col = m.textures.at(pbr.baseColorTexture.index);
-
-        if (base_col.source < 0)
+        texture_ptr base_color = find_texture(p_m.base_color_texture, true);
+        if (!base_color)
             return;
-
-        const tinygltf::Image& image = m.images[static_cast<g_enum>(base_col.source)];
-
-        if (base_col.sampler >= 0)
-        {
-            const tinygltf::Sampler& sampler = m.samplers[static_cast<g_enum>(base_col.sampler)];
-            config.texture_min_filter        = filter_parameter_from_gl(static_cast<g_enum>(sampler.minFilter));
-            config.texture_mag_filter        = filter_parameter_from_gl(static_cast<g_enum>(sampler.magFilter));
-            config.texture_wrap_s            = wrap_parameter_from_gl(static_cast<g_enum>(sampler.wrapS));
-            config.texture_wrap_t            = wrap_parameter_from_gl(static_cast<g_enum>(sampler.wrapT));
-        }
-
-        config.is_standard_color_space = true;
-        config.generate_mipmaps        = calculate_mip_count(image.width, image.height);
-        texture_ptr base_color         = texture::create(config);
-
-        format f;
-        format internal;
-        format type;
-        get_formats_and_types_for_image(config.is_standard_color_space, image.component, image.bits, f, internal, type, false);
-
-        base_color->set_data(internal, image.width, image.height, f, type, &image.image.at(0));
         material.component_material->base_color_texture = base_color;
     }
 
     // metallic / roughness
-    if (pbr.metallicRoughnessTexture.index < 0)
+    if (p_m.metallic_roughness_texture < 0)
     {
-        material.component_material->metallic  = static_cast<float>(pbr.metallicFactor);
-        material.component_material->roughness = static_cast<float>(pbr.roughnessFactor);
+        material.component_material->metallic  = p_m.metallic;
+        material.component_material->roughness = p_m.roughness;
     }
     else
     {
         material.component_material->use_roughness_metallic_texture = true;
-        const tinygltf::Texture& o_r_m_t                            = m.textures.at(pbr.metallicRoughnessTexture.index);
-
-        if (o_r_m_t.source < 0)
+        texture_ptr o_r_m                                           = find_texture(p_m.metallic_roughness_texture, false);
+        if (!o_r_m)
             return;
-
-        const tinygltf::Image& image = m.images[o_r_m_t.source];
-
-        if (o_r_m_t.sampler >= 0)
-        {
-            const tinygltf::Sampler& sampler = m.samplers[o_r_m_t.sampler];
-            config.texture_min_filter        = filter_parameter_from_gl(sampler.minFilter);
-            config.texture_mag_filter        = filter_parameter_from_gl(sampler.magFilter);
-            config.texture_wrap_s            = wrap_parameter_from_gl(sampler.wrapS);
-            config.texture_wrap_t            = wrap_parameter_from_gl(sampler.wrapT);
-        }
-
-        config.is_standard_color_space = false;
-        config.generate_mipmaps        = calculate_mip_count(image.width, image.height);
-        texture_ptr o_r_m              = texture::create(config);
-
-        format f;
-        format internal;
-        format type;
-        get_formats_and_types_for_image(config.is_standard_color_space, image.component, image.bits, f, internal, type, false);
-
-        o_r_m->set_data(internal, image.width, image.height, f, type, &image.image.at(0));
         material.component_material->roughness_metallic_texture = o_r_m;
     }
 
     // occlusion
-    if (p_m.occlusionTexture.index >= 0)
+    if (p_m.occlusion_texture >= 0)
     {
-        if (pbr.metallicRoughnessTexture.index == p_m.occlusionTexture.index)
+        if (p_m.metallic_roughness_texture == p_m.occlusion_texture)
         {
             // occlusion packed into r channel of the roughness and metallic texture.
             material.component_material->use_packed_occlusion = true;
@@ -865,155 +913,60 @@ void scene::load_material(material_component& material, const tinygltf::Primitiv
         {
             material.component_material->use_occlusion_texture = true;
             material.component_material->packed_occlusion      = false;
-            const tinygltf::Texture& occ                       = m.textures.at(p_m.occlusionTexture.index);
-            if (occ.source < 0)
+            texture_ptr occlusion                              = find_texture(p_m.occlusion_texture, false);
+            if (!occlusion)
                 return;
-
-            const tinygltf::Image& image = m.images[occ.source];
-
-            if (occ.sampler >= 0)
-            {
-                const tinygltf::Sampler& sampler = m.samplers[occ.sampler];
-                config.texture_min_filter        = filter_parameter_from_gl(sampler.minFilter);
-                config.texture_mag_filter        = filter_parameter_from_gl(sampler.magFilter);
-                config.texture_wrap_s            = wrap_parameter_from_gl(sampler.wrapS);
-                config.texture_wrap_t            = wrap_parameter_from_gl(sampler.wrapT);
-            }
-
-            config.is_standard_color_space = false;
-            config.generate_mipmaps        = calculate_mip_count(image.width, image.height);
-            texture_ptr occlusion          = texture::create(config);
-
-            format f;
-            format internal;
-            format type;
-            get_formats_and_types_for_image(config.is_standard_color_space, image.component, image.bits, f, internal, type, false);
-
-            occlusion->set_data(internal, image.width, image.height, f, type, &image.image.at(0));
             material.component_material->occlusion_texture = occlusion;
         }
     }
 
     // normal
-    if (p_m.normalTexture.index >= 0)
+    if (p_m.normal_texture >= 0)
     {
         material.component_material->use_normal_texture = true;
-        const tinygltf::Texture& norm                   = m.textures.at(p_m.normalTexture.index);
-
-        if (norm.source < 0)
+        texture_ptr normal_t                            = find_texture(p_m.normal_texture, false);
+        if (!normal_t)
             return;
-
-        const tinygltf::Image& image = m.images[norm.source];
-
-        if (norm.sampler >= 0)
-        {
-            const tinygltf::Sampler& sampler = m.samplers[norm.sampler];
-            config.texture_min_filter        = filter_parameter_from_gl(sampler.minFilter);
-            config.texture_mag_filter        = filter_parameter_from_gl(sampler.magFilter);
-            config.texture_wrap_s            = wrap_parameter_from_gl(sampler.wrapS);
-            config.texture_wrap_t            = wrap_parameter_from_gl(sampler.wrapT);
-        }
-
-        config.is_standard_color_space = false;
-        config.generate_mipmaps        = calculate_mip_count(image.width, image.height);
-        texture_ptr normal_t           = texture::create(config);
-
-        format f;
-        format internal;
-        format type;
-        get_formats_and_types_for_image(config.is_standard_color_space, image.component, image.bits, f, internal, type, false);
-
-        normal_t->set_data(internal, image.width, image.height, f, type, &image.image.at(0));
         material.component_material->normal_texture = normal_t;
     }
 
     // emissive
-    if (p_m.emissiveTexture.index < 0)
+    if (p_m.emissive_texture < 0)
     {
-        auto col                                    = p_m.emissiveFactor;
-        material.component_material->emissive_color = glm::vec3((float)col[0], (float)col[1], (float)col[2]);
+        material.component_material->emissive_color = glm::make_vec3(p_m.emissive_color);
     }
     else
     {
         material.component_material->use_emissive_color_texture = true;
-        const tinygltf::Texture& emissive                       = m.textures.at(p_m.emissiveTexture.index);
-
-        if (emissive.source < 0)
+        texture_ptr emissive_color                              = find_texture(p_m.emissive_texture, true);
+        if (!emissive_color)
             return;
-
-        const tinygltf::Image& image = m.images[emissive.source];
-
-        if (emissive.sampler >= 0)
-        {
-            const tinygltf::Sampler& sampler = m.samplers[emissive.sampler];
-            config.texture_min_filter        = filter_parameter_from_gl(sampler.minFilter);
-            config.texture_mag_filter        = filter_parameter_from_gl(sampler.magFilter);
-            config.texture_wrap_s            = wrap_parameter_from_gl(sampler.wrapS);
-            config.texture_wrap_t            = wrap_parameter_from_gl(sampler.wrapT);
-        }
-
-        config.is_standard_color_space = true;
-        config.generate_mipmaps        = calculate_mip_count(image.width, image.height);
-        texture_ptr emissive_color     = texture::create(config);
-
-        format f;
-        format internal;
-        format type;
-        get_formats_and_types_for_image(config.is_standard_color_space, image.component, image.bits, f, internal, type, false);
-
-        emissive_color->set_data(internal, image.width, image.height, f, type, &image.image.at(0));
         material.component_material->emissive_color_texture = emissive_color;
     }
 
     // transparency
-    if (p_m.alphaMode.compare("OPAQUE") == 0)
-    {
-        material.component_material->alpha_rendering = alpha_mode::mode_opaque;
-        material.component_material->alpha_cutoff    = 1.0f;
-    }
-    if (p_m.alphaMode.compare("MASK") == 0)
-    {
-        material.component_material->alpha_rendering = alpha_mode::mode_mask;
-        material.component_material->alpha_cutoff    = static_cast<float>(p_m.alphaCutoff);
-    }
-    if (p_m.alphaMode.compare("BLEND") == 0)
-    {
-        material.component_material->alpha_rendering = alpha_mode::mode_blend;
-        material.component_material->alpha_cutoff    = 1.0f;
-    }
+    material.component_material->alpha_rendering = static_cast<alpha_mode>(p_m.alpha_rendering);
+    material.component_material->alpha_cutoff    = p_m.alpha_cutoff;
 }
 
-static void update_scene_boundaries(glm::mat4& trafo, tinygltf::Model& m, tinygltf::Mesh& mesh, glm::vec3& min, glm::vec3& max)
+static void update_scene_boundaries(glm::mat4& trafo, const cooked_model& m, const cooked_mesh& mesh, glm::vec3& min, glm::vec3& max)
 {
     PROFILE_ZONE;
-    if (mesh.primitives.empty())
-        return;
-
     glm::vec3 min_a;
     glm::vec3 max_a;
     glm::vec3 center;
     glm::vec3 to_center;
     float radius;
 
-    for (int32 j = 0; j < static_cast<int32>(mesh.primitives.size()); ++j)
+    const cooked_primitive* primitives = m.get<cooked_primitive>(cooked_table::primitives) + mesh.first_primitive;
+    for (int32 j = 0; j < mesh.primitive_count; ++j)
     {
-        const tinygltf::Primitive& primitive = mesh.primitives[j];
-
-        auto attrib = primitive.attributes.find("POSITION");
-        if (attrib == primitive.attributes.end())
+        const cooked_primitive& primitive = primitives[j];
+        if (!primitive.has_bounds)
             continue;
 
-        const tinygltf::Accessor& accessor = m.accessors[attrib->second];
-
-        max_a.x = (float)accessor.maxValues[0];
-        max_a.y = (float)accessor.maxValues[1];
-        max_a.z = (float)accessor.maxValues[2];
-        min_a.x = (float)accessor.minValues[0];
-        min_a.y = (float)accessor.minValues[1];
-        min_a.z = (float)accessor.minValues[2];
-
-        max_a = glm::vec3(trafo * glm::vec4(max_a, 1.0f));
-        min_a = glm::vec3(trafo * glm::vec4(min_a, 1.0f));
+        max_a = glm::vec3(trafo * glm::vec4(glm::make_vec3(primitive.bounds_max), 1.0f));
+        min_a = glm::vec3(trafo * glm::vec4(glm::make_vec3(primitive.bounds_min), 1.0f));
 
         center    = (max_a + min_a) * 0.5f;
         to_center = max_a - center;
@@ -1026,3 +979,14 @@ static void update_scene_boundaries(glm::mat4& trafo, tinygltf::Model& m, tinygl
         min = glm::min(min, min_a);
     }
 }
+
+//! \brief Sets position, rotation and scale of a \a transform_component to its current world transformation.
+//! \details Used when the parent is removed, so the \a entity stays where it is.
+//! \param[in,out] transform The \a transform_component to update.
+static void keep_world_transformation(transform_component& transform)
+{
+    glm::vec3 skew;
+    glm::vec4 perspective;
+    glm::decompose(glm::mat4(transform.world_transformation_matrix), transform.scale, transform.rotation, transform.position, skew, perspective);
+    transform.changed = true;
+}
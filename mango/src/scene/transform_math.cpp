@@ -0,0 +1,95 @@
+//! \file      transform_math.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <scene/transform_math.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+//! \cond NO_COND
+#define MANGO_TRANSFORM_SSE 1
+//! \endcond
+#include <emmintrin.h>
+#endif // SSE2
+
+using namespace mango;
+
+#ifdef MANGO_TRANSFORM_SSE
+//! \brief Loads a glm::vec3 into the xyz lanes of a register, w is zero.
+//! \param[in] v The vector to load.
+//! \return The register.
+static inline __m128 load_vec3(const glm::vec3& v)
+{
+    const __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(&v.x));
+    return _mm_movelh_ps(xy, _mm_load_ss(&v.z));
+}
+
+//! \brief Stores the xyz lanes of a register in a glm::vec3.
+//! \param[out] v The vector to store in.
+//! \param[in] r The register.
+static inline void store_vec3(glm::vec3& v, __m128 r)
+{
+    _mm_storel_pi(reinterpret_cast<__m64*>(&v.x), r);
+    _mm_store_ss(&v.z, _mm_movehl_ps(r, r));
+}
+#endif // MANGO_TRANSFORM_SSE
+
+glm::mat4x3 mango::compose_transformation(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    glm::mat4x3 result;
+#ifdef MANGO_TRANSFORM_SSE
+    const __m128 q       = _mm_set_ps(rotation.w, rotation.z, rotation.y, rotation.x);
+    const __m128 q2      = _mm_add_ps(q, q);
+    const __m128 squares = _mm_mul_ps(q, q2); // 2xx, 2yy, 2zz, 2ww
+
+    // diagonal = 1 - (2yy + 2zz, 2xx + 2zz, 2xx + 2yy)
+    const __m128 diagonal = _mm_sub_ps(_mm_set1_ps(1.0f), _mm_add_ps(_mm_shuffle_ps(squares, squares, _MM_SHUFFLE(3, 0, 0, 1)), _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(3, 1, 2, 2))));
+    // mixed = (2xy, 2xz, 2yz), w_terms = (2wz, 2wy, 2wx)
+    const __m128 mixed   = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 1, 0, 0)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 2, 2, 1)));
+    const __m128 w_terms = _mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(3, 0, 1, 2)));
+    const __m128 plus    = _mm_add_ps(mixed, w_terms); // 2xy + 2wz, 2xz + 2wy, 2yz + 2wx
+    const __m128 minus   = _mm_sub_ps(mixed, w_terms); // 2xy - 2wz, 2xz - 2wy, 2yz - 2wx
+
+    // column 0 = (diagonal.x, plus.x, minus.y), column 1 = (minus.x, diagonal.y, plus.z), column 2 = (plus.y, minus.z, diagonal.z)
+    const __m128 column_0 = _mm_shuffle_ps(_mm_unpacklo_ps(diagonal, plus), minus, _MM_SHUFFLE(1, 1, 1, 0));
+    const __m128 column_1 = _mm_shuffle_ps(_mm_unpacklo_ps(minus, diagonal), plus, _MM_SHUFFLE(2, 2, 3, 0));
+    const __m128 column_2 = _mm_shuffle_ps(_mm_shuffle_ps(plus, minus, _MM_SHUFFLE(2, 2, 1, 1)), diagonal, _MM_SHUFFLE(2, 2, 2, 0));
+
+    store_vec3(result[0], _mm_mul_ps(column_0, _mm_set1_ps(scale.x)));
+    store_vec3(result[1], _mm_mul_ps(column_1, _mm_set1_ps(scale.y)));
+    store_vec3(result[2], _mm_mul_ps(column_2, _mm_set1_ps(scale.z)));
+#else
+    const glm::mat3 rotation_matrix = glm::mat3_cast(rotation);
+    result[0]                       = rotation_matrix[0] * scale.x;
+    result[1]                       = rotation_matrix[1] * scale.y;
+    result[2]                       = rotation_matrix[2] * scale.z;
+#endif // MANGO_TRANSFORM_SSE
+    result[3] = position;
+    return result;
+}
+
+glm::mat4x3 mango::multiply_transformations(const glm::mat4x3& parent, const glm::mat4x3& child)
+{
+    glm::mat4x3 result;
+#ifdef MANGO_TRANSFORM_SSE
+    const __m128 parent_0 = load_vec3(parent[0]);
+    const __m128 parent_1 = load_vec3(parent[1]);
+    const __m128 parent_2 = load_vec3(parent[2]);
+    for (int32 i = 0; i < 4; ++i)
+    {
+        __m128 column = _mm_mul_ps(parent_0, _mm_set1_ps(child[i].x));
+        column        = _mm_add_ps(column, _mm_mul_ps(parent_1, _mm_set1_ps(child[i].y)));
+        column        = _mm_add_ps(column, _mm_mul_ps(parent_2, _mm_set1_ps(child[i].z)));
+        if (i == 3)
+            column = _mm_add_ps(column, load_vec3(parent[3]));
+        store_vec3(result[i], column);
+    }
+#else
+    const glm::mat3 rotation_scale = glm::mat3(parent[0], parent[1], parent[2]);
+    for (int32 i = 0; i < 4; ++i)
+        result[i] = rotation_scale * child[i];
+    result[3] += parent[3];
+#endif // MANGO_TRANSFORM_SSE
+    return result;
+}
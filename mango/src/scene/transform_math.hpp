@@ -0,0 +1,31 @@
+//! \file      transform_math.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_TRANSFORM_MATH_HPP
+#define MANGO_TRANSFORM_MATH_HPP
+
+#include <glm/gtc/quaternion.hpp>
+#include <mango/types.hpp>
+
+namespace mango
+{
+    //! \brief Composes the affine transformation translate(position) * rotate(rotation) * scale(scale).
+    //! \details Uses SSE on x86, the result is the same as building the full 4x4 matrix with glm.
+    //! \param[in] position The translation.
+    //! \param[in] rotation The rotation quaternion. Has to be normalized.
+    //! \param[in] scale The scale.
+    //! \return The affine transformation. The fourth column is the translation.
+    glm::mat4x3 compose_transformation(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+    //! \brief Multiplies two affine transformations, as if they were 4x4 matrices with (0, 0, 0, 1) as last row.
+    //! \details Uses SSE on x86.
+    //! \param[in] parent The left hand side, usually the world transformation of the parent.
+    //! \param[in] child The right hand side, usually the local transformation of the child.
+    //! \return The affine transformation parent * child.
+    glm::mat4x3 multiply_transformations(const glm::mat4x3& parent, const glm::mat4x3& child);
+} // namespace mango
+
+#endif // MANGO_TRANSFORM_MATH_HPP
@@ -26,8 +26,9 @@ namespace mango
     //! \brief This is an imgui widget drawing the render view and the frame produced by the renderer.
     //! \param[in] shared_context The shared context.
     //! \param[in] enabled Specifies if window is rendered or not and can be set by imgui.
+    //! \param[in,out] selected The currently selected entity, set to the picked mesh primitive on double click.
     //! \return The size of the viewport.
-    ImVec2 render_view_widget(const shared_ptr<context_impl>& shared_context, bool& enabled)
+    ImVec2 render_view_widget(const shared_ptr<context_impl>& shared_context, bool& enabled, entity& selected)
     {
         ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, ImVec2{ 0, 0 });
         ImGui::Begin("Render View", &enabled);
@@ -43,6 +44,25 @@ namespace mango
         ImGui::GetWindowDrawList()->AddImage(
             (void*)(intptr_t)shared_context->get_render_system_internal().lock()->get_backbuffer()->get_attachment(framebuffer_attachment::color_attachment0)->get_name(), position,
             ImVec2(position.x + size.x, position.y + size.y), ImVec2(0, 1), ImVec2(1, 0));
+
+        // Picking: Cast a ray through the mouse position from the near to the far plane.
+        if (!bar && ImGui::IsWindowHovered() && ImGui::IsMouseDoubleClicked(0) && size.x > 0 && size.y > 0)
+        {
+            auto application_scene = shared_context->get_current_scene();
+            auto cam_info          = application_scene->get_active_camera_data().camera_info;
+            if (cam_info)
+            {
+                ImVec2 mouse                      = ImGui::GetMousePos();
+                glm::vec2 ndc                     = glm::vec2((mouse.x - position.x) / size.x, 1.0f - (mouse.y - position.y) / size.y) * 2.0f - 1.0f;
+                glm::mat4 inverse_view_projection = glm::inverse(cam_info->view_projection);
+                glm::vec4 near_point              = inverse_view_projection * glm::vec4(ndc, -1.0f, 1.0f);
+                glm::vec4 far_point               = inverse_view_projection * glm::vec4(ndc, 1.0f, 1.0f);
+                glm::vec3 origin                  = glm::vec3(near_point) / near_point.w;
+                entity picked                     = application_scene->pick(origin, glm::vec3(far_point) / far_point.w - origin);
+                if (picked != invalid_entity)
+                    selected = picked;
+            }
+        }
         ImGui::PopStyleVar();
         ImGui::End();
 
@@ -137,6 +157,49 @@ namespace mango
             ImGui::Text("%d", info.last_frame.materials);
             column_next();
             ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Retained Primitives:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d (%d patched, %d recorded)", info.last_frame.retained_primitives, info.last_frame.patched_primitives, info.last_frame.recorded_primitives);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Eliminated Commands:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d", info.last_frame.eliminated_commands);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Instanced Primitives:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d", info.last_frame.instanced_primitives);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Indirect Primitives:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d", info.last_frame.indirect_primitives);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Uploaded Materials:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d", info.last_frame.uploaded_materials);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Culled Primitives:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d of %d (%d from shadows)", info.last_frame.culled_primitives, info.last_frame.culled_primitives + info.last_frame.visible_primitives,
+                        info.last_frame.culled_shadow_primitives);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+            text_wrapped("Occluded Primitives:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d", info.last_frame.occluded_primitives);
+            column_next();
+            ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
             text_wrapped("Canvas Size:");
             column_next();
             ImGui::AlignTextToFramePadding();
@@ -144,6 +207,30 @@ namespace mango
 
             column_merge();
         }
+        auto current_scene = shared_context->get_current_scene();
+        if (current_scene && ImGui::CollapsingHeader("Scene Info", flags))
+        {
+            column_split("split", 2, ImGui::GetContentRegionAvail().x * 0.33f);
+
+            text_wrapped("Recomputed Matrices:");
+            column_next();
+            ImGui::AlignTextToFramePadding();
+            ImGui::Text("%d", current_scene->get_recomputed_transformations());
+            column_next();
+
+            auto pools = current_scene->get_component_pool_memory_info();
+            for (int32 i = 0; i < static_cast<int32>(pools.size()); ++i)
+            {
+                ImGui::SeparatorEx(ImGuiSeparatorFlags_SpanAllColumns | ImGuiSeparatorFlags_Horizontal);
+                text_wrapped(pools[i].component_name);
+                column_next();
+                ImGui::AlignTextToFramePadding();
+                ImGui::Text("%d of %d (%.1f KiB)", pools[i].size, pools[i].capacity, static_cast<float>(pools[i].allocated_bytes) / 1024.0f);
+                column_next();
+            }
+
+            column_merge();
+        }
         ImGui::End();
     }
 
@@ -708,7 +795,7 @@ namespace mango
                 float default_value[3] = { 0.0f, 0.0f, 0.0f };
 
                 // translation
-                drag_float_n("Translation", &transform_comp->position[0], 3, default_value, 0.08f, 0.0f, 0.0f, "%.2f", true);
+                bool changed = drag_float_n("Translation", &transform_comp->position[0], 3, default_value, 0.08f, 0.0f, 0.0f, "%.2f", true);
 
                 if (camera_comp)
                 {
@@ -717,18 +804,27 @@ namespace mango
                 }
 
                 // rotation
-                glm::vec3 rotation_hint_before = transform_comp->rotation_hint;
-                drag_float_n("Rotation", &transform_comp->rotation_hint[0], 3, default_value, 0.08f, 0.0f, 0.0f, "%.2f", true);
-                glm::quat x_quat         = glm::angleAxis(glm::radians(transform_comp->rotation_hint.x - rotation_hint_before.x), glm::vec3(1.0f, 0.0f, 0.0f));
-                glm::quat y_quat         = glm::angleAxis(glm::radians(transform_comp->rotation_hint.y - rotation_hint_before.y), glm::vec3(0.0f, 1.0f, 0.0f));
-                glm::quat z_quat         = glm::angleAxis(glm::radians(transform_comp->rotation_hint.z - rotation_hint_before.z), glm::vec3(0.0f, 0.0f, 1.0f));
+                // The euler angles are only edited here, so they are not stored in the transform_component.
+                static entity s_rotation_hint_entity = invalid_entity;
+                static glm::vec3 s_rotation_hint;
+                if (s_rotation_hint_entity != e)
+                {
+                    s_rotation_hint_entity = e;
+                    s_rotation_hint        = glm::degrees(glm::eulerAngles(transform_comp->rotation));
+                }
+                glm::vec3 rotation_hint_before = s_rotation_hint;
+                changed |= drag_float_n("Rotation", &s_rotation_hint[0], 3, default_value, 0.08f, 0.0f, 0.0f, "%.2f", true);
+                glm::quat x_quat         = glm::angleAxis(glm::radians(s_rotation_hint.x - rotation_hint_before.x), glm::vec3(1.0f, 0.0f, 0.0f));
+                glm::quat y_quat         = glm::angleAxis(glm::radians(s_rotation_hint.y - rotation_hint_before.y), glm::vec3(0.0f, 1.0f, 0.0f));
+                glm::quat z_quat         = glm::angleAxis(glm::radians(s_rotation_hint.z - rotation_hint_before.z), glm::vec3(0.0f, 0.0f, 1.0f));
                 transform_comp->rotation = x_quat * y_quat * z_quat * transform_comp->rotation;
 
                 default_value[0] = 1.0f;
                 default_value[1] = 1.0f;
                 default_value[2] = 1.0f;
                 // scale
-                drag_float_n("Scale", &transform_comp->scale[0], 3, default_value, 0.08f, 0.0f, 0.0f, "%.2f", true);
+                changed |= drag_float_n("Scale", &transform_comp->scale[0], 3, default_value, 0.08f, 0.0f, 0.0f, "%.2f", true);
+                transform_comp->changed |= changed;
 
                 ImGui::EndGroup();
                 if (camera_comp)
@@ -745,11 +841,12 @@ namespace mango
             details::draw_component<mango::model_component>(
                 model_comp,
                 [e, &application_scene, &model_comp, &transform_comp]() {
+                    const mango::model_load_state load_state = application_scene->get_model_load_state(e);
                     if (model_comp->model_file_path.empty())
                         custom_info(
                             "No Model Loaded!", []() {}, 0.0f, ImGui::GetContentRegionAvail().x);
                     else
-                        custom_info("Model Loaded:", [&model_comp]() {
+                        custom_info(load_state == mango::model_load_state::finished ? "Model Loaded:" : "Model Loading:", [&model_comp]() {
                             ImGui::AlignTextToFramePadding();
                             text_wrapped(model_comp->model_file_path.c_str());
                         });
@@ -767,7 +864,7 @@ namespace mango
                             if (ext == "glb" || ext == "gltf")
                             {
                                 application_scene->remove_component<model_component>(e); // TODO Paul: This could be done cleaner.
-                                application_scene->create_entities_from_model(queried, e);
+                                application_scene->create_entities_from_model_async(queried, e);
                             }
                         }
                     }
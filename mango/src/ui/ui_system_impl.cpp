@@ -249,10 +249,13 @@ void ui_system_impl::update(float dt)
         ImGui::EndMenuBar();
     }
 
+    // Selected in the render view and the inspectors.
+    static entity selected = invalid_entity;
+
     // Render View
     ImVec2 viewport_size = ImVec2(1080, 720);
     if (widgets[ui_widget::render_view] && render_view_enabled)
-        viewport_size = render_view_widget(m_shared_context, render_view_enabled);
+        viewport_size = render_view_widget(m_shared_context, render_view_enabled, selected);
 
     // Hardware Info
     if (widgets[ui_widget::hardware_info] && hardware_info_enabled && !cinema_view)
@@ -266,7 +269,6 @@ void ui_system_impl::update(float dt)
     // Inspectors
 
     // Scene Inspector
-    static entity selected = invalid_entity;
     auto application_scene = m_shared_context->get_current_scene();
     if (widgets[ui_widget::scene_inspector] && scene_inspector_enabled && !cinema_view)
     {
@@ -30,6 +30,30 @@ namespace mango
             return hash;
         }
     };
+
+    //! \brief fnv1a_hash
+    class fnv1a_hash
+    {
+      public:
+        //! \brief The initial value of a 64 bit fnv1a hash.
+        static const uint64 offset_basis = 14695981039346656037ull;
+
+        //! \brief Calculate the hash for arbitrary data.
+        //! \param[in] data Pointer to the data to hash.
+        //! \param[in] size The size of the data in bytes.
+        //! \param[in] hash The hash to continue. Can be used to hash data in multiple parts.
+        //! \return The hash.
+        static uint64 hash(const void* data, ptr_size size, uint64 hash = offset_basis)
+        {
+            const uint8* bytes = static_cast<const uint8*>(data);
+            for (ptr_size i = 0; i < size; ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+    };
 } // namespace mango
 
 #endif // MANGO_HASHING_HPP
\ No newline at end of file
@@ -7,6 +7,12 @@
 //! \copyright Apache License 2.0
 
 #include <util/helpers.hpp>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif // _WIN32
+#include <cerrno>
 
 using namespace mango;
 
@@ -34,3 +40,26 @@ bool mango::check_acquisition(void* ptr, const string& what)
 {
     return check_anything("Acquisition", ptr, what);
 }
+
+bool mango::create_directories(const string& path)
+{
+    for (ptr_size i = 1; i <= path.size(); ++i)
+    {
+        if (i < path.size() && path[i] != '/' && path[i] != '\\')
+            continue;
+        const string directory = path.substr(0, i);
+        if (directory.back() == ':') // drive letter
+            continue;
+#ifdef _WIN32
+        const int result = _mkdir(directory.c_str());
+#else
+        const int result = mkdir(directory.c_str(), 0755);
+#endif // _WIN32
+        if (result != 0 && errno != EEXIST)
+        {
+            MANGO_LOG_ERROR("Could not create directory {0}!", directory);
+            return false;
+        }
+    }
+    return true;
+}
@@ -25,6 +25,10 @@ namespace mango
     //! \param[in] ptr The pointer to check.
     //! \param[in] what The name of the checked object. Used for output.
     bool check_acquisition(void* ptr, const string& what);
+    //! \brief Creates a directory and all missing parent directories.
+    //! \param[in] path The path of the directory. Can use '/' and '\\' as separators.
+    //! \return True if the directory exists afterwards, else false.
+    bool create_directories(const string& path);
 } // namespace mango
 
 #endif // MANGO_HELPERS_HPP
\ No newline at end of file
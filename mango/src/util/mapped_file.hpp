@@ -0,0 +1,60 @@
+//! \file      mapped_file.hpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#ifndef MANGO_MAPPED_FILE_HPP
+#define MANGO_MAPPED_FILE_HPP
+
+#include <mango/types.hpp>
+
+namespace mango
+{
+    //! \brief A file mapped read only into memory.
+    //! \details The pages are loaded by the operating system on access, so data can be used directly from the file without copying it.
+    class mapped_file
+    {
+      public:
+        mapped_file();
+        ~mapped_file();
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        //! \brief Maps a file into memory. A previously mapped file is closed.
+        //! \param[in] path The path to the file.
+        //! \return True on success, else false.
+        bool open(const string& path);
+
+        //! \brief Unmaps the file.
+        void close();
+
+        //! \brief Returns the mapped data.
+        //! \return Pointer to the mapped data or nullptr if no file is mapped.
+        inline const uint8* data() const
+        {
+            return m_data;
+        }
+
+        //! \brief Returns the size of the mapped file.
+        //! \return The size of the mapped file in bytes.
+        inline uint64 size() const
+        {
+            return m_size;
+        }
+
+      private:
+        //! \brief The mapped data.
+        const uint8* m_data;
+        //! \brief The size of the mapped data in bytes.
+        uint64 m_size;
+#ifdef _WIN32
+        //! \brief The file handle.
+        void* m_file;
+        //! \brief The file mapping handle.
+        void* m_mapping;
+#endif // _WIN32
+    };
+} // namespace mango
+
+#endif // MANGO_MAPPED_FILE_HPP
@@ -0,0 +1,71 @@
+#ifndef MANGO_COMMON_MATERIAL_GLSL
+#define MANGO_COMMON_MATERIAL_GLSL
+
+struct material_table_entry
+{
+    vec4  base_color;
+    vec4  emissive_color; // this is a vec3, but there are annoying bugs with some drivers.
+    float metallic;
+    float roughness;
+
+    bool base_color_texture;
+    bool roughness_metallic_texture;
+    bool occlusion_texture;
+    bool packed_occlusion;
+    bool normal_texture;
+    bool emissive_color_texture;
+
+    int   alpha_mode;
+    float alpha_cutoff;
+
+    float padding0;
+    float padding1;
+
+    uvec2 texture_handles[5]; // bindless handles (base color, roughness metallic, occlusion, normal, emissive), zero if not enabled.
+};
+
+// Shader Storage Buffer Material Table (indexed by the material index of the model data).
+layout(binding = 3, std430) readonly buffer material_table
+{
+    material_table_entry materials[];
+};
+
+// Material of the current draw, filled by load_material().
+vec4  base_color;
+vec4  emissive_color;
+float metallic;
+float roughness;
+
+bool base_color_texture;
+bool roughness_metallic_texture;
+bool occlusion_texture;
+bool packed_occlusion;
+bool normal_texture;
+bool emissive_color_texture;
+
+int   alpha_mode;
+float alpha_cutoff;
+
+uvec2 texture_handles[5];
+
+void load_material(in int index)
+{
+    base_color     = materials[index].base_color;
+    emissive_color = materials[index].emissive_color;
+    metallic       = materials[index].metallic;
+    roughness      = materials[index].roughness;
+
+    base_color_texture         = materials[index].base_color_texture;
+    roughness_metallic_texture = materials[index].roughness_metallic_texture;
+    occlusion_texture          = materials[index].occlusion_texture;
+    packed_occlusion           = materials[index].packed_occlusion;
+    normal_texture             = materials[index].normal_texture;
+    emissive_color_texture     = materials[index].emissive_color_texture;
+
+    alpha_mode   = materials[index].alpha_mode;
+    alpha_cutoff = materials[index].alpha_cutoff;
+
+    texture_handles = materials[index].texture_handles;
+}
+
+#endif // MANGO_COMMON_MATERIAL_GLSL
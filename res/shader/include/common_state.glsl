@@ -1,6 +1,14 @@
 #ifndef MANGO_COMMON_STATE_GLSL
 #define MANGO_COMMON_STATE_GLSL
 
+#if defined(MULTI_DRAW_INDIRECT) && defined(VERTEX)
+#extension GL_ARB_shader_draw_parameters : require
+#endif // MULTI_DRAW_INDIRECT && VERTEX
+
+#if defined(BINDLESS_TEXTURES) && defined(FRAGMENT)
+#extension GL_ARB_bindless_texture : require
+#endif // BINDLESS_TEXTURES && FRAGMENT
+
 #ifdef LIGHTING
 
 struct
@@ -125,26 +133,11 @@ layout(binding = 2, std140) uniform model_data
     mat3 normal_matrix;
     bool has_normals;
     bool has_tangents;
+    bool instanced;
+    int material_index;
 };
 
-// Uniform Buffer Material.
-layout(binding = 3, std140) uniform material_data
-{
-    vec4  base_color;
-    vec4  emissive_color; // this is a vec3, but there are annoying bugs with some drivers.
-    float metallic;
-    float roughness;
-
-    bool base_color_texture;
-    bool roughness_metallic_texture;
-    bool occlusion_texture;
-    bool packed_occlusion;
-    bool normal_texture;
-    bool emissive_color_texture;
-
-    int   alpha_mode;
-    float alpha_cutoff;
-};
+#include <common_material.glsl>
 
 #endif // FORWARD
 
@@ -236,6 +229,8 @@ void populate_datapool()
     shader_datapool.metallic             = o_r_m.z;
 #endif // DEFERRED
 #ifdef FORWARD
+    load_material(material_index);
+
     shader_datapool.base_color           = base_color_texture ? texture(sampler_base_color, texcoord) : base_color;
     shader_datapool.logarithmic_depth    = 0.0; // TODO Paul: Not set!
     shader_datapool.world_space_position = fs_in.position;
@@ -262,7 +257,9 @@ void populate_datapool()
             }
 
             mat3 tbn = mat3(normalize(tangent), normalize(bitangent), normal);
-            vec3 mapped_normal = normalize(texture(sampler_normal, texcoord).rgb * 2.0 - 1.0);
+            // z is reconstructed, normal textures can be compressed to two channels.
+            vec2 mapped_xy     = texture(sampler_normal, texcoord).rg * 2.0 - 1.0;
+            vec3 mapped_normal = vec3(mapped_xy, sqrt(max(1.0 - dot(mapped_xy, mapped_xy), 0.0)));
             normal = normalize(tbn * mapped_normal.rgb);
         }
         shader_datapool.normal   = normal;
@@ -550,6 +547,7 @@ layout(binding = 0, std140) uniform renderer_data
     bool shadow_step_enabled;
 };
 
+#ifndef MULTI_DRAW_INDIRECT
 // Uniform Buffer Model.
 layout(binding = 2, std140) uniform model_data
 {
@@ -557,28 +555,60 @@ layout(binding = 2, std140) uniform model_data
     mat3 normal_matrix;
     bool has_normals;
     bool has_tangents;
+    bool instanced;
+    int material_index;
 };
-
-// Uniform Buffer Material.
-layout(binding = 3, std140) uniform material_data
+#else
+struct draw_model_data
 {
-    vec4  base_color;
-    vec4  emissive_color; // this is a vec3, but there are annoying bugs with some drivers.
-    float metallic;
-    float roughness;
+    mat4 model_matrix;
+    mat3 normal_matrix;
+    bool has_normals;
+    bool has_tangents;
+    bool instanced;
+    int material_index;
+};
 
-    bool base_color_texture;
-    bool roughness_metallic_texture;
-    bool occlusion_texture;
-    bool packed_occlusion;
-    bool normal_texture;
-    bool emissive_color_texture;
+struct draw_data
+{
+    draw_model_data model;
+};
 
-    int   alpha_mode;
-    float alpha_cutoff;
+// Shader Storage Buffer Draw Data (indexed by the draw id of multi draw indirect calls).
+layout(binding = 8, std430) readonly buffer indirect_draw_data
+{
+    draw_data draws[];
 };
 
 #ifdef VERTEX
+flat out int draw_id;
+#define current_draw draws[gl_DrawIDARB]
+#else
+flat in int draw_id;
+#define current_draw draws[draw_id]
+#endif // VERTEX
+
+#define model_matrix current_draw.model.model_matrix
+#define normal_matrix current_draw.model.normal_matrix
+#define has_normals current_draw.model.has_normals
+#define has_tangents current_draw.model.has_tangents
+#define instanced current_draw.model.instanced
+#define material_index current_draw.model.material_index
+#endif // MULTI_DRAW_INDIRECT
+
+#ifdef VERTEX
+struct instance_model_data
+{
+    mat4 model;
+    mat4 normal; // this is a mat3, but a mat4 keeps the layout simple.
+};
+
+// Shader Storage Buffer Instance Data.
+layout(binding = 7, std430) readonly buffer instance_data
+{
+    instance_model_data instances[];
+};
+
 // Vertex Input.
 layout(location = 0) in vec3 vertex_data_position;
 layout(location = 1) in vec3 vertex_data_normal;
@@ -595,18 +625,29 @@ out shared_data
     vec3 bitangent;
 } vs_out;
 
+mat4 get_model_matrix()
+{
+    return instanced ? instances[gl_InstanceID].model : model_matrix;
+}
+
+mat3 get_normal_matrix()
+{
+    return instanced ? mat3(instances[gl_InstanceID].normal) : normal_matrix;
+}
+
 vec4 get_world_space_position()
 {
-    return model_matrix * vec4(vertex_data_position, 1.0);
+    return get_model_matrix() * vec4(vertex_data_position, 1.0);
 }
 
 void get_normal_tangent_bitangent(out vec3 normal, out vec3 tangent, out vec3 bitangent)
 {
+    mat3 n_matrix = get_normal_matrix();
     if(has_normals)
-        normal = normal_matrix * normalize(vertex_data_normal);
+        normal = n_matrix * normalize(vertex_data_normal);
     if(has_tangents)
     {
-        tangent = normal_matrix * normalize(vertex_data_tangent.xyz);
+        tangent = n_matrix * normalize(vertex_data_tangent.xyz);
 
         if(has_normals)
         {
@@ -619,6 +660,10 @@ void get_normal_tangent_bitangent(out vec3 normal, out vec3 tangent, out vec3 bi
 
 void pass_shared_data(in vec4 world_position)
 {
+#ifdef MULTI_DRAW_INDIRECT
+    draw_id = gl_DrawIDARB;
+#endif // MULTI_DRAW_INDIRECT
+
     // Perspective Division
     vs_out.position = world_position.xyz / world_position.w;
 
@@ -647,12 +692,23 @@ in shared_data
     vec3 bitangent;
 } fs_in;
 
+#include <common_material.glsl>
+
+#ifndef BINDLESS_TEXTURES
 // Texture Samplers.
 layout (location = 0) uniform sampler2D sampler_base_color;
 layout (location = 1) uniform sampler2D sampler_roughness_metallic;
 layout (location = 2) uniform sampler2D sampler_occlusion;
 layout (location = 3) uniform sampler2D sampler_normal;
 layout (location = 4) uniform sampler2D sampler_emissive_color;
+#else
+// Texture Samplers from the bindless handles of the current material.
+#define sampler_base_color sampler2D(texture_handles[0])
+#define sampler_roughness_metallic sampler2D(texture_handles[1])
+#define sampler_occlusion sampler2D(texture_handles[2])
+#define sampler_normal sampler2D(texture_handles[3])
+#define sampler_emissive_color sampler2D(texture_handles[4])
+#endif // BINDLESS_TEXTURES
 
 #include <common_constants_and_functions.glsl>
 
@@ -706,7 +762,9 @@ vec3 get_normal()
         }
 
         mat3 tbn = mat3(normalize(tangent), normalize(bitangent), normal);
-        vec3 mapped_normal = normalize(texture(sampler_normal, fs_in.texcoord).rgb * 2.0 - 1.0);
+        // z is reconstructed, normal textures can be compressed to two channels.
+        vec2 mapped_xy     = texture(sampler_normal, fs_in.texcoord).rg * 2.0 - 1.0;
+        vec3 mapped_normal = vec3(mapped_xy, sqrt(max(1.0 - dot(mapped_xy, mapped_xy), 0.0)));
         normal = normalize(tbn * mapped_normal.rgb);
     }
     if(!gl_FrontFacing)
@@ -716,6 +774,8 @@ vec3 get_normal()
 
 void populate_gbuffer()
 {
+    load_material(material_index);
+
     gbuffer_color_target0 = vec4(get_base_color());
     gbuffer_color_target1 = vec4(get_normal(), 1.0);
     gbuffer_color_target2 = vec4(get_emissive(), 1.0);
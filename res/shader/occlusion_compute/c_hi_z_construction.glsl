@@ -0,0 +1,51 @@
+#define COMPUTE
+#include <../include/common_constants_and_functions.glsl>
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(location = 0) uniform sampler2D depth_input; // the gbuffer depth for the first level, else the hi-z texture itself
+layout(binding = 0, r32f) uniform writeonly image2D hi_z_output;
+
+layout(location = 1) uniform ivec2 params; // input level (x), unused (y)
+#define input_level params.x
+
+float fetch_depth(in ivec2 coords, in ivec2 input_size);
+
+void main()
+{
+    ivec2 output_size = imageSize(hi_z_output);
+    ivec2 coords = ivec2(gl_GlobalInvocationID.xy);
+    if (coords.x >= output_size.x || coords.y >= output_size.y)
+        return;
+
+    ivec2 input_size = textureSize(depth_input, input_level);
+
+    // The first level is a copy of the depth buffer.
+    if (input_size == output_size)
+    {
+        imageStore(hi_z_output, coords, vec4(texelFetch(depth_input, coords, input_level).r));
+        return;
+    }
+
+    // Farthest depth of the 2x2 texels below.
+    ivec2 source = coords * 2;
+    float depth = max(max(fetch_depth(source, input_size), fetch_depth(source + ivec2(1, 0), input_size)),
+                      max(fetch_depth(source + ivec2(0, 1), input_size), fetch_depth(source + ivec2(1, 1), input_size)));
+
+    // Odd input sizes leave a row or column, which is merged into the last texel.
+    bool extra_x = (input_size.x & 1) != 0 && coords.x == output_size.x - 1;
+    bool extra_y = (input_size.y & 1) != 0 && coords.y == output_size.y - 1;
+    if (extra_x)
+        depth = max(depth, max(fetch_depth(source + ivec2(2, 0), input_size), fetch_depth(source + ivec2(2, 1), input_size)));
+    if (extra_y)
+        depth = max(depth, max(fetch_depth(source + ivec2(0, 2), input_size), fetch_depth(source + ivec2(1, 2), input_size)));
+    if (extra_x && extra_y)
+        depth = max(depth, fetch_depth(source + ivec2(2, 2), input_size));
+
+    imageStore(hi_z_output, coords, vec4(depth));
+}
+
+float fetch_depth(in ivec2 coords, in ivec2 input_size)
+{
+    return texelFetch(depth_input, min(coords, input_size - 1), input_level).r;
+}
@@ -0,0 +1,83 @@
+#define COMPUTE
+#include <../include/common_constants_and_functions.glsl>
+
+layout(local_size_x = 64) in;
+
+layout(location = 0) uniform sampler2D hi_z;
+
+struct bounds
+{
+    vec4 bounds_min; // world space minimum (xyz), unused (w)
+    vec4 bounds_max; // world space maximum (xyz), unused (w)
+};
+
+layout(std430, binding = 9) readonly buffer occlusion_bounds
+{
+    bounds volumes[];
+};
+
+layout(std430, binding = 10) writeonly buffer occlusion_visibility
+{
+    uint visible[];
+};
+
+layout(location = 1) uniform mat4 view_projection;
+layout(location = 2) uniform ivec2 params; // number of volumes (x), number of hi-z levels (y)
+#define volume_count params.x
+#define level_count params.y
+
+bool is_visible(in bounds volume);
+
+void main()
+{
+    uint idx = gl_GlobalInvocationID.x;
+    if (idx >= uint(volume_count))
+        return;
+
+    visible[idx] = is_visible(volumes[idx]) ? 1 : 0;
+}
+
+bool is_visible(in bounds volume)
+{
+    vec3 ndc_min = vec3(1.0);
+    vec3 ndc_max = vec3(-1.0);
+    for (int i = 0; i < 8; ++i)
+    {
+        vec3 corner = vec3((i & 1) != 0 ? volume.bounds_max.x : volume.bounds_min.x,
+                           (i & 2) != 0 ? volume.bounds_max.y : volume.bounds_min.y,
+                           (i & 4) != 0 ? volume.bounds_max.z : volume.bounds_min.z);
+        vec4 clip = view_projection * vec4(corner, 1.0);
+        // Boxes reaching behind the camera can not be tested in screen space.
+        if (clip.w <= 0.0)
+            return true;
+        vec3 ndc = clip.xyz / clip.w;
+        ndc_min = min(ndc_min, ndc);
+        ndc_max = max(ndc_max, ndc);
+    }
+
+    float nearest_depth = ndc_min.z * 0.5 + 0.5;
+    if (nearest_depth <= 0.0)
+        return true;
+
+    // Texels of the first level covered by the box.
+    ivec2 size = textureSize(hi_z, 0);
+    ivec2 texel_min = clamp(ivec2(saturate(ndc_min.xy * 0.5 + 0.5) * vec2(size)), ivec2(0), size - 1);
+    ivec2 texel_max = clamp(ivec2(saturate(ndc_max.xy * 0.5 + 0.5) * vec2(size)), ivec2(0), size - 1);
+
+    // The level where the covered texels shrink to at most 2x2.
+    int level = 0;
+    ivec2 span = texel_max - texel_min;
+    while (level < level_count - 1 && max(span.x, span.y) > 1)
+    {
+        ++level;
+        span = (texel_max >> level) - (texel_min >> level);
+    }
+    ivec2 level_size = textureSize(hi_z, level);
+    texel_min = min(texel_min >> level, level_size - 1);
+    texel_max = min(texel_max >> level, level_size - 1);
+
+    float farthest_depth = max(max(texelFetch(hi_z, texel_min, level).r, texelFetch(hi_z, ivec2(texel_max.x, texel_min.y), level).r),
+                               max(texelFetch(hi_z, ivec2(texel_min.x, texel_max.y), level).r, texelFetch(hi_z, texel_max, level).r));
+
+    return nearest_depth <= farthest_depth;
+}
@@ -2,25 +2,19 @@
 
 layout (location = 0) uniform sampler2D sampler_base_color;
 
-// Uniform Buffer Material.
-layout(binding = 3, std140) uniform material_data
+// Uniform Buffer Model.
+layout(binding = 2, std140) uniform model_data
 {
-    vec4  base_color;
-    vec4  emissive_color; // this is a vec3, but there are annoying bugs with some drivers.
-    float metallic;
-    float roughness;
-
-    bool base_color_texture;
-    bool roughness_metallic_texture;
-    bool occlusion_texture;
-    bool packed_occlusion;
-    bool normal_texture;
-    bool emissive_color_texture;
-
-    int   alpha_mode;
-    float alpha_cutoff;
+    mat4 model_matrix;
+    mat3 normal_matrix;
+    bool has_normals;
+    bool has_tangents;
+    bool instanced;
+    int material_index;
 };
 
+#include <../include/common_material.glsl>
+
 in shared_data
 {
     vec2 texcoord;
@@ -28,6 +22,8 @@ in shared_data
 
 void main()
 {
+    load_material(material_index);
+
     vec4 color = base_color_texture ? texture(sampler_base_color, fs_in.texcoord) : base_color;
     if(alpha_mode == 1 && color.a <= alpha_cutoff)
         discard;
@@ -10,6 +10,20 @@ layout(binding = 2, std140) uniform model_data
     mat3 normal_matrix;
     bool has_normals;
     bool has_tangents;
+    bool instanced;
+    int material_index;
+};
+
+struct instance_model_data
+{
+    mat4 model;
+    mat4 normal; // this is a mat3, but a mat4 keeps the layout simple.
+};
+
+// Shader Storage Buffer Instance Data.
+layout(binding = 7, std430) readonly buffer instance_data
+{
+    instance_model_data instances[];
 };
 
 out shared_data
@@ -19,7 +33,8 @@ out shared_data
 
 vec4 get_world_position()
 {
-    return model_matrix * vec4(vertex_data_position, 1.0);
+    mat4 m = instanced ? instances[gl_InstanceID].model : model_matrix;
+    return m * vec4(vertex_data_position, 1.0);
 }
 
 void main()
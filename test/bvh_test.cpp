@@ -0,0 +1,184 @@
+//! \file      bvh_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include "mock_classes.hpp"
+#include <chrono>
+#include <glm/gtc/matrix_transform.hpp>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+#include <scene/bvh.hpp>
+#include <vector>
+
+//! \cond NO_DOC
+
+static std::vector<mango::axis_aligned_bounding_box> make_random_boxes(mango::int32 count, mango::uint32 seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> size(0.1f, 4.0f);
+    std::vector<mango::axis_aligned_bounding_box> boxes(count);
+    for (mango::axis_aligned_bounding_box& box : boxes)
+    {
+        box.min = glm::vec3(position(rng), position(rng), position(rng));
+        box.max = box.min + glm::vec3(size(rng), size(rng), size(rng));
+    }
+    return boxes;
+}
+
+static mango::frustum make_bvh_frustum(const glm::vec3& eye, const glm::vec3& target)
+{
+    return mango::frustum_from_view_projection(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 80.0f) * glm::lookAt(eye, target, GLOBAL_UP));
+}
+
+static void expect_same_visible_items(mango::bounding_volume_hierarchy& bvh, const std::vector<mango::axis_aligned_bounding_box>& boxes, const mango::frustum* frustums,
+                                      mango::int32 frustum_count)
+{
+    mango::culling_volumes volumes;
+    volumes.set_simd_level(mango::simd_level::scalar);
+    for (const mango::axis_aligned_bounding_box& box : boxes)
+        volumes.add(box);
+
+    std::vector<mango::int32> reference(boxes.size());
+    std::vector<mango::int32> result(boxes.size());
+    mango::int32 reference_count = volumes.cull(frustums, frustum_count, reference.data());
+    mango::int32 count           = bvh.cull(frustums, frustum_count, result.data());
+    ASSERT_EQ(count, reference_count);
+    for (mango::int32 i = 0; i < count; ++i)
+        ASSERT_EQ(result[i], reference[i]);
+}
+
+TEST(bvh_test, culling_matches_the_linear_culling)
+{
+    std::vector<mango::axis_aligned_bounding_box> boxes = make_random_boxes(5000, 42);
+    boxes[17]                                           = mango::axis_aligned_bounding_box(); // always visible
+    mango::bounding_volume_hierarchy bvh;
+    bvh.build(boxes.data(), static_cast<mango::int32>(boxes.size()));
+
+    mango::frustum frustums[] = { make_bvh_frustum(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)), make_bvh_frustum(glm::vec3(50.0f, 10.0f, 0.0f), glm::vec3(20.0f, 0.0f, 5.0f)) };
+    expect_same_visible_items(bvh, boxes, frustums, 1);
+    expect_same_visible_items(bvh, boxes, frustums, 2);
+
+    // Moved items are found after refitting.
+    for (mango::int32 i = 0; i < static_cast<mango::int32>(boxes.size()); i += 7)
+    {
+        boxes[i].min += glm::vec3(5.0f, 0.0f, -3.0f);
+        boxes[i].max += glm::vec3(5.0f, 0.0f, -3.0f);
+        bvh.update(i, boxes[i]);
+    }
+    ASSERT_TRUE(bvh.refit());
+    expect_same_visible_items(bvh, boxes, frustums, 2);
+
+    // Items getting valid bounds need a new build.
+    boxes[17] = boxes[18];
+    bvh.update(17, boxes[17]);
+    ASSERT_FALSE(bvh.refit());
+}
+
+TEST(bvh_test, culling_uses_the_batch_kernels_of_all_simd_levels)
+{
+    std::vector<mango::axis_aligned_bounding_box> boxes = make_random_boxes(5000, 7);
+    mango::bounding_volume_hierarchy bvh;
+    bvh.build(boxes.data(), static_cast<mango::int32>(boxes.size()));
+    EXPECT_EQ(bvh.get_simd_level(), mango::get_supported_simd_level());
+
+    mango::frustum frustums[] = { make_bvh_frustum(glm::vec3(10.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f)), make_bvh_frustum(glm::vec3(-40.0f, 5.0f, 0.0f), glm::vec3(0.0f)) };
+    for (mango::simd_level level : { mango::simd_level::scalar, mango::simd_level::sse, mango::simd_level::avx2 })
+    {
+        bvh.set_simd_level(level);
+        expect_same_visible_items(bvh, boxes, frustums, 1);
+        expect_same_visible_items(bvh, boxes, frustums, 2);
+    }
+}
+
+TEST(bvh_test, rays_hit_the_closest_item)
+{
+    std::vector<mango::axis_aligned_bounding_box> boxes = make_random_boxes(5000, 7);
+    mango::bounding_volume_hierarchy bvh;
+    bvh.build(boxes.data(), static_cast<mango::int32>(boxes.size()));
+
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+    for (mango::int32 r = 0; r < 100; ++r)
+    {
+        glm::vec3 origin    = glm::vec3(value(rng), value(rng), value(rng));
+        glm::vec3 direction = glm::vec3(value(rng), value(rng), value(rng));
+
+        // Brute force reference with the same slab test.
+        float reference_distance = std::numeric_limits<float>::max();
+        for (const mango::axis_aligned_bounding_box& box : boxes)
+        {
+            glm::vec3 t_near = glm::min((box.min - origin) / direction, (box.max - origin) / direction);
+            glm::vec3 t_far  = glm::max((box.min - origin) / direction, (box.max - origin) / direction);
+            float entry      = glm::max(glm::max(t_near.x, t_near.y), glm::max(t_near.z, 0.0f));
+            if (entry <= glm::min(glm::min(t_far.x, t_far.y), t_far.z))
+                reference_distance = glm::min(reference_distance, entry);
+        }
+
+        float distance;
+        mango::int32 item = bvh.intersect_ray(origin, direction, distance);
+        if (reference_distance == std::numeric_limits<float>::max())
+        {
+            ASSERT_EQ(item, -1);
+            continue;
+        }
+        ASSERT_GE(item, 0);
+        ASSERT_NEAR(distance, reference_distance, 1e-4f);
+    }
+}
+
+TEST(bvh_test, DISABLED_build_and_refit_benchmark)
+{
+    const mango::int32 count = 100000;
+    const mango::int32 runs  = 5;
+
+    std::vector<mango::axis_aligned_bounding_box> boxes = make_random_boxes(count, 1337);
+    mango::bounding_volume_hierarchy bvh;
+    std::vector<mango::int32> visible(count);
+    mango::frustum f = make_bvh_frustum(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    mango::culling_volumes volumes;
+    for (const mango::axis_aligned_bounding_box& box : boxes)
+        volumes.add(box);
+
+    std::chrono::high_resolution_clock::duration build_time(0);
+    std::chrono::high_resolution_clock::duration refit_time(0);
+    std::chrono::high_resolution_clock::duration cull_time(0);
+    std::chrono::high_resolution_clock::duration linear_time(0);
+    for (mango::int32 r = 0; r < runs; ++r)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        bvh.build(boxes.data(), count);
+        build_time += std::chrono::high_resolution_clock::now() - start;
+
+        // A tenth of the items moves.
+        for (mango::int32 i = r; i < count; i += 10)
+        {
+            mango::axis_aligned_bounding_box moved = boxes[i];
+            moved.min += glm::vec3(0.5f);
+            moved.max += glm::vec3(0.5f);
+            bvh.update(i, moved);
+        }
+        start = std::chrono::high_resolution_clock::now();
+        bvh.refit();
+        refit_time += std::chrono::high_resolution_clock::now() - start;
+
+        start = std::chrono::high_resolution_clock::now();
+        bvh.cull(&f, 1, visible.data());
+        cull_time += std::chrono::high_resolution_clock::now() - start;
+
+        start = std::chrono::high_resolution_clock::now();
+        volumes.cull(&f, 1, visible.data());
+        linear_time += std::chrono::high_resolution_clock::now() - start;
+    }
+
+    std::cout << "[ BENCHMARK] bvh over " << count << " boxes (" << bvh.get_node_count() << " nodes): build "
+              << std::chrono::duration_cast<std::chrono::microseconds>(build_time).count() / runs << " us, refit "
+              << std::chrono::duration_cast<std::chrono::microseconds>(refit_time).count() / runs << " us, cull "
+              << std::chrono::duration_cast<std::chrono::microseconds>(cull_time).count() / runs << " us, linear cull "
+              << std::chrono::duration_cast<std::chrono::microseconds>(linear_time).count() / runs << " us" << std::endl;
+}
+
+//! \endcond
@@ -0,0 +1,185 @@
+//! \file      command_buffer_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include "mock_classes.hpp"
+#include <algorithm>
+#include <chrono>
+#include <graphics/command_buffer.hpp>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+#include <vector>
+
+//! \cond NO_DOC
+
+template <typename K>
+static std::vector<K> record_random_commands(const mango::command_buffer_ptr<K>& buffer, mango::int64 count, mango::uint32 seed)
+{
+    std::vector<K> keys;
+    keys.reserve(static_cast<size_t>(count));
+    std::mt19937_64 rng(seed);
+    for (mango::int64 i = 0; i < count; ++i)
+    {
+        K k = static_cast<K>(rng());
+        if (sizeof(K) == sizeof(mango::max_key))
+        {
+            // Most real keys only differ in the lower bits.
+            mango::max_key mk = static_cast<mango::max_key>(k) & ((1ull << 32) - 1);
+            mango::command_keys::add_base_mode(mk, mango::command_keys::base_mode::standard);
+            k = static_cast<K>(mk);
+        }
+        mango::set_viewport_command* vp = buffer->template create<mango::set_viewport_command>(k);
+        vp->x                           = static_cast<mango::int32>(i);
+        keys.push_back(k);
+    }
+    return keys;
+}
+
+template <typename K>
+static void expect_sorted_and_stable(const mango::command_buffer_ptr<K>& sorted, const mango::command_buffer_ptr<K>& reference)
+{
+    ASSERT_EQ(sorted->size(), reference->size());
+    for (mango::int64 i = 0; i < sorted->size(); ++i)
+        ASSERT_EQ(sorted->sorted_key(i), reference->sorted_key(i));
+}
+
+TEST(command_buffer_test, radix_sort_matches_comparison_sort)
+{
+    const mango::int64 count = 1000;
+
+    auto radix_min      = mango::command_buffer<mango::min_key>::create(count * 64);
+    auto comparison_min = mango::command_buffer<mango::min_key>::create(count * 64);
+    record_random_commands(radix_min, count, 42);
+    record_random_commands(comparison_min, count, 42);
+    radix_min->radix_sort();
+    comparison_min->comparison_sort();
+    expect_sorted_and_stable(radix_min, comparison_min);
+
+    auto radix_max      = mango::command_buffer<mango::max_key>::create(count * 64);
+    auto comparison_max = mango::command_buffer<mango::max_key>::create(count * 64);
+    record_random_commands(radix_max, count, 7);
+    record_random_commands(comparison_max, count, 7);
+    radix_max->sort();
+    comparison_max->comparison_sort();
+    expect_sorted_and_stable(radix_max, comparison_max);
+
+    for (mango::int64 i = 1; i < count; ++i)
+        ASSERT_LE(radix_max->sorted_key(i - 1), radix_max->sorted_key(i));
+}
+
+TEST(command_buffer_test, command_buffer_grows_and_tracks_high_water_mark)
+{
+    const mango::int64 count = 1000;
+    const mango::int64 size  = 256;
+
+    auto buffer = mango::command_buffer<mango::max_key>::create(size);
+    record_random_commands(buffer, count, 3);
+    ASSERT_EQ(buffer->size(), count);
+    ASSERT_GT(buffer->bytes_used(), size);
+    ASSERT_GE(buffer->bytes_reserved(), buffer->bytes_used());
+
+    mango::int64 used = buffer->bytes_used();
+    buffer->sort();
+    for (mango::int64 i = 1; i < count; ++i)
+        ASSERT_LE(buffer->sorted_key(i - 1), buffer->sorted_key(i));
+
+    buffer->invalidate();
+    ASSERT_EQ(buffer->size(), 0);
+    ASSERT_EQ(buffer->bytes_used(), 0);
+    ASSERT_EQ(buffer->high_water_mark(), used);
+    ASSERT_GE(buffer->bytes_reserved(), used);
+
+    record_random_commands(buffer, count, 4);
+    ASSERT_EQ(buffer->bytes_used(), used);
+    ASSERT_EQ(buffer->bytes_reserved(), used);
+}
+
+TEST(command_buffer_test, removed_commands_are_counted_until_invalidation)
+{
+    auto buffer = mango::command_buffer<mango::max_key>::create(1024);
+    record_random_commands(buffer, 10, 5);
+    buffer->remove(3);
+    buffer->remove(3);
+    buffer->remove(7);
+    ASSERT_EQ(buffer->removed_count(), 2);
+    ASSERT_EQ(buffer->size(), 10);
+
+    buffer->invalidate();
+    ASSERT_EQ(buffer->removed_count(), 0);
+}
+
+TEST(command_buffer_test, redundant_state_is_eliminated_after_sorting)
+{
+    auto buffer = mango::command_buffer<mango::min_key>::create(1024);
+    for (mango::int32 i = 0; i < 4; ++i)
+    {
+        mango::bind_shader_program_command* bsp = buffer->create<mango::bind_shader_program_command>(static_cast<mango::min_key>(i));
+        bsp->shader_program_name                = i < 3 ? 1 : 2;
+        mango::bind_texture_command* bt         = buffer->append<mango::bind_texture_command>(bsp);
+        bt->binding                             = 0;
+        bt->texture_name                        = 5;
+        bt->sampler_location                    = 0;
+        mango::bind_vertex_array_command* bva   = buffer->append<mango::bind_vertex_array_command>(bt);
+        bva->vertex_array_name                  = 3;
+        buffer->append<mango::draw_elements_command>(bva);
+    }
+    buffer->sort();
+
+    // The second and third package repeat program, texture and vertex array.
+    // After the program change in the last package the vertex array bind is redundant, the texture is bound again.
+    ASSERT_EQ(buffer->eliminate_redundant_state(), 7);
+    ASSERT_EQ(buffer->eliminate_redundant_state(), 0);
+}
+
+TEST(command_buffer_test, radix_sort_matches_stable_sort_on_large_buffers)
+{
+    const mango::int64 counts[] = { 1000, 10000, 100000 };
+    for (mango::int64 count : counts)
+    {
+        auto buffer                           = mango::command_buffer<mango::max_key>::create(count * 64);
+        std::vector<mango::max_key> reference = record_random_commands(buffer, count, 1337);
+        buffer->radix_sort();
+        std::stable_sort(reference.begin(), reference.end());
+
+        ASSERT_EQ(buffer->size(), count);
+        for (mango::int64 i = 0; i < count; ++i)
+            ASSERT_EQ(buffer->sorted_key(i), reference[static_cast<size_t>(i)]) << "count " << count << " index " << i;
+    }
+}
+
+
+TEST(command_buffer_test, DISABLED_radix_sort_benchmark)
+{
+    const mango::int64 counts[] = { 1000, 10000, 100000 };
+    const mango::int32 runs     = 10;
+
+    for (mango::int64 count : counts)
+    {
+        auto buffer = mango::command_buffer<mango::max_key>::create(count * 64);
+        std::chrono::high_resolution_clock::duration comparison_time(0), radix_time(0);
+
+        for (mango::int32 r = 0; r < runs; ++r)
+        {
+            buffer->invalidate();
+            record_random_commands(buffer, count, 1337 + r);
+            auto start = std::chrono::high_resolution_clock::now();
+            buffer->comparison_sort();
+            comparison_time += std::chrono::high_resolution_clock::now() - start;
+
+            buffer->invalidate();
+            record_random_commands(buffer, count, 1337 + r);
+            start = std::chrono::high_resolution_clock::now();
+            buffer->radix_sort();
+            radix_time += std::chrono::high_resolution_clock::now() - start;
+        }
+
+        std::cout << "[ BENCHMARK] " << count << " packages: comparison sort "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(comparison_time).count() / runs << " us, radix sort "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(radix_time).count() / runs << " us" << std::endl;
+    }
+}
+
+//! \endcond
@@ -0,0 +1,134 @@
+//! \file      culling_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include "mock_classes.hpp"
+#include <chrono>
+#include <glm/gtc/matrix_transform.hpp>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <random>
+#include <scene/culling.hpp>
+#include <vector>
+
+//! \cond NO_DOC
+
+static mango::axis_aligned_bounding_box make_box(const glm::vec3& min, const glm::vec3& max)
+{
+    mango::axis_aligned_bounding_box box;
+    box.min = min;
+    box.max = max;
+    return box;
+}
+
+static void add_random_boxes(mango::culling_volumes& volumes, mango::int32 count, mango::uint32 seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.1f, 4.0f);
+    volumes.reserve(count);
+    for (mango::int32 i = 0; i < count; ++i)
+    {
+        glm::vec3 min = glm::vec3(position(rng), position(rng), position(rng));
+        volumes.add(make_box(min, min + glm::vec3(size(rng), size(rng), size(rng))));
+    }
+}
+
+static mango::frustum make_frustum(const glm::vec3& eye, const glm::vec3& target)
+{
+    return mango::frustum_from_view_projection(glm::perspective(glm::radians(60.0f), 1.5f, 0.1f, 40.0f) * glm::lookAt(eye, target, GLOBAL_UP));
+}
+
+TEST(culling_test, boxes_outside_the_frustum_are_culled)
+{
+    glm::mat4 view_projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f) * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), GLOBAL_UP);
+    mango::frustum f          = mango::frustum_from_view_projection(view_projection);
+
+    ASSERT_TRUE(mango::is_visible(f, make_box(glm::vec3(-0.5f, -0.5f, -5.5f), glm::vec3(0.5f, 0.5f, -4.5f))));
+    ASSERT_TRUE(mango::is_visible(f, make_box(glm::vec3(4.0f, -0.5f, -5.5f), glm::vec3(6.0f, 0.5f, -4.5f))));     // intersecting the right plane
+    ASSERT_FALSE(mango::is_visible(f, make_box(glm::vec3(-0.5f, -0.5f, 4.5f), glm::vec3(0.5f, 0.5f, 5.5f))));     // behind
+    ASSERT_FALSE(mango::is_visible(f, make_box(glm::vec3(6.0f, -0.5f, -5.5f), glm::vec3(7.0f, 0.5f, -4.5f))));    // right
+    ASSERT_FALSE(mango::is_visible(f, make_box(glm::vec3(-0.5f, -0.5f, -12.0f), glm::vec3(0.5f, 0.5f, -11.0f)))); // beyond far
+
+    // Empty boxes are never culled.
+    ASSERT_TRUE(mango::is_visible(f, mango::axis_aligned_bounding_box()));
+}
+
+TEST(culling_test, transformed_bounds_enclose_the_transformed_box)
+{
+    mango::axis_aligned_bounding_box box = make_box(glm::vec3(0.0f), glm::vec3(1.0f, 2.0f, 3.0f));
+    glm::mat4 transformation             = glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, 0.0f));
+    transformation                       = glm::rotate(transformation, glm::radians(90.0f), GLOBAL_UP);
+
+    mango::axis_aligned_bounding_box result = mango::transform_bounds(box, transformation);
+    const float eps                         = 1e-5f;
+    ASSERT_NEAR(result.min.x, 10.0f, eps);
+    ASSERT_NEAR(result.max.x, 13.0f, eps);
+    ASSERT_NEAR(result.min.y, 0.0f, eps);
+    ASSERT_NEAR(result.max.y, 2.0f, eps);
+    ASSERT_NEAR(result.min.z, -1.0f, eps);
+    ASSERT_NEAR(result.max.z, 0.0f, eps);
+
+    ASSERT_FALSE(mango::is_valid(mango::transform_bounds(mango::axis_aligned_bounding_box(), transformation)));
+}
+
+TEST(culling_test, all_simd_levels_produce_the_same_visible_indices)
+{
+    mango::culling_volumes volumes;
+    add_random_boxes(volumes, 1021, 42); // not a multiple of the batch width
+    volumes.add(mango::axis_aligned_bounding_box());
+
+    mango::frustum frustums[] = { make_frustum(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f)), make_frustum(glm::vec3(10.0f, 5.0f, 0.0f), glm::vec3(20.0f, 0.0f, 5.0f)) };
+
+    std::vector<mango::int32> reference(volumes.size());
+    volumes.set_simd_level(mango::simd_level::scalar);
+    mango::int32 reference_count = volumes.cull(frustums, 2, reference.data());
+    ASSERT_GT(reference_count, 0);
+    ASSERT_LT(reference_count, volumes.size());
+    ASSERT_EQ(reference[reference_count - 1], volumes.size() - 1); // the empty box
+
+    const mango::simd_level levels[] = { mango::simd_level::sse, mango::simd_level::avx2 };
+    for (mango::simd_level level : levels)
+    {
+        std::vector<mango::int32> result(volumes.size());
+        volumes.set_simd_level(level);
+        mango::int32 count = volumes.cull(frustums, 2, result.data());
+        ASSERT_EQ(count, reference_count);
+        for (mango::int32 i = 0; i < count; ++i)
+            ASSERT_EQ(result[i], reference[i]);
+    }
+}
+
+TEST(culling_test, DISABLED_batch_culling_benchmark)
+{
+    const mango::int32 counts[] = { 10000, 100000, 1000000 };
+    const mango::int32 runs     = 10;
+    const char* names[]         = { "scalar", "sse", "avx2" };
+
+    mango::frustum f = make_frustum(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+    for (mango::int32 count : counts)
+    {
+        mango::culling_volumes volumes;
+        add_random_boxes(volumes, count, 1337);
+        std::vector<mango::int32> visible(count);
+
+        std::cout << "[ BENCHMARK] " << count << " boxes:";
+        for (mango::int32 l = 0; l <= static_cast<mango::int32>(mango::get_supported_simd_level()); ++l)
+        {
+            volumes.set_simd_level(static_cast<mango::simd_level>(l));
+            std::chrono::high_resolution_clock::duration time(0);
+            for (mango::int32 r = 0; r < runs; ++r)
+            {
+                auto start = std::chrono::high_resolution_clock::now();
+                volumes.cull(&f, 1, visible.data());
+                time += std::chrono::high_resolution_clock::now() - start;
+            }
+            std::cout << " " << names[l] << " " << std::chrono::duration_cast<std::chrono::microseconds>(time).count() / runs << " us";
+        }
+        std::cout << std::endl;
+    }
+}
+
+//! \endcond
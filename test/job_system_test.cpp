@@ -0,0 +1,128 @@
+//! \file      job_system_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include "mock_classes.hpp"
+#include <algorithm>
+#include <chrono>
+#include <core/job_system.hpp>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <memory>
+#include <rendering/render_system_impl.hpp>
+#include <scene/ecs_internal.hpp>
+#include <thread>
+#include <vector>
+
+//! \cond NO_DOC
+
+TEST(job_system_test, parallel_for_visits_every_index_once)
+{
+    mango::job_system jobs(3);
+    std::vector<mango::int32> visits(100003, 0);
+    jobs.parallel_for(static_cast<mango::int32>(visits.size()), 64, [&visits](mango::int32 begin, mango::int32 end) {
+        for (mango::int32 i = begin; i < end; ++i)
+            visits[i]++;
+    });
+    ASSERT_TRUE(std::all_of(visits.begin(), visits.end(), [](mango::int32 v) { return v == 1; }));
+
+    // Nested parallel_for calls from jobs help instead of blocking the workers.
+    std::atomic<mango::int32> total(0);
+    jobs.parallel_for(32, 1, [&jobs, &total](mango::int32 begin, mango::int32 end) {
+        for (mango::int32 i = begin; i < end; ++i)
+            jobs.parallel_for(100, 1, [&total](mango::int32 b, mango::int32 e) { total += e - b; });
+    });
+    ASSERT_EQ(total.load(), 3200);
+}
+
+TEST(job_system_test, background_threads_are_limited_across_calls)
+{
+    const mango::int32 limit = std::max(static_cast<mango::int32>(std::thread::hardware_concurrency()) / 2, 1);
+    std::atomic<mango::int32> running(0);
+    std::atomic<mango::int32> peak(0);
+    std::atomic<mango::int32> visits(0);
+    auto work = [&](mango::int32) {
+        mango::int32 now = ++running;
+        mango::int32 old = peak.load();
+        while (now > old && !peak.compare_exchange_weak(old, now))
+            ;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        --running;
+        ++visits;
+    };
+
+    // Four concurrent loads, every calling thread takes part in its own call.
+    std::vector<std::thread> loads;
+    for (mango::int32 i = 0; i < 4; ++i)
+        loads.emplace_back([&work]() { ASSERT_GE(mango::parallel_for_background(200, work), 1); });
+    for (std::thread& t : loads)
+        t.join();
+
+    ASSERT_EQ(visits.load(), 800);
+    ASSERT_LE(peak.load(), limit + 4);
+    ASSERT_EQ(mango::parallel_for_background(0, work), 1);
+}
+
+TEST(job_system_test, conflicting_systems_keep_their_order)
+{
+    mango::job_system jobs(3);
+    std::mutex mutex;
+    std::vector<mango::int32> order;
+    auto record = [&mutex, &order](mango::int32 id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(id);
+    };
+
+    const mango::uint32 transforms = mango::component_bit<mango::transform_component>();
+    const mango::uint32 meshes     = mango::component_bit<mango::mesh_primitive_component>();
+    const mango::uint32 cameras    = mango::component_bit<mango::camera_component>();
+    std::vector<mango::scheduled_system> systems = {
+        { { 0, transforms }, [&record]() { record(0); } },
+        { { transforms, meshes }, [&record]() { record(1); } },
+        { { transforms, cameras }, [&record]() { record(2); } },
+        { { meshes | cameras, transforms }, [&record]() { record(3); } },
+    };
+    mango::execute_systems(&jobs, systems);
+
+    ASSERT_EQ(order.size(), 4u);
+    ASSERT_EQ(order.front(), 0);
+    ASSERT_EQ(order.back(), 3);
+    ASSERT_FALSE(systems[1].access.conflicts_with(systems[2].access));
+    ASSERT_TRUE(systems[0].access.conflicts_with(systems[1].access));
+}
+
+TEST(job_system_test, DISABLED_transformation_update_benchmark)
+{
+    const mango::int32 count = 100000;
+    const mango::int32 runs  = 10;
+
+    mango::scene_component_pool<mango::transform_component> transformations(4096);
+    for (mango::entity e = 1; e <= static_cast<mango::entity>(count); ++e)
+        transformations.create_component_for(e).position = glm::vec3(static_cast<float>(e), 0.0f, 0.0f);
+
+    mango::int32 max_threads = static_cast<mango::int32>(glm::max(std::thread::hardware_concurrency(), 1u));
+    std::cout << "[ BENCHMARK] transformation update of " << count << " entities:";
+    for (mango::int32 threads = 1; threads <= max_threads; threads *= 2)
+    {
+        std::unique_ptr<mango::job_system> jobs(threads > 1 ? new mango::job_system(threads - 1) : nullptr);
+        mango::transformation_update_system transformation_update;
+        transformation_update.setup(jobs.get());
+
+        std::chrono::high_resolution_clock::duration time(0);
+        for (mango::int32 r = 0; r < runs; ++r)
+        {
+            for (mango::int32 i = 0; i < count; ++i)
+                transformations.component_at(i).changed = true;
+            auto start = std::chrono::high_resolution_clock::now();
+            transformation_update.execute(0.0f, transformations);
+            time += std::chrono::high_resolution_clock::now() - start;
+        }
+        ASSERT_EQ(transformations.component_at(count - 1).world_transformation_matrix[3][0], static_cast<float>(count));
+        std::cout << " " << threads << " threads " << std::chrono::duration_cast<std::chrono::microseconds>(time).count() / runs << " us";
+    }
+    std::cout << std::endl;
+}
+
+//! \endcond
@@ -0,0 +1,167 @@
+//! \file      scene_component_pool_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include "mock_classes.hpp"
+#include <algorithm>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+//! \cond NO_DOC
+
+TEST(scene_component_pool_test, lookups_stay_valid_after_removal)
+{
+    std::unique_ptr<mango::scene_component_pool<mango::transform_component>> pool(new mango::scene_component_pool<mango::transform_component>());
+    for (mango::entity e = 1; e <= 3000; ++e)
+        pool->create_component_for(e).position.x = static_cast<float>(e);
+
+    for (mango::entity e = 1; e <= 3000; e += 3)
+        pool->remove_component_from(e);
+    pool->sort_remove_component_from(3000);
+
+    ASSERT_EQ(pool->size(), 1999u);
+    for (mango::entity e = 1; e < 3000; ++e)
+    {
+        mango::transform_component* t = pool->get_component_for_entity(e, true);
+        ASSERT_EQ(pool->contains(e), (e - 1) % 3 != 0);
+        if (t)
+            ASSERT_EQ(t->position.x, static_cast<float>(e));
+    }
+    ASSERT_FALSE(pool->contains(3000));
+    ASSERT_FALSE(pool->contains(100000));
+}
+
+TEST(scene_component_pool_test, capacity_grows_and_shrinks_in_chunks)
+{
+    mango::scene_component_pool<mango::transform_component> pool(64);
+    ASSERT_EQ(pool.capacity(), 0);
+
+    mango::transform_component* first = &pool.create_component_for(1);
+    for (mango::entity e = 2; e <= 20000; ++e)
+        pool.create_component_for(e);
+    ASSERT_EQ(pool.capacity(), 20032);
+    ASSERT_EQ(first, pool.get_component_for_entity(1)); // chunks are stable
+
+    for (mango::entity e = 20000; e > 100; --e)
+        pool.remove_component_from(e);
+    ASSERT_LE(pool.capacity(), 100 + 2 * 64);
+    pool.shrink_to_fit();
+    ASSERT_EQ(pool.capacity(), 128);
+
+    mango::component_pool_memory_info info = pool.get_memory_info();
+    ASSERT_EQ(info.size, 100);
+    ASSERT_EQ(info.capacity, 128);
+    ASSERT_GE(info.allocated_bytes, static_cast<mango::int64>(128 * sizeof(mango::transform_component)));
+}
+
+TEST(scene_component_pool_test, join_visits_entities_in_all_pools)
+{
+    mango::scene_component_pool<mango::transform_component> transforms;
+    mango::scene_component_pool<mango::node_component> nodes;
+    mango::scene_component_pool<mango::tag_component> tags;
+    for (mango::entity e = 1; e <= 100; ++e)
+        transforms.create_component_for(e).position.x = static_cast<float>(e);
+    for (mango::entity e = 1; e <= 100; e += 2)
+        nodes.create_component_for(e);
+    for (mango::entity e = 1; e <= 100; e += 5)
+        tags.create_component_for(e);
+
+    mango::int32 count = 0;
+    mango::join(transforms, nodes, [&count](mango::entity e, mango::transform_component& t, mango::node_component&) {
+        ASSERT_EQ(t.position.x, static_cast<float>(e));
+        count++;
+    });
+    ASSERT_EQ(count, 50);
+
+    count = 0;
+    mango::join(transforms, nodes, tags, [&count](mango::entity e, mango::transform_component&, mango::node_component&, mango::tag_component&) {
+        ASSERT_EQ(e % 10, 1u);
+        count++;
+    });
+    ASSERT_EQ(count, 10);
+}
+
+TEST(scene_component_pool_test, DISABLED_component_join_benchmark)
+{
+    const mango::int32 count = 10000;
+    const mango::int32 runs  = 100;
+
+    std::unique_ptr<mango::scene_component_pool<mango::mesh_primitive_component>> meshes(new mango::scene_component_pool<mango::mesh_primitive_component>());
+    std::unique_ptr<mango::scene_component_pool<mango::material_component>> materials(new mango::scene_component_pool<mango::material_component>());
+    std::unique_ptr<mango::scene_component_pool<mango::transform_component>> transforms(new mango::scene_component_pool<mango::transform_component>());
+
+    // The pools are filled in different orders, like components added by different systems.
+    std::vector<mango::entity> entities(count);
+    for (mango::int32 i = 0; i < count; ++i)
+        entities[i] = static_cast<mango::entity>(i + 1);
+    std::mt19937 rng(1337);
+    std::shuffle(entities.begin(), entities.end(), rng);
+    for (mango::entity e : entities)
+        meshes->create_component_for(e).count = static_cast<mango::int32>(e);
+    std::shuffle(entities.begin(), entities.end(), rng);
+    for (mango::entity e : entities)
+        materials->create_component_for(e);
+    std::shuffle(entities.begin(), entities.end(), rng);
+    for (mango::entity e : entities)
+        transforms->create_component_for(e).world_transformation_matrix[3][0] = 1.0f;
+
+    // The hashed lookup the pools used before, as reference.
+    std::unordered_map<mango::entity, mango::int32> material_lookup;
+    std::unordered_map<mango::entity, mango::int32> transform_lookup;
+    for (mango::int32 i = 0; i < count; ++i)
+    {
+        material_lookup.insert({ materials->entity_at(i), i });
+        transform_lookup.insert({ transforms->entity_at(i), i });
+    }
+
+    std::chrono::high_resolution_clock::duration hashed_time(0);
+    std::chrono::high_resolution_clock::duration sparse_time(0);
+    std::chrono::high_resolution_clock::duration join_time(0);
+    float hashed_sum = 0.0f;
+    float sparse_sum = 0.0f;
+    float join_sum   = 0.0f;
+    for (mango::int32 r = 0; r < runs; ++r)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (mango::int32 i = 0; i < count; ++i)
+        {
+            mango::entity e                   = meshes->entity_at(i);
+            mango::material_component& mat    = materials->component_at(material_lookup.find(e)->second);
+            mango::transform_component& trafo = transforms->component_at(transform_lookup.find(e)->second);
+            hashed_sum += trafo.world_transformation_matrix[3][0] + (mat.component_material ? 1.0f : 0.0f);
+        }
+        hashed_time += std::chrono::high_resolution_clock::now() - start;
+
+        start = std::chrono::high_resolution_clock::now();
+        for (mango::int32 i = 0; i < count; ++i)
+        {
+            mango::entity e                   = meshes->entity_at(i);
+            mango::material_component* mat    = materials->get_component_for_entity(e);
+            mango::transform_component* trafo = transforms->get_component_for_entity(e);
+            sparse_sum += trafo->world_transformation_matrix[3][0] + (mat->component_material ? 1.0f : 0.0f);
+        }
+        sparse_time += std::chrono::high_resolution_clock::now() - start;
+
+        start = std::chrono::high_resolution_clock::now();
+        mango::join(*meshes, *materials, *transforms, [&join_sum](mango::entity, mango::mesh_primitive_component&, mango::material_component& mat, mango::transform_component& trafo) {
+            join_sum += trafo.world_transformation_matrix[3][0] + (mat.component_material ? 1.0f : 0.0f);
+        });
+        join_time += std::chrono::high_resolution_clock::now() - start;
+    }
+    ASSERT_EQ(hashed_sum, sparse_sum);
+    ASSERT_EQ(hashed_sum, join_sum);
+
+    std::cout << "[ BENCHMARK] mesh x material x transform join over " << count << " entities: hashed "
+              << std::chrono::duration_cast<std::chrono::microseconds>(hashed_time).count() / runs << " us, sparse "
+              << std::chrono::duration_cast<std::chrono::microseconds>(sparse_time).count() / runs << " us, join "
+              << std::chrono::duration_cast<std::chrono::microseconds>(join_time).count() / runs << " us" << std::endl;
+}
+
+//! \endcond
@@ -0,0 +1,184 @@
+//! \file      scene_systems_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include "mock_classes.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <rendering/render_system_impl.hpp>
+#include <scene/ecs_internal.hpp>
+#include <vector>
+
+//! \cond NO_DOC
+
+TEST(scene_systems_test, only_changed_subtrees_are_recomputed)
+{
+    mango::scene_component_pool<mango::transform_component> transformations;
+    mango::scene_component_pool<mango::node_component> nodes;
+    mango::transformation_update_system transformation_update;
+    mango::scene_graph_update_system scene_graph_update;
+
+    // 1 -> 2 -> 3 and 4 -> 5.
+    const mango::entity parents[] = { mango::invalid_entity, 1, 2, mango::invalid_entity, 4 };
+    for (mango::entity e = 1; e <= 5; ++e)
+        transformations.create_component_for(e).position = glm::vec3(1.0f, 0.0f, 0.0f);
+    for (mango::entity e = 5; e >= 1; --e) // children before parents in the pool
+        nodes.create_component_for(e).parent_entity = parents[e - 1];
+    for (mango::entity e = 2; e <= 5; ++e)
+    {
+        if (parents[e - 1] == mango::invalid_entity)
+            continue;
+        mango::node_component* parent = nodes.get_component_for_entity(parents[e - 1]);
+        parent->child_entities        = e;
+        parent->children_count        = 1;
+    }
+
+    std::vector<mango::hierarchy_node> hierarchy;
+    mango::build_hierarchy(nodes, hierarchy);
+    ASSERT_EQ(hierarchy.size(), 5u);
+    for (mango::int32 i = 0; i < static_cast<mango::int32>(hierarchy.size()); ++i)
+    {
+        ASSERT_LT(hierarchy[i].parent_index, i);
+        if (hierarchy[i].parent_index >= 0)
+            ASSERT_EQ(hierarchy[hierarchy[i].parent_index].node_entity, parents[hierarchy[i].node_entity - 1]);
+    }
+    ASSERT_EQ(hierarchy.back().node_entity, 3u); // the only node at depth two
+    scene_graph_update.setup(&hierarchy);
+
+    transformation_update.execute(0.0f, transformations);
+    scene_graph_update.execute(0.0f, nodes, transformations);
+    ASSERT_EQ(transformation_update.get_recomputed_count(), 5);
+    ASSERT_EQ(scene_graph_update.get_recomputed_count(), 3);
+    ASSERT_EQ(transformations.get_component_for_entity(3)->world_transformation_matrix[3][0], 3.0f);
+
+    transformation_update.execute(0.0f, transformations);
+    scene_graph_update.execute(0.0f, nodes, transformations);
+    ASSERT_EQ(transformation_update.get_recomputed_count() + scene_graph_update.get_recomputed_count(), 0);
+
+    mango::transform_component* changed = transformations.get_component_for_entity(2);
+    changed->position.x                 = 2.0f;
+    changed->changed                    = true;
+    transformation_update.execute(0.0f, transformations);
+    scene_graph_update.execute(0.0f, nodes, transformations);
+    ASSERT_EQ(transformation_update.get_recomputed_count(), 1);
+    ASSERT_EQ(scene_graph_update.get_recomputed_count(), 2); // 2 and its child 3
+    ASSERT_EQ(transformations.get_component_for_entity(3)->world_transformation_matrix[3][0], 4.0f);
+    ASSERT_FALSE(transformations.get_component_for_entity(5)->world_changed);
+}
+
+//! \brief Checks that every live entry of a \a flat_hierarchy is stored behind its parent and the indices match.
+static void expect_valid_hierarchy(mango::scene_component_pool<mango::node_component>& nodes, const mango::flat_hierarchy& hierarchy)
+{
+    mango::int32 live = 0;
+    for (mango::int32 i = 0; i < static_cast<mango::int32>(hierarchy.nodes.size()); ++i)
+    {
+        const mango::hierarchy_node& node = hierarchy.nodes[i];
+        if (node.node_entity == mango::invalid_entity)
+            continue;
+        live++;
+        ASSERT_EQ(hierarchy.indices.at(node.node_entity), i);
+        ASSERT_LT(node.parent_index, i);
+        const mango::entity parent = nodes.get_component_for_entity(node.node_entity)->parent_entity;
+        if (node.parent_index < 0)
+            ASSERT_EQ(parent, mango::invalid_entity);
+        else
+            ASSERT_EQ(hierarchy.nodes[node.parent_index].node_entity, parent);
+    }
+    ASSERT_EQ(live, static_cast<mango::int32>(nodes.size()));
+    ASSERT_EQ(live + hierarchy.removed_count, static_cast<mango::int32>(hierarchy.nodes.size()));
+}
+
+TEST(scene_systems_test, moved_subtrees_are_spliced_into_the_hierarchy)
+{
+    mango::scene_component_pool<mango::node_component> nodes;
+
+    // 1 -> (2 -> 4, 3) and 5 -> 6.
+    const mango::entity parents[] = { mango::invalid_entity, 1, 1, 2, mango::invalid_entity, 5 };
+    for (mango::entity e = 1; e <= 6; ++e)
+        nodes.create_component_for(e).parent_entity = parents[e - 1];
+    auto link = [&nodes](mango::entity parent, mango::entity first_child, mango::entity second_child, mango::int32 count) {
+        mango::node_component* node  = nodes.get_component_for_entity(parent);
+        mango::node_component* child = nodes.get_component_for_entity(first_child);
+        node->child_entities         = first_child;
+        node->children_count         = count;
+        child->parent_entity         = parent;
+        child->next_sibling          = second_child;
+        if (second_child != mango::invalid_entity)
+            nodes.get_component_for_entity(second_child)->previous_sibling = first_child;
+    };
+    link(1, 2, 3, 2);
+    link(2, 4, mango::invalid_entity, 1);
+    link(5, 6, mango::invalid_entity, 1);
+
+    mango::flat_hierarchy hierarchy;
+    mango::build_hierarchy(nodes, hierarchy);
+    expect_valid_hierarchy(nodes, hierarchy);
+
+    // Moving 2 with its child 4 between 1 and 6 only touches their two entries.
+    for (mango::int32 move = 0; move < 8; ++move)
+    {
+        mango::node_component* three = nodes.get_component_for_entity(3);
+        mango::node_component* six   = nodes.get_component_for_entity(6);
+        if (move % 2 == 0)
+        {
+            link(1, 3, mango::invalid_entity, 1);
+            three->previous_sibling = mango::invalid_entity;
+            link(6, 2, mango::invalid_entity, 1);
+        }
+        else
+        {
+            six->child_entities = mango::invalid_entity;
+            six->children_count = 0;
+            link(1, 2, 3, 2);
+        }
+
+        const mango::int32 removed = hierarchy.removed_count;
+        mango::splice_hierarchy(nodes, { 2 }, hierarchy);
+        expect_valid_hierarchy(nodes, hierarchy);
+        if (hierarchy.removed_count > 0)
+            ASSERT_EQ(hierarchy.removed_count, removed + 2);
+        ASSERT_LE(hierarchy.removed_count, static_cast<mango::int32>(hierarchy.nodes.size()) / 2);
+    }
+
+    // Removed nodes lose their entry, their children become roots.
+    nodes.get_component_for_entity(4)->parent_entity = mango::invalid_entity;
+    link(1, 3, mango::invalid_entity, 1);
+    nodes.get_component_for_entity(3)->previous_sibling = mango::invalid_entity;
+    nodes.remove_component_from(2);
+    mango::splice_hierarchy(nodes, { 4, 2 }, hierarchy);
+    expect_valid_hierarchy(nodes, hierarchy);
+    ASSERT_EQ(hierarchy.indices.count(2), 0u);
+}
+
+TEST(scene_systems_test, composed_transformations_match_glm)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> value(-2.0f, 2.0f);
+    for (mango::int32 i = 0; i < 100; ++i)
+    {
+        glm::vec3 position = glm::vec3(value(rng), value(rng), value(rng));
+        glm::quat rotation = glm::normalize(glm::quat(value(rng), value(rng), value(rng), value(rng)));
+        glm::vec3 scale    = glm::vec3(value(rng), value(rng), value(rng));
+        glm::mat4 local    = glm::scale(glm::translate(glm::mat4(1.0f), position) * glm::toMat4(rotation), scale);
+        glm::mat4 parent   = glm::rotate(glm::translate(glm::mat4(1.0f), scale), value(rng), position + glm::vec3(3.0f));
+
+        glm::mat4 composed = glm::mat4(mango::compose_transformation(position, rotation, scale));
+        glm::mat4 world    = glm::mat4(mango::multiply_transformations(glm::mat4x3(parent), glm::mat4x3(local)));
+        for (mango::int32 c = 0; c < 4; ++c)
+        {
+            for (mango::int32 r = 0; r < 4; ++r)
+            {
+                ASSERT_NEAR(composed[c][r], local[c][r], 1e-5f);
+                ASSERT_NEAR(world[c][r], (parent * local)[c][r], 1e-4f);
+            }
+        }
+    }
+    // The world transformation is stored as 3x4 matrix without the local one.
+    ASSERT_LE(sizeof(mango::transform_component), 96u);
+}
+
+//! \endcond
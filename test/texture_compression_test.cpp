@@ -0,0 +1,152 @@
+//! \file      texture_compression_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <gtest/gtest.h>
+#include <random>
+#include <resources/texture_compression.hpp>
+#include <vector>
+
+//! \cond NO_DOC
+
+static mango::uint32 read_bits(const mango::uint8* block, mango::int32& position, mango::int32 bits)
+{
+    mango::uint32 value = 0;
+    for (mango::int32 i = 0; i < bits; ++i, ++position)
+        value |= static_cast<mango::uint32>((block[position >> 3] >> (position & 7)) & 1) << i;
+    return value;
+}
+
+static void decode_bc7_mode6(const mango::uint8* block, mango::uint8* pixels)
+{
+    static const mango::int32 weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    mango::int32 position = 0;
+    ASSERT_EQ(read_bits(block, position, 7), 1u << 6);
+    mango::int32 endpoints[2][4];
+    for (mango::int32 c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = static_cast<mango::int32>(read_bits(block, position, 7));
+        endpoints[1][c] = static_cast<mango::int32>(read_bits(block, position, 7));
+    }
+    const mango::int32 p0 = static_cast<mango::int32>(read_bits(block, position, 1));
+    const mango::int32 p1 = static_cast<mango::int32>(read_bits(block, position, 1));
+    for (mango::int32 i = 0; i < 16; ++i)
+    {
+        const mango::int32 index = static_cast<mango::int32>(read_bits(block, position, i == 0 ? 3 : 4));
+        for (mango::int32 c = 0; c < 4; ++c)
+        {
+            const mango::int32 e0 = (endpoints[0][c] << 1) | p0;
+            const mango::int32 e1 = (endpoints[1][c] << 1) | p1;
+            pixels[i * 4 + c]     = static_cast<mango::uint8>(((64 - weights[index]) * e0 + weights[index] * e1 + 32) >> 6);
+        }
+    }
+    ASSERT_EQ(position, 128);
+}
+
+static void decode_bc4(const mango::uint8* block, mango::uint8* values)
+{
+    const mango::int32 r0 = block[0];
+    const mango::int32 r1 = block[1];
+    mango::int32 palette[8];
+    palette[0] = r0;
+    palette[1] = r1;
+    for (mango::int32 k = 2; k < 8; ++k)
+        palette[k] = r0 > r1 ? ((8 - k) * r0 + (k - 1) * r1) / 7 : (k < 6 ? ((6 - k) * r0 + (k - 1) * r1) / 5 : (k == 6 ? 0 : 255));
+    mango::uint64 bits = 0;
+    for (mango::int32 i = 0; i < 6; ++i)
+        bits |= static_cast<mango::uint64>(block[2 + i]) << (8 * i);
+    for (mango::int32 i = 0; i < 16; ++i)
+        values[i] = static_cast<mango::uint8>(palette[(bits >> (3 * i)) & 7]);
+}
+
+static std::vector<mango::uint8> make_gradient_block(mango::uint32 seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> value(0, 255);
+    std::uniform_int_distribution<int> noise(-3, 3);
+    const int start[4] = { value(rng), value(rng), value(rng), value(rng) };
+    const int end[4]   = { value(rng), value(rng), value(rng), value(rng) };
+    std::vector<mango::uint8> pixels(64);
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            const int v       = start[c] + (end[c] - start[c]) * i / 15 + noise(rng);
+            pixels[i * 4 + c] = static_cast<mango::uint8>(std::min(std::max(v, 0), 255));
+        }
+    }
+    return pixels;
+}
+
+TEST(texture_compression_test, bc7_blocks_decode_close_to_the_source)
+{
+    for (mango::uint32 seed = 0; seed < 200; ++seed)
+    {
+        std::vector<mango::uint8> pixels = make_gradient_block(seed);
+        mango::uint8 block[16];
+        mango::compress_bc7_block(pixels.data(), block);
+        mango::uint8 decoded[64];
+        decode_bc7_mode6(block, decoded);
+        for (int i = 0; i < 64; ++i)
+            ASSERT_NEAR(decoded[i], pixels[i], 12) << "seed " << seed << " value " << i;
+    }
+}
+
+TEST(texture_compression_test, bc7_uniform_blocks_are_nearly_exact)
+{
+    std::vector<mango::uint8> pixels(64);
+    for (int i = 0; i < 16; ++i)
+    {
+        pixels[i * 4 + 0] = 200;
+        pixels[i * 4 + 1] = 31;
+        pixels[i * 4 + 2] = 7;
+        pixels[i * 4 + 3] = 255;
+    }
+    mango::uint8 block[16];
+    mango::compress_bc7_block(pixels.data(), block);
+    mango::uint8 decoded[64];
+    decode_bc7_mode6(block, decoded);
+    for (int i = 0; i < 64; ++i)
+        ASSERT_NEAR(decoded[i], pixels[i], 1);
+}
+
+TEST(texture_compression_test, bc4_blocks_decode_close_to_the_source)
+{
+    for (mango::uint32 seed = 0; seed < 200; ++seed)
+    {
+        std::vector<mango::uint8> pixels = make_gradient_block(seed);
+        mango::uint8 block[8];
+        mango::compress_bc4_block(pixels.data(), 2, block);
+        mango::uint8 decoded[16];
+        decode_bc4(block, decoded);
+        for (int i = 0; i < 16; ++i)
+            ASSERT_NEAR(decoded[i], pixels[i * 4 + 2], 20) << "seed " << seed << " pixel " << i;
+    }
+}
+
+TEST(texture_compression_test, compressed_texture_contains_all_levels)
+{
+    const mango::int32 width  = 37;
+    const mango::int32 height = 10;
+    const mango::int32 levels = mango::calculate_mip_count(width, height);
+    ASSERT_EQ(levels, 6);
+
+    // 10 x 3 + 5 x 2 + 3 x 1 + 1 x 1 + 1 x 1 + 1 x 1 blocks.
+    EXPECT_EQ(mango::get_compressed_size(mango::texture_compression::bc7, width, height, levels), 46 * 16);
+    EXPECT_EQ(mango::get_compressed_size(mango::texture_compression::bc4, width, height, levels), 46 * 8);
+
+    std::vector<mango::uint8> pixels(width * height * 4, 128);
+    std::vector<mango::uint8> output(static_cast<size_t>(mango::get_compressed_size(mango::texture_compression::bc5, width, height, levels)) + 1, 0xcd);
+    mango::compress_texture(mango::texture_compression::bc5, pixels.data(), width, height, levels, false, output.data());
+    EXPECT_EQ(output.back(), 0xcd);
+
+    // The last level of a uniform image is still uniform.
+    mango::uint8 decoded[16];
+    decode_bc4(output.data() + output.size() - 1 - 16, decoded);
+    for (int i = 0; i < 16; ++i)
+        EXPECT_EQ(decoded[i], 128);
+}
+
+//! \endcond
@@ -0,0 +1,50 @@
+//! \file      vertex_quantization_test.cpp
+//! \author    Paul Himmler
+//! \version   1.0
+//! \date      2020
+//! \copyright Apache License 2.0
+
+#include <gtest/gtest.h>
+#include <resources/vertex_quantization.hpp>
+
+//! \cond NO_DOC
+
+static float unpack_snorm(mango::uint32 packed, mango::int32 shift, mango::int32 bits)
+{
+    const mango::int32 value = static_cast<mango::int32>(packed << (32 - shift - bits)) >> (32 - bits);
+    return std::max(static_cast<float>(value) / static_cast<float>((1 << (bits - 1)) - 1), -1.0f);
+}
+
+TEST(vertex_quantization_test, snorm_10_10_10_2_round_trips)
+{
+    const float values[] = { -1.0f, -0.7071f, -0.25f, 0.0f, 0.1f, 0.5f, 0.9999f, 1.0f };
+    for (float x : values)
+    {
+        for (float y : values)
+        {
+            const mango::uint32 packed = mango::pack_snorm_10_10_10_2(x, y, -x, 1.0f);
+            EXPECT_NEAR(unpack_snorm(packed, 0, 10), x, 1.0f / 1022.0f);
+            EXPECT_NEAR(unpack_snorm(packed, 10, 10), y, 1.0f / 1022.0f);
+            EXPECT_NEAR(unpack_snorm(packed, 20, 10), -x, 1.0f / 1022.0f);
+        }
+    }
+}
+
+TEST(vertex_quantization_test, snorm_10_10_10_2_keeps_the_tangent_sign)
+{
+    EXPECT_EQ(unpack_snorm(mango::pack_snorm_10_10_10_2(0.0f, 0.0f, 1.0f, 1.0f), 30, 2), 1.0f);
+    EXPECT_EQ(unpack_snorm(mango::pack_snorm_10_10_10_2(0.0f, 0.0f, 1.0f, -1.0f), 30, 2), -1.0f);
+    EXPECT_EQ(mango::pack_snorm_10_10_10_2(1.0f, 0.0f, 0.0f, 0.0f), 511u);
+    EXPECT_EQ(mango::pack_snorm_10_10_10_2(-1.0f, 0.0f, 0.0f, 0.0f), 513u);
+}
+
+TEST(vertex_quantization_test, unorm16_is_clamped_and_rounded)
+{
+    EXPECT_EQ(mango::quantize_unorm16(0.0f), 0);
+    EXPECT_EQ(mango::quantize_unorm16(1.0f), 65535);
+    EXPECT_EQ(mango::quantize_unorm16(-0.5f), 0);
+    EXPECT_EQ(mango::quantize_unorm16(2.0f), 65535);
+    EXPECT_EQ(mango::quantize_unorm16(0.5f), 32768);
+}
+
+//! \endcond